@@ -0,0 +1,46 @@
+; ModuleID = 'fib'
+source_filename = "fib"
+target datalayout = "e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-pc-linux-gnu"
+
+define i64 @fib(i64 %n, i64 %a, i64 %b) {
+entry:
+  %n1 = alloca i64, align 8
+  store i64 %n, i64* %n1, align 4
+  %a2 = alloca i64, align 8
+  store i64 %a, i64* %a2, align 4
+  %b3 = alloca i64, align 8
+  store i64 %b, i64* %b3, align 4
+  %load = load i64, i64* %n1, align 4
+  %eq = icmp eq i64 %load, 0
+  br i1 %eq, label %then, label %merge
+
+normal_return:                                    ; preds = %cleanup_entry
+  ret i64 0
+
+cleanup_entry:                                    ; No predecessors!
+  br label %normal_return
+
+then:                                             ; preds = %entry
+  %load4 = load i64, i64* %a2, align 4
+  ret i64 %load4
+
+merge:                                            ; preds = %entry
+  %load5 = load i64, i64* %n1, align 4
+  %eq6 = icmp eq i64 %load5, 1
+  br i1 %eq6, label %then7, label %merge8
+
+then7:                                            ; preds = %merge
+  %load9 = load i64, i64* %b3, align 4
+  ret i64 %load9
+
+merge8:                                           ; preds = %merge
+  %load10 = load i64, i64* %n1, align 4
+  %sub = sub i64 %load10, 1
+  %load11 = load i64, i64* %b3, align 4
+  %load12 = load i64, i64* %a2, align 4
+  %load13 = load i64, i64* %b3, align 4
+  %add = add i64 %load12, %load13
+  %call = call i64 @fib(i64 %sub, i64 %load11, i64 %add)
+  ret i64 %call
+}
@@ -0,0 +1,42 @@
+	.text
+	.file	"fib"
+	.globl	fib
+	.p2align	4, 0x90
+	.type	fib,@function
+fib:
+	.cfi_startproc
+	subq	$24, %rsp
+	.cfi_def_cfa_offset 32
+	movq	%rdi, 16(%rsp)
+	movq	%rsi, 8(%rsp)
+	movq	%rdx, (%rsp)
+	testq	%rdi, %rdi
+	je	.LBB0_3
+	cmpq	$1, 16(%rsp)
+	jne	.LBB0_2
+	movq	(%rsp), %rax
+	addq	$24, %rsp
+	.cfi_def_cfa_offset 8
+	retq
+.LBB0_3:
+	.cfi_def_cfa_offset 32
+	movq	8(%rsp), %rax
+	addq	$24, %rsp
+	.cfi_def_cfa_offset 8
+	retq
+.LBB0_2:
+	.cfi_def_cfa_offset 32
+	movq	16(%rsp), %rdi
+	addq	$-1, %rdi
+	movq	(%rsp), %rsi
+	movq	8(%rsp), %rdx
+	addq	%rsi, %rdx
+	callq	fib@PLT
+	addq	$24, %rsp
+	.cfi_def_cfa_offset 8
+	retq
+.Lfunc_end0:
+	.size	fib, .Lfunc_end0-fib
+	.cfi_endproc
+
+	.section	".note.GNU-stack","",@progbits
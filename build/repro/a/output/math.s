@@ -0,0 +1,139 @@
+	.text
+	.file	"math"
+	.globl	add
+	.p2align	4, 0x90
+	.type	add,@function
+add:
+	.cfi_startproc
+	movq	%rdi, -8(%rsp)
+	movq	%rsi, -16(%rsp)
+	leaq	(%rdi,%rsi), %rax
+	retq
+.Lfunc_end0:
+	.size	add, .Lfunc_end0-add
+	.cfi_endproc
+
+	.globl	subtract
+	.p2align	4, 0x90
+	.type	subtract,@function
+subtract:
+	.cfi_startproc
+	movq	%rdi, %rax
+	movq	%rdi, -8(%rsp)
+	movq	%rsi, -16(%rsp)
+	subq	%rsi, %rax
+	retq
+.Lfunc_end1:
+	.size	subtract, .Lfunc_end1-subtract
+	.cfi_endproc
+
+	.globl	multiply
+	.p2align	4, 0x90
+	.type	multiply,@function
+multiply:
+	.cfi_startproc
+	movq	%rdi, %rax
+	movq	%rdi, -8(%rsp)
+	movq	%rsi, -16(%rsp)
+	imulq	%rsi, %rax
+	retq
+.Lfunc_end2:
+	.size	multiply, .Lfunc_end2-multiply
+	.cfi_endproc
+
+	.globl	divide
+	.p2align	4, 0x90
+	.type	divide,@function
+divide:
+	.cfi_startproc
+	subq	$24, %rsp
+	.cfi_def_cfa_offset 32
+	movq	%rdi, 16(%rsp)
+	movq	%rsi, 8(%rsp)
+	testq	%rsi, %rsi
+	je	.LBB3_5
+	movq	16(%rsp), %rax
+	movq	8(%rsp), %rcx
+	movq	%rax, %rdx
+	orq	%rcx, %rdx
+	shrq	$32, %rdx
+	je	.LBB3_2
+	cqto
+	idivq	%rcx
+	addq	$24, %rsp
+	.cfi_def_cfa_offset 8
+	retq
+.LBB3_5:
+	.cfi_def_cfa_offset 32
+	leaq	.Lfmt(%rip), %rdi
+	leaq	.Lstr(%rip), %rsi
+	xorl	%eax, %eax
+	callq	printf@PLT
+	xorl	%eax, %eax
+	addq	$24, %rsp
+	.cfi_def_cfa_offset 8
+	retq
+.LBB3_2:
+	.cfi_def_cfa_offset 32
+	xorl	%edx, %edx
+	divl	%ecx
+	addq	$24, %rsp
+	.cfi_def_cfa_offset 8
+	retq
+.Lfunc_end3:
+	.size	divide, .Lfunc_end3-divide
+	.cfi_endproc
+
+	.globl	fibonacci
+	.p2align	4, 0x90
+	.type	fibonacci,@function
+fibonacci:
+	.cfi_startproc
+	pushq	%rax
+	.cfi_def_cfa_offset 16
+	movq	%rdi, (%rsp)
+	testq	%rdi, %rdi
+	js	.LBB4_1
+	movq	(%rsp), %rdi
+	movl	$1, %edx
+	xorl	%esi, %esi
+	callq	fib@PLT
+	popq	%rcx
+	.cfi_def_cfa_offset 8
+	retq
+.LBB4_1:
+	.cfi_def_cfa_offset 16
+	leaq	.Lfmt.2(%rip), %rdi
+	leaq	.Lstr.1(%rip), %rsi
+	xorl	%eax, %eax
+	callq	printf@PLT
+	xorl	%eax, %eax
+	popq	%rcx
+	.cfi_def_cfa_offset 8
+	retq
+.Lfunc_end4:
+	.size	fibonacci, .Lfunc_end4-fibonacci
+	.cfi_endproc
+
+	.type	.Lstr,@object
+	.section	.rodata.str1.1,"aMS",@progbits,1
+.Lstr:
+	.asciz	"(Division by zero error) "
+	.size	.Lstr, 26
+
+	.type	.Lfmt,@object
+.Lfmt:
+	.asciz	"%s"
+	.size	.Lfmt, 3
+
+	.type	.Lstr.1,@object
+.Lstr.1:
+	.asciz	"(Negative index error) "
+	.size	.Lstr.1, 24
+
+	.type	.Lfmt.2,@object
+.Lfmt.2:
+	.asciz	"%s"
+	.size	.Lfmt.2, 3
+
+	.section	".note.GNU-stack","",@progbits
@@ -0,0 +1,15 @@
+; ModuleID = 'main'
+source_filename = "main"
+target datalayout = "e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-pc-linux-gnu"
+
+define i64 @main() {
+entry:
+  ret i64 0
+
+normal_return:                                    ; preds = %cleanup_entry
+  ret i64 0
+
+cleanup_entry:                                    ; No predecessors!
+  br label %normal_return
+}
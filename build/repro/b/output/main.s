@@ -0,0 +1,14 @@
+	.text
+	.file	"main"
+	.globl	main
+	.p2align	4, 0x90
+	.type	main,@function
+main:
+	.cfi_startproc
+	xorl	%eax, %eax
+	retq
+.Lfunc_end0:
+	.size	main, .Lfunc_end0-main
+	.cfi_endproc
+
+	.section	".note.GNU-stack","",@progbits
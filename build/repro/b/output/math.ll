@@ -0,0 +1,118 @@
+; ModuleID = 'math'
+source_filename = "math"
+target datalayout = "e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-pc-linux-gnu"
+
+@str = private unnamed_addr constant [26 x i8] c"(Division by zero error) \00", align 1
+@fmt = private unnamed_addr constant [3 x i8] c"%s\00", align 1
+@str.1 = private unnamed_addr constant [24 x i8] c"(Negative index error) \00", align 1
+@fmt.2 = private unnamed_addr constant [3 x i8] c"%s\00", align 1
+
+declare i64 @fib(i64, i64, i64)
+
+define i64 @add(i64 %x, i64 %y) {
+entry:
+  %x1 = alloca i64, align 8
+  store i64 %x, i64* %x1, align 4
+  %y2 = alloca i64, align 8
+  store i64 %y, i64* %y2, align 4
+  %load = load i64, i64* %x1, align 4
+  %load3 = load i64, i64* %y2, align 4
+  %add = add i64 %load, %load3
+  ret i64 %add
+
+normal_return:                                    ; preds = %cleanup_entry
+  ret i64 0
+
+cleanup_entry:                                    ; No predecessors!
+  br label %normal_return
+}
+
+define i64 @subtract(i64 %x, i64 %y) {
+entry:
+  %x1 = alloca i64, align 8
+  store i64 %x, i64* %x1, align 4
+  %y2 = alloca i64, align 8
+  store i64 %y, i64* %y2, align 4
+  %load = load i64, i64* %x1, align 4
+  %load3 = load i64, i64* %y2, align 4
+  %sub = sub i64 %load, %load3
+  ret i64 %sub
+
+normal_return:                                    ; preds = %cleanup_entry
+  ret i64 0
+
+cleanup_entry:                                    ; No predecessors!
+  br label %normal_return
+}
+
+define i64 @multiply(i64 %x, i64 %y) {
+entry:
+  %x1 = alloca i64, align 8
+  store i64 %x, i64* %x1, align 4
+  %y2 = alloca i64, align 8
+  store i64 %y, i64* %y2, align 4
+  %load = load i64, i64* %x1, align 4
+  %load3 = load i64, i64* %y2, align 4
+  %mul = mul i64 %load, %load3
+  ret i64 %mul
+
+normal_return:                                    ; preds = %cleanup_entry
+  ret i64 0
+
+cleanup_entry:                                    ; No predecessors!
+  br label %normal_return
+}
+
+define i64 @divide(i64 %x, i64 %y) {
+entry:
+  %x1 = alloca i64, align 8
+  store i64 %x, i64* %x1, align 4
+  %y2 = alloca i64, align 8
+  store i64 %y, i64* %y2, align 4
+  %load = load i64, i64* %y2, align 4
+  %eq = icmp eq i64 %load, 0
+  br i1 %eq, label %then, label %merge
+
+normal_return:                                    ; preds = %cleanup_entry
+  ret i64 0
+
+cleanup_entry:                                    ; No predecessors!
+  br label %normal_return
+
+then:                                             ; preds = %entry
+  %0 = call i32 (i8*, ...) @printf(i8* getelementptr inbounds ([3 x i8], [3 x i8]* @fmt, i32 0, i32 0), i8* getelementptr inbounds ([26 x i8], [26 x i8]* @str, i32 0, i32 0))
+  ret i64 0
+
+merge:                                            ; preds = %entry
+  %load3 = load i64, i64* %x1, align 4
+  %load4 = load i64, i64* %y2, align 4
+  %div = sdiv i64 %load3, %load4
+  ret i64 %div
+}
+
+declare i32 @printf(i8*, ...)
+
+define i64 @fibonacci(i64 %n) {
+entry:
+  %n1 = alloca i64, align 8
+  store i64 %n, i64* %n1, align 4
+  %load = load i64, i64* %n1, align 4
+  %lt = icmp slt i64 %load, 0
+  br i1 %lt, label %then, label %merge
+
+normal_return:                                    ; preds = %cleanup_entry
+  ret i64 0
+
+cleanup_entry:                                    ; No predecessors!
+  br label %normal_return
+
+then:                                             ; preds = %entry
+  %0 = call i32 (i8*, ...) @printf(i8* getelementptr inbounds ([3 x i8], [3 x i8]* @fmt.2, i32 0, i32 0), i8* getelementptr inbounds ([24 x i8], [24 x i8]* @str.1, i32 0, i32 0))
+  ret i64 0
+
+merge:                                            ; preds = %entry
+  %load2 = load i64, i64* %n1, align 4
+  %call = call i64 @fib(i64 %load2, i64 0, i64 1)
+  ret i64 %call
+}
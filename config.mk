@@ -1,13 +1,13 @@
 # config.mk
 
 CC       = gcc
-CFLAGS   = -Wall -Wextra -std=c17 -O2
-LDFLAGS  =
+CFLAGS   = -Wall -Wextra -std=c17 -O2 -pthread
+LDFLAGS  = -pthread
 INCLUDES = -Isrc
 
 # LLVM configuration
 LLVM_CFLAGS := $(shell llvm-config --cflags)
-LLVM_LDFLAGS := $(shell llvm-config --ldflags --system-libs --libs core analysis bitwriter target)
+LLVM_LDFLAGS := $(shell llvm-config --ldflags --system-libs --libs core analysis bitreader bitwriter linker passes target)
 
 # Add LLVM flags to existing flags
 override CFLAGS += $(LLVM_CFLAGS)
@@ -3,7 +3,7 @@
 AstNode *create_preprocessor_node(ArenaAllocator *arena, NodeType type,
                                   NodeCategory category, size_t line,
                                   size_t column) {
-  AstNode *node = arena_alloc(arena, sizeof(AstNode), alignof(AstNode));
+  AstNode *node = arena_alloc_fast(arena, sizeof(AstNode));
   if (!node)
     return NULL;
 
@@ -17,7 +17,7 @@ AstNode *create_preprocessor_node(ArenaAllocator *arena, NodeType type,
 
 AstNode *create_ast_node(ArenaAllocator *arena, NodeType type,
                          NodeCategory category, size_t line, size_t column) {
-  AstNode *node = arena_alloc(arena, sizeof(AstNode), alignof(AstNode));
+  AstNode *node = arena_alloc_fast(arena, sizeof(AstNode));
   if (!node)
     return NULL;
 
@@ -31,7 +31,7 @@ AstNode *create_ast_node(ArenaAllocator *arena, NodeType type,
 
 AstNode *create_expr_node(ArenaAllocator *arena, NodeType type, size_t line,
                           size_t column) {
-  AstNode *node = arena_alloc(arena, sizeof(AstNode), alignof(AstNode));
+  AstNode *node = arena_alloc_fast(arena, sizeof(AstNode));
   if (!node)
     return NULL;
   node->type = type;
@@ -43,7 +43,7 @@ AstNode *create_expr_node(ArenaAllocator *arena, NodeType type, size_t line,
 
 AstNode *create_stmt_node(ArenaAllocator *arena, NodeType type, size_t line,
                           size_t column) {
-  AstNode *node = arena_alloc(arena, sizeof(AstNode), alignof(AstNode));
+  AstNode *node = arena_alloc_fast(arena, sizeof(AstNode));
   if (!node)
     return NULL;
   node->type = type;
@@ -55,7 +55,7 @@ AstNode *create_stmt_node(ArenaAllocator *arena, NodeType type, size_t line,
 
 AstNode *create_type_node(ArenaAllocator *arena, NodeType type, size_t line,
                           size_t column) {
-  AstNode *node = arena_alloc(arena, sizeof(AstNode), alignof(AstNode));
+  AstNode *node = arena_alloc_fast(arena, sizeof(AstNode));
   if (!node)
     return NULL;
   node->type = type;
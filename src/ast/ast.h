@@ -33,6 +33,7 @@ typedef enum {
   AST_EXPR_FREE,
   AST_EXPR_CAST,
   AST_EXPR_SIZEOF,
+  AST_EXPR_ERROR,      // Placeholder for an expression that failed to parse
 
   // Statement nodes
   AST_PROGRAM,             // Program root node
@@ -51,6 +52,7 @@ typedef enum {
   AST_STMT_STRUCT,         // Struct declarations
   AST_STMT_FIELD_DECL,     // Field declarations (for structs)
   AST_STMT_DEFER,          // Defer statements
+  AST_STMT_ERROR,          // Placeholder for a statement that failed to parse
 
   // Type nodes
   AST_TYPE_BASIC,    // Basic types (int, float, string, etc.)
@@ -66,6 +68,7 @@ typedef enum {
   LITERAL_IDENT,
   LITERAL_INT,
   LITERAL_FLOAT,
+  LITERAL_DOUBLE, // Number with an f64 suffix
   LITERAL_STRING,
   LITERAL_CHAR,
   LITERAL_BOOL,
@@ -116,6 +119,17 @@ typedef enum {
   Node_Category_PREPROCESSOR
 } NodeCategory;
 
+// Function body skipped by the parser in skim mode. The tokens are kept so
+// the body can be parsed when it is first needed (see parse_deferred_body),
+// and stay after that: func_decl.body is NULL until the body is parsed, and
+// can be dropped again to reparse it later (luma watch)
+typedef struct {
+  const void *tokens;    // Token * to the body's '{'
+  size_t token_count;    // Tokens up to and including the matching '}'
+  const char *source;    // Source text the tokens point into
+  const char *file_path; // For diagnostics
+} DeferredBody;
+
 // Base AST node structure
 struct AstNode {
   NodeType type;
@@ -324,6 +338,11 @@ struct AstNode {
           AstNode *return_type; // Changed from Type* to AstNode*
           bool is_public;
           AstNode *body; // Changed from Stmt* to AstNode*
+          DeferredBody *deferred; // Body tokens in skim mode, else NULL
+          bool reuse_object; // Incremental build: body unchanged, link the
+                             // object cached by the last build instead
+          bool is_extern;      // C function: declared here, defined elsewhere
+          const char *library; // Extern: library to link it from, or NULL
         } func_decl;
 
         // If statement
@@ -479,6 +498,7 @@ AstNode *create_cast_expr(ArenaAllocator *arena, Expr *type, Expr *castee,
                           size_t line, size_t col);
 AstNode *create_sizeof_expr(ArenaAllocator *arena, Expr *object, bool is_type, size_t line,
                             size_t col);
+AstNode *create_error_expr(ArenaAllocator *arena, size_t line, size_t col);
 
 // Statement creation macros
 AstNode *create_program_node(ArenaAllocator *arena, AstNode **statements,
@@ -531,6 +551,7 @@ AstNode *create_break_continue_stmt(ArenaAllocator *arena, bool is_continue,
                                     size_t line, size_t column);
 AstNode *create_defer_stmt(ArenaAllocator *arena, AstNode *statement,
                             size_t line, size_t column);  
+AstNode *create_error_stmt(ArenaAllocator *arena, size_t line, size_t column);
 
 // Type creation macros
 AstNode *create_basic_type(ArenaAllocator *arena, const char *name, size_t line,
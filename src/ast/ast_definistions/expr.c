@@ -22,6 +22,7 @@ AstNode *create_literal_expr(ArenaAllocator *arena, LiteralType lit_type,
     node->expr.literal.value.int_val = *(long long *)value;
     break;
   case LITERAL_FLOAT:
+  case LITERAL_DOUBLE:
     node->expr.literal.value.float_val = *(double *)value;
     break;
   case LITERAL_STRING:
@@ -184,3 +185,7 @@ AstNode *create_sizeof_expr(ArenaAllocator *arena, Expr *object, bool is_type,
   node->expr.size_of.is_type = is_type;
   return node;
 }
+
+AstNode *create_error_expr(ArenaAllocator *arena, size_t line, size_t col) {
+  return create_expr(arena, AST_EXPR_ERROR, line, col);
+}
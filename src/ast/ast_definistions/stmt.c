@@ -43,6 +43,10 @@ AstNode *create_func_decl_stmt(ArenaAllocator *arena, const char *name,
   node->stmt.func_decl.return_type = return_type;
   node->stmt.func_decl.is_public = is_public;
   node->stmt.func_decl.body = body;
+  node->stmt.func_decl.deferred = NULL;
+  node->stmt.func_decl.reuse_object = false;
+  node->stmt.func_decl.is_extern = false;
+  node->stmt.func_decl.library = NULL;
   return node;
 }
 
@@ -171,3 +175,7 @@ AstNode *create_defer_stmt(ArenaAllocator *arena, AstNode *statement,
   node->stmt.defer_stmt.statement = statement;
   return node;
 }
+
+AstNode *create_error_stmt(ArenaAllocator *arena, size_t line, size_t column) {
+  return create_stmt_node(arena, AST_STMT_ERROR, line, column);
+}
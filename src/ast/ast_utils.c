@@ -52,6 +52,8 @@ const char *node_type_to_string(NodeType type) {
     return "ALLOC";
   case AST_EXPR_FREE:
     return "FREE";
+  case AST_EXPR_ERROR:
+    return "ErrorExpr";
   case AST_STMT_EXPRESSION:
     return "ExprStmt";
   case AST_STMT_VAR_DECL:
@@ -82,6 +84,8 @@ const char *node_type_to_string(NodeType type) {
     return "Defer";
   case AST_STMT_FIELD_DECL:
     return "FieldDecl";
+  case AST_STMT_ERROR:
+    return "ErrorStmt";
   case AST_TYPE_BASIC:
     return "TypeBasic";
   case AST_TYPE_POINTER:
@@ -177,6 +181,8 @@ const char *literal_type_to_string(LiteralType type) {
     return "int";
   case LITERAL_FLOAT:
     return "float";
+  case LITERAL_DOUBLE:
+    return "double";
   case LITERAL_STRING:
     return "string";
   case LITERAL_CHAR:
@@ -331,6 +337,7 @@ void print_ast(const AstNode *node, const char *prefix, bool is_last,
       printf(GREEN("%lld\n"), node->expr.literal.value.int_val);
       break;
     case LITERAL_FLOAT:
+    case LITERAL_DOUBLE:
       printf(GREEN("%f\n"), node->expr.literal.value.float_val);
       break;
     case LITERAL_STRING:
@@ -666,7 +673,13 @@ void print_ast(const AstNode *node, const char *prefix, bool is_last,
       print_prefix(next_prefix, true);
       printf(GRAY("<no return type>\n"));
     }
-    print_ast(node->stmt.func_decl.body, next_prefix, true, false);
+    if (!node->stmt.func_decl.body && node->stmt.func_decl.deferred) {
+      print_prefix(next_prefix, true);
+      printf(GRAY("<body not parsed yet: %zu tokens>\n"),
+             node->stmt.func_decl.deferred->token_count);
+    } else {
+      print_ast(node->stmt.func_decl.body, next_prefix, true, false);
+    }
     break;
 
   case AST_STMT_ENUM:
@@ -857,6 +870,12 @@ void print_ast(const AstNode *node, const char *prefix, bool is_last,
     }
     break;
 
+  case AST_EXPR_ERROR:
+  case AST_STMT_ERROR:
+    print_prefix(next_prefix, true);
+    printf(GRAY("<syntax error>\n"));
+    break;
+
   default:
     print_prefix(next_prefix, true);
     printf(GRAY("No specific print logic for this node type.\n"));
@@ -0,0 +1,280 @@
+/**
+ * @file module_graph.c
+ * @brief Module dependency graph, cycle detection and wave scheduling.
+ *
+ * @see module_graph.h
+ */
+
+#include "module_graph.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+size_t module_graph_find(const ModuleGraph *graph, const char *name) {
+  for (size_t i = 0; i < graph->count; i++) {
+    if (strcmp(graph->nodes[i].name, name) == 0) {
+      return i;
+    }
+  }
+  return graph->count;
+}
+
+/**
+ * @brief Resolve a module's `@use` directives into dependency indices
+ */
+static bool module_graph_link(ModuleGraph *graph, size_t index,
+                              ArenaAllocator *arena) {
+  ModuleGraphNode *node = &graph->nodes[index];
+  AstNode **body = node->module->preprocessor.module.body;
+  size_t body_count = node->module->preprocessor.module.body_count;
+
+  size_t use_count = 0;
+  for (size_t i = 0; i < body_count; i++) {
+    if (body[i] && body[i]->type == AST_PREPROCESSOR_USE) {
+      use_count++;
+    }
+  }
+
+  node->deps = NULL;
+  node->dep_count = 0;
+  if (use_count == 0) {
+    return true;
+  }
+
+  node->deps = arena_alloc(arena, use_count * sizeof(size_t), alignof(size_t));
+  if (!node->deps) {
+    return false;
+  }
+
+  bool ok = true;
+  for (size_t i = 0; i < body_count; i++) {
+    if (!body[i] || body[i]->type != AST_PREPROCESSOR_USE) {
+      continue;
+    }
+
+    const char *used = body[i]->preprocessor.use.module_name;
+    size_t dep = module_graph_find(graph, used);
+    if (dep == graph->count) {
+      fprintf(stderr, "Error: Module '%s' uses unknown module '%s' at line "
+                      "%zu\n",
+              node->name, used, body[i]->line);
+      ok = false;
+      continue;
+    }
+
+    // The same module may be imported under several aliases
+    bool seen = false;
+    for (size_t d = 0; d < node->dep_count; d++) {
+      seen = seen || node->deps[d] == dep;
+    }
+    if (!seen) {
+      node->deps[node->dep_count++] = dep;
+    }
+  }
+
+  return ok;
+}
+
+/**
+ * @brief Print one dependency cycle among the modules left unscheduled
+ */
+static void module_graph_report_cycle(const ModuleGraph *graph,
+                                      const bool *scheduled) {
+  size_t start = 0;
+  while (scheduled[start]) {
+    start++;
+  }
+
+  // Walk unscheduled dependencies until a module repeats; every unscheduled
+  // module has at least one, so the walk always closes a loop
+  size_t *path = malloc(graph->count * sizeof(size_t));
+  size_t *position = malloc(graph->count * sizeof(size_t));
+  if (!path || !position) {
+    fprintf(stderr, "Error: Circular module dependency\n");
+    free(path);
+    free(position);
+    return;
+  }
+  for (size_t i = 0; i < graph->count; i++) {
+    position[i] = graph->count;
+  }
+
+  size_t length = 0;
+  size_t current = start;
+  while (position[current] == graph->count) {
+    position[current] = length;
+    path[length++] = current;
+
+    const ModuleGraphNode *node = &graph->nodes[current];
+    for (size_t d = 0; d < node->dep_count; d++) {
+      if (!scheduled[node->deps[d]]) {
+        current = node->deps[d];
+        break;
+      }
+    }
+  }
+
+  fprintf(stderr, "Error: Circular module dependency: ");
+  for (size_t i = position[current]; i < length; i++) {
+    fprintf(stderr, "%s -> ", graph->nodes[path[i]].name);
+  }
+  fprintf(stderr, "%s\n", graph->nodes[current].name);
+
+  free(path);
+  free(position);
+}
+
+/**
+ * @brief Kahn's algorithm, one wave (in-degree frontier) at a time
+ */
+static bool module_graph_sort(ModuleGraph *graph, ArenaAllocator *arena) {
+  size_t n = graph->count;
+  graph->order = arena_alloc(arena, n * sizeof(size_t), alignof(size_t));
+  graph->wave_start =
+      arena_alloc(arena, (n + 1) * sizeof(size_t), alignof(size_t));
+  size_t *pending = arena_alloc(arena, n * sizeof(size_t), alignof(size_t));
+  bool *scheduled = arena_alloc(arena, n * sizeof(bool), alignof(bool));
+  if (!graph->order || !graph->wave_start || !pending || !scheduled) {
+    return false;
+  }
+
+  for (size_t i = 0; i < n; i++) {
+    pending[i] = graph->nodes[i].dep_count;
+    scheduled[i] = false;
+  }
+
+  size_t done = 0;
+  graph->wave_count = 0;
+  while (done < n) {
+    size_t wave_begin = done;
+    for (size_t i = 0; i < n; i++) {
+      if (!scheduled[i] && pending[i] == 0) {
+        graph->order[done++] = i;
+      }
+    }
+    if (done == wave_begin) {
+      module_graph_report_cycle(graph, scheduled);
+      return false;
+    }
+
+    graph->wave_start[graph->wave_count] = wave_begin;
+    for (size_t k = wave_begin; k < done; k++) {
+      size_t i = graph->order[k];
+      scheduled[i] = true;
+      graph->nodes[i].wave = graph->wave_count;
+    }
+    graph->wave_count++;
+
+    // Release dependents only after the whole wave is picked, so a module is
+    // never placed in the same wave as something it uses
+    for (size_t i = 0; i < n; i++) {
+      if (scheduled[i]) {
+        continue;
+      }
+      for (size_t d = 0; d < graph->nodes[i].dep_count; d++) {
+        size_t dep = graph->nodes[i].deps[d];
+        if (scheduled[dep] &&
+            graph->nodes[dep].wave == graph->wave_count - 1) {
+          pending[i]--;
+        }
+      }
+    }
+  }
+  graph->wave_start[graph->wave_count] = n;
+
+  return true;
+}
+
+bool module_graph_build(ModuleGraph *graph, AstNode **modules, size_t count,
+                        ArenaAllocator *arena) {
+  graph->nodes = NULL;
+  graph->count = 0;
+  graph->order = NULL;
+  graph->wave_start = NULL;
+  graph->wave_count = 0;
+
+  graph->nodes = arena_alloc(arena, count * sizeof(ModuleGraphNode),
+                             alignof(ModuleGraphNode));
+  if (!graph->nodes) {
+    return false;
+  }
+
+  bool ok = true;
+  for (size_t i = 0; i < count; i++) {
+    if (!modules[i] || modules[i]->type != AST_PREPROCESSOR_MODULE) {
+      continue;
+    }
+
+    const char *name = modules[i]->preprocessor.module.name;
+    if (module_graph_find(graph, name) != graph->count) {
+      fprintf(stderr, "Error: Module '%s' is defined more than once\n", name);
+      ok = false;
+      continue;
+    }
+
+    ModuleGraphNode *node = &graph->nodes[graph->count++];
+    node->module = modules[i];
+    node->name = name;
+    node->deps = NULL;
+    node->dep_count = 0;
+    node->wave = 0;
+  }
+
+  for (size_t i = 0; i < graph->count; i++) {
+    ok = module_graph_link(graph, i, arena) && ok;
+  }
+
+  return ok && module_graph_sort(graph, arena);
+}
+
+typedef struct {
+  ModuleGraphTask task;
+  void *arg;
+  size_t node;
+  bool ok;
+} WaveTask;
+
+static void module_graph_wave_task(void *arg, size_t worker) {
+  WaveTask *wave_task = (WaveTask *)arg;
+  wave_task->ok = wave_task->task(wave_task->arg, wave_task->node, worker);
+}
+
+bool module_graph_run_waves(const ModuleGraph *graph, ThreadPool *pool,
+                            ModuleGraphTask task, void *arg) {
+  if (graph->count == 0) {
+    return true;
+  }
+
+  WaveTask *tasks = malloc(graph->count * sizeof(WaveTask));
+  if (!tasks) {
+    fprintf(stderr, "Out of memory while scheduling modules\n");
+    return false;
+  }
+
+  // Every module of a failing wave still runs so all of its errors are
+  // reported, but nothing that depends on the wave is started
+  bool ok = true;
+  for (size_t w = 0; ok && w < graph->wave_count; w++) {
+    for (size_t k = graph->wave_start[w]; k < graph->wave_start[w + 1]; k++) {
+      tasks[k] = (WaveTask){task, arg, graph->order[k], false};
+      if (!pool) {
+        module_graph_wave_task(&tasks[k], 0);
+      } else if (!thread_pool_submit(pool, module_graph_wave_task,
+                                     &tasks[k])) {
+        fprintf(stderr, "Out of memory while scheduling module '%s'\n",
+                graph->nodes[graph->order[k]].name);
+      }
+    }
+    if (pool) {
+      thread_pool_wait(pool);
+    }
+
+    for (size_t k = graph->wave_start[w]; k < graph->wave_start[w + 1]; k++) {
+      ok = ok && tasks[k].ok;
+    }
+  }
+
+  free(tasks);
+  return ok;
+}
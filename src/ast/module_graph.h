@@ -0,0 +1,88 @@
+/**
+ * @file module_graph.h
+ * @brief Module dependency graph built from `@use` directives.
+ *
+ * After parsing, every module is a node and every `@use "name"` inside it is
+ * an edge to the module it names. The graph is checked for unknown modules,
+ * duplicate module names and cycles, then split into topological waves:
+ *
+ * - wave 0 holds the modules that use nothing
+ * - wave N holds the modules whose deepest dependency is in wave N-1
+ *
+ * Modules in the same wave never depend on each other, so a whole wave can be
+ * handed to the thread pool at once; module_graph_run_waves() runs the waves
+ * in order with a barrier between them.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "../c_libs/memory/memory.h"
+#include "../c_libs/thread/thread_pool.h"
+#include "ast.h"
+
+/**
+ * @brief One module and the modules it depends on.
+ */
+typedef struct {
+  AstNode *module;   /**< AST_PREPROCESSOR_MODULE node */
+  const char *name;  /**< Module name from `@module` */
+  size_t *deps;      /**< Indices of the modules named by its `@use`s */
+  size_t dep_count;  /**< Number of distinct dependencies */
+  size_t wave;       /**< Wave the module is scheduled in */
+} ModuleGraphNode;
+
+/**
+ * @brief Acyclic module graph in topological wave order.
+ */
+typedef struct {
+  ModuleGraphNode *nodes; /**< Nodes in the order the modules were given */
+  size_t count;           /**< Number of modules */
+  size_t *order;          /**< Node indices sorted by wave */
+  size_t *wave_start;     /**< Wave w is order[wave_start[w]..wave_start[w+1]) */
+  size_t wave_count;      /**< Number of waves */
+} ModuleGraph;
+
+/**
+ * @brief Task run for one module of a wave.
+ * @param arg User pointer passed to module_graph_run_waves().
+ * @param node Index of the module in graph->nodes.
+ * @param worker Index of the pool worker running the task.
+ * @return false to stop scheduling after the current wave.
+ */
+typedef bool (*ModuleGraphTask)(void *arg, size_t node, size_t worker);
+
+/**
+ * @brief Builds the dependency graph of a set of parsed modules.
+ *
+ * Reports unknown modules, duplicate module names and dependency cycles on
+ * stderr.
+ *
+ * @param graph Graph to fill in.
+ * @param modules AST_PREPROCESSOR_MODULE nodes; other node types are ignored.
+ * @param count Number of entries in @p modules.
+ * @param arena Arena for the graph's arrays.
+ * @return true if the graph is complete and acyclic.
+ */
+bool module_graph_build(ModuleGraph *graph, AstNode **modules, size_t count,
+                        ArenaAllocator *arena);
+
+/**
+ * @brief Finds a module by name.
+ * @return Index into graph->nodes, or graph->count if there is none.
+ */
+size_t module_graph_find(const ModuleGraph *graph, const char *name);
+
+/**
+ * @brief Runs @p task for every module, one wave at a time.
+ *
+ * Every module of a wave is submitted to @p pool before waiting for the wave
+ * to drain; a NULL pool runs the tasks inline in topological order. Waves
+ * after the first one with a failing task are not started.
+ *
+ * @return true if every task returned true.
+ */
+bool module_graph_run_waves(const ModuleGraph *graph, ThreadPool *pool,
+                            ModuleGraphTask task, void *arg);
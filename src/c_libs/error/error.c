@@ -7,6 +7,7 @@
  * with color highlighting.
  */
 
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
@@ -19,6 +20,9 @@
 #define MAX_ERRORS 256
 static ErrorInformation error_list[MAX_ERRORS];
 static int error_count = 0;
+// Deferred function bodies are parsed on pool workers, so errors can be added
+// from several threads at once
+static pthread_mutex_t error_lock = PTHREAD_MUTEX_INITIALIZER;
 
 /**
  * @brief Generates the full source line text for a given line number.
@@ -72,14 +76,34 @@ const char *generate_line(ArenaAllocator *arena, Token *tokens, int token_count,
 /**
  * @brief Adds an error to the internal error list.
  *
- * If the list is full (>= MAX_ERRORS), the error is ignored.
+ * If the list is full (>= MAX_ERRORS), the error is ignored. Safe to call
+ * from several threads.
  *
  * @param err The ErrorInformation to add.
  */
 void error_add(ErrorInformation err) {
+    pthread_mutex_lock(&error_lock);
     if (error_count < MAX_ERRORS) {
         error_list[error_count++] = err;
     }
+    pthread_mutex_unlock(&error_lock);
+}
+
+/**
+ * @brief Returns the number of accumulated errors.
+ */
+int error_count_get(void) {
+    return error_count;
+}
+
+/**
+ * @brief Returns the error at @p index, or NULL if there is none.
+ */
+const ErrorInformation *error_get(int index) {
+    if (index < 0 || index >= error_count) {
+        return NULL;
+    }
+    return &error_list[index];
 }
 
 /**
@@ -77,6 +77,25 @@ void error_add(ErrorInformation err);
  */
 bool error_report(void);
 
+/**
+ * @brief Number of errors added since the last error_clear().
+ *
+ * Lets a caller tell whether a phase produced errors without printing them,
+ * so diagnostics from several files can be reported together.
+ */
+int error_count_get(void);
+
+/**
+ * @brief Returns one of the errors added since the last error_clear().
+ *
+ * For tools that present errors themselves instead of printing them, such
+ * as the language server.
+ *
+ * @param index 0-based, below error_count_get().
+ * @return The error, or NULL if @p index is out of range.
+ */
+const ErrorInformation *error_get(int index);
+
 /**
  * @brief Clears all accumulated errors.
  *
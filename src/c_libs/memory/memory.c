@@ -169,6 +169,8 @@ int arena_allocator_init(ArenaAllocator *arena, size_t initial_size) {
 static Buffer *arena_add_buffer(ArenaAllocator *arena, size_t min_size) {
   size_t buffer_size =
       calculate_next_buffer_size(arena->next_buffer_size, min_size);
+  // Requests above the per-buffer cap still need a buffer that fits them.
+  buffer_size = max_size(buffer_size, min_size);
 
   Buffer *new_buffer = buffer_create(buffer_size, 1024);
   if (!new_buffer) {
@@ -215,10 +217,16 @@ void *arena_alloc(ArenaAllocator *arena, size_t size, size_t alignment) {
     alignment = alignof(max_align_t);
 
   if (size > ARENA_MAX_BUFFER_SIZE / 4) {
-    Buffer *dedicated_buffer = arena_add_buffer(arena, size);
+    Buffer *dedicated_buffer = buffer_create(size, 1024);
     if (!dedicated_buffer)
       return NULL;
 
+    // Dedicated buffers are fully used, so link them in front of the chain
+    // where the bump pointer will never walk into them (until a reset).
+    dedicated_buffer->next = arena->head;
+    arena->head = dedicated_buffer;
+    arena->total_allocated += size;
+
     // Zero out the allocated memory
     memset(dedicated_buffer->ptr, 0, size);
 
@@ -382,6 +390,37 @@ void arena_destroy(ArenaAllocator *arena) {
   arena->total_allocated = 0;
 }
 
+/**
+ * @brief Moves every buffer of one arena into another.
+ *
+ * The adopted buffers are linked in front of the chain, like dedicated
+ * buffers, so the bump pointer of @p arena never walks into them.
+ *
+ * @param arena Arena taking ownership of the buffers.
+ * @param other Arena giving them up; left empty.
+ */
+void arena_adopt(ArenaAllocator *arena, ArenaAllocator *other) {
+  if (!arena || !other || !other->head)
+    return;
+
+  Buffer *tail = other->head;
+  while (tail->next) {
+    tail = tail->next;
+  }
+  tail->next = arena->head;
+  arena->head = other->head;
+  arena->total_allocated += other->total_allocated;
+
+  DEBUG_PRINT("arena_adopt: took %zu bytes from arena %p\n",
+              other->total_allocated, (void *)other);
+
+  other->head = NULL;
+  other->buffer = NULL;
+  other->offset = 0;
+  other->next_buffer_size = 0;
+  other->total_allocated = 0;
+}
+
 /**
  * @brief Returns the total number of bytes allocated across all buffers.
  *
@@ -496,7 +535,8 @@ bool growable_array_init(GrowableArray *arr, ArenaAllocator *arena,
  */
 void *growable_array_push(GrowableArray *arr) {
   if (arr->count >= arr->capacity) {
-    size_t new_capacity = arr->capacity * 2;
+    // Arrays may start empty (capacity 0) and allocate on first push
+    size_t new_capacity = arr->capacity ? arr->capacity * 2 : 4;
     size_t alignment = (arr->item_size == sizeof(void *)) ? alignof(void *)
                        : (arr->item_size >= alignof(max_align_t))
                            ? alignof(max_align_t)
@@ -55,6 +55,9 @@ extern "C" {
 /** @brief Maximum size of an arena buffer in bytes. */
 #define ARENA_MAX_BUFFER_SIZE (16 * 1024 * 1024) // 16MB maximum per buffer
 
+/** @brief Alignment used by the inline fast path (node-sized allocations). */
+#define ARENA_FAST_ALIGN alignof(void *)
+
 /** @brief Enable to print debug allocation logs. */
 // #define DEBUG_ARENA_ALLOC 1
 
@@ -149,6 +152,29 @@ int arena_allocator_init(ArenaAllocator *arena, size_t initial_size);
  */
 void *arena_alloc(ArenaAllocator *arena, size_t size, size_t alignment);
 
+/**
+ * @brief Inline bump allocation for small, pointer-aligned objects.
+ *
+ * Serves the request straight out of the active buffer when it fits and only
+ * calls into arena_alloc() when the buffer is exhausted. Intended for hot
+ * paths such as AST node construction where the size is known and small.
+ *
+ * @param arena Pointer to the arena.
+ * @param size Number of bytes to allocate.
+ * @return Pointer to allocated memory, or NULL on failure.
+ */
+static inline void *arena_alloc_fast(ArenaAllocator *arena, size_t size) {
+  Buffer *buf = arena->buffer;
+  size_t offset = (arena->offset + (ARENA_FAST_ALIGN - 1)) &
+                  ~(size_t)(ARENA_FAST_ALIGN - 1);
+
+  if (buf && offset + size <= buf->size) {
+    arena->offset = offset + size;
+    return buf->ptr + offset;
+  }
+  return arena_alloc(arena, size, ARENA_FAST_ALIGN);
+}
+
 /**
  * @brief Reallocates memory from the arena allocator.
  *
@@ -180,6 +206,19 @@ void arena_reset(ArenaAllocator *arena);
  */
 void arena_destroy(ArenaAllocator *arena);
 
+/**
+ * @brief Moves every buffer of @p other into @p arena.
+ *
+ * Memory allocated from @p other stays valid and is now freed together with
+ * @p arena. Useful for letting a worker thread fill a private arena and
+ * handing the results back to the owner afterwards. @p other is left empty;
+ * allocating from it fails until it is initialized again.
+ *
+ * @param arena Arena taking ownership of the buffers.
+ * @param other Arena giving them up.
+ */
+void arena_adopt(ArenaAllocator *arena, ArenaAllocator *other);
+
 /**
  * @brief Duplicates a string into arena-managed memory.
  * @param arena Pointer to the arena.
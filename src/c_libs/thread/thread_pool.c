@@ -0,0 +1,187 @@
+/**
+ * @file thread_pool.c
+ * @brief pthread implementation of the fixed-size worker pool.
+ *
+ * @see thread_pool.h
+ */
+
+#include "thread_pool.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+typedef struct PoolJob {
+  ThreadPoolTask task;
+  void *arg;
+  struct PoolJob *next;
+} PoolJob;
+
+typedef struct {
+  ThreadPool *pool;
+  size_t index;
+} PoolWorker;
+
+struct ThreadPool {
+  pthread_mutex_t lock;
+  pthread_cond_t has_work; /**< Signalled when a job is queued or on stop */
+  pthread_cond_t idle;     /**< Signalled when the pool runs out of work */
+  PoolJob *head;
+  PoolJob *tail;
+  size_t pending; /**< Jobs queued or running */
+  bool stopping;
+
+  size_t worker_count;
+  pthread_t *threads;
+  PoolWorker *workers;
+};
+
+size_t thread_pool_default_workers(void) {
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? (size_t)n : 1;
+}
+
+static void *thread_pool_worker(void *arg) {
+  PoolWorker *worker = (PoolWorker *)arg;
+  ThreadPool *pool = worker->pool;
+
+  pthread_mutex_lock(&pool->lock);
+  while (1) {
+    while (!pool->head && !pool->stopping) {
+      pthread_cond_wait(&pool->has_work, &pool->lock);
+    }
+    if (!pool->head) {
+      break; // stopping and drained
+    }
+
+    PoolJob *job = pool->head;
+    pool->head = job->next;
+    if (!pool->head) {
+      pool->tail = NULL;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    job->task(job->arg, worker->index);
+    free(job);
+
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->pending == 0) {
+      pthread_cond_broadcast(&pool->idle);
+    }
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+ThreadPool *thread_pool_create(size_t workers) {
+  if (workers == 0) {
+    workers = thread_pool_default_workers();
+  }
+
+  ThreadPool *pool = calloc(1, sizeof(ThreadPool));
+  if (!pool) {
+    return NULL;
+  }
+
+  pool->worker_count = workers;
+  if (workers == 1) {
+    return pool; // Inline mode, no threads needed
+  }
+
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->has_work, NULL);
+  pthread_cond_init(&pool->idle, NULL);
+
+  pool->threads = calloc(workers, sizeof(pthread_t));
+  pool->workers = calloc(workers, sizeof(PoolWorker));
+  if (!pool->threads || !pool->workers) {
+    free(pool->threads);
+    free(pool->workers);
+    free(pool);
+    return NULL;
+  }
+
+  for (size_t i = 0; i < workers; i++) {
+    pool->workers[i].pool = pool;
+    pool->workers[i].index = i;
+    if (pthread_create(&pool->threads[i], NULL, thread_pool_worker,
+                       &pool->workers[i]) != 0) {
+      fprintf(stderr, "Failed to start worker thread %zu\n", i);
+      pool->worker_count = i;
+      thread_pool_destroy(pool);
+      return NULL;
+    }
+  }
+
+  return pool;
+}
+
+size_t thread_pool_size(const ThreadPool *pool) { return pool->worker_count; }
+
+bool thread_pool_submit(ThreadPool *pool, ThreadPoolTask task, void *arg) {
+  if (!pool->threads) {
+    task(arg, 0);
+    return true;
+  }
+
+  PoolJob *job = malloc(sizeof(PoolJob));
+  if (!job) {
+    return false;
+  }
+  job->task = task;
+  job->arg = arg;
+  job->next = NULL;
+
+  pthread_mutex_lock(&pool->lock);
+  if (pool->tail) {
+    pool->tail->next = job;
+  } else {
+    pool->head = job;
+  }
+  pool->tail = job;
+  pool->pending++;
+  pthread_cond_signal(&pool->has_work);
+  pthread_mutex_unlock(&pool->lock);
+
+  return true;
+}
+
+void thread_pool_wait(ThreadPool *pool) {
+  if (!pool->threads) {
+    return;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  while (pool->pending > 0) {
+    pthread_cond_wait(&pool->idle, &pool->lock);
+  }
+  pthread_mutex_unlock(&pool->lock);
+}
+
+void thread_pool_destroy(ThreadPool *pool) {
+  if (!pool) {
+    return;
+  }
+
+  if (pool->threads) {
+    thread_pool_wait(pool);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->has_work);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (size_t i = 0; i < pool->worker_count; i++) {
+      pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->has_work);
+    pthread_cond_destroy(&pool->idle);
+    free(pool->threads);
+    free(pool->workers);
+  }
+
+  free(pool);
+}
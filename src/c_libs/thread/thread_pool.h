@@ -0,0 +1,67 @@
+/**
+ * @file thread_pool.h
+ * @brief Fixed-size worker pool for running independent compiler tasks.
+ *
+ * Tasks are queued with thread_pool_submit() and run in FIFO order by a fixed
+ * set of workers. Every task receives the index of the worker running it, so
+ * callers can keep per-worker state (arenas, resolvers, ...) in a plain array
+ * instead of synchronising on shared state.
+ *
+ * A pool created with a single worker runs tasks inline on the calling thread,
+ * which keeps `-j 1` builds free of any threading.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Task entry point.
+ * @param arg User pointer passed to thread_pool_submit().
+ * @param worker Index of the worker running the task (0..workers-1).
+ */
+typedef void (*ThreadPoolTask)(void *arg, size_t worker);
+
+typedef struct ThreadPool ThreadPool;
+
+/**
+ * @brief Returns the number of online CPUs (at least 1).
+ */
+size_t thread_pool_default_workers(void);
+
+/**
+ * @brief Creates a pool with the given number of workers.
+ * @param workers Worker count; 0 selects thread_pool_default_workers().
+ * @return The new pool, or NULL on failure.
+ */
+ThreadPool *thread_pool_create(size_t workers);
+
+/**
+ * @brief Returns the number of workers in the pool.
+ */
+size_t thread_pool_size(const ThreadPool *pool);
+
+/**
+ * @brief Queues a task (or runs it immediately on a single-worker pool).
+ * @return false if the task could not be queued.
+ */
+bool thread_pool_submit(ThreadPool *pool, ThreadPoolTask task, void *arg);
+
+/**
+ * @brief Blocks until every submitted task has finished.
+ */
+void thread_pool_wait(ThreadPool *pool);
+
+/**
+ * @brief Waits for outstanding tasks, stops the workers and frees the pool.
+ */
+void thread_pool_destroy(ThreadPool *pool);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,752 @@
+/**
+ * @file build_cache.c
+ * @brief Directory and HTTP backends of the shared object cache.
+ *
+ * @see build_cache.h
+ */
+
+#include "build_cache.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#endif
+
+#include <llvm-c/TargetMachine.h>
+#include <llvm/Config/llvm-config.h>
+
+#include "help.h"
+
+/** Seconds a cache server may stay silent before a request gives up */
+#define CACHE_TIMEOUT 5
+
+/** Longest header block the client and the server read */
+#define CACHE_HEADER_MAX 8192
+
+/** Bytes of the trailer following every stored object; see object_trailer */
+#define CACHE_TRAILER_SIZE 62
+
+/** Mixed into the keys, so blobs of an older layout are never fetched */
+#define CACHE_FORMAT "trailer-1"
+
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+static uint64_t mix_str(uint64_t hash, const char *text) {
+  for (const char *c = text; *c; c++) {
+    hash = (hash ^ (unsigned char)*c) * FNV_PRIME;
+  }
+  return (hash ^ 0xff) * FNV_PRIME; // Terminator, so "ab","c" != "a","bc"
+}
+
+// Key of an object: 16 hex digits plus ".o", also its file name
+static void object_key(const BuildCache *cache, uint64_t hash, char key[20]) {
+  uint64_t mixed = cache->salt;
+  for (int shift = 0; shift < 64; shift += 8) {
+    mixed = (mixed ^ ((hash >> shift) & 0xff)) * FNV_PRIME;
+  }
+  snprintf(key, 20, "%016" PRIx64 ".o", mixed);
+}
+
+// Unique per process and call, so concurrent writers never share a file.
+// False if the name does not fit.
+static bool temporary_path(char *out, size_t size, const char *path) {
+  static atomic_uint counter;
+  int length = snprintf(out, size, "%s.%ld.%u.tmp", path, (long)getpid(),
+                        atomic_fetch_add(&counter, 1));
+  return length > 0 && (size_t)length < size;
+}
+
+static bool make_directory(const char *path) {
+#ifdef _WIN32
+  return _mkdir(path) == 0 || errno == EEXIST;
+#else
+  return mkdir(path, 0755) == 0 || errno == EEXIST;
+#endif
+}
+
+// <dir>/<ab>/<key>; creates <dir>/<ab> when create is set
+static bool directory_path(const char *dir, const char *key, char *out,
+                           size_t size, bool create) {
+  snprintf(out, size, "%s/%.2s", dir, key);
+  if (create && !make_directory(out)) {
+    return false;
+  }
+  snprintf(out, size, "%s/%.2s/%s", dir, key, key);
+  return true;
+}
+
+static bool write_all(int fd, const char *data, size_t length) {
+  while (length > 0) {
+    ssize_t written = write(fd, data, length);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      return false;
+    }
+    data += written;
+    length -= (size_t)written;
+  }
+  return true;
+}
+
+// Opens a temporary file next to path, for finish_temporary to rename over
+// it; -1 on failure
+static int open_temporary(const char *path, char *temporary, size_t size) {
+  return temporary_path(temporary, size, path)
+             ? open(temporary, O_RDWR | O_CREAT | O_TRUNC, 0644)
+             : -1;
+}
+
+// Closes the file and renames it into place if ok, or removes it
+static bool finish_temporary(int file, bool ok, const char *temporary,
+                             const char *path) {
+  ok = close(file) == 0 && ok && rename(temporary, path) == 0;
+  if (!ok) {
+    unlink(temporary);
+  }
+  return ok;
+}
+
+static bool copy_fd(int in, int out) {
+  char buffer[65536];
+  ssize_t length;
+  bool ok = true;
+  while (ok && (length = read(in, buffer, sizeof(buffer))) != 0) {
+    ok = length > 0 ? write_all(out, buffer, (size_t)length) : errno == EINTR;
+  }
+  return ok;
+}
+
+// FNV-1a of the first length bytes of a file
+static bool file_checksum(int fd, uint64_t length, uint64_t *sum) {
+  if (lseek(fd, 0, SEEK_SET) != 0) {
+    return false;
+  }
+  uint64_t hash = FNV_OFFSET;
+  unsigned char buffer[65536];
+  while (length > 0) {
+    size_t want = length < sizeof(buffer) ? (size_t)length : sizeof(buffer);
+    ssize_t got = read(fd, buffer, want);
+    if (got < 0 && errno == EINTR) {
+      continue;
+    }
+    if (got <= 0) {
+      return false;
+    }
+    for (ssize_t i = 0; i < got; i++) {
+      hash = (hash ^ buffer[i]) * FNV_PRIME;
+    }
+    length -= (uint64_t)got;
+  }
+  *sum = hash;
+  return true;
+}
+
+// "luma-cache <key> <length> <checksum>\n", stored after the object bytes.
+// The key catches a blob served under the wrong name, the length and the
+// checksum a truncated or corrupted one.
+static void object_trailer(const char *key, uint64_t length, uint64_t sum,
+                           char out[CACHE_TRAILER_SIZE + 1]) {
+  snprintf(out, CACHE_TRAILER_SIZE + 1,
+           "luma-cache %.16s %016" PRIx64 " %016" PRIx64 "\n", key, length,
+           sum);
+}
+
+// Trailer of the object file fd, left positioned at its start
+static bool trailer_of(int fd, const char *key,
+                       char out[CACHE_TRAILER_SIZE + 1]) {
+  struct stat st;
+  uint64_t sum;
+  if (fstat(fd, &st) != 0 ||
+      !file_checksum(fd, (uint64_t)st.st_size, &sum)) {
+    return false;
+  }
+  object_trailer(key, (uint64_t)st.st_size, sum, out);
+  return lseek(fd, 0, SEEK_SET) == 0;
+}
+
+// Length of the object in the blob fd if its trailer matches key and the
+// bytes before it, otherwise -1
+static long long checked_length(int fd, const char *key) {
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < CACHE_TRAILER_SIZE) {
+    return -1;
+  }
+  uint64_t length = (uint64_t)st.st_size - CACHE_TRAILER_SIZE;
+  char found[CACHE_TRAILER_SIZE];
+  char expected[CACHE_TRAILER_SIZE + 1];
+  uint64_t sum;
+  if (lseek(fd, (off_t)length, SEEK_SET) != (off_t)length ||
+      read(fd, found, CACHE_TRAILER_SIZE) != CACHE_TRAILER_SIZE ||
+      !file_checksum(fd, length, &sum)) {
+    return -1;
+  }
+  object_trailer(key, length, sum, expected);
+  return memcmp(found, expected, CACHE_TRAILER_SIZE) == 0 ? (long long)length
+                                                          : -1;
+}
+
+// Checks a fetched blob and cuts its trailer off, leaving the object
+static bool unwrap_object(int fd, const char *key) {
+  long long length = checked_length(fd, key);
+  if (length < 0) {
+    fprintf(stderr, "Warning: cached object %s is corrupt, rebuilding it\n",
+            key);
+    return false;
+  }
+  return ftruncate(fd, (off_t)length) == 0;
+}
+
+// Object file into the cache as a blob: the object and its trailer
+static bool store_file(const char *from, const char *to, const char *key) {
+  int in = open(from, O_RDONLY);
+  char trailer[CACHE_TRAILER_SIZE + 1];
+  if (in < 0 || !trailer_of(in, key, trailer)) {
+    if (in >= 0) {
+      close(in);
+    }
+    return false;
+  }
+
+  char temporary[1024];
+  int out = open_temporary(to, temporary, sizeof(temporary));
+  if (out < 0) {
+    close(in);
+    return false;
+  }
+  bool ok = copy_fd(in, out) && write_all(out, trailer, CACHE_TRAILER_SIZE);
+  close(in);
+  return finish_temporary(out, ok, temporary, to);
+}
+
+// Blob out of the cache, checked after the copy so a concurrent writer
+// cannot slip in between
+static bool fetch_file(const char *from, const char *to, const char *key) {
+  int in = open(from, O_RDONLY);
+  if (in < 0) {
+    return false;
+  }
+
+  char temporary[1024];
+  int out = open_temporary(to, temporary, sizeof(temporary));
+  if (out < 0) {
+    close(in);
+    return false;
+  }
+  bool ok = copy_fd(in, out) && unwrap_object(out, key);
+  close(in);
+  return finish_temporary(out, ok, temporary, to);
+}
+
+// =============================================================================
+// HTTP
+// =============================================================================
+
+// BSD sockets only; on Windows the cache has to be a directory
+#ifndef _WIN32
+static int connect_to(const char *host, const char *port) {
+  struct addrinfo hints = {0};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+
+  struct addrinfo *addresses;
+  if (getaddrinfo(host, port, &hints, &addresses) != 0) {
+    return -1;
+  }
+
+  int fd = -1;
+  for (struct addrinfo *a = addresses; a && fd < 0; a = a->ai_next) {
+    fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+    if (fd < 0) {
+      continue;
+    }
+    struct timeval timeout = {CACHE_TIMEOUT, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    if (connect(fd, a->ai_addr, a->ai_addrlen) != 0) {
+      close(fd);
+      fd = -1;
+    }
+  }
+  freeaddrinfo(addresses);
+  return fd;
+}
+
+// MSG_NOSIGNAL: a peer that hangs up must not kill the process with SIGPIPE
+static bool send_all(int fd, const char *data, size_t length) {
+  while (length > 0) {
+    ssize_t sent = send(fd, data, length, MSG_NOSIGNAL);
+    if (sent < 0 && errno == EINTR) {
+      continue;
+    }
+    if (sent <= 0) {
+      return false;
+    }
+    data += sent;
+    length -= (size_t)sent;
+  }
+  return true;
+}
+
+static bool send_file(int fd, int file) {
+  char buffer[65536];
+  ssize_t length;
+  while ((length = read(file, buffer, sizeof(buffer))) != 0) {
+    if (length < 0 && errno == EINTR) {
+      continue;
+    }
+    if (length < 0 || !send_all(fd, buffer, (size_t)length)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Header block of one HTTP message; the bytes read past it are the start of
+ * the body.
+ */
+typedef struct {
+  char data[CACHE_HEADER_MAX];
+  size_t length;       // Bytes in data
+  size_t body_start;   // Offset of the body in data
+  long content_length; // -1 if not given
+} HttpHeader;
+
+static bool read_header(int fd, HttpHeader *header) {
+  header->length = 0;
+  header->content_length = -1;
+  while (header->length < sizeof(header->data) - 1) {
+    ssize_t got = recv(fd, header->data + header->length,
+                       sizeof(header->data) - 1 - header->length, 0);
+    if (got < 0 && errno == EINTR) {
+      continue;
+    }
+    if (got <= 0) {
+      return false;
+    }
+    header->length += (size_t)got;
+    header->data[header->length] = '\0';
+
+    char *end = strstr(header->data, "\r\n\r\n");
+    if (end) {
+      header->body_start = (size_t)(end - header->data) + 4;
+      for (char *line = strstr(header->data, "\r\n"); line && line < end;
+           line = strstr(line + 2, "\r\n")) {
+        if (strncasecmp(line + 2, "Content-Length:", 15) == 0) {
+          header->content_length = strtol(line + 17, NULL, 10);
+        }
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+// Body of a message into a file; with a Content-Length, exactly that much
+static bool receive_body(int fd, const HttpHeader *header, int file) {
+  size_t buffered = header->length - header->body_start;
+  long expected = header->content_length;
+  if (expected >= 0 && buffered > (size_t)expected) {
+    buffered = (size_t)expected;
+  }
+  if (!write_all(file, header->data + header->body_start, buffered)) {
+    return false;
+  }
+
+  size_t received = buffered;
+  char buffer[65536];
+  while (expected < 0 || received < (size_t)expected) {
+    size_t want = sizeof(buffer);
+    if (expected >= 0 && (size_t)expected - received < want) {
+      want = (size_t)expected - received;
+    }
+    ssize_t got = recv(fd, buffer, want, 0);
+    if (got < 0 && errno == EINTR) {
+      continue;
+    }
+    if (got < 0) {
+      return false;
+    }
+    if (got == 0) {
+      return expected < 0; // Without a length, the body ends with the stream
+    }
+    if (!write_all(file, buffer, (size_t)got)) {
+      return false;
+    }
+    received += (size_t)got;
+  }
+  return true;
+}
+
+static int status_code(const HttpHeader *header) {
+  int status = 0;
+  return sscanf(header->data, "HTTP/%*s %d", &status) == 1 ? status : 0;
+}
+
+// Connection failures take the server out of the build: every later object
+// would wait for the same timeout
+static int http_connect(BuildCache *cache) {
+  if (atomic_load(&cache->offline)) {
+    return -1;
+  }
+  int fd = connect_to(cache->host, cache->port);
+  if (fd < 0 && !atomic_exchange(&cache->offline, true)) {
+    fprintf(stderr, "Warning: cache server %s:%s is unreachable\n",
+            cache->host, cache->port);
+  }
+  return fd;
+}
+
+static bool http_fetch(BuildCache *cache, const char *key, const char *path) {
+  int fd = http_connect(cache);
+  if (fd < 0) {
+    return false;
+  }
+
+  char request[1024];
+  int length = snprintf(request, sizeof(request),
+                        "GET %s/%s HTTP/1.0\r\nHost: %s\r\n\r\n",
+                        cache->prefix, key, cache->host);
+  HttpHeader header;
+  bool ok = length > 0 && (size_t)length < sizeof(request) &&
+            send_all(fd, request, (size_t)length) &&
+            read_header(fd, &header) && status_code(&header) == 200;
+
+  char temporary[1024];
+  int file = ok ? open_temporary(path, temporary, sizeof(temporary)) : -1;
+  if (file >= 0) {
+    ok = receive_body(fd, &header, file) && unwrap_object(file, key);
+    ok = finish_temporary(file, ok, temporary, path);
+  } else {
+    ok = false;
+  }
+  close(fd);
+  return ok;
+}
+
+static bool http_store(BuildCache *cache, const char *key, const char *path) {
+  int file = open(path, O_RDONLY);
+  struct stat st;
+  char trailer[CACHE_TRAILER_SIZE + 1];
+  if (file < 0 || fstat(file, &st) != 0 || !trailer_of(file, key, trailer)) {
+    if (file >= 0) {
+      close(file);
+    }
+    return false;
+  }
+
+  int fd = http_connect(cache);
+  if (fd < 0) {
+    close(file);
+    return false;
+  }
+
+  char request[1024];
+  int length = snprintf(request, sizeof(request),
+                        "PUT %s/%s HTTP/1.0\r\nHost: %s\r\n"
+                        "Content-Length: %lld\r\n\r\n",
+                        cache->prefix, key, cache->host,
+                        (long long)st.st_size + CACHE_TRAILER_SIZE);
+  HttpHeader header;
+  bool ok = length > 0 && (size_t)length < sizeof(request) &&
+            send_all(fd, request, (size_t)length) && send_file(fd, file) &&
+            send_all(fd, trailer, CACHE_TRAILER_SIZE) &&
+            read_header(fd, &header);
+  int status = ok ? status_code(&header) : 0;
+  close(file);
+  close(fd);
+  return status >= 200 && status < 300;
+}
+
+// http://host[:port][/path]
+static bool parse_url(BuildCache *cache, const char *url,
+                      ArenaAllocator *arena) {
+  const char *host = url + strlen("http://");
+  const char *path = strchr(host, '/');
+  if (!path) {
+    path = host + strlen(host);
+  }
+  const char *colon = memchr(host, ':', (size_t)(path - host));
+  const char *host_end = colon ? colon : path;
+  if (host_end == host || (colon && colon + 1 == path)) {
+    return false;
+  }
+
+  char *name = arena_alloc(arena, (size_t)(host_end - host) + 1, alignof(char));
+  char *port = arena_alloc(arena, 8, alignof(char));
+  char *prefix = arena_strdup(arena, path);
+  if (!name || !port || !prefix) {
+    return false;
+  }
+  memcpy(name, host, (size_t)(host_end - host));
+  name[host_end - host] = '\0';
+  if (colon) {
+    snprintf(port, 8, "%.*s", (int)(path - colon - 1), colon + 1);
+  } else {
+    strcpy(port, "80");
+  }
+
+  size_t length = strlen(prefix);
+  while (length > 0 && prefix[length - 1] == '/') {
+    prefix[--length] = '\0';
+  }
+
+  cache->kind = CACHE_HTTP;
+  cache->host = name;
+  cache->port = port;
+  cache->prefix = prefix;
+  return true;
+}
+#endif
+
+// =============================================================================
+// CACHE
+// =============================================================================
+
+bool build_cache_open(BuildCache *cache, const char *spec, const char *options,
+                      ArenaAllocator *arena) {
+  memset(cache, 0, sizeof(*cache));
+  atomic_init(&cache->offline, false);
+
+  if (strncmp(spec, "http://", 7) == 0) {
+#ifdef _WIN32
+    (void)arena;
+    fprintf(stderr, "Error: HTTP caches are not supported on Windows, use a "
+                    "directory\n");
+    return false;
+#else
+    if (!parse_url(cache, spec, arena)) {
+      fprintf(stderr, "Invalid cache URL: %s\n", spec);
+      return false;
+    }
+#endif
+  } else {
+    cache->kind = CACHE_DIRECTORY;
+    cache->dir = spec;
+    if (!make_directory(spec)) {
+      fprintf(stderr, "Failed to create cache directory %s: %s\n", spec,
+              strerror(errno));
+      return false;
+    }
+  }
+
+  char *triple = LLVMGetDefaultTargetTriple();
+  uint64_t salt = mix_str(FNV_OFFSET, COMPILER_VERSION);
+  salt = mix_str(salt, LLVM_VERSION_STRING);
+  salt = mix_str(salt, triple);
+  salt = mix_str(salt, CACHE_FORMAT);
+  cache->salt = mix_str(salt, options);
+  LLVMDisposeMessage(triple);
+  return true;
+}
+
+bool build_cache_fetch(BuildCache *cache, uint64_t hash, const char *path) {
+  char key[20];
+  object_key(cache, hash, key);
+#ifndef _WIN32
+  if (cache->kind == CACHE_HTTP) {
+    return http_fetch(cache, key, path);
+  }
+#endif
+
+  char stored[1024];
+  directory_path(cache->dir, key, stored, sizeof(stored), false);
+  return fetch_file(stored, path, key);
+}
+
+bool build_cache_store(BuildCache *cache, uint64_t hash, const char *path) {
+  char key[20];
+  object_key(cache, hash, key);
+#ifndef _WIN32
+  if (cache->kind == CACHE_HTTP) {
+    return http_store(cache, key, path);
+  }
+#endif
+
+  char stored[1024];
+  if (!directory_path(cache->dir, key, stored, sizeof(stored), true) ||
+      !store_file(path, stored, key)) {
+    fprintf(stderr, "Warning: failed to store %s in %s\n", path, cache->dir);
+    return false;
+  }
+  return true;
+}
+
+// =============================================================================
+// SERVER
+// =============================================================================
+
+#ifndef _WIN32
+static bool is_object_key(const char *name) {
+  size_t length = strlen(name);
+  if (length != 18 || strcmp(name + 16, ".o") != 0) {
+    return false;
+  }
+  for (size_t i = 0; i < 16; i++) {
+    if (!strchr("0123456789abcdef", name[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void respond(int fd, const char *status) {
+  char response[256];
+  int length = snprintf(response, sizeof(response),
+                        "HTTP/1.0 %s\r\nContent-Length: 0\r\n\r\n", status);
+  send_all(fd, response, (size_t)length);
+}
+
+static void serve_get(int fd, const char *stored) {
+  int file = open(stored, O_RDONLY);
+  struct stat st;
+  if (file < 0 || fstat(file, &st) != 0) {
+    if (file >= 0) {
+      close(file);
+    }
+    respond(fd, "404 Not Found");
+    return;
+  }
+
+  char response[256];
+  int length = snprintf(response, sizeof(response),
+                        "HTTP/1.0 200 OK\r\nContent-Length: %lld\r\n\r\n",
+                        (long long)st.st_size);
+  if (send_all(fd, response, (size_t)length)) {
+    send_file(fd, file);
+  }
+  close(file);
+}
+
+// Blobs whose trailer does not match are refused, so a client that hung up
+// midway cannot leave a broken one behind
+static void serve_put(int fd, const HttpHeader *header, const char *stored,
+                      const char *key) {
+  if (header->content_length < 0) {
+    respond(fd, "411 Length Required");
+    return;
+  }
+
+  char temporary[1024];
+  int file = open_temporary(stored, temporary, sizeof(temporary));
+  if (file < 0) {
+    respond(fd, "500 Internal Server Error");
+    return;
+  }
+  bool received = receive_body(fd, header, file);
+  bool valid = received && checked_length(file, key) >= 0;
+  if (!finish_temporary(file, valid, temporary, stored)) {
+    respond(fd, received && !valid ? "400 Bad Request"
+                                   : "500 Internal Server Error");
+    return;
+  }
+  respond(fd, "201 Created");
+}
+
+static void serve_connection(int fd, const char *dir) {
+  HttpHeader header;
+  char method[8], target[512];
+  if (!read_header(fd, &header) ||
+      sscanf(header.data, "%7s %511s", method, target) != 2) {
+    respond(fd, "400 Bad Request");
+    return;
+  }
+
+  // Clients may put any path in front of the key
+  const char *key = strrchr(target, '/');
+  key = key ? key + 1 : target;
+  char stored[1024];
+  if (!is_object_key(key) ||
+      !directory_path(dir, key, stored, sizeof(stored), true)) {
+    respond(fd, "404 Not Found");
+    return;
+  }
+
+  if (strcmp(method, "GET") == 0) {
+    serve_get(fd, stored);
+  } else if (strcmp(method, "PUT") == 0) {
+    serve_put(fd, &header, stored, key);
+  } else {
+    respond(fd, "405 Method Not Allowed");
+  }
+}
+
+bool run_cache_server(const char *dir, const char *bind_address,
+                      unsigned port) {
+  // Writes are not authenticated, so only local clients by default
+  const char *host = bind_address ? bind_address : "127.0.0.1";
+  struct sockaddr_in address = {0};
+  address.sin_family = AF_INET;
+  address.sin_port = htons((uint16_t)port);
+  if (inet_pton(AF_INET, host, &address.sin_addr) != 1) {
+    fprintf(stderr, "Invalid address to bind: %s\n", host);
+    return false;
+  }
+
+  if (!make_directory(dir)) {
+    fprintf(stderr, "Failed to create cache directory %s: %s\n", dir,
+            strerror(errno));
+    return false;
+  }
+
+  int listener = socket(AF_INET, SOCK_STREAM, 0);
+  int reuse = 1;
+  if (listener < 0 ||
+      setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) !=
+          0 ||
+      bind(listener, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+      listen(listener, 64) != 0) {
+    fprintf(stderr, "Failed to listen on %s:%u: %s\n", host, port,
+            strerror(errno));
+    if (listener >= 0) {
+      close(listener);
+    }
+    return false;
+  }
+
+  printf("Serving cache %s on %s:%u\n", dir, host, port);
+  fflush(stdout);
+  for (;;) {
+    int fd = accept(listener, NULL, NULL);
+    if (fd < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fprintf(stderr, "accept failed: %s\n", strerror(errno));
+      close(listener);
+      return false;
+    }
+    struct timeval timeout = {CACHE_TIMEOUT, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    serve_connection(fd, dir);
+    close(fd);
+  }
+}
+#else
+bool run_cache_server(const char *dir, const char *bind_address,
+                      unsigned port) {
+  (void)dir;
+  (void)bind_address;
+  (void)port;
+  fprintf(stderr, "Error: cache-server is not supported on Windows\n");
+  return false;
+}
+#endif
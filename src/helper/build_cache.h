@@ -0,0 +1,118 @@
+/**
+ * @file build_cache.h
+ * @brief Content-addressed object cache shared between machines (`-cache`).
+ *
+ * Incremental builds (see incremental.h) reuse the object of a function from
+ * their own last build. A shared cache lets every build reuse the objects any
+ * other build has compiled: a fresh CI worker fetches most of its function
+ * objects instead of generating them.
+ *
+ * An object is stored under a key that hashes:
+ *
+ * - the function's incremental hash: its normalized body tokens, signature
+ *   and the declaration (interface) hashes of everything it uses
+ * - the compiler and LLVM versions
+ * - the code generation options and the target triple
+ *
+ * so equal keys mean equal objects, wherever they were built. Backends:
+ *
+ * - a directory, e.g. on a shared mount: `<dir>/<ab>/<key>.o`, where `ab`
+ *   are the first two digits of the key
+ * - an HTTP object store: `GET` and `PUT` of `<url>/<key>.o`. Any server
+ *   that stores what is `PUT` will do; `luma cache-server` is a minimal one
+ *   serving a directory cache.
+ *
+ * The key is only 64 bits of FNV, and transfers can break off, so every
+ * object is stored followed by a trailer repeating its key, its length and
+ * a checksum of its bytes. A fetched blob is checked against it before the
+ * trailer is cut off; one that does not match is discarded and the
+ * function compiled again.
+ *
+ * The cache is best effort: a miss, an unreachable server or a failed store
+ * never fails the build, they only cost code generation.
+ */
+
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../c_libs/memory/memory.h"
+
+/** Environment variable naming the cache when -cache is not given */
+#define BUILD_CACHE_ENV "LUMA_CACHE"
+
+/** Port of `luma cache-server` unless -port is given */
+#define BUILD_CACHE_DEFAULT_PORT 8765
+
+/**
+ * @brief Where cached objects are kept.
+ */
+typedef enum {
+  CACHE_DIRECTORY, /**< A local or mounted directory */
+  CACHE_HTTP       /**< An HTTP server taking GET and PUT */
+} BuildCacheKind;
+
+/**
+ * @brief An opened cache.
+ */
+typedef struct {
+  BuildCacheKind kind; /**< Backend */
+  const char *dir;     /**< CACHE_DIRECTORY: root directory */
+  const char *host;    /**< CACHE_HTTP: server host */
+  const char *port;    /**< CACHE_HTTP: server port */
+  const char *prefix;  /**< CACHE_HTTP: path before the keys, no trailing / */
+  uint64_t salt;       /**< Compiler, options and target; mixed into keys */
+  atomic_bool offline; /**< CACHE_HTTP: server unreachable, stop asking */
+} BuildCache;
+
+/**
+ * @brief Opens a cache.
+ *
+ * @param cache Cache to initialize.
+ * @param spec `http://host[:port][/path]` or a directory, created if needed.
+ * @param options Code generation options that change the objects.
+ * @param arena Arena for the parsed specification.
+ * @return false if @p spec is malformed or the directory cannot be created.
+ */
+bool build_cache_open(BuildCache *cache, const char *spec, const char *options,
+                      ArenaAllocator *arena);
+
+/**
+ * @brief Fetches the object stored for @p hash into the file @p path.
+ *
+ * The file is written under a temporary name and renamed, so @p path is
+ * either untouched or complete. Safe to call from several threads.
+ *
+ * @return true on a hit.
+ */
+bool build_cache_fetch(BuildCache *cache, uint64_t hash, const char *path);
+
+/**
+ * @brief Stores the object file @p path for @p hash.
+ *
+ * Safe to call from several threads.
+ *
+ * @return false if the object could not be stored (already reported).
+ */
+bool build_cache_store(BuildCache *cache, uint64_t hash, const char *path);
+
+/**
+ * @brief Serves a directory cache over HTTP until the process is killed.
+ *
+ * Answers `GET` and `PUT` of `/<key>.o` one connection at a time, refusing
+ * a `PUT` whose trailer does not match; this is a stand-in for a real object
+ * store, for tests and small teams. Anyone who
+ * can reach it can replace objects, so it only listens on the loopback
+ * interface unless an address is given.
+ *
+ * @param dir Directory cache to serve, created if needed.
+ * @param bind_address IPv4 address to listen on (`0.0.0.0` for every
+ *        interface), or NULL for 127.0.0.1.
+ * @param port Port to listen on.
+ * @return false if the directory or the socket cannot be set up.
+ */
+bool run_cache_server(const char *dir, const char *bind_address,
+                      unsigned port);
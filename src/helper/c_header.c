@@ -0,0 +1,213 @@
+/**
+ * @file c_header.c
+ * @brief Generates the C header of a `--lib` build.
+ *
+ * @see c_header.h
+ */
+
+#include "c_header.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+/** Lux basic types with a C equivalent, and that equivalent */
+static const struct {
+  const char *lux;
+  const char *c;
+} basic_types[] = {
+    {"int", "int64_t"}, {"float", "float"}, {"double", "double"},
+    {"bool", "bool"},   {"char", "char"},   {"str", "char *"},
+    {"void", "void"},
+};
+
+// Spell @p type in C into @p buf. False if it has no C equivalent.
+static bool c_type(AstNode *type, char *buf, size_t size) {
+  if (!type || type->category != Node_Category_TYPE) {
+    return false;
+  }
+
+  if (type->type == AST_TYPE_POINTER) {
+    if (!c_type(type->type_data.pointer.pointee_type, buf, size)) {
+      return false;
+    }
+    size_t len = strlen(buf);
+    const char *star = buf[len - 1] == '*' ? "*" : " *";
+    if (len + strlen(star) >= size) {
+      return false;
+    }
+    strcat(buf, star);
+    return true;
+  }
+
+  if (type->type != AST_TYPE_BASIC) {
+    return false;
+  }
+  for (size_t i = 0; i < sizeof(basic_types) / sizeof(basic_types[0]); i++) {
+    if (strcmp(type->type_data.basic.name, basic_types[i].lux) == 0) {
+      return (size_t)snprintf(buf, size, "%s", basic_types[i].c) < size;
+    }
+  }
+  return false;
+}
+
+// "char *" and a name make "char *name", anything else "int64_t name"
+static void write_declarator(FILE *f, const char *type, const char *name) {
+  size_t len = strlen(type);
+  fprintf(f, "%s%s%s", type, type[len - 1] == '*' ? "" : " ", name);
+}
+
+// One prototype, from the signature declared in the module scope. The scope
+// has the types; the declaration has the parameter names.
+static bool write_prototype(FILE *f, AstNode *decl, AstNode *func_type,
+                            const char *header, ArenaAllocator *arena) {
+  const char *name = decl->stmt.func_decl.name;
+  size_t param_count = func_type->type_data.function.param_count;
+  char ret[128];
+  char param[128];
+
+  bool ok = c_type(func_type->type_data.function.return_type, ret,
+                   sizeof(ret));
+  for (size_t i = 0; ok && i < param_count; i++) {
+    ok = c_type(func_type->type_data.function.param_types[i], param,
+                sizeof(param));
+  }
+  if (!ok) {
+    fprintf(stderr,
+            "Warning: pub function '%s' has type '%s', which has no C "
+            "equivalent; left out of %s\n",
+            name, type_to_string(func_type, arena), header);
+    return false;
+  }
+
+  write_declarator(f, ret, name);
+  fprintf(f, "(");
+  if (param_count == 0) {
+    fprintf(f, "void");
+  }
+  for (size_t i = 0; i < param_count; i++) {
+    c_type(func_type->type_data.function.param_types[i], param, sizeof(param));
+    if (i > 0) {
+      fprintf(f, ", ");
+    }
+    write_declarator(f, param, decl->stmt.func_decl.param_names[i]);
+  }
+  fprintf(f, ");\n");
+  return true;
+}
+
+static void write_module(FILE *f, AstNode *module, Scope *module_scope,
+                         const char *header, ArenaAllocator *arena) {
+  AstNode **body = module->preprocessor.module.body;
+  size_t body_count = module->preprocessor.module.body_count;
+  bool titled = false;
+
+  for (size_t i = 0; i < body_count; i++) {
+    AstNode *decl = body[i];
+    if (!decl || decl->type != AST_STMT_FUNCTION ||
+        decl->stmt.func_decl.is_extern ||
+        strcmp(decl->stmt.func_decl.name, "main") == 0) {
+      continue;
+    }
+
+    Symbol *symbol =
+        scope_lookup_current_only(module_scope, decl->stmt.func_decl.name);
+    if (!symbol || !symbol->is_public || !symbol->type ||
+        symbol->type->type != AST_TYPE_FUNCTION) {
+      continue;
+    }
+
+    if (!titled) {
+      fprintf(f, "\n/* %s */\n", module->preprocessor.module.name);
+      titled = true;
+    }
+    write_prototype(f, decl, symbol->type, header, arena);
+  }
+}
+
+// A static library does not record what it links against; its users must
+static void write_link_note(FILE *f, const ModuleGraph *graph,
+                            ArenaAllocator *arena) {
+  GrowableArray libraries;
+  if (!growable_array_init(&libraries, arena, 4, sizeof(const char *))) {
+    return;
+  }
+
+  for (size_t i = 0; i < graph->count; i++) {
+    AstNode *module = graph->nodes[graph->order[i]].module;
+    for (size_t j = 0; j < module->preprocessor.module.body_count; j++) {
+      AstNode *decl = module->preprocessor.module.body[j];
+      if (!decl || decl->type != AST_STMT_FUNCTION ||
+          !decl->stmt.func_decl.is_extern || !decl->stmt.func_decl.library) {
+        continue;
+      }
+
+      const char *library = decl->stmt.func_decl.library;
+      bool seen = false;
+      for (size_t k = 0; k < libraries.count && !seen; k++) {
+        seen = strcmp(((const char **)libraries.data)[k], library) == 0;
+      }
+      const char **slot = seen ? NULL : growable_array_push(&libraries);
+      if (slot) {
+        *slot = library;
+      }
+    }
+  }
+
+  if (libraries.count == 0) {
+    return;
+  }
+  fprintf(f, " * Link with:");
+  for (size_t i = 0; i < libraries.count; i++) {
+    const char *library = ((const char **)libraries.data)[i];
+    fprintf(f, " %s%s", strchr(library, '/') ? "" : "-l", library);
+  }
+  fprintf(f, "\n");
+}
+
+bool write_c_header(const char *path, const ModuleGraph *graph,
+                    Scope *global_scope, LibraryKind kind,
+                    ArenaAllocator *arena) {
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    fprintf(stderr, "Failed to write %s: %s\n", path, strerror(errno));
+    return false;
+  }
+
+  // Include guard from the file name: out/libfoo.h -> LIBFOO_H
+  const char *base = strrchr(path, '/');
+  base = base ? base + 1 : path;
+  char guard[256];
+  size_t len = 0;
+  for (const char *c = base; *c && len + 1 < sizeof(guard); c++) {
+    guard[len++] = isalnum((unsigned char)*c) ? (char)toupper(*c) : '_';
+  }
+  guard[len] = '\0';
+
+  fprintf(f, "/*\n * %s: generated by luma from the pub functions of the "
+             "library; do not edit.\n",
+          base);
+  if (kind == LIBRARY_STATIC) {
+    write_link_note(f, graph, arena);
+  }
+  fprintf(f, " */\n\n#ifndef %s\n#define %s\n\n", guard, guard);
+  fprintf(f, "#include <stdbool.h>\n#include <stdint.h>\n\n");
+  fprintf(f, "#ifdef __cplusplus\nextern \"C\" {\n#endif\n");
+
+  // Dependencies first, like the program was declared
+  for (size_t i = 0; i < graph->count; i++) {
+    const ModuleGraphNode *node = &graph->nodes[graph->order[i]];
+    Scope *module_scope = find_module_scope(global_scope, node->name);
+    if (module_scope) {
+      write_module(f, node->module, module_scope, base, arena);
+    }
+  }
+
+  fprintf(f, "\n#ifdef __cplusplus\n}\n#endif\n\n#endif /* %s */\n", guard);
+  if (fclose(f) != 0) {
+    fprintf(stderr, "Failed to write %s: %s\n", path, strerror(errno));
+    return false;
+  }
+  return true;
+}
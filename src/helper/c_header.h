@@ -0,0 +1,46 @@
+/**
+ * @file c_header.h
+ * @brief C header describing a library built with `--lib`.
+ *
+ * The header declares every `pub` function of the library's modules with
+ * the signature the typechecker declared in its module scope, so C and C++
+ * code can call them in-process:
+ *
+ * | Lux     | C            |
+ * |---------|--------------|
+ * | int     | int64_t      |
+ * | float   | float        |
+ * | double  | double       |
+ * | bool    | bool         |
+ * | char    | char         |
+ * | str     | char *       |
+ * | void    | void         |
+ * | *T      | T *          |
+ *
+ * Functions using other types (structs, enums, arrays) have no C
+ * equivalent; they are left out with a warning. `extern` functions are C
+ * functions already and `main` is a program's, so neither is declared.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "../ast/module_graph.h"
+#include "../c_libs/memory/memory.h"
+#include "../typechecker/type.h"
+#include "help.h"
+
+/**
+ * @brief Writes the header of a library to @p path.
+ *
+ * @param path File to write.
+ * @param graph Modules of the library, declared in dependency order.
+ * @param global_scope Scope the program was typechecked in.
+ * @param kind A static library also lists the C libraries its externs need.
+ * @param arena Arena for temporary strings.
+ * @return false if the file cannot be written (already reported).
+ */
+bool write_c_header(const char *path, const ModuleGraph *graph,
+                    Scope *global_scope, LibraryKind kind,
+                    ArenaAllocator *arena);
@@ -10,7 +10,9 @@
 #include <unistd.h>
 
 #include "../c_libs/color/color.h"
+#include "build_cache.h"
 #include "help.h"
+#include "module_path.h"
 
 /**
  * @brief Checks if the number of command-line arguments is at least expected.
@@ -77,11 +79,58 @@ int print_help() {
   printf("  -name <name>    Set the name of the build target\n");
   printf("  -save           Save the outputed llvm file\n");
   printf("  build <target>  Build the specified target\n");
+  printf("  watch <target>  Build, then rebuild whenever an input file "
+         "changes\n");
+  printf("  run <target>    Build the target, then run it; returns its exit "
+         "status\n");
+  printf("  --interp        With run: interpret the program instead of "
+         "compiling it\n"
+         "                  (no LLVM, no linking: for scripts and tests)\n");
+  printf("  -run            Run the program once built (in watch mode: after "
+         "each build)\n");
+  printf("  lsp             Run a language server on stdin/stdout (takes "
+         "-I)\n");
   printf("  clean           Clean the build artifacts\n");
   printf("  -debug          builds a debug version and shows the allocators "
-         "trace");
+         "trace\n");
+  printf("  -j <n>          Number of worker threads (default: one per CPU)\n");
+  printf("  -incremental    Reuse the code of functions unchanged since the "
+         "last build\n");
+  printf("  -cache <where>  Share function objects through a directory or an "
+         "http:// store\n"
+         "                  (implies -incremental; default: $%s)\n",
+         BUILD_CACHE_ENV);
+  printf("  cache-server <dir> [-port <n>] [-bind <addr>]\n"
+         "                  Serve <dir> as an http:// cache (default port: "
+         "%d;\n"
+         "                  only on 127.0.0.1 unless -bind is given)\n",
+         BUILD_CACHE_DEFAULT_PORT);
+  printf("  --lib=<kind>    Build lib<name>.a (static) or lib<name>.so "
+         "(shared) and a\n"
+         "                  C header <name>.h of its pub functions instead of "
+         "a program\n");
   printf("  -l, -link     Link lux files so that they can be used in other "
          "lux files\n");
+  printf("  <file>.bc       Optimize LLVM bitcode (e.g. clang -flto) "
+         "together with the\n"
+         "                  program, as one module\n");
+  printf("  --codegen-units=<n>\n"
+         "                  Split every module's functions into <n> units "
+         "compiled in\n"
+         "                  parallel (default: 1)\n");
+  printf("  --emit=<kinds>  Write these for every module, from one code "
+         "generator run:\n"
+         "                  obj, asm, ll, bc, comma separated (default: obj, "
+         "and asm,ll\n"
+         "                  with -save). Links only if obj is among them\n");
+  printf("  --dev           Compile for turnaround: locals in registers, no "
+         "backend\n"
+         "                  optimizations\n");
+  printf("  -L <dir>        Search <dir> for the libraries of extern "
+         "functions\n");
+  printf("  -I <dir>        Search <dir> (and its %s) for modules named "
+         "by @use\n",
+         MODULE_INDEX_FILE);
   return 0;
 }
 
@@ -91,7 +140,7 @@ int print_help() {
  * @return Always returns 0.
  */
 int print_version() {
-  printf("Lux Compiler v1.0\n");
+  printf("Lux Compiler %s\n", COMPILER_VERSION);
   return 0;
 }
 
@@ -105,6 +154,88 @@ int print_license() {
   return 0;
 }
 
+// Both "-I dir" and "-Idir"
+static bool is_include_option(int argc, char *argv[], int j) {
+  return strncmp(argv[j], "-I", 2) == 0 &&
+         (argv[j][2] != '\0' || j + 1 < argc);
+}
+
+static bool add_include_dir(char *argv[], int *j, BuildConfig *config) {
+  char **slot = (char **)growable_array_push(&config->include_dirs);
+  if (!slot) {
+    fprintf(stderr, "Failed to add include directory\n");
+    return false;
+  }
+  *slot = argv[*j][2] != '\0' ? argv[*j] + 2 : argv[++*j];
+  return true;
+}
+
+// Both "-L dir" and "-Ldir"
+static bool is_library_dir_option(int argc, char *argv[], int j) {
+  return strncmp(argv[j], "-L", 2) == 0 &&
+         (argv[j][2] != '\0' || j + 1 < argc);
+}
+
+static bool add_library_dir(char *argv[], int *j, BuildConfig *config) {
+  char **slot = (char **)growable_array_push(&config->library_dirs);
+  if (!slot) {
+    fprintf(stderr, "Failed to add library directory\n");
+    return false;
+  }
+  *slot = argv[*j][2] != '\0' ? argv[*j] + 2 : argv[++*j];
+  return true;
+}
+
+// "--emit=obj,asm,ll,bc": the artifacts written for every unit
+static bool parse_emit(const char *list, BuildConfig *config) {
+  static const struct {
+    const char *name;
+    EmitKind kind;
+  } kinds[] = {{"obj", EMIT_OBJECT},
+               {"asm", EMIT_ASSEMBLY},
+               {"ll", EMIT_IR},
+               {"bc", EMIT_BITCODE}};
+
+  config->emit = 0;
+  while (*list) {
+    size_t len = strcspn(list, ",");
+    size_t k = 0;
+    while (k < sizeof(kinds) / sizeof(kinds[0]) &&
+           (strlen(kinds[k].name) != len ||
+            strncmp(kinds[k].name, list, len) != 0))
+      k++;
+    if (k == sizeof(kinds) / sizeof(kinds[0])) {
+      fprintf(stderr, "Unknown --emit kind '%.*s' (expected obj, asm, ll or "
+                      "bc)\n",
+              (int)len, list);
+      return false;
+    }
+    config->emit |= kinds[k].kind;
+    list += len + (list[len] == ',');
+  }
+  if (config->emit == 0) {
+    fprintf(stderr, "--emit needs at least one of obj, asm, ll or bc\n");
+    return false;
+  }
+  return true;
+}
+
+// LLVM bitcode, e.g. from clang -flto, to link into the program
+static bool is_bitcode_file(const char *arg) {
+  size_t len = strlen(arg);
+  return arg[0] != '-' && len > 3 && strcmp(arg + len - 3, ".bc") == 0;
+}
+
+static bool add_bitcode_file(char *path, BuildConfig *config) {
+  char **slot = (char **)growable_array_push(&config->bitcode_files);
+  if (!slot) {
+    fprintf(stderr, "Failed to add bitcode file to array\n");
+    return false;
+  }
+  *slot = path;
+  return true;
+}
+
 /**
  * @brief Parses command-line arguments and configures the build.
  *
@@ -120,7 +251,10 @@ int print_license() {
 bool parse_args(int argc, char *argv[], BuildConfig *config,
                 ArenaAllocator *arena) {
   // Initialize the files array
-  if (!growable_array_init(&config->files, arena, 4, sizeof(char *))) {
+  if (!growable_array_init(&config->files, arena, 4, sizeof(char *)) ||
+      !growable_array_init(&config->include_dirs, arena, 4, sizeof(char *)) ||
+      !growable_array_init(&config->library_dirs, arena, 4, sizeof(char *)) ||
+      !growable_array_init(&config->bitcode_files, arena, 4, sizeof(char *))) {
     fprintf(stderr, "Failed to initialize files array\n");
     return false;
   }
@@ -132,7 +266,13 @@ bool parse_args(int argc, char *argv[], BuildConfig *config,
       return print_help(), false;
     else if (strcmp(argv[i], "-lc") == 0 || strcmp(argv[i], "--license") == 0)
       return print_license(), false;
-    else if (strcmp(argv[i], "build") == 0 && i + 1 < argc) {
+    else if ((strcmp(argv[i], "build") == 0 ||
+              strcmp(argv[i], "watch") == 0 ||
+              strcmp(argv[i], "run") == 0) &&
+             i + 1 < argc) {
+      // watch and run take the same options as build
+      config->watch = strcmp(argv[i], "watch") == 0;
+      config->run = strcmp(argv[i], "run") == 0;
       config->filepath = argv[++i];
       for (int j = i + 1; j < argc; j++) {
         if (strcmp(argv[j], "-name") == 0 && j + 1 < argc)
@@ -141,13 +281,54 @@ bool parse_args(int argc, char *argv[], BuildConfig *config,
           config->save = true;
         else if (strcmp(argv[j], "-clean") == 0)
           config->clean = true;
-        else if (strcmp(argv[j], "-debug") == 0) {
+        else if (strcmp(argv[j], "-incremental") == 0)
+          config->incremental = true;
+        else if (strcmp(argv[j], "-cache") == 0 && j + 1 < argc)
+          config->cache = argv[++j];
+        else if (strcmp(argv[j], "--lib=static") == 0)
+          config->lib = LIBRARY_STATIC;
+        else if (strcmp(argv[j], "--lib=shared") == 0)
+          config->lib = LIBRARY_SHARED;
+        else if (strncmp(argv[j], "--codegen-units=", 16) == 0) {
+          char *end;
+          unsigned long units = strtoul(argv[j] + 16, &end, 10);
+          if (*end != '\0' || units == 0) {
+            fprintf(stderr, "Invalid codegen unit count: %s\n", argv[j] + 16);
+            return false;
+          }
+          config->codegen_units = (size_t)units;
+        } else if (strcmp(argv[j], "--dev") == 0)
+          config->dev = true;
+        else if (strcmp(argv[j], "--interp") == 0)
+          config->interp = true;
+        else if (strncmp(argv[j], "--emit=", 7) == 0) {
+          if (!parse_emit(argv[j] + 7, config))
+            return false;
+        } else if (is_bitcode_file(argv[j])) {
+          if (!add_bitcode_file(argv[j], config))
+            return false;
+        } else if (strcmp(argv[j], "-run") == 0)
+          config->run = true;
+        else if (strcmp(argv[j], "-j") == 0 && j + 1 < argc)
+          config->jobs = (size_t)strtoul(argv[++j], NULL, 10);
+        else if (is_include_option(argc, argv, j)) {
+          if (!add_include_dir(argv, &j, config))
+            return false;
+        } else if (is_library_dir_option(argc, argv, j)) {
+          if (!add_library_dir(argv, &j, config))
+            return false;
+        } else if (strcmp(argv[j], "-debug") == 0) {
           // Placeholder for debug flag
         } else if (strcmp(argv[j], "-l") == 0 ||
                    strcmp(argv[j], "-link") == 0) {
           // Collect files until next flag or end of args
           int start = j + 1;
           while (start < argc && argv[start][0] != '-') {
+            if (is_bitcode_file(argv[start])) {
+              if (!add_bitcode_file(argv[start++], config))
+                return false;
+              continue;
+            }
             char **slot = (char **)growable_array_push(&config->files);
             if (!slot) {
               fprintf(stderr, "Failed to add file to array\n");
@@ -163,9 +344,86 @@ bool parse_args(int argc, char *argv[], BuildConfig *config,
           return false;
         }
       }
+    } else if (strcmp(argv[i], "lsp") == 0) {
+      // The language server reads its files from the editor
+      config->lsp = true;
+      for (int j = i + 1; j < argc; j++) {
+        if (is_include_option(argc, argv, j)) {
+          if (!add_include_dir(argv, &j, config))
+            return false;
+        } else {
+          fprintf(stderr, "Unknown lsp option: %s\n", argv[j]);
+          return false;
+        }
+      }
+      i = argc;
+    } else if (strcmp(argv[i], "cache-server") == 0 && i + 1 < argc) {
+      config->cache_server = argv[++i];
+      config->port = BUILD_CACHE_DEFAULT_PORT;
+      for (int j = i + 1; j < argc; j++) {
+        if (strcmp(argv[j], "-port") == 0 && j + 1 < argc) {
+          config->port = (unsigned)strtoul(argv[++j], NULL, 10);
+        } else if (strcmp(argv[j], "-bind") == 0 && j + 1 < argc) {
+          config->bind_address = argv[++j];
+        } else {
+          fprintf(stderr, "Unknown cache-server option: %s\n", argv[j]);
+          return false;
+        }
+      }
+      i = argc;
     }
   }
 
+  // -save keeps the assembly and IR that --emit would name explicitly
+  if (config->emit == 0)
+    config->emit = EMIT_OBJECT | (config->save ? EMIT_ASSEMBLY | EMIT_IR : 0);
+
+  // Watch builds are always incremental (run_watch() turns it on later)
+  bool incremental = config->incremental || config->watch;
+
+  // A program optimized as one module has no per-function objects
+  if (config->bitcode_files.count > 0 && (incremental || config->cache)) {
+    fprintf(stderr, "Error: .bc inputs cannot be combined with -incremental, "
+                    "-cache or watch\n");
+    return false;
+  }
+
+  // .bc inputs exist to be optimized with the program
+  if (config->bitcode_files.count > 0 && config->dev) {
+    fprintf(stderr, "Error: .bc inputs cannot be combined with --dev\n");
+    return false;
+  }
+
+  // Incremental builds reuse objects, which a build without them lacks
+  if (!(config->emit & EMIT_OBJECT) && (incremental || config->cache)) {
+    fprintf(stderr, "Error: --emit without obj cannot be combined with "
+                    "-incremental, -cache or watch\n");
+    return false;
+  }
+
+  // The interpreter runs the typechecked program; nothing is compiled
+  if (config->interp && (!config->run || config->watch)) {
+    fprintf(stderr, "Error: --interp only applies to luma run\n");
+    return false;
+  }
+  if (config->interp &&
+      (config->incremental || config->cache || config->lib != LIBRARY_NONE ||
+       config->bitcode_files.count > 0)) {
+    fprintf(stderr, "Error: --interp cannot be combined with -incremental, "
+                    "-cache, --lib or .bc inputs\n");
+    return false;
+  }
+
+  // CI jobs name the cache once in their environment
+  if (!config->cache && config->bitcode_files.count == 0 &&
+      !config->interp && (config->emit & EMIT_OBJECT))
+    config->cache = getenv(BUILD_CACHE_ENV);
+  if (config->cache && !*config->cache)
+    config->cache = NULL;
+  // The cache holds per-function objects
+  if (config->cache)
+    config->incremental = true;
+
   return true;
 }
 
@@ -20,10 +20,12 @@
 
 /** Macro to access token at index in a token growable array */
 #define TOKEN_AT(i) (((Token *)tokens.data)[(i)])
-#define MAX_TOKENS 100
 
 #define BAR_WIDTH 40
 
+/** Version printed by --version; part of every shared cache key */
+#define COMPILER_VERSION "v1.0"
+
 /** Enable debug logs for arena allocator (comment to disable) */
 #define DEBUG_ARENA_ALLOC 1
 
@@ -38,6 +40,15 @@ typedef enum {
   UNKNOWN_ERROR = 99
 } ErrorCode;
 
+/**
+ * @brief What `--lib` builds instead of an executable.
+ */
+typedef enum {
+  LIBRARY_NONE,   /**< An executable */
+  LIBRARY_STATIC, /**< An archive, lib<name>.a */
+  LIBRARY_SHARED  /**< A shared object, lib<name>.so */
+} LibraryKind;
+
 /**
  * @brief Configuration structure to hold build options parsed from CLI.
  */
@@ -49,8 +60,39 @@ typedef struct {
   bool clean;
   GrowableArray files; // Change from char** to GrowableArray
   size_t file_count;   // Keep for convenience, or remove and use files.count
+  size_t jobs;         // Worker threads (0 = one per CPU)
+  GrowableArray include_dirs; // -I module search directories (char *)
+  GrowableArray library_dirs; // -L C library search directories (char *)
+  bool incremental;           // Per-function objects reused across builds
+  bool watch;                 // luma watch: rebuild whenever an input changes
+  bool run;                   // luma run, -run: run the program once built
+  bool interp;                // luma run --interp: interpret, no codegen
+  bool lsp;                   // luma lsp: serve editors instead of building
+  const char *cache;          // Shared object cache: directory or http:// URL
+  const char *cache_server;   // luma cache-server: directory to serve
+  const char *bind_address;   // luma cache-server: -bind, NULL for loopback
+  unsigned port;              // luma cache-server: port to listen on
+  LibraryKind lib;            // --lib: a C library and header, no main
+  size_t codegen_units;       // --codegen-units: backend units per module
+  unsigned emit;              // --emit: EmitKind artifacts of every unit
+  bool dev;                   // --dev: compile latency over code quality
+  GrowableArray bitcode_files; // .bc inputs optimized with the program
 } BuildConfig;
 
+typedef struct SourceCache SourceCache;
+
+/**
+ * @brief Everything the final link of a program takes, in link order.
+ */
+typedef struct {
+  const char **objects;      /**< Object files */
+  size_t object_count;       /**< Number of @c objects */
+  const char **libraries;    /**< Libraries named by extern declarations */
+  size_t library_count;      /**< Number of @c libraries */
+  const char **library_dirs; /**< -L directories searched for them */
+  size_t library_dir_count;  /**< Number of @c library_dirs */
+} LinkInputs;
+
 bool check_argc(int argc, int expected);
 const char *read_file(const char *filename);
 
@@ -59,10 +101,16 @@ int print_version();
 int print_license();
 
 AstNode *lex_and_parse_file(const char *path, ArenaAllocator *allocator);
+Stmt *parse_file_to_module(const char *path, size_t position, bool skim_bodies,
+                           size_t jobs, ArenaAllocator *allocator);
 
 bool parse_args(int argc, char *argv[], BuildConfig *config,
                 ArenaAllocator *arena);
 bool run_build(BuildConfig config, ArenaAllocator *allocator);
+bool run_build_cached(BuildConfig config, ArenaAllocator *allocator,
+                      SourceCache *cache);
+bool run_watch(BuildConfig config);
+int run_command(BuildConfig config, ArenaAllocator *allocator);
 
 void print_token(const Token *t);
 
@@ -72,6 +120,8 @@ bool link_with_ld(const char *obj_filename, const char *exe_filename);
 bool get_gcc_file_path(const char *filename, char *buffer, size_t buffer_size);
 bool get_lib_paths(char *buffer, size_t buffer_size);
 bool link_with_ld_simple(const char *obj_filename, const char *exe_filename);
-bool link_object_files(const char *output_dir, const char *executable_name);
+bool link_object_files(const char *output_dir, const LinkInputs *inputs,
+                       const char *executable_name);
+bool link_library(const char *output_dir, const LinkInputs *inputs,
+                  LibraryKind kind, const char *library_name);
 bool validate_module_system(CodeGenContext *ctx);
-void save_module_output_files(CodeGenContext *ctx, const char *output_dir);
@@ -0,0 +1,615 @@
+/**
+ * @file incremental.c
+ * @brief Per-function hashes and the manifest of incremental builds.
+ *
+ * @see incremental.h
+ */
+
+#include "incremental.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../lexer/lexer.h"
+#include "../llvm/llvm.h"
+
+/** Bump whenever code generation changes, to invalidate every object */
+#define INCREMENTAL_VERSION 1
+
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+static uint64_t mix_bytes(uint64_t hash, const void *data, size_t length) {
+  const unsigned char *bytes = (const unsigned char *)data;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ bytes[i]) * FNV_PRIME;
+  }
+  return hash;
+}
+
+static uint64_t mix_u64(uint64_t hash, uint64_t value) {
+  return mix_bytes(hash, &value, sizeof(value));
+}
+
+// Includes the terminator, so "ab","c" and "a","bc" differ
+static uint64_t mix_str(uint64_t hash, const char *text) {
+  return text ? mix_bytes(hash, text, strlen(text) + 1) : mix_u64(hash, 0);
+}
+
+// =============================================================================
+// NAME TABLE
+// =============================================================================
+
+// Open-addressing map from a (not necessarily terminated) name to a hash, so
+// identifiers can be looked up straight from the token text
+typedef struct {
+  const char *name;
+  size_t length;
+  uint64_t value;
+} NameSlot;
+
+typedef struct {
+  NameSlot *slots;
+  size_t capacity; // Power of two, at least twice the number of names
+} NameTable;
+
+static bool table_init(NameTable *table, size_t count, ArenaAllocator *arena) {
+  table->capacity = 16;
+  while (table->capacity < count * 2) {
+    table->capacity *= 2;
+  }
+  table->slots = arena_alloc(arena, table->capacity * sizeof(NameSlot),
+                             alignof(NameSlot));
+  if (!table->slots) {
+    return false;
+  }
+  memset(table->slots, 0, table->capacity * sizeof(NameSlot));
+  return true;
+}
+
+static NameSlot *table_slot(const NameTable *table, const char *name,
+                            size_t length) {
+  size_t mask = table->capacity - 1;
+  size_t i = (size_t)mix_bytes(FNV_OFFSET, name, length) & mask;
+  while (table->slots[i].name &&
+         (table->slots[i].length != length ||
+          memcmp(table->slots[i].name, name, length) != 0)) {
+    i = (i + 1) & mask;
+  }
+  return &table->slots[i];
+}
+
+static void table_put(NameTable *table, const char *name, uint64_t value) {
+  NameSlot *slot = table_slot(table, name, strlen(name));
+  slot->name = name;
+  slot->length = strlen(name);
+  slot->value = value;
+}
+
+static const NameSlot *table_get(const NameTable *table, const char *name,
+                                 size_t length) {
+  const NameSlot *slot = table_slot(table, name, length);
+  return slot->name ? slot : NULL;
+}
+
+// =============================================================================
+// DECLARATION HASHES
+// =============================================================================
+
+static uint64_t hash_type(uint64_t hash, AstNode *type) {
+  if (!type) {
+    return mix_u64(hash, 0);
+  }
+
+  hash = mix_u64(hash, type->type);
+  switch (type->type) {
+  case AST_TYPE_BASIC:
+    return mix_str(hash, type->type_data.basic.name);
+  case AST_TYPE_POINTER:
+    return hash_type(hash, type->type_data.pointer.pointee_type);
+  case AST_TYPE_ARRAY: {
+    AstNode *size = type->type_data.array.size;
+    hash = hash_type(hash, type->type_data.array.element_type);
+    if (size && size->type == AST_EXPR_LITERAL) {
+      return mix_u64(hash, (uint64_t)size->expr.literal.value.int_val);
+    }
+    return mix_u64(hash, size ? size->type : 0);
+  }
+  case AST_TYPE_FUNCTION:
+    for (size_t i = 0; i < type->type_data.function.param_count; i++) {
+      hash = hash_type(hash, type->type_data.function.param_types[i]);
+    }
+    return hash_type(hash, type->type_data.function.return_type);
+  default:
+    return hash;
+  }
+}
+
+static const char *declaration_name(AstNode *stmt) {
+  switch (stmt->type) {
+  case AST_STMT_FUNCTION:
+    return stmt->stmt.func_decl.name;
+  case AST_STMT_VAR_DECL:
+    return stmt->stmt.var_decl.name;
+  case AST_STMT_STRUCT:
+    return stmt->stmt.struct_decl.name;
+  case AST_STMT_ENUM:
+    return stmt->stmt.enum_decl.name;
+  default:
+    return NULL;
+  }
+}
+
+static uint64_t hash_function_signature(uint64_t hash, AstNode *func) {
+  hash = mix_str(hash, func->stmt.func_decl.name);
+  hash = mix_u64(hash, func->stmt.func_decl.is_public);
+  hash = mix_u64(hash, func->stmt.func_decl.param_count);
+  for (size_t i = 0; i < func->stmt.func_decl.param_count; i++) {
+    hash = hash_type(hash, func->stmt.func_decl.param_types[i]);
+  }
+  return hash_type(hash, func->stmt.func_decl.return_type);
+}
+
+static uint64_t hash_members(uint64_t hash, AstNode **members, size_t count) {
+  hash = mix_u64(hash, count);
+  for (size_t i = 0; i < count; i++) {
+    AstNode *member = members[i];
+    hash = mix_str(hash, member->stmt.field_decl.name);
+    hash = mix_u64(hash, member->stmt.field_decl.is_public);
+    hash = hash_type(hash, member->stmt.field_decl.type);
+    if (member->stmt.field_decl.function) {
+      hash = hash_function_signature(hash, member->stmt.field_decl.function);
+    }
+  }
+  return hash;
+}
+
+// Everything about a top-level declaration that code using it depends on
+static uint64_t hash_declaration(AstNode *stmt) {
+  uint64_t hash = mix_u64(FNV_OFFSET, stmt->type);
+  switch (stmt->type) {
+  case AST_STMT_FUNCTION:
+    // Callers of an extern function call its unqualified C symbol
+    hash = mix_u64(hash, stmt->stmt.func_decl.is_extern);
+    hash = mix_str(hash, stmt->stmt.func_decl.library);
+    return hash_function_signature(hash, stmt);
+  case AST_STMT_VAR_DECL:
+    hash = mix_str(hash, stmt->stmt.var_decl.name);
+    hash = mix_u64(hash, stmt->stmt.var_decl.is_public);
+    hash = mix_u64(hash, stmt->stmt.var_decl.is_mutable);
+    return hash_type(hash, stmt->stmt.var_decl.var_type);
+  case AST_STMT_STRUCT:
+    hash = mix_str(hash, stmt->stmt.struct_decl.name);
+    hash = mix_u64(hash, stmt->stmt.struct_decl.is_public);
+    hash = hash_members(hash, stmt->stmt.struct_decl.public_members,
+                        stmt->stmt.struct_decl.public_count);
+    return hash_members(hash, stmt->stmt.struct_decl.private_members,
+                        stmt->stmt.struct_decl.private_count);
+  case AST_STMT_ENUM:
+    hash = mix_str(hash, stmt->stmt.enum_decl.name);
+    hash = mix_u64(hash, stmt->stmt.enum_decl.is_public);
+    for (size_t i = 0; i < stmt->stmt.enum_decl.member_count; i++) {
+      hash = mix_str(hash, stmt->stmt.enum_decl.members[i]);
+    }
+    return hash;
+  default:
+    return hash;
+  }
+}
+
+// =============================================================================
+// FUNCTION HASHES
+// =============================================================================
+
+typedef struct {
+  const char *alias; // NULL: names are imported unqualified
+  size_t module;     // Index into the graph, graph->count if unknown
+} ModuleUse;
+
+typedef struct {
+  NameTable decls;     // Top-level name -> hash_declaration()
+  ModuleUse *uses;
+  size_t use_count;
+} ModuleDecls;
+
+static bool collect_module(ModuleDecls *decls, const ModuleGraph *graph,
+                           AstNode *module, ArenaAllocator *arena) {
+  AstNode **body = module->preprocessor.module.body;
+  size_t body_count = module->preprocessor.module.body_count;
+
+  decls->uses = arena_alloc(arena, (body_count + 1) * sizeof(ModuleUse),
+                            alignof(ModuleUse));
+  decls->use_count = 0;
+  if (!decls->uses || !table_init(&decls->decls, body_count, arena)) {
+    return false;
+  }
+
+  for (size_t i = 0; i < body_count; i++) {
+    if (!body[i]) {
+      continue;
+    }
+    if (body[i]->type == AST_PREPROCESSOR_USE) {
+      decls->uses[decls->use_count++] = (ModuleUse){
+          body[i]->preprocessor.use.alias,
+          module_graph_find(graph, body[i]->preprocessor.use.module_name)};
+      continue;
+    }
+
+    const char *name = declaration_name(body[i]);
+    if (name) {
+      table_put(&decls->decls, name, hash_declaration(body[i]));
+    }
+  }
+  return true;
+}
+
+static uint64_t mix_decl(uint64_t hash, const ModuleDecls *decls, size_t tag,
+                         const Token *name) {
+  const NameSlot *slot = table_get(&decls->decls, name->value, name->length);
+  return slot ? mix_u64(mix_u64(hash, tag), slot->value) : hash;
+}
+
+static uint64_t hash_function(const ModuleDecls *all, size_t module_count,
+                              size_t module, const char *module_name,
+                              const char *options, AstNode *func) {
+  const ModuleDecls *own = &all[module];
+  uint64_t hash = mix_u64(FNV_OFFSET, INCREMENTAL_VERSION);
+  hash = mix_str(hash, options);
+  hash = mix_str(hash, module_name);
+  hash = mix_u64(hash, hash_declaration(func));
+
+  const DeferredBody *body = func->stmt.func_decl.deferred;
+  const Token *tokens = (const Token *)body->tokens;
+  for (size_t i = 0; i < body->token_count; i++) {
+    hash = mix_u64(hash, tokens[i].type_);
+    hash = mix_bytes(hash, tokens[i].value, (size_t)tokens[i].length);
+    if (tokens[i].type_ != TOK_IDENTIFIER) {
+      continue;
+    }
+
+    // The name can be a local too; depending on a declaration it does not
+    // use only costs a rebuild now and then
+    hash = mix_decl(hash, own, 0, &tokens[i]);
+
+    bool qualified = i + 2 < body->token_count &&
+                     tokens[i + 1].type_ == TOK_DOT &&
+                     tokens[i + 2].type_ == TOK_IDENTIFIER;
+    for (size_t u = 0; u < own->use_count; u++) {
+      const ModuleUse *use = &own->uses[u];
+      if (use->module >= module_count) {
+        continue;
+      }
+      if (!use->alias) {
+        hash = mix_decl(hash, &all[use->module], u + 1, &tokens[i]);
+      } else if (qualified &&
+                 strlen(use->alias) == (size_t)tokens[i].length &&
+                 memcmp(use->alias, tokens[i].value, tokens[i].length) == 0) {
+        hash = mix_decl(hash, &all[use->module], u + 1, &tokens[i + 2]);
+      }
+    }
+  }
+  return hash;
+}
+
+// =============================================================================
+// MANIFEST
+// =============================================================================
+
+static bool write_manifest(const IncrementalBuild *build, bool reused_only) {
+  char path[512];
+  snprintf(path, sizeof(path), "%s/%s", build->dir, INCREMENTAL_MANIFEST);
+
+  FILE *file = fopen(path, "w");
+  if (!file) {
+    fprintf(stderr, "Failed to write %s\n", path);
+    return false;
+  }
+
+  fprintf(file, "lux-incremental %d\n", INCREMENTAL_VERSION);
+  const IncrementalEntry *entries =
+      (const IncrementalEntry *)build->current.data;
+  for (size_t i = 0; i < build->current.count; i++) {
+    if (reused_only && !entries[i].reused) {
+      continue;
+    }
+    fprintf(file, "%016" PRIx64 " %s %s\n", entries[i].hash,
+            entries[i].module, entries[i].function);
+  }
+
+  bool ok = !ferror(file);
+  return fclose(file) == 0 && ok;
+}
+
+static bool read_manifest(IncrementalBuild *build) {
+  char path[512];
+  snprintf(path, sizeof(path), "%s/%s", build->dir, INCREMENTAL_MANIFEST);
+
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    return true; // First incremental build
+  }
+
+  char line[1024];
+  int version = 0;
+  if (!fgets(line, sizeof(line), file) ||
+      sscanf(line, "lux-incremental %d", &version) != 1 ||
+      version != INCREMENTAL_VERSION) {
+    fclose(file);
+    return true; // Written by another compiler version: reuse nothing
+  }
+
+  bool ok = true;
+  while (ok && fgets(line, sizeof(line), file)) {
+    uint64_t hash;
+    char module[256], function[256];
+    if (sscanf(line, "%" SCNx64 " %255s %255s", &hash, module, function) !=
+        3) {
+      continue;
+    }
+
+    IncrementalEntry *entry =
+        (IncrementalEntry *)growable_array_push(&build->previous);
+    ok = entry != NULL;
+    if (ok) {
+      *entry = (IncrementalEntry){arena_strdup(build->arena, module),
+                                  arena_strdup(build->arena, function), hash,
+                                  false};
+      ok = entry->module && entry->function;
+    }
+  }
+
+  fclose(file);
+  return ok;
+}
+
+static char *entry_key(ArenaAllocator *arena, const char *module,
+                       const char *function) {
+  size_t size = strlen(module) + strlen(function) + 2;
+  char *key = arena_alloc(arena, size, alignof(char));
+  if (key) {
+    snprintf(key, size, "%s.%s", module, function);
+  }
+  return key;
+}
+
+// =============================================================================
+// SHARED CACHE
+// =============================================================================
+
+typedef struct {
+  IncrementalBuild *build;
+  IncrementalEntry *entry;
+  AstNode *function; // Marked reuse_object on a hit; NULL when storing
+  bool ok;
+} CacheTask;
+
+static void fetch_task(void *arg, size_t worker) {
+  (void)worker;
+  CacheTask *task = (CacheTask *)arg;
+  char object[512];
+  function_object_path(object, sizeof(object), task->build->dir,
+                       task->entry->module, task->entry->function);
+  task->ok = build_cache_fetch(task->build->cache, task->entry->hash, object);
+}
+
+static void store_task(void *arg, size_t worker) {
+  (void)worker;
+  CacheTask *task = (CacheTask *)arg;
+  char object[512];
+  function_object_path(object, sizeof(object), task->build->dir,
+                       task->entry->module, task->entry->function);
+  task->ok = build_cache_store(task->build->cache, task->entry->hash, object);
+}
+
+// Fetching or storing an object is mostly waiting on the disk or the
+// network, so all of them run at once on the pool
+static void run_cache_tasks(CacheTask *tasks, size_t count, ThreadPool *pool,
+                            ThreadPoolTask run) {
+  for (size_t i = 0; i < count; i++) {
+    if (!pool || !thread_pool_submit(pool, run, &tasks[i])) {
+      run(&tasks[i], 0);
+    }
+  }
+  if (pool) {
+    thread_pool_wait(pool);
+  }
+}
+
+// Functions planned for code generation whose object the cache has
+static bool fetch_objects(IncrementalBuild *build, AstNode **functions,
+                          ThreadPool *pool) {
+  IncrementalEntry *entries = (IncrementalEntry *)build->current.data;
+  CacheTask *tasks =
+      arena_alloc(build->arena, build->current.count * sizeof(CacheTask),
+                  alignof(CacheTask));
+  if (!tasks) {
+    return false;
+  }
+
+  size_t count = 0;
+  for (size_t i = 0; i < build->current.count; i++) {
+    if (!entries[i].reused) {
+      tasks[count++] = (CacheTask){build, &entries[i], functions[i], false};
+    }
+  }
+  run_cache_tasks(tasks, count, pool, fetch_task);
+
+  for (size_t i = 0; i < count; i++) {
+    if (tasks[i].ok) {
+      tasks[i].entry->reused = true;
+      tasks[i].function->stmt.func_decl.reuse_object = true;
+      build->reused++;
+      build->fetched++;
+    }
+  }
+  return true;
+}
+
+// =============================================================================
+// BUILD
+// =============================================================================
+
+bool incremental_begin(IncrementalBuild *build, const char *output_dir,
+                       const char *options, BuildCache *cache,
+                       ArenaAllocator *arena) {
+  build->arena = arena;
+  build->options = options;
+  build->reused = 0;
+  build->cache = cache;
+  build->fetched = 0;
+  build->stored = 0;
+
+  size_t size = strlen(output_dir) + sizeof(INCREMENTAL_DIR) + 1;
+  build->dir = arena_alloc(arena, size, alignof(char));
+  if (!build->dir ||
+      !growable_array_init(&build->previous, arena, 64,
+                           sizeof(IncrementalEntry)) ||
+      !growable_array_init(&build->current, arena, 64,
+                           sizeof(IncrementalEntry))) {
+    fprintf(stderr, "Out of memory while starting incremental build\n");
+    return false;
+  }
+  snprintf(build->dir, size, "%s/%s", output_dir, INCREMENTAL_DIR);
+
+  if ((mkdir(output_dir, 0755) != 0 && errno != EEXIST) ||
+      (mkdir(build->dir, 0755) != 0 && errno != EEXIST)) {
+    fprintf(stderr, "Failed to create directory: %s\n", build->dir);
+    return false;
+  }
+
+  if (!read_manifest(build)) {
+    fprintf(stderr, "Out of memory while reading the incremental manifest\n");
+    return false;
+  }
+  return true;
+}
+
+bool incremental_plan(IncrementalBuild *build, const ModuleGraph *graph,
+                      ThreadPool *pool) {
+  ArenaAllocator *arena = build->arena;
+
+  ModuleDecls *decls = arena_alloc(arena, graph->count * sizeof(ModuleDecls),
+                                   alignof(ModuleDecls));
+  NameTable previous;
+  if (!decls || !table_init(&previous, build->previous.count, arena)) {
+    return false;
+  }
+  for (size_t m = 0; m < graph->count; m++) {
+    if (!collect_module(&decls[m], graph, graph->nodes[m].module, arena)) {
+      return false;
+    }
+  }
+
+  // Previous hashes by object name; the index is kept to spot stale entries
+  IncrementalEntry *old = (IncrementalEntry *)build->previous.data;
+  for (size_t i = 0; i < build->previous.count; i++) {
+    char *key = entry_key(arena, old[i].module, old[i].function);
+    if (!key) {
+      return false;
+    }
+    table_put(&previous, key, i);
+  }
+
+  // Function of every entry of build->current, for the cache to mark
+  GrowableArray functions;
+  if (!growable_array_init(&functions, arena, 64, sizeof(AstNode *))) {
+    return false;
+  }
+
+  for (size_t m = 0; m < graph->count; m++) {
+    AstNode *module = graph->nodes[m].module;
+    for (size_t i = 0; i < module->preprocessor.module.body_count; i++) {
+      AstNode *stmt = module->preprocessor.module.body[i];
+      if (!stmt || stmt->type != AST_STMT_FUNCTION ||
+          !stmt->stmt.func_decl.deferred) {
+        continue;
+      }
+
+      IncrementalEntry *entry =
+          (IncrementalEntry *)growable_array_push(&build->current);
+      AstNode **function = (AstNode **)growable_array_push(&functions);
+      if (!entry || !function) {
+        return false;
+      }
+      *function = stmt;
+      const char *name = stmt->stmt.func_decl.name;
+      *entry = (IncrementalEntry){
+          graph->nodes[m].name, name,
+          hash_function(decls, graph->count, m, graph->nodes[m].name,
+                        build->options, stmt),
+          false};
+
+      char *key = entry_key(arena, entry->module, name);
+      if (!key) {
+        return false;
+      }
+      const NameSlot *slot = table_get(&previous, key, strlen(key));
+      if (!slot) {
+        continue;
+      }
+
+      // Claimed: whatever is left unclaimed afterwards is stale
+      old[slot->value].reused = true;
+
+      char object[512];
+      function_object_path(object, sizeof(object), build->dir, entry->module,
+                           name);
+      if (old[slot->value].hash == entry->hash && access(object, R_OK) == 0) {
+        entry->reused = true;
+        stmt->stmt.func_decl.reuse_object = true;
+        build->reused++;
+      }
+    }
+  }
+
+  // Objects of functions that were removed would still be linked
+  for (size_t i = 0; i < build->previous.count; i++) {
+    if (!old[i].reused) {
+      char object[512];
+      function_object_path(object, sizeof(object), build->dir, old[i].module,
+                           old[i].function);
+      unlink(object);
+    }
+  }
+
+  // The manifest stops vouching for the objects a fetch may overwrite first,
+  // and vouches for the fetched ones once they are complete
+  if (!write_manifest(build, true)) {
+    return false;
+  }
+  if (!build->cache) {
+    return true;
+  }
+  return fetch_objects(build, (AstNode **)functions.data, pool) &&
+         (build->fetched == 0 || write_manifest(build, true));
+}
+
+bool incremental_commit(IncrementalBuild *build, ThreadPool *pool) {
+  if (build->cache) {
+    IncrementalEntry *entries = (IncrementalEntry *)build->current.data;
+    CacheTask *tasks =
+        arena_alloc(build->arena, build->current.count * sizeof(CacheTask),
+                    alignof(CacheTask));
+    if (!tasks) {
+      return false;
+    }
+
+    // Only what this build generated: the objects it reused came from the
+    // cache or from an earlier build
+    size_t count = 0;
+    for (size_t i = 0; i < build->current.count; i++) {
+      if (!entries[i].reused) {
+        tasks[count++] = (CacheTask){build, &entries[i], NULL, false};
+      }
+    }
+    run_cache_tasks(tasks, count, pool, store_task);
+    for (size_t i = 0; i < count; i++) {
+      build->stored += tasks[i].ok;
+    }
+  }
+  return write_manifest(build, false);
+}
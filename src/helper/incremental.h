@@ -0,0 +1,103 @@
+/**
+ * @file incremental.h
+ * @brief Function-level incremental builds (`-incremental`).
+ *
+ * Every function is compiled to an object file of its own (see
+ * CodeGenContext.function_object_dir) and a manifest in the same directory
+ * records one hash per function. The hash covers:
+ *
+ * - the code generation options that change objects (e.g. `--dev`)
+ * - the function's module, name, visibility and signature
+ * - the tokens of its body, without their positions, so edits elsewhere in
+ *   the file leave it alone
+ * - the declaration of every top-level name its body mentions, in its own
+ *   module or through an `@use`
+ *
+ * A function whose hash matches the last successful build and whose object
+ * file is still there is marked reuse_object: its body is never parsed,
+ * typechecked or generated, and the cached object is linked instead. Bodies
+ * must have been skimmed by the parser, which keeps their tokens around.
+ *
+ * With a shared cache (see build_cache.h), a function that cannot be reused
+ * from the last build is looked up in the cache by the same hash, and the
+ * objects this build generates are stored there.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../ast/module_graph.h"
+#include "../c_libs/memory/memory.h"
+#include "../c_libs/thread/thread_pool.h"
+#include "build_cache.h"
+
+/** Subdirectory of the object directory holding the function objects */
+#define INCREMENTAL_DIR "functions"
+
+/** Manifest file inside INCREMENTAL_DIR */
+#define INCREMENTAL_MANIFEST "manifest"
+
+/**
+ * @brief Hash of one function, as recorded in the manifest.
+ */
+typedef struct {
+  const char *module;   /**< Module name */
+  const char *function; /**< Function name */
+  uint64_t hash;        /**< Hash of everything its object depends on */
+  bool reused; /**< This build: object reused; last build: still a function */
+} IncrementalEntry;
+
+/**
+ * @brief State of one incremental build.
+ */
+typedef struct {
+  char *dir;              /**< Directory of the function objects */
+  const char *options;    /**< Code generation options, in every hash */
+  GrowableArray previous; /**< IncrementalEntry of the last build */
+  GrowableArray current;  /**< IncrementalEntry of this build */
+  size_t reused;          /**< Functions whose object is linked as is */
+  BuildCache *cache;      /**< Shared cache, NULL if none */
+  size_t fetched;         /**< Of @c reused, objects fetched from the cache */
+  size_t stored;          /**< Objects stored in the cache by this build */
+  ArenaAllocator *arena;  /**< Arena for the entries and names */
+} IncrementalBuild;
+
+/**
+ * @brief Creates the function object directory and reads its manifest.
+ *
+ * A missing or unreadable manifest just means nothing can be reused.
+ *
+ * @param build Build state to initialize.
+ * @param output_dir Object directory of the build.
+ * @param options Code generation options that change the objects, as given
+ *                to build_cache_open.
+ * @param cache Shared cache to fetch from and store to, or NULL.
+ * @param arena Arena for everything the build state allocates.
+ * @return false if the directory cannot be created or memory runs out.
+ */
+bool incremental_begin(IncrementalBuild *build, const char *output_dir,
+                       const char *options, BuildCache *cache,
+                       ArenaAllocator *arena);
+
+/**
+ * @brief Hashes every top-level function and marks the reusable ones.
+ *
+ * Objects of functions that no longer exist are deleted, and the manifest
+ * is rewritten to vouch only for the objects this build will not touch, so
+ * a build that fails half way never leaves a stale object behind a matching
+ * hash. Objects missing locally are fetched from the cache, on @p pool.
+ *
+ * @return false if memory runs out.
+ */
+bool incremental_plan(IncrementalBuild *build, const ModuleGraph *graph,
+                      ThreadPool *pool);
+
+/**
+ * @brief Records the hashes of this build once its objects are written, and
+ * stores the objects it generated in the cache, on @p pool.
+ * @return false if the manifest cannot be written.
+ */
+bool incremental_commit(IncrementalBuild *build, ThreadPool *pool);
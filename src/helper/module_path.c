@@ -0,0 +1,173 @@
+/**
+ * @file module_path.c
+ * @brief Module search directories and index files.
+ *
+ * @see module_path.h
+ */
+
+#include "module_path.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * @brief Join a directory and a relative path; absolute paths are kept
+ */
+static char *join_path(ArenaAllocator *arena, const char *dir,
+                       const char *path, size_t path_len) {
+  bool absolute = path_len > 0 && path[0] == '/';
+  size_t dir_len = absolute ? 0 : strlen(dir);
+  char *joined = arena_alloc(arena, dir_len + path_len + 2, alignof(char));
+  if (!joined) {
+    return NULL;
+  }
+
+  size_t n = 0;
+  if (!absolute) {
+    memcpy(joined, dir, dir_len);
+    n = dir_len;
+    if (n > 0 && joined[n - 1] != '/') {
+      joined[n++] = '/';
+    }
+  }
+  memcpy(joined + n, path, path_len);
+  joined[n + path_len] = '\0';
+  return joined;
+}
+
+/**
+ * @brief Copy the next whitespace-delimited word of @p line, advancing it
+ */
+static char *next_word(ArenaAllocator *arena, const char **line,
+                       size_t *length) {
+  const char *start = *line;
+  while (*start && isspace((unsigned char)*start)) {
+    start++;
+  }
+  const char *end = start;
+  while (*end && !isspace((unsigned char)*end)) {
+    end++;
+  }
+  *line = end;
+  *length = (size_t)(end - start);
+  if (*length == 0) {
+    return NULL;
+  }
+
+  char *word = arena_alloc(arena, *length + 1, alignof(char));
+  if (word) {
+    memcpy(word, start, *length);
+    word[*length] = '\0';
+  }
+  return word;
+}
+
+/**
+ * @brief Add the entries of one directory's index file, if it has one
+ */
+static bool read_index(ModuleSearchPath *search, size_t dir) {
+  const char *index_path =
+      join_path(search->arena, search->dirs[dir], MODULE_INDEX_FILE,
+                strlen(MODULE_INDEX_FILE));
+  if (!index_path) {
+    return false;
+  }
+
+  FILE *file = fopen(index_path, "r");
+  if (!file) {
+    return true; // An index is optional
+  }
+
+  char line[1024];
+  size_t line_number = 0;
+  bool ok = true;
+  while (ok && fgets(line, sizeof(line), file)) {
+    line_number++;
+
+    const char *cursor = line;
+    size_t name_len;
+    char *name = next_word(search->arena, &cursor, &name_len);
+    if (!name || name[0] == '#') {
+      continue;
+    }
+
+    const char *path = cursor;
+    while (*path && isspace((unsigned char)*path)) {
+      path++;
+    }
+    size_t path_len = 0;
+    while (path[path_len] && !isspace((unsigned char)path[path_len])) {
+      path_len++;
+    }
+    if (path_len == 0) {
+      fprintf(stderr, "Warning: %s:%zu: module '%s' has no path\n", index_path,
+              line_number, name);
+      continue;
+    }
+
+    ModuleIndexEntry *entry =
+        (ModuleIndexEntry *)growable_array_push(&search->entries);
+    if (!entry) {
+      ok = false;
+      break;
+    }
+    entry->name = name;
+    entry->path = join_path(search->arena, search->dirs[dir], path, path_len);
+    entry->dir = dir;
+    ok = entry->path != NULL;
+  }
+
+  fclose(file);
+  return ok;
+}
+
+bool module_search_path_init(ModuleSearchPath *search, const char **dirs,
+                             size_t dir_count, ArenaAllocator *arena) {
+  search->dirs = dirs;
+  search->dir_count = dir_count;
+  search->arena = arena;
+  if (!growable_array_init(&search->entries, arena, 16,
+                           sizeof(ModuleIndexEntry))) {
+    return false;
+  }
+
+  for (size_t i = 0; i < dir_count; i++) {
+    if (!read_index(search, i)) {
+      fprintf(stderr, "Out of memory while reading module index of '%s'\n",
+              dirs[i]);
+      return false;
+    }
+  }
+  return true;
+}
+
+const char *module_search_path_find(const ModuleSearchPath *search,
+                                    const char *name) {
+  const ModuleIndexEntry *entries =
+      (const ModuleIndexEntry *)search->entries.data;
+
+  for (size_t dir = 0; dir < search->dir_count; dir++) {
+    for (size_t i = 0; i < search->entries.count; i++) {
+      if (entries[i].dir == dir && strcmp(entries[i].name, name) == 0) {
+        return entries[i].path;
+      }
+    }
+
+    size_t name_len = strlen(name);
+    char *file_name = arena_alloc(search->arena, name_len + 4, alignof(char));
+    if (!file_name) {
+      return NULL;
+    }
+    memcpy(file_name, name, name_len);
+    memcpy(file_name + name_len, ".lx", 4);
+
+    char *candidate =
+        join_path(search->arena, search->dirs[dir], file_name, name_len + 3);
+    if (candidate && access(candidate, R_OK) == 0) {
+      return candidate;
+    }
+  }
+  return NULL;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file module_path.h
+ * @brief Locating module source files for `@use` directives.
+ *
+ * A module named by `@use "name"` that was not given on the command line is
+ * looked up in the `-I` search directories, in order. In each directory:
+ *
+ * - an index file (`MODULE_INDEX_FILE`) may map module names to files, one
+ *   `name path` pair per line; relative paths are relative to the directory,
+ *   blank lines and lines starting with `#` are ignored
+ * - otherwise `<dir>/<name>.lx` is used if it exists
+ *
+ * Index files are read once, when the search path is created.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "../c_libs/memory/memory.h"
+
+/** Name of the per-directory module index file */
+#define MODULE_INDEX_FILE "modules.index"
+
+/**
+ * @brief One `name path` line of a module index.
+ */
+typedef struct {
+  const char *name; /**< Module name as written in `@use` */
+  const char *path; /**< Source file, already joined with its directory */
+  size_t dir;       /**< Search directory the entry came from */
+} ModuleIndexEntry;
+
+/**
+ * @brief Ordered module search directories and their indexes.
+ */
+typedef struct {
+  const char **dirs;     /**< Search directories, highest priority first */
+  size_t dir_count;      /**< Number of directories */
+  GrowableArray entries; /**< ModuleIndexEntry from every index file */
+  ArenaAllocator *arena; /**< Arena for paths and entries */
+} ModuleSearchPath;
+
+/**
+ * @brief Creates a search path and reads the directories' index files.
+ *
+ * Malformed index lines are reported on stderr and skipped.
+ *
+ * @param search Search path to initialize.
+ * @param dirs Directories in priority order.
+ * @param dir_count Number of directories.
+ * @param arena Arena for everything the search path allocates.
+ * @return false if out of memory.
+ */
+bool module_search_path_init(ModuleSearchPath *search, const char **dirs,
+                             size_t dir_count, ArenaAllocator *arena);
+
+/**
+ * @brief Finds the source file of a module.
+ *
+ * Directories are tried in order; within a directory the index wins over
+ * `<dir>/<name>.lx`.
+ *
+ * @return Path of the module's source file, or NULL if no directory has it.
+ */
+const char *module_search_path_find(const ModuleSearchPath *search,
+                                    const char *name);
@@ -1,14 +1,23 @@
 #include "../ast/ast_utils.h"
 #include "../c_libs/error/error.h"
+#include "../interp/interp.h"
 #include "../llvm/llvm.h"
 #include "../parser/parser.h"
 #include "../typechecker/type.h"
+#include "build_cache.h"
+#include "c_header.h"
 #include "help.h"
+#include "incremental.h"
+#include "module_path.h"
+#include "watch.h"
 
 #include <errno.h>
 #include <stdbool.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#ifndef _WIN32
+#include <sys/wait.h>
+#endif
 
 // Helper function to create directory if it doesn't exist
 bool create_directory(const char *path) {
@@ -19,53 +28,28 @@ bool create_directory(const char *path) {
 #endif
 }
 
-void save_module_output_files(CodeGenContext *ctx, const char *output_dir) {
-  // Create output directory if it doesn't exist
-  if (!create_directory(output_dir)) {
-    fprintf(stderr, "Warning: Failed to create output directory: %s\n",
-            output_dir);
-  }
-
-  // Save IR and assembly for each module
-  for (ModuleCompilationUnit *unit = ctx->modules; unit; unit = unit->next) {
-    char filename[512];
-
-    // Set current module for legacy functions
-    set_current_module(ctx, unit);
-    ctx->module = unit->module; // Update legacy field
-
-    // Save readable LLVM IR
-    snprintf(filename, sizeof(filename), "%s/%s.ll", output_dir,
-             unit->module_name);
-    char *ir = print_llvm_ir(ctx);
-    if (ir) {
-      FILE *f = fopen(filename, "w");
-      if (f) {
-        fprintf(f, "%s", ir);
-        fclose(f);
-        // printf("Generated IR file: %s\n", filename);
-      }
-      LLVMDisposeMessage(ir);
-    }
-
-    // Generate assembly file
-    snprintf(filename, sizeof(filename), "%s/%s.s", output_dir,
-             unit->module_name);
-    generate_assembly_file(ctx, filename);
-    // printf("Generated assembly file: %s\n", filename);
-  }
-}
-
 // Update your generate_llvm_code_modules function:
-bool generate_llvm_code_modules(AstNode *root, BuildConfig config,
+bool generate_llvm_code_modules(AstNode *root, const ModuleGraph *graph,
+                                ThreadPool *pool, BuildConfig config,
+                                const char *output_dir,
+                                const char *function_object_dir,
                                 ArenaAllocator *allocator, int *step) {
   CodeGenContext *ctx = init_codegen_context(allocator);
   if (!ctx) {
     return false;
   }
+  ctx->function_object_dir = function_object_dir;
+  // Per-function objects already spread the work; a whole program
+  // optimized with bitcode inputs is one module
+  if (!function_object_dir && config.bitcode_files.count == 0 &&
+      config.codegen_units > 1)
+    ctx->codegen_units = config.codegen_units;
+  ctx->emit = config.emit;
+  ctx->dev = config.dev;
+  ctx->bitcode_inputs = (const char **)config.bitcode_files.data;
+  ctx->bitcode_input_count = config.bitcode_files.count;
 
   const char *base_name = config.name ? config.name : "output";
-  const char *output_dir = config.save ? "output" : "obj";
 
   // Create output directory
   if (!create_directory(output_dir)) {
@@ -75,7 +59,7 @@ bool generate_llvm_code_modules(AstNode *root, BuildConfig config,
   }
 
   // Generate LLVM IR for all modules using the new multi-module system
-  bool success = generate_program_modules(ctx, root, output_dir);
+  bool success = generate_program_modules(ctx, root, graph, pool, output_dir);
   if (!success) {
     fprintf(stderr, "Failed to generate LLVM modules\n");
     cleanup_codegen_context(ctx);
@@ -91,15 +75,10 @@ bool generate_llvm_code_modules(AstNode *root, BuildConfig config,
   //   return false;
   // }
 
-  if (config.save) {
-    // Save detailed output files for debugging
-    save_module_output_files(ctx, output_dir);
-
-    // Print module information for debugging
-    // print_module_info(ctx);
-
-    // Debug object files
-    // debug_object_files(output_dir);
+  // --emit without obj: the assembly, IR or bitcode was all that was asked
+  if (!(config.emit & EMIT_OBJECT)) {
+    cleanup_codegen_context(ctx);
+    return true;
   }
 
   // Link all object files together to create final executable
@@ -107,7 +86,16 @@ bool generate_llvm_code_modules(AstNode *root, BuildConfig config,
   snprintf(exe_file, sizeof(exe_file), "%s", base_name);
 
   // printf("Linking modules into executable: %s\n", exe_file);
-  if (!link_object_files(output_dir, exe_file)) {
+  LinkInputs inputs = {(const char **)ctx->object_files.data,
+                       ctx->object_files.count,
+                       (const char **)ctx->link_libraries.data,
+                       ctx->link_libraries.count,
+                       (const char **)config.library_dirs.data,
+                       config.library_dirs.count};
+  bool linked = config.lib != LIBRARY_NONE
+                    ? link_library(output_dir, &inputs, config.lib, base_name)
+                    : link_object_files(output_dir, &inputs, exe_file);
+  if (!linked) {
     fprintf(stderr, "Failed to link object files\n");
 
     // Try to provide more helpful error information
@@ -124,12 +112,64 @@ bool generate_llvm_code_modules(AstNode *root, BuildConfig config,
   return true;
 }
 
-// Helper function to link all object files in a directory
-bool link_object_files(const char *output_dir, const char *executable_name) {
-  char command[2048];
+// Write one response-file argument, escaping what the compiler driver would
+// otherwise split or unquote
+static void write_response_arg(FILE *f, const char *arg) {
+  for (const char *c = arg; *c; c++) {
+    if (*c == ' ' || *c == '\t' || *c == '\n' || *c == '\'' || *c == '"' ||
+        *c == '\\') {
+      fputc('\\', f);
+    }
+    fputc(*c, f);
+  }
+  fputc('\n', f);
+}
+
+// Write the link inputs to the response file output_dir/link.rsp, in order.
+// The list of a per-function build can be longer than a command line may be.
+static bool write_link_response(const char *output_dir,
+                                const LinkInputs *inputs, bool libraries,
+                                char *response, size_t size) {
+  snprintf(response, size, "%s/link.rsp", output_dir);
+  FILE *f = fopen(response, "w");
+  if (!f) {
+    fprintf(stderr, "Failed to write %s: %s\n", response, strerror(errno));
+    return false;
+  }
+  for (size_t i = 0; i < inputs->object_count; i++) {
+    write_response_arg(f, inputs->objects[i]);
+  }
+  for (size_t i = 0; libraries && i < inputs->library_dir_count; i++) {
+    fprintf(f, "-L");
+    write_response_arg(f, inputs->library_dirs[i]);
+  }
+  // After the objects, which are what needs their symbols. A name with a
+  // '/' is a library file, anything else is looked up like -l does
+  for (size_t i = 0; libraries && i < inputs->library_count; i++) {
+    if (!strchr(inputs->libraries[i], '/')) {
+      fprintf(f, "-l");
+    }
+    write_response_arg(f, inputs->libraries[i]);
+  }
+  if (fclose(f) != 0) {
+    fprintf(stderr, "Failed to write %s: %s\n", response, strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+// Helper function to link the given object files and libraries, in the given
+// order
+bool link_object_files(const char *output_dir, const LinkInputs *inputs,
+                       const char *executable_name) {
+  char response[512];
+  if (!write_link_response(output_dir, inputs, true, response,
+                           sizeof(response)))
+    return false;
 
   // Build the linking command with PIE-compatible flags
-  snprintf(command, sizeof(command), "cc -pie %s/*.o -o %s", output_dir,
+  char command[2048];
+  snprintf(command, sizeof(command), "cc -pie @%s -o %s", response,
            executable_name);
 
   // printf("Linking command: %s\n", command);
@@ -140,7 +180,7 @@ bool link_object_files(const char *output_dir, const char *executable_name) {
 
     // Try alternative linking approach
     printf("Trying alternative linking approach...\n");
-    snprintf(command, sizeof(command), "gcc -no-pie %s/*.o -o %s", output_dir,
+    snprintf(command, sizeof(command), "gcc -no-pie @%s -o %s", response,
              executable_name);
 
     printf("Alternative linking command: %s\n", command);
@@ -156,6 +196,39 @@ bool link_object_files(const char *output_dir, const char *executable_name) {
   return true;
 }
 
+// Build lib<name>.a or lib<name>.so from the objects, without a main. An
+// archive cannot carry the C libraries of extern functions: the generated
+// header lists them for its users instead.
+bool link_library(const char *output_dir, const LinkInputs *inputs,
+                  LibraryKind kind, const char *library_name) {
+  char response[512];
+  if (!write_link_response(output_dir, inputs, kind == LIBRARY_SHARED,
+                           response, sizeof(response)))
+    return false;
+
+  char library_file[256];
+  char command[2048];
+  if (kind == LIBRARY_STATIC) {
+    // ar adds to an existing archive; start over so no stale member survives
+    snprintf(library_file, sizeof(library_file), "lib%s.a", library_name);
+    remove(library_file);
+    snprintf(command, sizeof(command), "ar rcsD %s @%s", library_file,
+             response);
+  } else {
+    snprintf(library_file, sizeof(library_file), "lib%s.so", library_name);
+    snprintf(command, sizeof(command), "cc -shared @%s -o %s", response,
+             library_file);
+  }
+
+  int result = system(command);
+  if (result != 0) {
+    fprintf(stderr, "Creating %s failed with exit code %d\n", library_file,
+            result);
+    return false;
+  }
+  return true;
+}
+
 // Alternative approach: Enhanced linking with better error handling
 bool link_object_files_enhanced(const char *output_dir,
                                 const char *executable_name) {
@@ -195,44 +268,48 @@ bool link_object_files_enhanced(const char *output_dir,
   return false;
 }
 
-// Helper function to parse a single file and extract its module
-Stmt *parse_file_to_module(const char *path, size_t position,
-                           ArenaAllocator *allocator) {
-  const char *source = read_file(path);
-  if (!source) {
+// Helper function to parse a single file and extract its module. With
+// skim_bodies, function bodies are only brace-matched here and parsed later by
+// the typechecker, which needs the tokens and source text to stay alive: the
+// source is then copied into the arena instead of being freed on return.
+// Very large files are lexed on up to jobs threads.
+Stmt *parse_file_to_module(const char *path, size_t position, bool skim_bodies,
+                           size_t jobs, ArenaAllocator *allocator) {
+  char *owned = (char *)read_file(path);
+  if (!owned) {
     fprintf(stderr, "Failed to read source file: %s\n", path);
     return NULL;
   }
 
-  Lexer lexer;
-  init_lexer(&lexer, source, allocator);
+  const char *source = owned;
+  if (skim_bodies) {
+    source = arena_strdup(allocator, owned);
+    free(owned);
+    owned = NULL;
+    if (!source) {
+      fprintf(stderr, "Out of memory while reading %s\n", path);
+      return NULL;
+    }
+  }
 
+  int errors_before = error_count_get();
   GrowableArray tokens;
-  if (!growable_array_init(&tokens, allocator, MAX_TOKENS, sizeof(Token))) {
-    fprintf(stderr, "Failed to initialize token array for %s.\n", path);
-    free((void *)source);
+  if (!lex_source(source, allocator, jobs, &tokens)) {
+    fprintf(stderr, "Out of memory while lexing %s\n", path);
+    free(owned);
     return NULL;
   }
 
-  Token tk;
-  while ((tk = next_token(&lexer)).type_ != TOK_EOF) {
-    Token *slot = (Token *)growable_array_push(&tokens);
-    if (!slot) {
-      fprintf(stderr, "Out of memory while growing token array\n");
-      free((void *)source);
-      return NULL;
-    }
-    *slot = tk;
-  }
-
-  if (error_report()) {
-    free((void *)source);
+  // Lexer errors are reported by the caller together with those of the
+  // other files; a file that failed to lex is not parsed
+  if (error_count_get() > errors_before) {
+    free(owned);
     return NULL;
   }
 
   // Parse and extract the module from the program
-  AstNode *program_root = parse(&tokens, allocator);
-  free((void *)source);
+  AstNode *program_root = parse(&tokens, allocator, path, skim_bodies);
+  free(owned);
 
   if (!program_root) {
     return NULL;
@@ -264,42 +341,137 @@ AstNode *lex_and_parse_file(const char *path, ArenaAllocator *allocator) {
     return NULL;
   }
 
-  Lexer lexer;
-  init_lexer(&lexer, source, allocator);
-
   GrowableArray tokens;
-  if (!growable_array_init(&tokens, allocator, MAX_TOKENS, sizeof(Token))) {
-    fprintf(stderr, "Failed to initialize token array for %s.\n", path);
+  if (!lex_source(source, allocator, 1, &tokens)) {
+    fprintf(stderr, "Out of memory while lexing %s\n", path);
     free((void *)source);
     return NULL;
   }
 
-  Token tk;
-  while ((tk = next_token(&lexer)).type_ != TOK_EOF) {
-    Token *slot = (Token *)growable_array_push(&tokens);
-    if (!slot) {
-      fprintf(stderr, "Out of memory while growing token array\n");
-      free((void *)source);
-      return NULL;
-    }
-    *slot = tk;
-  }
-
   if (error_report()) {
     free((void *)source);
     return NULL;
   }
 
-  AstNode *root = parse(&tokens, allocator);
+  AstNode *root = parse(&tokens, allocator, path, false);
 
   free((void *)source);
   return root;
 }
 
-bool run_build(BuildConfig config, ArenaAllocator *allocator) {
+// Parses a file, or in watch mode takes its module from the source cache
+static Stmt *load_module(SourceCache *cache, const char *path, size_t position,
+                         bool skim_bodies, size_t jobs,
+                         ArenaAllocator *allocator) {
+  if (cache)
+    return source_cache_load(cache, path, position, skim_bodies, jobs);
+  return parse_file_to_module(path, position, skim_bodies, jobs, allocator);
+}
+
+static bool name_listed(const GrowableArray *names, const char *name) {
+  const char **data = (const char **)names->data;
+  for (size_t i = 0; i < names->count; i++) {
+    if (strcmp(data[i], name) == 0)
+      return true;
+  }
+  return false;
+}
+
+static bool list_name(GrowableArray *names, const char *name) {
+  const char **slot = (const char **)growable_array_push(names);
+  if (!slot)
+    return false;
+  *slot = name;
+  return true;
+}
+
+// Loads the modules named by @use that were not given on the command line,
+// following their own @use directives in turn, so only modules that are
+// actually (transitively) referenced are read. Names that no search
+// directory has are left for module_graph_build() to report as unknown.
+static bool load_used_modules(GrowableArray *modules,
+                              const ModuleSearchPath *search,
+                              SourceCache *cache, size_t jobs,
+                              ArenaAllocator *allocator, bool *parsed) {
+  // Every module name already loaded or looked up
+  GrowableArray seen;
+  if (!growable_array_init(&seen, allocator, 16, sizeof(const char *)))
+    return false;
+  for (size_t m = 0; m < modules->count; m++) {
+    AstNode *module = ((AstNode **)modules->data)[m];
+    if (!list_name(&seen, module->preprocessor.module.name))
+      return false;
+  }
+
+  // modules grows while it is walked; re-read its data after every push
+  for (size_t m = 0; m < modules->count; m++) {
+    AstNode *module = ((AstNode **)modules->data)[m];
+
+    for (size_t i = 0; i < module->preprocessor.module.body_count; i++) {
+      AstNode *stmt = module->preprocessor.module.body[i];
+      if (!stmt || stmt->type != AST_PREPROCESSOR_USE)
+        continue;
+
+      const char *name = stmt->preprocessor.use.module_name;
+      if (name_listed(&seen, name))
+        continue;
+      if (!list_name(&seen, name))
+        return false;
+
+      const char *path = module_search_path_find(search, name);
+      if (!path)
+        continue;
+
+      Stmt *loaded =
+          load_module(cache, path, modules->count, true, jobs, allocator);
+      if (!loaded) {
+        *parsed = false;
+        continue;
+      }
+      if (strcmp(loaded->preprocessor.module.name, name) != 0) {
+        fprintf(stderr,
+                "%s: declares module '%s' but was found for @use '%s'\n", path,
+                loaded->preprocessor.module.name, name);
+        *parsed = false;
+        continue;
+      }
+
+      AstNode **slot = (AstNode **)growable_array_push(modules);
+      if (!slot)
+        return false;
+      *slot = (AstNode *)loaded;
+    }
+  }
+  return true;
+}
+
+static void parse_skimmed_bodies(AstNode **modules, size_t module_count,
+                                 ArenaAllocator *allocator) {
+  for (size_t m = 0; m < module_count; m++) {
+    AstNode *module = modules[m];
+    for (size_t i = 0; i < module->preprocessor.module.body_count; i++) {
+      AstNode *stmt = module->preprocessor.module.body[i];
+      if (stmt && stmt->type == AST_STMT_FUNCTION)
+        parse_deferred_body(stmt, allocator);
+    }
+  }
+}
+
+// luma run --interp leaves stdout to the program
+static void stage(const BuildConfig *config, int *step, int total,
+                  const char *name) {
+  if (!config->interp)
+    print_progress(++*step, total, name);
+}
+
+// With --interp the typechecked program runs instead of being compiled, and
+// @p exit_status receives what its main returned
+static bool build(BuildConfig config, ArenaAllocator *allocator,
+                  SourceCache *cache, int *exit_status) {
   bool success = false;
   int total_stages = 9;
   int step = 0;
+  ThreadPool *pool = NULL;
 
   GrowableArray modules;
   if (!growable_array_init(&modules, allocator, 16, sizeof(AstNode *))) {
@@ -307,14 +479,20 @@ bool run_build(BuildConfig config, ArenaAllocator *allocator) {
   }
 
   // Stage 1: Lexing
-  print_progress(++step, total_stages, "Lexing");
+  stage(&config, &step, total_stages, "Lexing");
 
-  // Parse additional files
+  // Parse additional files. Syntax errors don't stop the loop, so one build
+  // reports the errors of every file. Library function bodies are skimmed
+  // and parsed on the thread pool while typechecking
+  bool parsed = true;
   for (size_t i = 0; i < config.file_count; i++) {
     char **files_array = (char **)config.files.data;
-    Stmt *module = parse_file_to_module(files_array[i], i, allocator);
-    if (!module || error_report())
-      goto cleanup;
+    Stmt *module =
+        load_module(cache, files_array[i], i, true, config.jobs, allocator);
+    if (!module) {
+      parsed = false;
+      continue;
+    }
 
     AstNode **slot = (AstNode **)growable_array_push(&modules);
     if (!slot)
@@ -323,50 +501,196 @@ bool run_build(BuildConfig config, ArenaAllocator *allocator) {
   }
 
   // Stage 2: Parsing
-  print_progress(++step, total_stages, "Parsing");
+  stage(&config, &step, total_stages, "Parsing");
 
+  // Incremental builds hash function bodies from their tokens, and codegen
+  // units are balanced by them, so the main file is skimmed as well
   Stmt *main_module =
-      parse_file_to_module(config.filepath, config.file_count, allocator);
-  if (!main_module || error_report())
-    goto cleanup;
+      load_module(cache, config.filepath, config.file_count,
+                  config.incremental || config.codegen_units > 1, config.jobs,
+                  allocator);
+  if (main_module) {
+    AstNode **main_slot = (AstNode **)growable_array_push(&modules);
+    if (!main_slot)
+      goto cleanup;
+    *main_slot = (AstNode *)main_module;
+  } else {
+    parsed = false;
+  }
 
-  AstNode **main_slot = (AstNode **)growable_array_push(&modules);
-  if (!main_slot)
+  // Modules named by @use but not linked with -l come from the -I directories
+  if (config.include_dirs.count > 0) {
+    ModuleSearchPath search;
+    if (!module_search_path_init(&search,
+                                 (const char **)config.include_dirs.data,
+                                 config.include_dirs.count, allocator) ||
+        !load_used_modules(&modules, &search, cache, config.jobs, allocator,
+                           &parsed))
+      goto cleanup;
+  }
+
+  // Skimmed bodies are normally parsed while typechecking, which a build with
+  // syntax errors never reaches; parse them now so their errors are reported
+  // with the others
+  if (!parsed || error_count_get() > 0)
+    parse_skimmed_bodies((AstNode **)modules.data, modules.count, allocator);
+
+  if (error_report() || !parsed)
     goto cleanup;
-  *main_slot = (AstNode *)main_module;
 
   // Stage 3: Combining modules
-  print_progress(++step, total_stages, "Module Combination");
+  stage(&config, &step, total_stages, "Module Combination");
+
+  ModuleGraph graph;
+  if (!module_graph_build(&graph, (AstNode **)modules.data, modules.count,
+                          allocator))
+    goto cleanup;
+
+  // Dependencies first, so anything walking the program sees a module's
+  // imports before the module itself
+  AstNode **ordered = arena_alloc(allocator, graph.count * sizeof(AstNode *),
+                                  alignof(AstNode *));
+  if (!ordered)
+    goto cleanup;
+  for (size_t i = 0; i < graph.count; i++)
+    ordered[i] = graph.nodes[graph.order[i]].module;
 
-  AstNode *combined_program = create_program_node(
-      allocator, (AstNode **)modules.data, modules.count, 0, 0);
+  AstNode *combined_program =
+      create_program_node(allocator, ordered, graph.count, 0, 0);
   if (!combined_program)
     goto cleanup;
 
-  print_ast(combined_program, "", false, false);
+  if (!config.interp)
+    print_ast(combined_program, "", false, false);
+
+  // Decide which functions keep their object from the last build before
+  // typechecking, which skips their bodies
+  pool = thread_pool_create(config.jobs);
+  if (!pool)
+    goto cleanup;
+
+  // Code generation options that change the objects go into the cache keys
+  // and the incremental hashes: --dev compiles them differently
+  char options[64];
+  snprintf(options, sizeof(options), "per-function%s",
+           config.dev ? ",dev" : "");
+  BuildCache object_cache;
+  BuildCache *shared = NULL;
+  if (config.cache) {
+    if (!build_cache_open(&object_cache, config.cache, options, allocator))
+      goto cleanup;
+    shared = &object_cache;
+  }
+
+  const char *output_dir = config.save ? "output" : "obj";
+  IncrementalBuild incremental;
+  if (config.incremental &&
+      (!incremental_begin(&incremental, output_dir, options, shared,
+                          allocator) ||
+       !incremental_plan(&incremental, &graph, pool)))
+    goto cleanup;
 
   // Stage 4: Typechecking
-  print_progress(++step, total_stages, "Typechecker");
+  stage(&config, &step, total_stages, "Typechecker");
 
   Scope root_scope;
   init_scope(&root_scope, NULL, "global", allocator);
-  bool tc = typecheck(combined_program, &root_scope, allocator);
+  bool tc = typecheck_program(combined_program, &graph, &root_scope, allocator,
+                              pool);
+  // Syntax errors in skimmed library bodies surface while typechecking
+  if (error_report())
+    tc = false;
   // debug_print_scope(&root_scope, 0);
 
+  if (config.interp) {
+    if (tc)
+      success = interp_program(combined_program,
+                               (const char **)config.library_dirs.data,
+                               config.library_dirs.count, allocator,
+                               exit_status);
+    goto cleanup;
+  }
+
   if (tc) {
     // Stage 5: LLVM IR (UPDATED - now uses module system)
     print_progress(++step, total_stages, "LLVM IR");
 
-    success =
-        generate_llvm_code_modules(combined_program, config, allocator, &step);
+    success = generate_llvm_code_modules(
+        combined_program, &graph, pool, config, output_dir,
+        config.incremental ? incremental.dir : NULL, allocator, &step);
+    if (success && config.incremental)
+      success = incremental_commit(&incremental, pool);
+    if (success && config.lib != LIBRARY_NONE && (config.emit & EMIT_OBJECT)) {
+      char header[256];
+      snprintf(header, sizeof(header), "%s.h",
+               config.name ? config.name : "output");
+      success = write_c_header(header, &graph, &root_scope, config.lib,
+                               allocator);
+    }
   }
 
   // Stage 6: Finalizing
   print_progress(++step, total_stages, "Finalizing");
   print_progress(++step, total_stages, "Completed");
-  printf("Build succeeded! Written to '%s'\n",
-         config.name ? config.name : "output");
+  if (success) {
+    if (config.lib != LIBRARY_NONE && (config.emit & EMIT_OBJECT))
+      printf("Build succeeded! Written to 'lib%s.%s' and '%s.h'\n",
+             config.name ? config.name : "output",
+             config.lib == LIBRARY_STATIC ? "a" : "so",
+             config.name ? config.name : "output");
+    else if (config.emit & EMIT_OBJECT)
+      printf("Build succeeded! Written to '%s'\n",
+             config.name ? config.name : "output");
+    else
+      printf("Build succeeded! Written to '%s/'\n", output_dir);
+  }
+  if (success && config.incremental)
+    printf("Reused %zu of %zu functions from the last build\n",
+           incremental.reused - incremental.fetched,
+           incremental.current.count);
+  if (success && shared)
+    printf("Fetched %zu and stored %zu functions in the cache\n",
+           incremental.fetched, incremental.stored);
 
 cleanup:
+  thread_pool_destroy(pool);
   return success;
 }
+
+bool run_build(BuildConfig config, ArenaAllocator *allocator) {
+  return build(config, allocator, NULL, NULL);
+}
+
+// With a source cache (luma watch), unchanged files are not read or parsed
+// again; their modules come from the cache instead of this build's arena
+bool run_build_cached(BuildConfig config, ArenaAllocator *allocator,
+                      SourceCache *cache) {
+  return build(config, allocator, cache, NULL);
+}
+
+// luma run: the program's exit status, or 1 if it could not be built or
+// did not exit
+int run_command(BuildConfig config, ArenaAllocator *allocator) {
+  int status = 1;
+  if (config.interp)
+    return build(config, allocator, NULL, &status) ? status : 1;
+
+  if (!run_build(config, allocator))
+    return 1;
+
+  const char *name = config.name ? config.name : "output";
+  char command[1024];
+  snprintf(command, sizeof(command), "%s%s", strchr(name, '/') ? "" : "./",
+           name);
+  fflush(stdout);
+  status = system(command);
+  if (status == -1) {
+    fprintf(stderr, "Failed to run '%s'\n", command);
+    return 1;
+  }
+#ifdef _WIN32
+  return status;
+#else
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+#endif
+}
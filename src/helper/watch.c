@@ -0,0 +1,395 @@
+/**
+ * @file watch.c
+ * @brief Source cache and rebuild loop of `luma watch`.
+ *
+ * @see watch.h
+ */
+
+#include "watch.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+#include "../c_libs/error/error.h"
+#include "module_path.h"
+
+/** Quiet time after a change before rebuilding; editors save in bursts */
+#define WATCH_SETTLE_MS 40
+
+/** Interval between stat() sweeps where inotify is unavailable */
+#define WATCH_POLL_MS 200
+
+/**
+ * @brief Identity of a file's contents as far as the cache is concerned.
+ */
+typedef struct {
+  bool exists;
+  off_t size;
+  ino_t inode;
+  time_t mtime;
+  long mtime_ns;
+} FileStamp;
+
+/**
+ * @brief One source file and the module parsed from it.
+ */
+typedef struct {
+  const char *path;     /**< Path as given on the command line or found */
+  const char *dir;      /**< Directory to watch for changes of the file */
+  FileStamp stamp;      /**< File state when @c module was parsed */
+  ArenaAllocator arena; /**< Source, tokens and AST of the file */
+  bool has_arena;       /**< @c arena is initialized */
+  Stmt *module;         /**< Parsed module, NULL if the last parse failed */
+  bool skim;            /**< @c module was parsed with skimmed bodies */
+  bool used;            /**< Loaded by the current build */
+} CachedSource;
+
+static FileStamp file_stamp(const char *path) {
+  FileStamp stamp = {0};
+  struct stat st;
+  if (stat(path, &st) != 0) {
+    return stamp;
+  }
+
+  stamp.exists = true;
+  stamp.size = st.st_size;
+  stamp.inode = st.st_ino;
+  stamp.mtime = st.st_mtime;
+#ifdef __linux__
+  stamp.mtime_ns = st.st_mtim.tv_nsec;
+#endif
+  return stamp;
+}
+
+static bool same_stamp(FileStamp a, FileStamp b) {
+  return a.exists == b.exists && a.size == b.size && a.inode == b.inode &&
+         a.mtime == b.mtime && a.mtime_ns == b.mtime_ns;
+}
+
+static char *directory_of(ArenaAllocator *arena, const char *path) {
+  const char *slash = strrchr(path, '/');
+  if (!slash) {
+    return arena_strdup(arena, ".");
+  }
+
+  size_t length = slash == path ? 1 : (size_t)(slash - path);
+  char *dir = arena_alloc(arena, length + 1, alignof(char));
+  if (dir) {
+    memcpy(dir, path, length);
+    dir[length] = '\0';
+  }
+  return dir;
+}
+
+static CachedSource *find_entry(SourceCache *cache, const char *path) {
+  CachedSource **entries = (CachedSource **)cache->entries.data;
+  for (size_t i = 0; i < cache->entries.count; i++) {
+    if (strcmp(entries[i]->path, path) == 0) {
+      return entries[i];
+    }
+  }
+  return NULL;
+}
+
+static CachedSource *add_entry(SourceCache *cache, const char *path) {
+  CachedSource *entry = arena_alloc(&cache->arena, sizeof(CachedSource),
+                                    alignof(CachedSource));
+  CachedSource **slot = (CachedSource **)growable_array_push(&cache->entries);
+  if (!entry || !slot) {
+    return NULL;
+  }
+
+  *entry = (CachedSource){0};
+  entry->path = arena_strdup(&cache->arena, path);
+  entry->dir = directory_of(&cache->arena, path);
+  if (!entry->path || !entry->dir) {
+    return NULL;
+  }
+  *slot = entry;
+  return entry;
+}
+
+// Bodies parsed from skimmed tokens went into the last build's arena, and
+// reuse_object was decided for the last build's hashes
+static void forget_build_state(Stmt *module) {
+  for (size_t i = 0; i < module->preprocessor.module.body_count; i++) {
+    AstNode *stmt = module->preprocessor.module.body[i];
+    if (stmt && stmt->type == AST_STMT_FUNCTION &&
+        stmt->stmt.func_decl.deferred) {
+      stmt->stmt.func_decl.body = NULL;
+      stmt->stmt.func_decl.reuse_object = false;
+    }
+  }
+}
+
+bool source_cache_init(SourceCache *cache) {
+  if (arena_allocator_init(&cache->arena, ARENA_MIN_BUFFER_SIZE) != 0) {
+    return false;
+  }
+  return growable_array_init(&cache->entries, &cache->arena, 16,
+                             sizeof(CachedSource *));
+}
+
+void source_cache_destroy(SourceCache *cache) {
+  CachedSource **entries = (CachedSource **)cache->entries.data;
+  for (size_t i = 0; i < cache->entries.count; i++) {
+    if (entries[i]->has_arena) {
+      arena_destroy(&entries[i]->arena);
+    }
+  }
+  arena_destroy(&cache->arena);
+}
+
+void source_cache_begin_build(SourceCache *cache) {
+  CachedSource **entries = (CachedSource **)cache->entries.data;
+  for (size_t i = 0; i < cache->entries.count; i++) {
+    entries[i]->used = false;
+  }
+}
+
+Stmt *source_cache_load(SourceCache *cache, const char *path, size_t position,
+                        bool skim_bodies, size_t jobs) {
+  CachedSource *entry = find_entry(cache, path);
+  if (!entry && !(entry = add_entry(cache, path))) {
+    fprintf(stderr, "Out of memory while caching %s\n", path);
+    return NULL;
+  }
+  // Even a file that fails to load is watched, so fixing it rebuilds
+  entry->used = true;
+
+  FileStamp stamp = file_stamp(path);
+  if (!entry->module || entry->skim != skim_bodies ||
+      !same_stamp(entry->stamp, stamp)) {
+    // A failed parse keeps its arena until here, since the errors of that
+    // build point into its source
+    if (entry->has_arena) {
+      arena_destroy(&entry->arena);
+      entry->has_arena = false;
+    }
+    entry->module = NULL;
+    if (arena_allocator_init(&entry->arena, ARENA_MIN_BUFFER_SIZE) != 0) {
+      fprintf(stderr, "Out of memory while caching %s\n", path);
+      return NULL;
+    }
+    entry->has_arena = true;
+
+    // Stamped before reading: a save racing with the read costs one more
+    // parse next time instead of leaving a stale module behind
+    entry->stamp = stamp;
+    entry->skim = skim_bodies;
+    entry->module = parse_file_to_module(entry->path, position, skim_bodies,
+                                         jobs, &entry->arena);
+    return entry->module;
+  }
+
+  forget_build_state(entry->module);
+  entry->module->preprocessor.module.potions = (int)position;
+  return entry->module;
+}
+
+static double elapsed_ms(const struct timespec *start) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)(now.tv_sec - start->tv_sec) * 1000.0 +
+         (double)(now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+static bool dir_listed(const char **dirs, size_t count, const char *dir) {
+  for (size_t i = 0; i < count; i++) {
+    if (strcmp(dirs[i], dir) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Directories holding a file of the last build, plus the -I directories,
+// whose index files and not yet used modules can change what @use finds
+static size_t watched_dirs(SourceCache *cache, const BuildConfig *config,
+                           const char **dirs, size_t max) {
+  size_t count = 0;
+  CachedSource **entries = (CachedSource **)cache->entries.data;
+  for (size_t i = 0; i < cache->entries.count && count < max; i++) {
+    if (entries[i]->used && !dir_listed(dirs, count, entries[i]->dir)) {
+      dirs[count++] = entries[i]->dir;
+    }
+  }
+
+  const char **include = (const char **)config->include_dirs.data;
+  for (size_t i = 0; i < config->include_dirs.count && count < max; i++) {
+    if (!dir_listed(dirs, count, include[i])) {
+      dirs[count++] = include[i];
+    }
+  }
+  return count;
+}
+
+// Whether a file the last build read changed since it was read
+static bool sources_changed(SourceCache *cache) {
+  CachedSource **entries = (CachedSource **)cache->entries.data;
+  for (size_t i = 0; i < cache->entries.count; i++) {
+    if (entries[i]->used &&
+        !same_stamp(entries[i]->stamp, file_stamp(entries[i]->path))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+#ifdef __linux__
+static bool is_source_name(const char *name) {
+  size_t length = strlen(name);
+  return (length > 3 && strcmp(name + length - 3, ".lx") == 0) ||
+         strcmp(name, MODULE_INDEX_FILE) == 0;
+}
+
+// Returns true if any event in the buffer concerns a source file
+static bool read_source_events(int fd) {
+  char buffer[4096]
+      __attribute__((aligned(__alignof__(struct inotify_event))));
+  bool relevant = false;
+
+  ssize_t length;
+  while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+    for (char *p = buffer; p < buffer + length;) {
+      struct inotify_event *event = (struct inotify_event *)p;
+      if (event->len > 0 && is_source_name(event->name)) {
+        relevant = true;
+      }
+      p += sizeof(struct inotify_event) + event->len;
+    }
+  }
+  return relevant;
+}
+
+static bool wait_for_change(SourceCache *cache, const char **dirs,
+                            size_t count) {
+  int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0) {
+    fprintf(stderr, "Failed to start watching files: %s\n", strerror(errno));
+    return false;
+  }
+
+  uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE;
+  for (size_t i = 0; i < count; i++) {
+    if (inotify_add_watch(fd, dirs[i], mask) < 0) {
+      fprintf(stderr, "Warning: cannot watch '%s': %s\n", dirs[i],
+              strerror(errno));
+    }
+  }
+
+  // The watches only see saves from now on; one made during the build (or
+  // while the program ran) shows in the stamps instead
+  struct pollfd pfd = {.fd = fd, .events = POLLIN};
+  bool changed = sources_changed(cache);
+  while (!changed) {
+    if (poll(&pfd, 1, -1) < 0 && errno != EINTR) {
+      close(fd);
+      return false;
+    }
+    changed = read_source_events(fd);
+  }
+
+  // Let the rest of a multi-file save arrive before building
+  while (poll(&pfd, 1, WATCH_SETTLE_MS) > 0) {
+    read_source_events(fd);
+  }
+  close(fd);
+  return true;
+}
+#else
+static bool wait_for_change(SourceCache *cache, const char **dirs,
+                            size_t count) {
+  (void)cache;
+  (void)dirs;
+  (void)count;
+  return false;
+}
+#endif
+
+// Fallback for systems without inotify, and for when it cannot be used:
+// sweep the stamps of the files the last build read
+static bool poll_for_change(SourceCache *cache) {
+  for (;;) {
+    usleep(WATCH_POLL_MS * 1000);
+    if (sources_changed(cache)) {
+      usleep(WATCH_SETTLE_MS * 1000);
+      return true;
+    }
+  }
+}
+
+static void run_program(const BuildConfig *config) {
+  const char *name = config->name ? config->name : "output";
+  char command[1024];
+  snprintf(command, sizeof(command), "%s%s", strchr(name, '/') ? "" : "./",
+           name);
+
+  fflush(stdout);
+  int status = system(command);
+  if (status == -1) {
+    fprintf(stderr, "Failed to run '%s'\n", command);
+  } else if (WIFEXITED(status)) {
+    printf("\n'%s' exited with code %d\n", name, WEXITSTATUS(status));
+  } else {
+    printf("\n'%s' terminated abnormally\n", name);
+  }
+}
+
+bool run_watch(BuildConfig config) {
+  // Unchanged functions keep their objects across rebuilds
+  config.incremental = true;
+
+  SourceCache cache;
+  ArenaAllocator build_arena;
+  if (!source_cache_init(&cache)) {
+    fprintf(stderr, "Failed to initialize the source cache\n");
+    return false;
+  }
+  if (arena_allocator_init(&build_arena, ARENA_MIN_BUFFER_SIZE) != 0) {
+    fprintf(stderr, "Failed to initialize the build arena\n");
+    source_cache_destroy(&cache);
+    return false;
+  }
+
+  bool use_inotify = true;
+  for (;;) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    source_cache_begin_build(&cache);
+    bool built = run_build_cached(config, &build_arena, &cache);
+    printf("%s in %.1f ms\n", built ? "Rebuilt" : "Build failed",
+           elapsed_ms(&start));
+    if (built && config.run) {
+      run_program(&config);
+    }
+
+    error_clear();
+    arena_reset(&build_arena);
+
+    printf("Watching for changes (Ctrl-C to stop)...\n");
+    fflush(stdout);
+
+    const char *dirs[256];
+    size_t dir_count = watched_dirs(&cache, &config, dirs, 256);
+    if (use_inotify && !wait_for_change(&cache, dirs, dir_count)) {
+      use_inotify = false;
+    }
+    if (!use_inotify) {
+      poll_for_change(&cache);
+    }
+    printf("\n");
+  }
+}
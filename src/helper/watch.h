@@ -0,0 +1,64 @@
+/**
+ * @file watch.h
+ * @brief `luma watch`: a resident compiler that rebuilds on every save.
+ *
+ * The process stays alive between builds and keeps a SourceCache of every
+ * file it has parsed. Each cached file owns an arena holding its source,
+ * tokens and module AST, so a rebuild only reads and parses the files whose
+ * size or modification time changed; everything else a build allocates
+ * lives in a per-build arena that is reset before the next one.
+ *
+ * Builds are always incremental (see incremental.h), so unchanged functions
+ * keep their object files and only edited ones are generated again.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "../ast/ast.h"
+#include "../c_libs/memory/memory.h"
+#include "help.h"
+
+/**
+ * @brief Parsed modules of the files seen by previous builds.
+ */
+struct SourceCache {
+  ArenaAllocator arena;  /**< Paths and the entries themselves */
+  GrowableArray entries; /**< CachedSource * */
+};
+
+/**
+ * @brief Initializes an empty cache.
+ * @return false if out of memory.
+ */
+bool source_cache_init(SourceCache *cache);
+
+/**
+ * @brief Frees every cached module and the cache itself.
+ */
+void source_cache_destroy(SourceCache *cache);
+
+/**
+ * @brief Forgets which files the last build used; call before each build.
+ */
+void source_cache_begin_build(SourceCache *cache);
+
+/**
+ * @brief Returns the module of a file, parsing it only if it changed.
+ *
+ * Works like parse_file_to_module(). Syntax errors are never cached: a file
+ * that failed to parse is parsed again by the next build. Function bodies
+ * parsed from skimmed tokens during the last build belonged to that build's
+ * arena and are dropped, so the typechecker parses them again.
+ *
+ * @param cache Source cache.
+ * @param path Source file.
+ * @param position Position of the module in this build.
+ * @param skim_bodies Keep function bodies as tokens; see parse().
+ * @param jobs Threads to lex a very large file with; see lex_source().
+ * @return The file's module, or NULL if it cannot be read or parsed.
+ */
+Stmt *source_cache_load(SourceCache *cache, const char *path, size_t position,
+                        bool skim_bodies, size_t jobs);
@@ -0,0 +1,214 @@
+/**
+ * @file bytecode.h
+ * @brief Register bytecode run by `luma run --interp`.
+ *
+ * Every function has a window of 8-byte registers. Its parameters are the
+ * first registers, followed by its locals and the temporaries of its
+ * expressions. A call copies nothing: the arguments are evaluated into
+ * consecutive registers of the caller, the callee's window starts at the
+ * first of them, and its return value is left in that register.
+ *
+ * An instruction is 8 bytes: an opcode, a destination register @c a and
+ * either two operand registers @c b and @c c, a signed immediate @c sbx
+ * (jump offsets, small integers) or an unsigned index @c bx (constants,
+ * globals, functions).
+ *
+ * Values are untyped; the compiler picks the instruction for the static
+ * type of the operands. `int`, `bool` and `char` live in @c i (sign
+ * extended), `float` and `double` in @c f (a `float` is rounded after every
+ * operation), and `str` and pointers in @c p.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../ast/ast.h"
+#include "../c_libs/memory/memory.h"
+
+/** Registers the interpreter's stack has, for all active calls */
+#define BC_STACK_SLOTS (1u << 18)
+
+/** Calls that can be active at once */
+#define BC_MAX_FRAMES (1u << 16)
+
+/** Arguments of an extern function, by register class (System V) */
+#define BC_EXTERN_INT_ARGS 6
+#define BC_EXTERN_FLOAT_ARGS 8
+
+// X(name): every opcode, in the order of the dispatch table
+#define BC_OPCODES(X)                                                          \
+  X(LOADK)   /* a = K[bx]                                  */                  \
+  X(LOADI)   /* a.i = sbx                                  */                  \
+  X(MOVE)    /* a = b                                      */                  \
+  X(GETG)    /* a = G[bx]                                  */                  \
+  X(SETG)    /* G[bx] = a                                  */                  \
+  X(ADDRG)   /* a.p = &G[bx]                               */                  \
+  X(ADDRL)   /* a.p = &b                                   */                  \
+  X(ADD)     /* a.i = b.i + c.i                            */                  \
+  X(ADDI)    /* a.i = b.i + (int16_t)c                     */                  \
+  X(SUB)     /* a.i = b.i - c.i                            */                  \
+  X(MUL)     /* a.i = b.i * c.i                            */                  \
+  X(DIV)     /* a.i = b.i / c.i                            */                  \
+  X(MOD)     /* a.i = b.i % c.i                            */                  \
+  X(NEG)     /* a.i = -b.i                                 */                  \
+  X(BAND)    /* a.i = b.i & c.i                            */                  \
+  X(BOR)     /* a.i = b.i | c.i                            */                  \
+  X(BXOR)    /* a.i = b.i ^ c.i                            */                  \
+  X(SHL)     /* a.i = b.i << c.i                           */                  \
+  X(SHR)     /* a.i = b.i >> c.i                           */                  \
+  X(BNOT)    /* a.i = ~b.i                                 */                  \
+  X(NOT)     /* a.i = !b.i                                 */                  \
+  X(FADD)    /* a.f = b.f + c.f                            */                  \
+  X(FSUB)    /* a.f = b.f - c.f                            */                  \
+  X(FMUL)    /* a.f = b.f * c.f                            */                  \
+  X(FDIV)    /* a.f = b.f / c.f                            */                  \
+  X(FNEG)    /* a.f = -b.f                                 */                  \
+  X(FROUND)  /* a.f = (float)b.f                           */                  \
+  X(EQ)      /* a.i = b.i == c.i (and NE, LT, LE, GT, GE)  */                  \
+  X(NE)                                                                        \
+  X(LT)                                                                        \
+  X(LE)                                                                        \
+  X(GT)                                                                        \
+  X(GE)                                                                        \
+  X(FEQ)     /* a.i = b.f == c.f (and FNE, ..., FGE)       */                  \
+  X(FNE)                                                                       \
+  X(FLT)                                                                       \
+  X(FLE)                                                                       \
+  X(FGT)                                                                       \
+  X(FGE)                                                                       \
+  X(I2F)     /* a.f = b.i                                  */                  \
+  X(F2I)     /* a.i = b.f, truncated                       */                  \
+  X(TOCHAR)  /* a.i = (int8_t)b.i                          */                  \
+  X(TOBOOL)  /* a.i = b.i != 0                             */                  \
+  X(FTOBOOL) /* a.i = b.f != 0                             */                  \
+  X(JMP)     /* pc += sbx                                  */                  \
+  X(JMPF)    /* if (!a.i) pc += sbx                        */                  \
+  X(JMPT)    /* if (a.i) pc += sbx                         */                  \
+  X(CALL)    /* a = functions[bx](a, a + 1, ...)           */                  \
+  X(CALLC)   /* a = externs[bx](a, a + 1, ...)             */                  \
+  X(RET)     /* return a                                   */                  \
+  X(PRINTI)  /* printf("%lld", a.i)                        */                  \
+  X(PRINTC)  /* printf("%d", a.i), bool and char           */                  \
+  X(PRINTF)  /* printf("%f", a.f)                          */                  \
+  X(PRINTS)  /* printf("%s", a.p)                          */                  \
+  X(PRINTP)  /* printf("%p", a.p)                          */                  \
+  X(PRINTLN) /* putchar('\n')                              */                  \
+  X(ALLOC)   /* a.p = malloc(b.i)                          */                  \
+  X(FREE)    /* free(a.p)                                  */                  \
+  X(MEMCPY)  /* memcpy(a.p, b.p, c.i)                      */                  \
+  X(LDI64)   /* a.i = *(int64_t *)b.p                      */                  \
+  X(LDI8)    /* a.i = *(int8_t *)b.p                       */                  \
+  X(LDU8)    /* a.i = *(uint8_t *)b.p                      */                  \
+  X(LDF32)   /* a.f = *(float *)b.p                        */                  \
+  X(LDF64)   /* a.f = *(double *)b.p                       */                  \
+  X(STI64)   /* *(int64_t *)a.p = b.i                      */                  \
+  X(STI8)    /* *(int8_t *)a.p = b.i                       */                  \
+  X(STF32)   /* *(float *)a.p = b.f                        */                  \
+  X(STF64)   /* *(double *)a.p = b.f                       */
+
+typedef enum {
+#define BC_OPCODE_ENUM(name) BC_##name,
+  BC_OPCODES(BC_OPCODE_ENUM)
+#undef BC_OPCODE_ENUM
+      BC_OPCODE_COUNT
+} BcOpcode;
+
+/**
+ * @brief One instruction.
+ */
+typedef struct {
+  uint8_t op; /**< BcOpcode */
+  uint16_t a; /**< Destination (or tested) register */
+  union {
+    struct {
+      uint16_t b; /**< First operand register */
+      uint16_t c; /**< Second operand register or immediate */
+    };
+    int32_t sbx; /**< Jump offset from the next instruction, or integer */
+    uint32_t bx; /**< Constant, global, function or extern index */
+  };
+} BcInstr;
+
+/**
+ * @brief A register, global or constant.
+ */
+typedef union {
+  int64_t i;
+  double f;
+  void *p;
+} BcValue;
+
+/**
+ * @brief Register classes of extern parameters and results.
+ */
+typedef enum {
+  BC_CLASS_VOID,
+  BC_CLASS_INT,    /**< Integers and pointers */
+  BC_CLASS_FLOAT,  /**< `float` */
+  BC_CLASS_DOUBLE, /**< `double` */
+} BcClass;
+
+/**
+ * @brief A compiled Lux function.
+ */
+typedef struct {
+  const char *name;
+  const BcInstr *code;
+  const uint32_t *lines; /**< Source line of every instruction */
+  size_t code_count;
+  const BcValue *constants;
+  size_t frame_size; /**< Registers of its window */
+} BcFunction;
+
+/**
+ * @brief A C function called by the program.
+ */
+typedef struct {
+  const char *name;
+  const char *library; /**< Library named by the declaration, or NULL */
+  void *address;       /**< Resolved by interp_link_externs() */
+  size_t param_count;
+  BcClass params[BC_EXTERN_INT_ARGS + BC_EXTERN_FLOAT_ARGS];
+  BcClass result;
+} BcExtern;
+
+/**
+ * @brief A whole program, ready to run.
+ */
+typedef struct {
+  BcFunction *functions;
+  size_t function_count;
+  BcExtern *externs;
+  size_t extern_count;
+  BcValue *globals;
+  size_t global_count;
+  size_t entry; /**< Initializes the globals, then returns what main does */
+} BcProgram;
+
+/**
+ * @brief Compiles a typechecked program to bytecode.
+ *
+ * Programs using what the interpreter does not support (structs, enums,
+ * arrays, function values) are reported with the line of the construct.
+ *
+ * @param program AST_PROGRAM, its modules in dependency order.
+ * @param out Program to fill.
+ * @param arena Arena for the bytecode and everything it points to.
+ * @return false on an error (already reported).
+ */
+bool bc_compile(AstNode *program, BcProgram *out, ArenaAllocator *arena);
+
+/**
+ * @brief Runs one function of a program to completion.
+ *
+ * @param program Compiled program, externs resolved.
+ * @param function Index of a function taking no parameters.
+ * @param arena Arena for the register stack and call frames.
+ * @param result Its return value.
+ * @return false on a runtime error (already reported).
+ */
+bool bc_execute(const BcProgram *program, size_t function,
+                ArenaAllocator *arena, BcValue *result);
@@ -0,0 +1,1597 @@
+/**
+ * @file compile.c
+ * @brief Compiles a typechecked program to register bytecode.
+ *
+ * Locals get a register for the block they are declared in, temporaries
+ * the registers above them for the expression they belong to. Every
+ * expression is compiled into a destination register chosen by its user,
+ * except that a local used as an operand is read where it lives.
+ *
+ * `defer`red statements are compiled where they run: at the end of their
+ * block, before a `return` (every enclosing block's) and before a `break`
+ * or `continue` (the loop body's), most recent first.
+ *
+ * @see bytecode.h
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bytecode.h"
+
+// Static types the bytecode tells apart
+typedef enum {
+  KIND_VOID,
+  KIND_INT,
+  KIND_BOOL,
+  KIND_CHAR,
+  KIND_FLOAT,
+  KIND_DOUBLE,
+  KIND_PTR,   // str and *T
+  KIND_OTHER, // Structs, enums, arrays and functions
+} Kind;
+
+typedef enum { SYMBOL_FUNCTION, SYMBOL_EXTERN, SYMBOL_GLOBAL } SymbolKind;
+
+// A function, extern function or global of a module
+typedef struct {
+  const char *name;
+  SymbolKind kind;
+  uint32_t index; // Into the program's functions, externs or globals
+  AstNode *decl;  // AST_STMT_FUNCTION or AST_STMT_VAR_DECL
+  bool is_public;
+} ModuleSymbol;
+
+typedef struct {
+  const char *name;
+  AstNode *node;
+  GrowableArray symbols; // ModuleSymbol
+} ModuleInfo;
+
+typedef struct {
+  const char *name;
+  AstNode *type;
+  uint32_t reg;
+} Local;
+
+typedef struct {
+  AstNode *stmt;
+  size_t local_count; // Locals visible where it was deferred
+} Defer;
+
+typedef struct {
+  size_t defer_count;      // Defers pending outside the loop
+  GrowableArray breaks;    // size_t: jumps to the end of the loop
+  GrowableArray continues; // size_t: jumps to its next iteration
+} Loop;
+
+// Where an assignment stores
+typedef struct {
+  enum { LVALUE_LOCAL, LVALUE_GLOBAL, LVALUE_MEMORY } kind;
+  uint32_t reg;   // Local, or address in memory
+  uint32_t index; // Global
+  AstNode *type;
+} LValue;
+
+typedef struct {
+  ArenaAllocator *arena;
+  ModuleInfo *modules;
+  size_t module_count;
+  GrowableArray functions; // BcFunction
+  GrowableArray externs;   // BcExtern
+  GrowableArray bodies;    // AstNode *: declaration of every function
+  GrowableArray owners;    // ModuleInfo *: module of every function
+  size_t global_count;
+  AstNode *types[KIND_OTHER]; // Basic types, str for KIND_PTR
+  AstNode *void_ptr;          // Type of null and of alloc()
+
+  // Function being compiled
+  ModuleInfo *module;
+  const char *function;
+  AstNode *return_type;
+  GrowableArray code;      // BcInstr
+  GrowableArray lines;     // uint32_t
+  GrowableArray constants; // BcValue
+  GrowableArray locals;    // Local
+  GrowableArray defers;    // Defer
+  GrowableArray loops;     // Loop
+  uint32_t next_reg;
+  uint32_t frame_size;
+  size_t line;
+  bool failed;
+} Compiler;
+
+#define REGISTER_LIMIT UINT16_MAX
+
+static AstNode *expr(Compiler *c, AstNode *node, uint32_t dest);
+static void stmt(Compiler *c, AstNode *node);
+
+static void report(Compiler *c, AstNode *node, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  fprintf(stderr, "Error: ");
+  vfprintf(stderr, format, args);
+  fprintf(stderr, " (module '%s'", c->module ? c->module->name : "?");
+  if (node) {
+    fprintf(stderr, ", line %zu, column %zu", node->line, node->column);
+  }
+  fprintf(stderr, ")\n");
+  va_end(args);
+  c->failed = true;
+}
+
+static void unsupported(Compiler *c, AstNode *node, const char *what) {
+  report(c, node, "%s is not supported by --interp", what);
+}
+
+static bool array_init(Compiler *c, GrowableArray *array, size_t item_size) {
+  if (growable_array_init(array, c->arena, 16, item_size)) {
+    return true;
+  }
+  fprintf(stderr, "Error: out of memory compiling for --interp\n");
+  c->failed = true;
+  return false;
+}
+
+static void *array_push(Compiler *c, GrowableArray *array) {
+  void *slot = growable_array_push(array);
+  if (!slot && !c->failed) {
+    fprintf(stderr, "Error: out of memory compiling for --interp\n");
+    c->failed = true;
+  }
+  return slot;
+}
+
+/* Types */
+
+static Kind kind_of(const AstNode *type) {
+  static const struct {
+    const char *name;
+    Kind kind;
+  } basics[] = {
+      {"void", KIND_VOID},   {"int", KIND_INT},       {"bool", KIND_BOOL},
+      {"char", KIND_CHAR},   {"float", KIND_FLOAT},   {"double", KIND_DOUBLE},
+      {"str", KIND_PTR},
+  };
+
+  if (!type) {
+    return KIND_VOID;
+  }
+  if (type->type == AST_TYPE_POINTER) {
+    return KIND_PTR;
+  }
+  if (type->type != AST_TYPE_BASIC) {
+    return KIND_OTHER;
+  }
+  for (size_t i = 0; i < sizeof(basics) / sizeof(basics[0]); i++) {
+    if (strcmp(type->type_data.basic.name, basics[i].name) == 0) {
+      return basics[i].kind;
+    }
+  }
+  return KIND_OTHER;
+}
+
+static bool is_floating(Kind kind) {
+  return kind == KIND_FLOAT || kind == KIND_DOUBLE;
+}
+
+// What the code generator lays out: a bool and a char take a byte
+static size_t kind_size(Kind kind) {
+  switch (kind) {
+  case KIND_BOOL:
+  case KIND_CHAR:
+  case KIND_VOID:
+    return 1;
+  case KIND_FLOAT:
+    return 4;
+  default:
+    return 8;
+  }
+}
+
+// What *p reads: str points to chars
+static AstNode *pointee(Compiler *c, AstNode *type) {
+  if (type && type->type == AST_TYPE_POINTER) {
+    return type->type_data.pointer.pointee_type;
+  }
+  return c->types[KIND_CHAR];
+}
+
+/* Emission */
+
+static uint32_t reg_alloc(Compiler *c) {
+  if (c->next_reg >= REGISTER_LIMIT) {
+    if (!c->failed) {
+      report(c, NULL, "function '%s' needs more than %u registers",
+             c->function, REGISTER_LIMIT);
+    }
+    return 0;
+  }
+  uint32_t reg = c->next_reg++;
+  if (c->next_reg > c->frame_size) {
+    c->frame_size = c->next_reg;
+  }
+  return reg;
+}
+
+static size_t emit(Compiler *c, BcOpcode op, uint32_t a, uint32_t b,
+                   uint32_t operand) {
+  BcInstr *instr = array_push(c, &c->code);
+  uint32_t *line = array_push(c, &c->lines);
+  if (!instr || !line) {
+    return 0;
+  }
+  *instr = (BcInstr){.op = (uint8_t)op, .a = (uint16_t)a};
+  instr->b = (uint16_t)b;
+  instr->c = (uint16_t)operand;
+  *line = (uint32_t)c->line;
+  return c->code.count - 1;
+}
+
+static size_t emit_bx(Compiler *c, BcOpcode op, uint32_t a, uint32_t bx) {
+  size_t at = emit(c, op, a, 0, 0);
+  if (!c->failed) {
+    ((BcInstr *)c->code.data)[at].bx = bx;
+  }
+  return at;
+}
+
+static size_t emit_sbx(Compiler *c, BcOpcode op, uint32_t a, int32_t sbx) {
+  size_t at = emit(c, op, a, 0, 0);
+  if (!c->failed) {
+    ((BcInstr *)c->code.data)[at].sbx = sbx;
+  }
+  return at;
+}
+
+// Points the jump at @p at to @p target
+static void patch(Compiler *c, size_t at, size_t target) {
+  if (!c->failed) {
+    ((BcInstr *)c->code.data)[at].sbx = (int32_t)target - (int32_t)at - 1;
+  }
+}
+
+static void jump_to(Compiler *c, size_t target) {
+  patch(c, emit_sbx(c, BC_JMP, 0, 0), target);
+}
+
+static void load_constant(Compiler *c, uint32_t dest, BcValue value) {
+  BcValue *slot = array_push(c, &c->constants);
+  if (slot) {
+    *slot = value;
+    emit_bx(c, BC_LOADK, dest, (uint32_t)(c->constants.count - 1));
+  }
+}
+
+static void load_int(Compiler *c, uint32_t dest, int64_t value) {
+  if (value >= INT32_MIN && value <= INT32_MAX) {
+    emit_sbx(c, BC_LOADI, dest, (int32_t)value);
+  } else {
+    load_constant(c, dest, (BcValue){.i = value});
+  }
+}
+
+// dest = src, converted from one type to another as an assignment does
+static void convert(Compiler *c, uint32_t dest, uint32_t src, AstNode *from,
+                    AstNode *to) {
+  Kind f = kind_of(from);
+  Kind t = kind_of(to);
+
+  if (is_floating(t) && !is_floating(f)) {
+    emit(c, BC_I2F, dest, src, 0);
+  } else if (t == KIND_BOOL && is_floating(f)) {
+    emit(c, BC_FTOBOOL, dest, src, 0);
+  } else if (!is_floating(t) && is_floating(f)) {
+    emit(c, BC_F2I, dest, src, 0);
+    if (t == KIND_CHAR) {
+      emit(c, BC_TOCHAR, dest, dest, 0);
+    }
+  } else if (t == KIND_FLOAT && f == KIND_DOUBLE) {
+    emit(c, BC_FROUND, dest, src, 0);
+  } else if (t == KIND_CHAR && f != KIND_CHAR && f != KIND_BOOL) {
+    emit(c, BC_TOCHAR, dest, src, 0);
+  } else if (t == KIND_BOOL && f != KIND_BOOL) {
+    emit(c, BC_TOBOOL, dest, src, 0);
+  } else if (dest != src) {
+    emit(c, BC_MOVE, dest, src, 0);
+  }
+
+  if (t == KIND_FLOAT && !is_floating(f)) {
+    emit(c, BC_FROUND, dest, dest, 0);
+  }
+}
+
+/* Names */
+
+static Local *find_local(Compiler *c, const char *name) {
+  for (size_t i = c->locals.count; i > 0; i--) {
+    Local *local = &((Local *)c->locals.data)[i - 1];
+    if (strcmp(local->name, name) == 0) {
+      return local;
+    }
+  }
+  return NULL;
+}
+
+static ModuleSymbol *module_symbol(ModuleInfo *module, const char *name) {
+  ModuleSymbol *symbols = module->symbols.data;
+  for (size_t i = 0; i < module->symbols.count; i++) {
+    if (strcmp(symbols[i].name, name) == 0) {
+      return &symbols[i];
+    }
+  }
+  return NULL;
+}
+
+// The current module's own names first, then every module's public ones
+static ModuleSymbol *find_name(Compiler *c, const char *name) {
+  ModuleSymbol *symbol = module_symbol(c->module, name);
+  for (size_t i = 0; !symbol && i < c->module_count; i++) {
+    ModuleSymbol *other = module_symbol(&c->modules[i], name);
+    if (other && other->is_public) {
+      symbol = other;
+    }
+  }
+  return symbol;
+}
+
+// alias.name, with alias from a @use of the current module
+static ModuleSymbol *find_member(Compiler *c, AstNode *node) {
+  AstNode *object = node->expr.member.object;
+  if (object->type != AST_EXPR_IDENTIFIER) {
+    return NULL;
+  }
+
+  const char *alias = object->expr.identifier.name;
+  AstNode *module = c->module->node;
+  for (size_t i = 0; i < module->preprocessor.module.body_count; i++) {
+    AstNode *use = module->preprocessor.module.body[i];
+    if (!use || use->type != AST_PREPROCESSOR_USE ||
+        !use->preprocessor.use.alias ||
+        strcmp(use->preprocessor.use.alias, alias) != 0) {
+      continue;
+    }
+    for (size_t j = 0; j < c->module_count; j++) {
+      if (strcmp(c->modules[j].name, use->preprocessor.use.module_name) == 0) {
+        return module_symbol(&c->modules[j], node->expr.member.member);
+      }
+    }
+  }
+  return NULL;
+}
+
+/* Expressions */
+
+// Register holding the value of @p node: a local where it lives, or a new
+// temporary. UINT32_MAX on an error
+static uint32_t operand(Compiler *c, AstNode *node, AstNode **type) {
+  if (node->type == AST_EXPR_IDENTIFIER) {
+    Local *local = find_local(c, node->expr.identifier.name);
+    if (local) {
+      *type = local->type;
+      return local->reg;
+    }
+  }
+  uint32_t reg = reg_alloc(c);
+  *type = expr(c, node, reg);
+  return *type ? reg : UINT32_MAX;
+}
+
+// @p reg converted to @p to: itself, or a temporary holding the conversion
+static uint32_t converted(Compiler *c, uint32_t reg, AstNode *from,
+                          AstNode *to) {
+  Kind f = kind_of(from);
+  Kind t = kind_of(to);
+  if (f == t || (t == KIND_DOUBLE && f == KIND_FLOAT)) {
+    return reg;
+  }
+  uint32_t temp = reg_alloc(c);
+  convert(c, temp, reg, from, to);
+  return temp;
+}
+
+// Evaluates @p node into @p dest as a value of type @p to
+static bool expr_to(Compiler *c, AstNode *node, uint32_t dest, AstNode *to) {
+  AstNode *type = expr(c, node, dest);
+  if (!type) {
+    return false;
+  }
+  convert(c, dest, dest, type, to);
+  return true;
+}
+
+// Evaluates a condition into a temporary
+static uint32_t condition(Compiler *c, AstNode *node) {
+  uint32_t reg = reg_alloc(c);
+  return expr_to(c, node, reg, c->types[KIND_BOOL]) ? reg : UINT32_MAX;
+}
+
+static bool lvalue(Compiler *c, AstNode *node, LValue *out) {
+  switch (node->type) {
+  case AST_EXPR_GROUPING:
+    return lvalue(c, node->expr.grouping.expr, out);
+
+  case AST_EXPR_IDENTIFIER: {
+    Local *local = find_local(c, node->expr.identifier.name);
+    if (local) {
+      *out = (LValue){.kind = LVALUE_LOCAL, .reg = local->reg,
+                      .type = local->type};
+      return true;
+    }
+  }
+    // fallthrough
+  case AST_EXPR_MEMBER: {
+    ModuleSymbol *symbol = node->type == AST_EXPR_MEMBER
+                               ? find_member(c, node)
+                               : find_name(c, node->expr.identifier.name);
+    if (!symbol || symbol->kind != SYMBOL_GLOBAL) {
+      unsupported(c, node, "assigning to or taking the address of this");
+      return false;
+    }
+    *out = (LValue){.kind = LVALUE_GLOBAL, .index = symbol->index,
+                    .type = symbol->decl->stmt.var_decl.var_type};
+    return true;
+  }
+
+  case AST_EXPR_UNARY:
+  case AST_EXPR_DEREF: {
+    AstNode *object = node->type == AST_EXPR_DEREF ? node->expr.deref.object
+                                                   : node->expr.unary.operand;
+    if (node->type == AST_EXPR_UNARY && node->expr.unary.op != UNOP_DEREF) {
+      break;
+    }
+    AstNode *type;
+    uint32_t reg = operand(c, object, &type);
+    if (reg == UINT32_MAX) {
+      return false;
+    }
+    if (kind_of(type) != KIND_PTR) {
+      report(c, node, "dereferencing a value that is not a pointer");
+      return false;
+    }
+    *out = (LValue){.kind = LVALUE_MEMORY, .reg = reg,
+                    .type = pointee(c, type)};
+    Kind kind = kind_of(out->type);
+    if (kind == KIND_VOID || kind == KIND_OTHER) {
+      unsupported(c, node, "dereferencing this pointer type");
+      return false;
+    }
+    return true;
+  }
+
+  default:
+    break;
+  }
+  unsupported(c, node, "this assignment target");
+  return false;
+}
+
+static void load(Compiler *c, const LValue *lv, uint32_t dest) {
+  static const BcOpcode loads[] = {
+      [KIND_INT] = BC_LDI64,   [KIND_BOOL] = BC_LDU8,
+      [KIND_CHAR] = BC_LDI8,   [KIND_FLOAT] = BC_LDF32,
+      [KIND_DOUBLE] = BC_LDF64, [KIND_PTR] = BC_LDI64,
+  };
+
+  switch (lv->kind) {
+  case LVALUE_LOCAL:
+    if (dest != lv->reg) {
+      emit(c, BC_MOVE, dest, lv->reg, 0);
+    }
+    break;
+  case LVALUE_GLOBAL:
+    emit_bx(c, BC_GETG, dest, lv->index);
+    break;
+  case LVALUE_MEMORY:
+    emit(c, loads[kind_of(lv->type)], dest, lv->reg, 0);
+    break;
+  }
+}
+
+static void store(Compiler *c, const LValue *lv, uint32_t src) {
+  static const BcOpcode stores[] = {
+      [KIND_INT] = BC_STI64,   [KIND_BOOL] = BC_STI8,
+      [KIND_CHAR] = BC_STI8,   [KIND_FLOAT] = BC_STF32,
+      [KIND_DOUBLE] = BC_STF64, [KIND_PTR] = BC_STI64,
+  };
+
+  switch (lv->kind) {
+  case LVALUE_LOCAL:
+    if (src != lv->reg) {
+      emit(c, BC_MOVE, lv->reg, src, 0);
+    }
+    break;
+  case LVALUE_GLOBAL:
+    emit_bx(c, BC_SETG, src, lv->index);
+    break;
+  case LVALUE_MEMORY:
+    emit(c, stores[kind_of(lv->type)], lv->reg, src, 0);
+    break;
+  }
+}
+
+static AstNode *literal(Compiler *c, AstNode *node, uint32_t dest) {
+  switch (node->expr.literal.lit_type) {
+  case LITERAL_INT:
+    load_int(c, dest, node->expr.literal.value.int_val);
+    return c->types[KIND_INT];
+  case LITERAL_FLOAT:
+  case LITERAL_DOUBLE:
+    // Kept exact; assigning to a float rounds it
+    load_constant(c, dest,
+                  (BcValue){.f = node->expr.literal.value.float_val});
+    return c->types[KIND_DOUBLE];
+  case LITERAL_BOOL:
+    load_int(c, dest, node->expr.literal.value.bool_val);
+    return c->types[KIND_BOOL];
+  case LITERAL_CHAR:
+    load_int(c, dest, (int8_t)node->expr.literal.value.char_val);
+    return c->types[KIND_CHAR];
+  case LITERAL_NULL:
+    load_int(c, dest, 0);
+    return c->void_ptr;
+  case LITERAL_STRING:
+    load_constant(c, dest,
+                  (BcValue){.p = (void *)node->expr.literal.value.string_val});
+    return c->types[KIND_PTR];
+  default:
+    unsupported(c, node, "this literal");
+    return NULL;
+  }
+}
+
+static AstNode *identifier(Compiler *c, AstNode *node, uint32_t dest) {
+  LValue lv;
+  Local *local = find_local(c, node->expr.identifier.name);
+  ModuleSymbol *symbol =
+      local ? NULL : find_name(c, node->expr.identifier.name);
+  if (!local && (!symbol || symbol->kind != SYMBOL_GLOBAL)) {
+    report(c, node, "'%s' is not a variable", node->expr.identifier.name);
+    return NULL;
+  }
+  if (!lvalue(c, node, &lv)) {
+    return NULL;
+  }
+  load(c, &lv, dest);
+  return lv.type;
+}
+
+static AstNode *arithmetic(Compiler *c, AstNode *node, uint32_t dest) {
+  static const BcOpcode int_ops[] = {
+      [BINOP_ADD] = BC_ADD,      [BINOP_SUB] = BC_SUB,
+      [BINOP_MUL] = BC_MUL,      [BINOP_DIV] = BC_DIV,
+      [BINOP_MOD] = BC_MOD,      [BINOP_EQ] = BC_EQ,
+      [BINOP_NE] = BC_NE,        [BINOP_LT] = BC_LT,
+      [BINOP_LE] = BC_LE,        [BINOP_GT] = BC_GT,
+      [BINOP_GE] = BC_GE,        [BINOP_BIT_AND] = BC_BAND,
+      [BINOP_BIT_OR] = BC_BOR,   [BINOP_BIT_XOR] = BC_BXOR,
+      [BINOP_SHL] = BC_SHL,      [BINOP_SHR] = BC_SHR,
+  };
+  static const BcOpcode float_ops[] = {
+      [BINOP_ADD] = BC_FADD, [BINOP_SUB] = BC_FSUB, [BINOP_MUL] = BC_FMUL,
+      [BINOP_DIV] = BC_FDIV, [BINOP_EQ] = BC_FEQ,
+      [BINOP_NE] = BC_FNE,   [BINOP_LT] = BC_FLT,   [BINOP_LE] = BC_FLE,
+      [BINOP_GT] = BC_FGT,   [BINOP_GE] = BC_FGE,
+  };
+
+  BinaryOp op = node->expr.binary.op;
+  bool compare = op >= BINOP_EQ && op <= BINOP_GE;
+  AstNode *right_node = node->expr.binary.right;
+  AstNode *left_type;
+  AstNode *right_type;
+  uint32_t mark = c->next_reg;
+
+  uint32_t left = operand(c, node->expr.binary.left, &left_type);
+  if (left == UINT32_MAX) {
+    return NULL;
+  }
+  Kind l = kind_of(left_type);
+
+  // x + 1, x - 1: one instruction
+  if ((op == BINOP_ADD || op == BINOP_SUB) && l == KIND_INT &&
+      right_node->type == AST_EXPR_LITERAL &&
+      right_node->expr.literal.lit_type == LITERAL_INT &&
+      right_node->expr.literal.value.int_val >= INT16_MIN + 1 &&
+      right_node->expr.literal.value.int_val <= INT16_MAX) {
+    int64_t value = right_node->expr.literal.value.int_val;
+    emit(c, BC_ADDI, dest, left,
+         (uint16_t)(int16_t)(op == BINOP_ADD ? value : -value));
+    c->next_reg = mark;
+    return left_type;
+  }
+
+  uint32_t right = operand(c, right_node, &right_type);
+  if (right == UINT32_MAX) {
+    return NULL;
+  }
+  Kind r = kind_of(right_type);
+  if (l == KIND_OTHER || r == KIND_OTHER || l == KIND_VOID ||
+      r == KIND_VOID) {
+    unsupported(c, node, "an operation on these types");
+    return NULL;
+  }
+
+  AstNode *type;
+  if (is_floating(l) || is_floating(r)) {
+    if (op > BINOP_GE || op == BINOP_MOD || op == BINOP_POW) {
+      unsupported(c, node, "this operation on floating point values");
+      return NULL;
+    }
+    type = c->types[l == KIND_FLOAT && r == KIND_FLOAT ? KIND_FLOAT
+                                                       : KIND_DOUBLE];
+    left = converted(c, left, left_type, type);
+    right = converted(c, right, right_type, type);
+    emit(c, float_ops[op], dest, left, right);
+    if (!compare && kind_of(type) == KIND_FLOAT) {
+      emit(c, BC_FROUND, dest, dest, 0);
+    }
+  } else {
+    if (op == BINOP_POW) {
+      unsupported(c, node, "'**'");
+      return NULL;
+    }
+    // Pointer arithmetic counts elements, as in C
+    size_t scale = l == KIND_PTR && r != KIND_PTR && !compare
+                       ? kind_size(kind_of(pointee(c, left_type)))
+                       : 1;
+    if (scale > 1) {
+      uint32_t temp = reg_alloc(c);
+      load_int(c, temp, (int64_t)scale);
+      emit(c, BC_MUL, temp, right, temp);
+      right = temp;
+    }
+    emit(c, int_ops[op], dest, left, right);
+    type = l == KIND_PTR ? left_type : c->types[KIND_INT];
+    if (l == r && (l == KIND_CHAR || l == KIND_BOOL)) {
+      type = left_type;
+      if (!compare && l == KIND_CHAR) {
+        emit(c, BC_TOCHAR, dest, dest, 0);
+      }
+    }
+  }
+
+  c->next_reg = mark;
+  return compare ? c->types[KIND_BOOL] : type;
+}
+
+// && and || evaluate their right side only when it decides the result
+static AstNode *logical(Compiler *c, AstNode *node, uint32_t dest) {
+  uint32_t mark = c->next_reg;
+  if (!expr_to(c, node->expr.binary.left, dest, c->types[KIND_BOOL])) {
+    return NULL;
+  }
+  size_t skip = emit_sbx(
+      c, node->expr.binary.op == BINOP_AND ? BC_JMPF : BC_JMPT, dest, 0);
+  if (!expr_to(c, node->expr.binary.right, dest, c->types[KIND_BOOL])) {
+    return NULL;
+  }
+  patch(c, skip, c->code.count);
+  c->next_reg = mark;
+  return c->types[KIND_BOOL];
+}
+
+// ++x, x++, --x, x--
+static AstNode *step(Compiler *c, AstNode *node, uint32_t dest) {
+  UnaryOp op = node->expr.unary.op;
+  bool post = op == UNOP_POST_INC || op == UNOP_POST_DEC;
+  int delta = op == UNOP_PRE_INC || op == UNOP_POST_INC ? 1 : -1;
+  uint32_t mark = c->next_reg;
+
+  LValue lv;
+  if (!lvalue(c, node->expr.unary.operand, &lv)) {
+    return NULL;
+  }
+  Kind kind = kind_of(lv.type);
+  uint32_t value = lv.kind == LVALUE_LOCAL ? lv.reg : reg_alloc(c);
+  load(c, &lv, value);
+  if (post) {
+    emit(c, BC_MOVE, dest, value, 0);
+  }
+
+  if (is_floating(kind)) {
+    uint32_t one = reg_alloc(c);
+    load_constant(c, one, (BcValue){.f = 1.0});
+    emit(c, delta > 0 ? BC_FADD : BC_FSUB, value, value, one);
+    if (kind == KIND_FLOAT) {
+      emit(c, BC_FROUND, value, value, 0);
+    }
+  } else if (kind == KIND_PTR) {
+    size_t size = kind_size(kind_of(pointee(c, lv.type)));
+    emit(c, BC_ADDI, value, value, (uint16_t)(int16_t)(delta * (int)size));
+  } else {
+    emit(c, BC_ADDI, value, value, (uint16_t)(int16_t)delta);
+    if (kind == KIND_CHAR) {
+      emit(c, BC_TOCHAR, value, value, 0);
+    }
+  }
+
+  store(c, &lv, value);
+  if (!post) {
+    emit(c, BC_MOVE, dest, value, 0);
+  }
+  c->next_reg = mark;
+  return lv.type;
+}
+
+static AstNode *unary(Compiler *c, AstNode *node, uint32_t dest) {
+  UnaryOp op = node->expr.unary.op;
+  switch (op) {
+  case UNOP_PRE_INC:
+  case UNOP_PRE_DEC:
+  case UNOP_POST_INC:
+  case UNOP_POST_DEC:
+    return step(c, node, dest);
+  case UNOP_DEREF: {
+    uint32_t mark = c->next_reg;
+    LValue lv;
+    if (!lvalue(c, node, &lv)) {
+      return NULL;
+    }
+    load(c, &lv, dest);
+    c->next_reg = mark;
+    return lv.type;
+  }
+  default:
+    break;
+  }
+
+  AstNode *type = expr(c, node->expr.unary.operand, dest);
+  if (!type) {
+    return NULL;
+  }
+  Kind kind = kind_of(type);
+  switch (op) {
+  case UNOP_NEG:
+    emit(c, is_floating(kind) ? BC_FNEG : BC_NEG, dest, dest, 0);
+    return type;
+  case UNOP_POS:
+    return type;
+  case UNOP_NOT:
+    if (is_floating(kind)) {
+      emit(c, BC_FTOBOOL, dest, dest, 0);
+    }
+    // The code generator's not: logical on bool, bitwise on integers
+    emit(c, kind == KIND_BOOL || is_floating(kind) ? BC_NOT : BC_BNOT, dest,
+         dest, 0);
+    return kind == KIND_BOOL || is_floating(kind) ? c->types[KIND_BOOL]
+                                                  : type;
+  case UNOP_BIT_NOT:
+    emit(c, BC_BNOT, dest, dest, 0);
+    return type;
+  default:
+    unsupported(c, node, "this unary operator");
+    return NULL;
+  }
+}
+
+static AstNode *call(Compiler *c, AstNode *node, uint32_t dest) {
+  AstNode *callee = node->expr.call.callee;
+  ModuleSymbol *symbol = NULL;
+  if (callee->type == AST_EXPR_IDENTIFIER &&
+      !find_local(c, callee->expr.identifier.name)) {
+    symbol = find_name(c, callee->expr.identifier.name);
+  } else if (callee->type == AST_EXPR_MEMBER) {
+    symbol = find_member(c, callee);
+  }
+  if (!symbol || symbol->kind == SYMBOL_GLOBAL) {
+    unsupported(c, node, "calling a function value");
+    return NULL;
+  }
+
+  AstNode *decl = symbol->decl;
+  size_t arg_count = node->expr.call.arg_count;
+  if (arg_count != decl->stmt.func_decl.param_count) {
+    report(c, node, "'%s' takes %zu arguments, not %zu",
+           decl->stmt.func_decl.name, decl->stmt.func_decl.param_count,
+           arg_count);
+    return NULL;
+  }
+
+  // The callee's registers start at its first argument, where it leaves
+  // its result
+  uint32_t mark = c->next_reg;
+  uint32_t base = c->next_reg;
+  for (size_t i = 0; i < arg_count; i++) {
+    uint32_t reg = reg_alloc(c);
+    if (!expr_to(c, node->expr.call.args[i], reg,
+                 decl->stmt.func_decl.param_types[i])) {
+      return NULL;
+    }
+    // Temporaries of the next argument start after this one
+    c->next_reg = reg + 1;
+  }
+  if (arg_count == 0) {
+    reg_alloc(c);
+  }
+
+  emit_bx(c, symbol->kind == SYMBOL_EXTERN ? BC_CALLC : BC_CALL, base,
+          symbol->index);
+  AstNode *type = decl->stmt.func_decl.return_type;
+  Kind result = kind_of(type);
+  if (symbol->kind == SYMBOL_EXTERN &&
+      (result == KIND_CHAR || result == KIND_BOOL)) {
+    // C leaves the upper bits of narrow results undefined
+    convert(c, dest, base, c->types[KIND_INT], type);
+  } else if (dest != base) {
+    emit(c, BC_MOVE, dest, base, 0);
+  }
+  c->next_reg = mark;
+  return type ? type : c->types[KIND_VOID];
+}
+
+static AstNode *assignment(Compiler *c, AstNode *node, uint32_t dest) {
+  uint32_t mark = c->next_reg;
+  LValue lv;
+  if (!lvalue(c, node->expr.assignment.target, &lv)) {
+    return NULL;
+  }
+
+  // Arithmetic reads its operands before writing its result, so it can
+  // write straight into a local: i = i + 1 is one instruction
+  AstNode *value = node->expr.assignment.value;
+  bool direct = lv.kind == LVALUE_LOCAL &&
+                ((value->type == AST_EXPR_BINARY &&
+                  value->expr.binary.op != BINOP_AND &&
+                  value->expr.binary.op != BINOP_OR) ||
+                 value->type == AST_EXPR_LITERAL);
+  uint32_t reg = direct ? lv.reg : reg_alloc(c);
+  if (!expr_to(c, value, reg, lv.type)) {
+    return NULL;
+  }
+  store(c, &lv, reg);
+  if (dest != reg) {
+    emit(c, BC_MOVE, dest, reg, 0);
+  }
+  c->next_reg = mark;
+  return lv.type;
+}
+
+static AstNode *ternary(Compiler *c, AstNode *node, uint32_t dest) {
+  uint32_t mark = c->next_reg;
+  uint32_t test = condition(c, node->expr.ternary.condition);
+  if (test == UINT32_MAX) {
+    return NULL;
+  }
+  size_t to_else = emit_sbx(c, BC_JMPF, test, 0);
+  AstNode *type = expr(c, node->expr.ternary.then_expr, dest);
+  if (!type) {
+    return NULL;
+  }
+  size_t to_end = emit_sbx(c, BC_JMP, 0, 0);
+  patch(c, to_else, c->code.count);
+  if (!expr_to(c, node->expr.ternary.else_expr, dest, type)) {
+    return NULL;
+  }
+  patch(c, to_end, c->code.count);
+  c->next_reg = mark;
+  return type;
+}
+
+static AstNode *size_of(Compiler *c, AstNode *node, uint32_t dest) {
+  AstNode *type = node->expr.size_of.object;
+  if (!node->expr.size_of.is_type) {
+    // Only the type matters: compile the expression and drop its code
+    size_t code_count = c->code.count;
+    uint32_t mark = c->next_reg;
+    type = expr(c, node->expr.size_of.object, reg_alloc(c));
+    c->code.count = c->lines.count = code_count;
+    c->next_reg = mark;
+    if (!type) {
+      return NULL;
+    }
+  }
+  if (kind_of(type) == KIND_OTHER) {
+    unsupported(c, node, "sizeof of this type");
+    return NULL;
+  }
+  load_int(c, dest, (int64_t)kind_size(kind_of(type)));
+  return c->types[KIND_INT];
+}
+
+static AstNode *expr(Compiler *c, AstNode *node, uint32_t dest) {
+  if (c->failed) {
+    return NULL;
+  }
+  c->line = node->line;
+
+  switch (node->type) {
+  case AST_EXPR_LITERAL:
+    return literal(c, node, dest);
+  case AST_EXPR_IDENTIFIER:
+    return identifier(c, node, dest);
+  case AST_EXPR_GROUPING:
+    return expr(c, node->expr.grouping.expr, dest);
+  case AST_EXPR_BINARY:
+    return node->expr.binary.op == BINOP_AND || node->expr.binary.op == BINOP_OR
+               ? logical(c, node, dest)
+               : arithmetic(c, node, dest);
+  case AST_EXPR_UNARY:
+    return unary(c, node, dest);
+  case AST_EXPR_CALL:
+    return call(c, node, dest);
+  case AST_EXPR_ASSIGNMENT:
+    return assignment(c, node, dest);
+  case AST_EXPR_TERNARY:
+    return ternary(c, node, dest);
+
+  case AST_EXPR_MEMBER: {
+    ModuleSymbol *symbol = find_member(c, node);
+    if (!symbol || symbol->kind != SYMBOL_GLOBAL) {
+      unsupported(c, node, "this member access");
+      return NULL;
+    }
+    emit_bx(c, BC_GETG, dest, symbol->index);
+    return symbol->decl->stmt.var_decl.var_type;
+  }
+
+  case AST_EXPR_DEREF: {
+    uint32_t mark = c->next_reg;
+    LValue lv;
+    if (!lvalue(c, node, &lv)) {
+      return NULL;
+    }
+    load(c, &lv, dest);
+    c->next_reg = mark;
+    return lv.type;
+  }
+
+  case AST_EXPR_ADDR: {
+    uint32_t mark = c->next_reg;
+    LValue lv;
+    if (!lvalue(c, node->expr.addr.object, &lv)) {
+      return NULL;
+    }
+    if (lv.kind == LVALUE_LOCAL) {
+      emit(c, BC_ADDRL, dest, lv.reg, 0);
+    } else if (lv.kind == LVALUE_GLOBAL) {
+      emit_bx(c, BC_ADDRG, dest, lv.index);
+    } else if (dest != lv.reg) {
+      emit(c, BC_MOVE, dest, lv.reg, 0); // &*p is p
+    }
+    c->next_reg = mark;
+    return create_pointer_type(c->arena, lv.type, node->line, node->column);
+  }
+
+  case AST_EXPR_ALLOC: {
+    uint32_t mark = c->next_reg;
+    AstNode *type;
+    uint32_t size = operand(c, node->expr.alloc.size, &type);
+    if (size == UINT32_MAX) {
+      return NULL;
+    }
+    emit(c, BC_ALLOC, dest, size, 0);
+    c->next_reg = mark;
+    return c->void_ptr;
+  }
+
+  case AST_EXPR_FREE: {
+    AstNode *type = expr(c, node->expr.free.ptr, dest);
+    if (!type) {
+      return NULL;
+    }
+    emit(c, BC_FREE, dest, 0, 0);
+    return c->types[KIND_VOID];
+  }
+
+  case AST_EXPR_MEMCPY: {
+    uint32_t mark = c->next_reg;
+    AstNode *type;
+    if (!expr(c, node->expr.memcpy.to, dest)) {
+      return NULL;
+    }
+    uint32_t from = operand(c, node->expr.memcpy.from, &type);
+    uint32_t size = from == UINT32_MAX
+                        ? UINT32_MAX
+                        : operand(c, node->expr.memcpy.size, &type);
+    if (size == UINT32_MAX) {
+      return NULL;
+    }
+    emit(c, BC_MEMCPY, dest, from, size);
+    c->next_reg = mark;
+    return c->void_ptr;
+  }
+
+  case AST_EXPR_CAST: {
+    AstNode *type = expr(c, node->expr.cast.castee, dest);
+    if (!type) {
+      return NULL;
+    }
+    if (kind_of(node->expr.cast.type) == KIND_OTHER) {
+      unsupported(c, node, "casting to this type");
+      return NULL;
+    }
+    convert(c, dest, dest, type, node->expr.cast.type);
+    return node->expr.cast.type;
+  }
+
+  case AST_EXPR_SIZEOF:
+    return size_of(c, node, dest);
+
+  case AST_EXPR_INDEX:
+    unsupported(c, node, "indexing");
+    return NULL;
+  case AST_EXPR_ARRAY:
+    unsupported(c, node, "an array literal");
+    return NULL;
+  default:
+    unsupported(c, node, "this expression");
+    return NULL;
+  }
+}
+
+/* Statements */
+
+typedef struct {
+  size_t local_count;
+  size_t defer_count;
+  uint32_t next_reg;
+} BlockMark;
+
+static BlockMark block_enter(Compiler *c) {
+  return (BlockMark){c->locals.count, c->defers.count, c->next_reg};
+}
+
+static void run_defer(Compiler *c, Defer defer) {
+  // The deferred statement sees the locals it saw where it was deferred,
+  // not ones declared after it
+  size_t local_count = c->locals.count;
+  uint32_t mark = c->next_reg;
+  for (size_t i = 0; i < defer.local_count; i++) {
+    Local visible = ((Local *)c->locals.data)[i];
+    Local *slot = array_push(c, &c->locals);
+    if (!slot) {
+      return;
+    }
+    *slot = visible;
+  }
+  stmt(c, defer.stmt);
+  c->locals.count = local_count;
+  c->next_reg = mark;
+}
+
+// Compiles the defers pending above @p down_to, most recent first
+static void run_defers(Compiler *c, size_t down_to) {
+  size_t count = c->defers.count;
+  for (size_t i = count; i > down_to && !c->failed; i--) {
+    Defer defer = ((Defer *)c->defers.data)[i - 1];
+    // A defer that returns does not run itself again
+    c->defers.count = i - 1;
+    run_defer(c, defer);
+  }
+  c->defers.count = count;
+}
+
+static void block_exit(Compiler *c, BlockMark mark) {
+  run_defers(c, mark.defer_count);
+  c->defers.count = mark.defer_count;
+  c->locals.count = mark.local_count;
+  c->next_reg = mark.next_reg;
+}
+
+static void declare_local(Compiler *c, AstNode *node) {
+  AstNode *type = node->stmt.var_decl.var_type;
+  if (kind_of(type) == KIND_OTHER || kind_of(type) == KIND_VOID) {
+    unsupported(c, node, "a variable of this type");
+    return;
+  }
+
+  // The initializer does not see the variable it initializes
+  uint32_t reg = reg_alloc(c);
+  if (node->stmt.var_decl.initializer) {
+    if (!expr_to(c, node->stmt.var_decl.initializer, reg, type)) {
+      return;
+    }
+  } else {
+    load_int(c, reg, 0);
+  }
+  c->next_reg = reg + 1;
+
+  Local *local = array_push(c, &c->locals);
+  if (local) {
+    *local = (Local){node->stmt.var_decl.name, type, reg};
+  }
+}
+
+static void block(Compiler *c, AstNode *node) {
+  BlockMark mark = block_enter(c);
+  for (size_t i = 0; i < node->stmt.block.stmt_count && !c->failed; i++) {
+    stmt(c, node->stmt.block.statements[i]);
+  }
+  block_exit(c, mark);
+}
+
+static void if_stmt(Compiler *c, AstNode *node) {
+  GrowableArray ends; // size_t: jumps past the whole statement
+  if (!array_init(c, &ends, sizeof(size_t))) {
+    return;
+  }
+
+  AstNode *branch = node;
+  for (int i = -1; i < node->stmt.if_stmt.elif_count && !c->failed; i++) {
+    if (i >= 0) {
+      branch = node->stmt.if_stmt.elif_stmts[i];
+    }
+    uint32_t mark = c->next_reg;
+    uint32_t test = condition(c, branch->stmt.if_stmt.condition);
+    if (test == UINT32_MAX) {
+      return;
+    }
+    c->next_reg = mark;
+    size_t next = emit_sbx(c, BC_JMPF, test, 0);
+    stmt(c, branch->stmt.if_stmt.then_stmt);
+    size_t *end = array_push(c, &ends);
+    if (!end) {
+      return;
+    }
+    *end = emit_sbx(c, BC_JMP, 0, 0);
+    patch(c, next, c->code.count);
+  }
+
+  if (node->stmt.if_stmt.else_stmt) {
+    stmt(c, node->stmt.if_stmt.else_stmt);
+  }
+  for (size_t i = 0; i < ends.count; i++) {
+    patch(c, ((size_t *)ends.data)[i], c->code.count);
+  }
+}
+
+static void loop_stmt(Compiler *c, AstNode *node) {
+  BlockMark mark = block_enter(c);
+  for (size_t i = 0; i < node->stmt.loop_stmt.init_count && !c->failed; i++) {
+    declare_local(c, node->stmt.loop_stmt.initializer[i]);
+  }
+
+  Loop *loop = array_push(c, &c->loops);
+  if (!loop || !array_init(c, &loop->breaks, sizeof(size_t)) ||
+      !array_init(c, &loop->continues, sizeof(size_t))) {
+    return;
+  }
+  loop->defer_count = c->defers.count;
+  size_t index = c->loops.count - 1;
+
+  size_t top = c->code.count;
+  size_t done = SIZE_MAX;
+  if (node->stmt.loop_stmt.condition) {
+    uint32_t temps = c->next_reg;
+    uint32_t test = condition(c, node->stmt.loop_stmt.condition);
+    if (test == UINT32_MAX) {
+      return;
+    }
+    c->next_reg = temps;
+    done = emit_sbx(c, BC_JMPF, test, 0);
+  }
+
+  stmt(c, node->stmt.loop_stmt.body);
+
+  // loop (cond) : (step) runs step after every iteration, continued or not
+  loop = &((Loop *)c->loops.data)[index];
+  for (size_t i = 0; i < loop->continues.count; i++) {
+    patch(c, ((size_t *)loop->continues.data)[i], c->code.count);
+  }
+  if (node->stmt.loop_stmt.optional) {
+    uint32_t temps = c->next_reg;
+    expr(c, node->stmt.loop_stmt.optional, reg_alloc(c));
+    c->next_reg = temps;
+  }
+  jump_to(c, top);
+
+  loop = &((Loop *)c->loops.data)[index];
+  if (done != SIZE_MAX) {
+    patch(c, done, c->code.count);
+  }
+  for (size_t i = 0; i < loop->breaks.count; i++) {
+    patch(c, ((size_t *)loop->breaks.data)[i], c->code.count);
+  }
+  c->loops.count = index;
+  block_exit(c, mark);
+}
+
+static void break_continue(Compiler *c, AstNode *node) {
+  if (c->loops.count == 0) {
+    report(c, node, "%s outside of a loop",
+           node->stmt.break_continue.is_continue ? "continue" : "break");
+    return;
+  }
+  size_t index = c->loops.count - 1;
+  run_defers(c, ((Loop *)c->loops.data)[index].defer_count);
+
+  Loop *loop = &((Loop *)c->loops.data)[index];
+  size_t *slot = array_push(c, node->stmt.break_continue.is_continue
+                                   ? &loop->continues
+                                   : &loop->breaks);
+  if (slot) {
+    *slot = emit_sbx(c, BC_JMP, 0, 0);
+  }
+}
+
+static void return_stmt(Compiler *c, AstNode *node) {
+  uint32_t mark = c->next_reg;
+  uint32_t reg = reg_alloc(c);
+  // The value is computed before the defers run
+  if (node->stmt.return_stmt.value) {
+    if (!expr_to(c, node->stmt.return_stmt.value, reg, c->return_type)) {
+      return;
+    }
+  } else {
+    load_int(c, reg, 0);
+  }
+  run_defers(c, 0);
+  emit(c, BC_RET, reg, 0, 0);
+  c->next_reg = mark;
+}
+
+static void print_stmt(Compiler *c, AstNode *node) {
+  uint32_t mark = c->next_reg;
+  uint32_t reg = reg_alloc(c);
+  for (size_t i = 0; i < node->stmt.print_stmt.expr_count; i++) {
+    AstNode *type = expr(c, node->stmt.print_stmt.expressions[i], reg);
+    if (!type) {
+      return;
+    }
+
+    // The code generator's formats, except that str and float print as
+    // text and numbers
+    BcOpcode op;
+    switch (kind_of(type)) {
+    case KIND_INT:
+      op = BC_PRINTI;
+      break;
+    case KIND_BOOL:
+    case KIND_CHAR:
+      op = BC_PRINTC;
+      break;
+    case KIND_FLOAT:
+    case KIND_DOUBLE:
+      op = BC_PRINTF;
+      break;
+    case KIND_PTR:
+      op = type->type == AST_TYPE_BASIC ? BC_PRINTS : BC_PRINTP;
+      break;
+    default:
+      unsupported(c, node->stmt.print_stmt.expressions[i],
+                  "printing this type");
+      return;
+    }
+    emit(c, op, reg, 0, 0);
+  }
+  if (node->stmt.print_stmt.ln) {
+    emit(c, BC_PRINTLN, 0, 0, 0);
+  }
+  c->next_reg = mark;
+}
+
+static void stmt(Compiler *c, AstNode *node) {
+  if (c->failed || !node) {
+    return;
+  }
+  c->line = node->line;
+
+  switch (node->type) {
+  case AST_STMT_EXPRESSION: {
+    uint32_t mark = c->next_reg;
+    expr(c, node->stmt.expr_stmt.expression, reg_alloc(c));
+    c->next_reg = mark;
+    break;
+  }
+  case AST_STMT_VAR_DECL:
+    declare_local(c, node);
+    break;
+  case AST_STMT_BLOCK:
+    block(c, node);
+    break;
+  case AST_STMT_IF:
+    if_stmt(c, node);
+    break;
+  case AST_STMT_LOOP:
+    loop_stmt(c, node);
+    break;
+  case AST_STMT_BREAK_CONTINUE:
+    break_continue(c, node);
+    break;
+  case AST_STMT_RETURN:
+    return_stmt(c, node);
+    break;
+  case AST_STMT_PRINT:
+    print_stmt(c, node);
+    break;
+  case AST_STMT_DEFER: {
+    Defer *defer = array_push(c, &c->defers);
+    if (defer) {
+      *defer = (Defer){node->stmt.defer_stmt.statement, c->locals.count};
+    }
+    break;
+  }
+  default:
+    unsupported(c, node, "this statement");
+    break;
+  }
+}
+
+/* Functions and modules */
+
+static bool function_begin(Compiler *c, ModuleInfo *module, const char *name,
+                           AstNode *return_type) {
+  c->module = module;
+  c->function = name;
+  c->return_type = return_type;
+  c->next_reg = 0;
+  c->frame_size = 1; // Room for the result
+  c->defers.count = 0;
+  c->loops.count = 0;
+  c->locals.count = 0;
+  return array_init(c, &c->code, sizeof(BcInstr)) &&
+         array_init(c, &c->lines, sizeof(uint32_t)) &&
+         array_init(c, &c->constants, sizeof(BcValue));
+}
+
+// Falling off the end returns zero, as compiled code does
+static void function_end(Compiler *c, BcFunction *out) {
+  uint32_t reg = reg_alloc(c);
+  load_int(c, reg, 0);
+  emit(c, BC_RET, reg, 0, 0);
+
+  out->name = c->function;
+  out->code = c->code.data;
+  out->lines = c->lines.data;
+  out->code_count = c->code.count;
+  out->constants = c->constants.data;
+  out->frame_size = c->frame_size;
+}
+
+static void compile_function(Compiler *c, ModuleInfo *module, AstNode *decl,
+                             BcFunction *out) {
+  if (!function_begin(c, module, decl->stmt.func_decl.name,
+                      decl->stmt.func_decl.return_type)) {
+    return;
+  }
+  if (!decl->stmt.func_decl.body) {
+    report(c, decl, "the body of '%s' was not parsed",
+           decl->stmt.func_decl.name);
+    return;
+  }
+
+  for (size_t i = 0; i < decl->stmt.func_decl.param_count; i++) {
+    AstNode *type = decl->stmt.func_decl.param_types[i];
+    if (kind_of(type) == KIND_OTHER) {
+      unsupported(c, decl, "a parameter of this type");
+      return;
+    }
+    Local *param = array_push(c, &c->locals);
+    if (!param) {
+      return;
+    }
+    *param = (Local){decl->stmt.func_decl.param_names[i], type, reg_alloc(c)};
+  }
+  if (kind_of(decl->stmt.func_decl.return_type) == KIND_OTHER) {
+    unsupported(c, decl, "a function returning this type");
+    return;
+  }
+
+  stmt(c, decl->stmt.func_decl.body);
+  function_end(c, out);
+}
+
+static bool add_extern(Compiler *c, ModuleInfo *module, AstNode *decl,
+                       ModuleSymbol *symbol) {
+  BcExtern *ext = array_push(c, &c->externs);
+  if (!ext) {
+    return false;
+  }
+  *ext = (BcExtern){.name = decl->stmt.func_decl.name,
+                    .library = decl->stmt.func_decl.library,
+                    .param_count = decl->stmt.func_decl.param_count};
+
+  size_t ints = 0;
+  size_t floats = 0;
+  for (size_t i = 0; i < ext->param_count; i++) {
+    Kind kind = kind_of(decl->stmt.func_decl.param_types[i]);
+    if (kind == KIND_OTHER || kind == KIND_VOID) {
+      c->module = module;
+      unsupported(c, decl, "an extern parameter of this type");
+      return false;
+    }
+    ext->params[i] = kind == KIND_FLOAT    ? BC_CLASS_FLOAT
+                     : kind == KIND_DOUBLE ? BC_CLASS_DOUBLE
+                                           : BC_CLASS_INT;
+    if (is_floating(kind) ? ++floats > BC_EXTERN_FLOAT_ARGS
+                          : ++ints > BC_EXTERN_INT_ARGS) {
+      c->module = module;
+      report(c, decl,
+             "--interp calls externs with at most %d integer and %d floating "
+             "point arguments",
+             BC_EXTERN_INT_ARGS, BC_EXTERN_FLOAT_ARGS);
+      return false;
+    }
+  }
+
+  Kind result = kind_of(decl->stmt.func_decl.return_type);
+  ext->result = result == KIND_VOID     ? BC_CLASS_VOID
+                : result == KIND_FLOAT  ? BC_CLASS_FLOAT
+                : result == KIND_DOUBLE ? BC_CLASS_DOUBLE
+                                        : BC_CLASS_INT;
+  symbol->kind = SYMBOL_EXTERN;
+  symbol->index = (uint32_t)(c->externs.count - 1);
+  return true;
+}
+
+// Gives every function, extern and global of @p module its index, so
+// bodies can call functions declared after them
+static bool declare_module(Compiler *c, ModuleInfo *module) {
+  AstNode *node = module->node;
+  for (size_t i = 0; i < node->preprocessor.module.body_count; i++) {
+    AstNode *decl = node->preprocessor.module.body[i];
+    if (!decl || (decl->type != AST_STMT_FUNCTION &&
+                  decl->type != AST_STMT_VAR_DECL)) {
+      continue;
+    }
+
+    ModuleSymbol *symbol = array_push(c, &module->symbols);
+    if (!symbol) {
+      return false;
+    }
+    symbol->decl = decl;
+
+    if (decl->type == AST_STMT_VAR_DECL) {
+      symbol->name = decl->stmt.var_decl.name;
+      symbol->is_public = decl->stmt.var_decl.is_public;
+      symbol->kind = SYMBOL_GLOBAL;
+      symbol->index = (uint32_t)c->global_count++;
+      continue;
+    }
+
+    symbol->name = decl->stmt.func_decl.name;
+    symbol->is_public = decl->stmt.func_decl.is_public;
+    if (decl->stmt.func_decl.is_extern) {
+      if (!add_extern(c, module, decl, symbol)) {
+        return false;
+      }
+      continue;
+    }
+
+    BcFunction *function = array_push(c, &c->functions);
+    AstNode **body = array_push(c, &c->bodies);
+    ModuleInfo **owner = array_push(c, &c->owners);
+    if (!function || !body || !owner) {
+      return false;
+    }
+    *function = (BcFunction){.name = symbol->name};
+    *body = decl;
+    *owner = module;
+    symbol->kind = SYMBOL_FUNCTION;
+    symbol->index = (uint32_t)(c->functions.count - 1);
+  }
+  return true;
+}
+
+// The program's entry: initializes the globals in declaration order,
+// dependencies first, then calls main
+static void compile_entry(Compiler *c, uint32_t main_index, BcFunction *out) {
+  if (!function_begin(c, c->module_count ? &c->modules[0] : NULL, "<entry>",
+                      c->types[KIND_INT])) {
+    return;
+  }
+  for (size_t m = 0; m < c->module_count && !c->failed; m++) {
+    c->module = &c->modules[m];
+    ModuleSymbol *symbols = c->module->symbols.data;
+    for (size_t i = 0; i < c->module->symbols.count && !c->failed; i++) {
+      AstNode *decl = symbols[i].decl;
+      if (symbols[i].kind != SYMBOL_GLOBAL ||
+          !decl->stmt.var_decl.initializer) {
+        continue;
+      }
+      if (kind_of(decl->stmt.var_decl.var_type) == KIND_OTHER) {
+        unsupported(c, decl, "a global of this type");
+        return;
+      }
+      c->line = decl->line;
+      uint32_t reg = reg_alloc(c);
+      if (expr_to(c, decl->stmt.var_decl.initializer, reg,
+                  decl->stmt.var_decl.var_type)) {
+        emit_bx(c, BC_SETG, reg, symbols[i].index);
+      }
+      c->next_reg = 0;
+    }
+  }
+  uint32_t reg = reg_alloc(c);
+  emit_bx(c, BC_CALL, reg, main_index);
+  emit(c, BC_RET, reg, 0, 0);
+  function_end(c, out);
+}
+
+bool bc_compile(AstNode *program, BcProgram *out, ArenaAllocator *arena) {
+  static const char *const basic_names[KIND_OTHER] = {
+      [KIND_VOID] = "void",   [KIND_INT] = "int",   [KIND_BOOL] = "bool",
+      [KIND_CHAR] = "char",   [KIND_FLOAT] = "float",
+      [KIND_DOUBLE] = "double", [KIND_PTR] = "str",
+  };
+
+  Compiler c = {.arena = arena};
+  for (size_t i = 0; i < KIND_OTHER; i++) {
+    c.types[i] = create_basic_type(arena, basic_names[i], 0, 0);
+    if (!c.types[i]) {
+      fprintf(stderr, "Error: out of memory compiling for --interp\n");
+      return false;
+    }
+  }
+  c.void_ptr = create_pointer_type(arena, c.types[KIND_VOID], 0, 0);
+  if (!c.void_ptr || !array_init(&c, &c.functions, sizeof(BcFunction)) ||
+      !array_init(&c, &c.externs, sizeof(BcExtern)) ||
+      !array_init(&c, &c.bodies, sizeof(AstNode *)) ||
+      !array_init(&c, &c.owners, sizeof(ModuleInfo *)) ||
+      !array_init(&c, &c.locals, sizeof(Local)) ||
+      !array_init(&c, &c.defers, sizeof(Defer)) ||
+      !array_init(&c, &c.loops, sizeof(Loop))) {
+    return false;
+  }
+
+  c.module_count = program->stmt.program.module_count;
+  c.modules = arena_alloc(arena, (c.module_count + 1) * sizeof(ModuleInfo),
+                          alignof(ModuleInfo));
+  if (!c.modules) {
+    fprintf(stderr, "Error: out of memory compiling for --interp\n");
+    return false;
+  }
+  for (size_t i = 0; i < c.module_count; i++) {
+    AstNode *module = program->stmt.program.modules[i];
+    c.modules[i] = (ModuleInfo){.name = module->preprocessor.module.name,
+                                .node = module};
+    if (!array_init(&c, &c.modules[i].symbols, sizeof(ModuleSymbol)) ||
+        !declare_module(&c, &c.modules[i])) {
+      return false;
+    }
+  }
+
+  // main is the program's, in the last module
+  size_t entry = SIZE_MAX;
+  for (size_t i = c.module_count; i > 0 && entry == SIZE_MAX; i--) {
+    ModuleSymbol *symbol = module_symbol(&c.modules[i - 1], "main");
+    if (symbol && symbol->kind == SYMBOL_FUNCTION) {
+      if (symbol->decl->stmt.func_decl.param_count > 0) {
+        c.module = &c.modules[i - 1];
+        unsupported(&c, symbol->decl, "a main with parameters");
+        return false;
+      }
+      entry = symbol->index;
+    }
+  }
+  if (entry == SIZE_MAX) {
+    fprintf(stderr, "Error: the program has no main function\n");
+    return false;
+  }
+
+  // The entry runs as one more function
+  if (!array_push(&c, &c.functions)) {
+    return false;
+  }
+  size_t function_count = c.functions.count;
+  BcFunction *functions = c.functions.data;
+  for (size_t i = 0; i + 1 < function_count && !c.failed; i++) {
+    compile_function(&c, ((ModuleInfo **)c.owners.data)[i],
+                     ((AstNode **)c.bodies.data)[i], &functions[i]);
+  }
+  if (!c.failed) {
+    compile_entry(&c, (uint32_t)entry, &functions[function_count - 1]);
+  }
+  if (c.failed) {
+    return false;
+  }
+
+  *out = (BcProgram){
+      .functions = functions,
+      .function_count = function_count,
+      .externs = c.externs.data,
+      .extern_count = c.externs.count,
+      .globals = arena_alloc(arena, (c.global_count + 1) * sizeof(BcValue),
+                             alignof(BcValue)),
+      .global_count = c.global_count,
+      .entry = function_count - 1,
+  };
+  if (!out->globals) {
+    fprintf(stderr, "Error: out of memory compiling for --interp\n");
+    return false;
+  }
+  memset(out->globals, 0, (c.global_count + 1) * sizeof(BcValue));
+  return true;
+}
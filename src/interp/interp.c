@@ -0,0 +1,102 @@
+/**
+ * @file interp.c
+ * @brief Finds a program's extern functions and runs it.
+ *
+ * @see interp.h
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // RTLD_DEFAULT
+#endif
+
+#include "interp.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <dlfcn.h>
+
+// A path as it is; a name as lib<name>.so in the -L directories, then
+// wherever the dynamic loader looks. Distributions ship the unversioned
+// name only with the development package, and it may be a linker script
+static void *open_library(const char *library, const char **library_dirs,
+                          size_t library_dir_count) {
+  static const char *const suffixes[] = {".so", ".so.6", ".so.1", ".so.0"};
+  char path[1024];
+
+  if (strchr(library, '/')) {
+    return dlopen(library, RTLD_NOW | RTLD_GLOBAL);
+  }
+  for (size_t i = 0; i < library_dir_count; i++) {
+    snprintf(path, sizeof(path), "%s/lib%s.so", library_dirs[i], library);
+    void *handle = dlopen(path, RTLD_NOW | RTLD_GLOBAL);
+    if (handle) {
+      return handle;
+    }
+  }
+  for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); i++) {
+    snprintf(path, sizeof(path), "lib%s%s", library, suffixes[i]);
+    void *handle = dlopen(path, RTLD_NOW | RTLD_GLOBAL);
+    if (handle) {
+      return handle;
+    }
+  }
+  return NULL;
+}
+
+bool interp_link_externs(BcProgram *program, const char **library_dirs,
+                         size_t library_dir_count) {
+  for (size_t i = 0; i < program->extern_count; i++) {
+    BcExtern *ext = &program->externs[i];
+    void *handle = RTLD_DEFAULT;
+    if (ext->library) {
+      handle = open_library(ext->library, library_dirs, library_dir_count);
+      if (!handle) {
+        fprintf(stderr, "Error: cannot load library '%s' of extern '%s'\n",
+                ext->library, ext->name);
+        return false;
+      }
+    }
+
+    ext->address = dlsym(handle, ext->name);
+    if (!ext->address) {
+      fprintf(stderr, "Error: extern function '%s' not found%s%s\n",
+              ext->name, ext->library ? " in " : "",
+              ext->library ? ext->library : "");
+      return false;
+    }
+  }
+  return true;
+}
+#else
+bool interp_link_externs(BcProgram *program, const char **library_dirs,
+                         size_t library_dir_count) {
+  (void)library_dirs;
+  (void)library_dir_count;
+  if (program->extern_count > 0) {
+    fprintf(stderr, "Error: --interp cannot call extern functions on "
+                    "Windows\n");
+    return false;
+  }
+  return true;
+}
+#endif
+
+bool interp_program(AstNode *program, const char **library_dirs,
+                    size_t library_dir_count, ArenaAllocator *arena,
+                    int *exit_status) {
+  BcProgram bytecode;
+  if (!bc_compile(program, &bytecode, arena) ||
+      !interp_link_externs(&bytecode, library_dirs, library_dir_count)) {
+    return false;
+  }
+
+  BcValue result;
+  bool ran = bc_execute(&bytecode, bytecode.entry, arena, &result);
+  fflush(stdout);
+  if (ran) {
+    *exit_status = (int)result.i;
+  }
+  return ran;
+}
@@ -0,0 +1,53 @@
+/**
+ * @file interp.h
+ * @brief Runs a typechecked program without LLVM (`luma run --interp`).
+ *
+ * The program is compiled to register bytecode (see bytecode.h) and run by
+ * an interpreter in the compiler's process, so a script starts executing
+ * right after typechecking instead of after code generation and linking.
+ *
+ * It supports what the code generator does: `int`, `float`, `double`,
+ * `bool`, `char`, `str` and pointers, globals, functions across modules,
+ * `output`/`outputln`, `alloc`, `free`, `memcpy`, `sizeof`, `cast`, `defer`
+ * and loops, and calls `extern` functions with up to six integer or pointer
+ * and eight floating point arguments.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "../ast/ast.h"
+#include "../c_libs/memory/memory.h"
+#include "bytecode.h"
+
+/**
+ * @brief Finds the C functions a program declares `extern`.
+ *
+ * A function with a library is looked up in that library (lib<name>.so,
+ * from @p library_dirs first, or a path), any other in the libraries the
+ * compiler itself is linked with.
+ *
+ * @param program Compiled program.
+ * @param library_dirs -L directories.
+ * @param library_dir_count Number of @p library_dirs.
+ * @return false if one is missing (already reported).
+ */
+bool interp_link_externs(BcProgram *program, const char **library_dirs,
+                         size_t library_dir_count);
+
+/**
+ * @brief Interprets a program: initializes its globals and runs its `main`.
+ *
+ * @param program AST_PROGRAM, typechecked, its modules in dependency order.
+ * @param library_dirs -L directories searched for extern functions.
+ * @param library_dir_count Number of @p library_dirs.
+ * @param arena Arena for the bytecode and the interpreter's stack.
+ * @param exit_status What `main` returned, as a process exit status.
+ * @return false if the program could not be compiled or failed at run time
+ *         (already reported).
+ */
+bool interp_program(AstNode *program, const char **library_dirs,
+                    size_t library_dir_count, ArenaAllocator *arena,
+                    int *exit_status);
@@ -0,0 +1,459 @@
+/**
+ * @file vm.c
+ * @brief Runs register bytecode.
+ *
+ * With GCC and Clang every instruction ends in its own indirect jump to the
+ * next one (computed goto), so the branch predictor learns which opcode
+ * follows which; other compilers get a switch in a loop. The registers of
+ * every active call share one stack of BC_STACK_SLOTS values taken from the
+ * arena, and a call pushes a frame recording where to return to.
+ *
+ * Integer arithmetic wraps like the code generator's does.
+ *
+ * @see bytecode.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bytecode.h"
+
+typedef struct {
+  const BcFunction *function;
+  const BcInstr *pc;   // Next instruction of the caller
+  BcValue *registers; // The caller's window
+} Frame;
+
+#define EXTERN_PARAMS                                                          \
+  int64_t, int64_t, int64_t, int64_t, int64_t, int64_t, double, double,       \
+      double, double, double, double, double, double
+#define EXTERN_ARGS(i, f)                                                      \
+  i[0], i[1], i[2], i[3], i[4], i[5], f[0], f[1], f[2], f[3], f[4], f[5],      \
+      f[6], f[7]
+
+// Integer and pointer arguments go in the integer registers and floating
+// point ones in the vector registers, each class in order (System V x86-64
+// and AArch64), so one call with every register filled fits any extern
+static BcValue call_extern(const BcExtern *ext, const BcValue *args) {
+  int64_t ints[BC_EXTERN_INT_ARGS] = {0};
+  double floats[BC_EXTERN_FLOAT_ARGS] = {0};
+  size_t int_count = 0;
+  size_t float_count = 0;
+
+  for (size_t i = 0; i < ext->param_count; i++) {
+    if (ext->params[i] == BC_CLASS_FLOAT) {
+      // A float is passed in the low half of its register
+      union {
+        double d;
+        float f;
+      } bits = {0};
+      bits.f = (float)args[i].f;
+      floats[float_count++] = bits.d;
+    } else if (ext->params[i] == BC_CLASS_DOUBLE) {
+      floats[float_count++] = args[i].f;
+    } else {
+      ints[int_count++] = args[i].i;
+    }
+  }
+
+  BcValue result = {0};
+  switch (ext->result) {
+  case BC_CLASS_FLOAT:
+    result.f = ((float (*)(EXTERN_PARAMS))ext->address)(
+        EXTERN_ARGS(ints, floats));
+    break;
+  case BC_CLASS_DOUBLE:
+    result.f = ((double (*)(EXTERN_PARAMS))ext->address)(
+        EXTERN_ARGS(ints, floats));
+    break;
+  default:
+    result.i = ((int64_t (*)(EXTERN_PARAMS))ext->address)(
+        EXTERN_ARGS(ints, floats));
+    break;
+  }
+  return result;
+}
+
+#define WRAP(a, op, b) ((int64_t)((uint64_t)(a)op(uint64_t)(b)))
+
+bool bc_execute(const BcProgram *program, size_t function_index,
+                ArenaAllocator *arena, BcValue *result) {
+  BcValue *stack = arena_alloc(arena, BC_STACK_SLOTS * sizeof(BcValue),
+                               alignof(BcValue));
+  Frame *frames =
+      arena_alloc(arena, BC_MAX_FRAMES * sizeof(Frame), alignof(Frame));
+  if (!stack || !frames) {
+    fprintf(stderr, "Error: out of memory for the interpreter's stack\n");
+    return false;
+  }
+
+  const BcValue *stack_end = stack + BC_STACK_SLOTS;
+  const Frame *frames_end = frames + BC_MAX_FRAMES;
+  Frame *frame = frames;
+  const BcFunction *function = &program->functions[function_index];
+  const BcInstr *pc = function->code;
+  const BcValue *K = function->constants;
+  BcValue *R = stack;
+  BcValue *G = program->globals;
+  const char *error = "stack overflow";
+  BcInstr i;
+
+  if (function->frame_size > BC_STACK_SLOTS) {
+    goto fail;
+  }
+
+#if defined(__GNUC__)
+  static const void *const dispatch[BC_OPCODE_COUNT] = {
+#define BC_LABEL(name) &&op_##name,
+      BC_OPCODES(BC_LABEL)
+#undef BC_LABEL
+  };
+#define VM_CASE(name) op_##name:
+#define VM_NEXT()                                                              \
+  do {                                                                         \
+    i = *pc++;                                                                 \
+    goto *dispatch[i.op];                                                      \
+  } while (0)
+  VM_NEXT();
+#else
+#define VM_CASE(name) case BC_##name:
+#define VM_NEXT() continue
+  for (;;) {
+    i = *pc++;
+    switch (i.op) {
+#endif
+
+  VM_CASE(LOADK) {
+    R[i.a] = K[i.bx];
+    VM_NEXT();
+  }
+  VM_CASE(LOADI) {
+    R[i.a].i = i.sbx;
+    VM_NEXT();
+  }
+  VM_CASE(MOVE) {
+    R[i.a] = R[i.b];
+    VM_NEXT();
+  }
+  VM_CASE(GETG) {
+    R[i.a] = G[i.bx];
+    VM_NEXT();
+  }
+  VM_CASE(SETG) {
+    G[i.bx] = R[i.a];
+    VM_NEXT();
+  }
+  VM_CASE(ADDRG) {
+    R[i.a].p = &G[i.bx];
+    VM_NEXT();
+  }
+  VM_CASE(ADDRL) {
+    R[i.a].p = &R[i.b];
+    VM_NEXT();
+  }
+
+  VM_CASE(ADD) {
+    R[i.a].i = WRAP(R[i.b].i, +, R[i.c].i);
+    VM_NEXT();
+  }
+  VM_CASE(ADDI) {
+    R[i.a].i = WRAP(R[i.b].i, +, (int16_t)i.c);
+    VM_NEXT();
+  }
+  VM_CASE(SUB) {
+    R[i.a].i = WRAP(R[i.b].i, -, R[i.c].i);
+    VM_NEXT();
+  }
+  VM_CASE(MUL) {
+    R[i.a].i = WRAP(R[i.b].i, *, R[i.c].i);
+    VM_NEXT();
+  }
+  VM_CASE(DIV) {
+    if (R[i.c].i == 0) {
+      error = "division by zero";
+      goto fail;
+    }
+    R[i.a].i =
+        R[i.c].i == -1 ? WRAP(0, -, R[i.b].i) : R[i.b].i / R[i.c].i;
+    VM_NEXT();
+  }
+  VM_CASE(MOD) {
+    if (R[i.c].i == 0) {
+      error = "division by zero";
+      goto fail;
+    }
+    R[i.a].i = R[i.c].i == -1 ? 0 : R[i.b].i % R[i.c].i;
+    VM_NEXT();
+  }
+  VM_CASE(NEG) {
+    R[i.a].i = WRAP(0, -, R[i.b].i);
+    VM_NEXT();
+  }
+  VM_CASE(BAND) {
+    R[i.a].i = R[i.b].i & R[i.c].i;
+    VM_NEXT();
+  }
+  VM_CASE(BOR) {
+    R[i.a].i = R[i.b].i | R[i.c].i;
+    VM_NEXT();
+  }
+  VM_CASE(BXOR) {
+    R[i.a].i = R[i.b].i ^ R[i.c].i;
+    VM_NEXT();
+  }
+  VM_CASE(SHL) {
+    R[i.a].i = (int64_t)((uint64_t)R[i.b].i << (R[i.c].i & 63));
+    VM_NEXT();
+  }
+  VM_CASE(SHR) {
+    R[i.a].i = R[i.b].i >> (R[i.c].i & 63);
+    VM_NEXT();
+  }
+  VM_CASE(BNOT) {
+    R[i.a].i = ~R[i.b].i;
+    VM_NEXT();
+  }
+  VM_CASE(NOT) {
+    R[i.a].i = !R[i.b].i;
+    VM_NEXT();
+  }
+
+  VM_CASE(FADD) {
+    R[i.a].f = R[i.b].f + R[i.c].f;
+    VM_NEXT();
+  }
+  VM_CASE(FSUB) {
+    R[i.a].f = R[i.b].f - R[i.c].f;
+    VM_NEXT();
+  }
+  VM_CASE(FMUL) {
+    R[i.a].f = R[i.b].f * R[i.c].f;
+    VM_NEXT();
+  }
+  VM_CASE(FDIV) {
+    R[i.a].f = R[i.b].f / R[i.c].f;
+    VM_NEXT();
+  }
+  VM_CASE(FNEG) {
+    R[i.a].f = -R[i.b].f;
+    VM_NEXT();
+  }
+  VM_CASE(FROUND) {
+    R[i.a].f = (float)R[i.b].f;
+    VM_NEXT();
+  }
+
+  VM_CASE(EQ) {
+    R[i.a].i = R[i.b].i == R[i.c].i;
+    VM_NEXT();
+  }
+  VM_CASE(NE) {
+    R[i.a].i = R[i.b].i != R[i.c].i;
+    VM_NEXT();
+  }
+  VM_CASE(LT) {
+    R[i.a].i = R[i.b].i < R[i.c].i;
+    VM_NEXT();
+  }
+  VM_CASE(LE) {
+    R[i.a].i = R[i.b].i <= R[i.c].i;
+    VM_NEXT();
+  }
+  VM_CASE(GT) {
+    R[i.a].i = R[i.b].i > R[i.c].i;
+    VM_NEXT();
+  }
+  VM_CASE(GE) {
+    R[i.a].i = R[i.b].i >= R[i.c].i;
+    VM_NEXT();
+  }
+  VM_CASE(FEQ) {
+    R[i.a].i = R[i.b].f == R[i.c].f;
+    VM_NEXT();
+  }
+  VM_CASE(FNE) {
+    R[i.a].i = R[i.b].f != R[i.c].f;
+    VM_NEXT();
+  }
+  VM_CASE(FLT) {
+    R[i.a].i = R[i.b].f < R[i.c].f;
+    VM_NEXT();
+  }
+  VM_CASE(FLE) {
+    R[i.a].i = R[i.b].f <= R[i.c].f;
+    VM_NEXT();
+  }
+  VM_CASE(FGT) {
+    R[i.a].i = R[i.b].f > R[i.c].f;
+    VM_NEXT();
+  }
+  VM_CASE(FGE) {
+    R[i.a].i = R[i.b].f >= R[i.c].f;
+    VM_NEXT();
+  }
+
+  VM_CASE(I2F) {
+    R[i.a].f = (double)R[i.b].i;
+    VM_NEXT();
+  }
+  VM_CASE(F2I) {
+    R[i.a].i = (int64_t)R[i.b].f;
+    VM_NEXT();
+  }
+  VM_CASE(TOCHAR) {
+    R[i.a].i = (int8_t)R[i.b].i;
+    VM_NEXT();
+  }
+  VM_CASE(TOBOOL) {
+    R[i.a].i = R[i.b].i != 0;
+    VM_NEXT();
+  }
+  VM_CASE(FTOBOOL) {
+    R[i.a].i = R[i.b].f != 0;
+    VM_NEXT();
+  }
+
+  VM_CASE(JMP) {
+    pc += i.sbx;
+    VM_NEXT();
+  }
+  VM_CASE(JMPF) {
+    if (!R[i.a].i) {
+      pc += i.sbx;
+    }
+    VM_NEXT();
+  }
+  VM_CASE(JMPT) {
+    if (R[i.a].i) {
+      pc += i.sbx;
+    }
+    VM_NEXT();
+  }
+
+  VM_CASE(CALL) {
+    // The callee's window starts at its first argument
+    const BcFunction *callee = &program->functions[i.bx];
+    BcValue *window = R + i.a;
+    if (frame + 1 == frames_end ||
+        callee->frame_size > (size_t)(stack_end - window)) {
+      error = "stack overflow";
+      goto fail;
+    }
+    *frame++ = (Frame){function, pc, R};
+    function = callee;
+    pc = callee->code;
+    K = callee->constants;
+    R = window;
+    VM_NEXT();
+  }
+  VM_CASE(CALLC) {
+    R[i.a] = call_extern(&program->externs[i.bx], &R[i.a]);
+    VM_NEXT();
+  }
+  VM_CASE(RET) {
+    if (frame == frames) {
+      *result = R[i.a];
+      return true;
+    }
+    // Where the caller reads the result
+    R[0] = R[i.a];
+    frame--;
+    function = frame->function;
+    pc = frame->pc;
+    K = function->constants;
+    R = frame->registers;
+    VM_NEXT();
+  }
+
+  VM_CASE(PRINTI) {
+    printf("%lld", (long long)R[i.a].i);
+    VM_NEXT();
+  }
+  VM_CASE(PRINTC) {
+    printf("%d", (int)R[i.a].i);
+    VM_NEXT();
+  }
+  VM_CASE(PRINTF) {
+    printf("%f", R[i.a].f);
+    VM_NEXT();
+  }
+  VM_CASE(PRINTS) {
+    fputs(R[i.a].p ? (const char *)R[i.a].p : "(null)", stdout);
+    VM_NEXT();
+  }
+  VM_CASE(PRINTP) {
+    printf("%p", R[i.a].p);
+    VM_NEXT();
+  }
+  VM_CASE(PRINTLN) {
+    putchar('\n');
+    VM_NEXT();
+  }
+
+  VM_CASE(ALLOC) {
+    R[i.a].p = malloc((size_t)R[i.b].i);
+    VM_NEXT();
+  }
+  VM_CASE(FREE) {
+    free(R[i.a].p);
+    VM_NEXT();
+  }
+  VM_CASE(MEMCPY) {
+    memcpy(R[i.a].p, R[i.b].p, (size_t)R[i.c].i);
+    VM_NEXT();
+  }
+
+  VM_CASE(LDI64) {
+    R[i.a].i = *(const int64_t *)R[i.b].p;
+    VM_NEXT();
+  }
+  VM_CASE(LDI8) {
+    R[i.a].i = *(const int8_t *)R[i.b].p;
+    VM_NEXT();
+  }
+  VM_CASE(LDU8) {
+    R[i.a].i = *(const uint8_t *)R[i.b].p;
+    VM_NEXT();
+  }
+  VM_CASE(LDF32) {
+    R[i.a].f = *(const float *)R[i.b].p;
+    VM_NEXT();
+  }
+  VM_CASE(LDF64) {
+    R[i.a].f = *(const double *)R[i.b].p;
+    VM_NEXT();
+  }
+  VM_CASE(STI64) {
+    *(int64_t *)R[i.a].p = R[i.b].i;
+    VM_NEXT();
+  }
+  VM_CASE(STI8) {
+    *(int8_t *)R[i.a].p = (int8_t)R[i.b].i;
+    VM_NEXT();
+  }
+  VM_CASE(STF32) {
+    *(float *)R[i.a].p = (float)R[i.b].f;
+    VM_NEXT();
+  }
+  VM_CASE(STF64) {
+    *(double *)R[i.a].p = R[i.b].f;
+    VM_NEXT();
+  }
+
+#if !defined(__GNUC__)
+    default:
+      error = "invalid instruction";
+      goto fail;
+    }
+  }
+#endif
+
+fail:
+  fprintf(stderr, "Runtime error: %s in '%s'", error, function->name);
+  if (pc > function->code) {
+    fprintf(stderr, " at line %u", function->lines[pc - 1 - function->code]);
+  }
+  fprintf(stderr, "\n");
+  return false;
+}
@@ -7,8 +7,10 @@
  */
 
 #include <ctype.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "../c_libs/error/error.h"
@@ -78,6 +80,7 @@ static const KeywordEntry keywords[] = {
     {"sizeof", TOK_SIZE_OF},
     {"as", TOK_AS},
     {"defer", TOK_DEFER},
+    {"extern", TOK_EXTERN},
 };
 
 static const KeywordEntry preprocessor_directives[] = {
@@ -120,10 +123,11 @@ void report_lexer_error(Lexer *lx, const char *error_type, const char *file,
  *
  * @param source Full source code string
  * @param target_line Line number to extract (1-based)
- * @return Pointer to static buffer containing the line text
+ * @return Pointer to a per-thread static buffer containing the line text
  */
 const char *get_line_text_from_source(const char *source, int target_line) {
-  static char line_buffer[1024];
+  // Per thread, since deferred function bodies are parsed on pool workers
+  static _Thread_local char line_buffer[1024];
   const char *start = source;
   int current_line = 1;
 
@@ -148,6 +152,24 @@ const char *get_line_text_from_source(const char *source, int target_line) {
   return line_buffer;
 }
 
+/**
+ * @internal
+ * @brief Reports an error on the lexer's current line, unless it is quiet.
+ *
+ * @param lx Pointer to Lexer
+ * @param msg Error message
+ * @param col Column of the erroneous token
+ * @param tk_length Length of the erroneous token
+ */
+static void report_here(Lexer *lx, const char *msg, int col, int tk_length) {
+  // Skips finding the line as well, which scans from the start of the source
+  if (!lx->quiet) {
+    report_lexer_error(lx, "LexerError", "unknown_file", msg,
+                       get_line_text_from_source(lx->src, lx->line), lx->line,
+                       col, tk_length);
+  }
+}
+
 /**
  * @internal
  * @brief Looks up if a string matches a keyword token.
@@ -214,6 +236,7 @@ void init_lexer(Lexer *lexer, const char *source, ArenaAllocator *arena) {
   lexer->current = source;
   lexer->line = 1;
   lexer->col = 0;
+  lexer->quiet = false;
 }
 
 /**
@@ -267,7 +290,7 @@ char advance(Lexer *lx) {
  */
 Token make_token(TokenType type, const char *start, int line, int col,
                  int length, int whitespace_len) {
-  return (Token){type, start, line, col, length, whitespace_len};
+  return (Token){type, start, line, col, length, whitespace_len, NULL};
 }
 
 /**
@@ -323,6 +346,238 @@ int skip_whitespace(Lexer *lx) {
   return count;
 }
 
+/**
+ * @internal
+ * @brief Reports a malformed literal spanning from @p start to the current
+ * position and returns an error token for it.
+ */
+static Token literal_error(Lexer *lx, const char *start, const char *msg,
+                           int wh_count) {
+  int len = (int)(lx->current - start);
+  report_here(lx, msg, lx->col - len, len);
+  return MAKE_TOKEN(TOK_ERROR, start, lx, len, wh_count);
+}
+
+/**
+ * @internal
+ * @brief Value of a digit in the given base.
+ *
+ * @return The digit's value, or -1 if @p c is not a digit of @p base
+ */
+static int digit_value(char c, int base) {
+  int digit = -1;
+  if (c >= '0' && c <= '9') {
+    digit = c - '0';
+  } else if (c >= 'a' && c <= 'f') {
+    digit = c - 'a' + 10;
+  } else if (c >= 'A' && c <= 'F') {
+    digit = c - 'A' + 10;
+  }
+  return digit < base ? digit : -1;
+}
+
+/**
+ * @internal
+ * @brief Digits of a number literal, without separators.
+ */
+typedef struct {
+  unsigned long long value; /**< Integer value of the digits */
+  bool overflow;            /**< value exceeded 64 bits */
+  char text[128];           /**< Digits and '.', for strtod */
+  size_t text_len;          /**< Used length of text */
+  bool too_long;            /**< text was truncated */
+} NumberDigits;
+
+/**
+ * @internal
+ * @brief Appends a character to the text of a number literal.
+ */
+static void append_digit_text(NumberDigits *digits, char c) {
+  if (digits->text_len + 1 < sizeof(digits->text)) {
+    digits->text[digits->text_len++] = c;
+  } else {
+    digits->too_long = true;
+  }
+}
+
+/**
+ * @internal
+ * @brief Consumes digits of @p base, and '_' separators between them.
+ *
+ * @param lx Pointer to Lexer
+ * @param base 2, 10 or 16
+ * @param digits Digits read so far, extended in place
+ */
+static void scan_digits(Lexer *lx, int base, NumberDigits *digits) {
+  for (;;) {
+    char c = peek(lx, 0);
+    if (c == '_' && digit_value(peek(lx, 1), base) >= 0) {
+      advance(lx);
+      continue;
+    }
+    int digit = digit_value(c, base);
+    if (digit < 0) {
+      return;
+    }
+    advance(lx);
+    if (digits->value > (ULLONG_MAX - (unsigned)digit) / (unsigned)base) {
+      digits->overflow = true;
+    }
+    digits->value = digits->value * (unsigned)base + (unsigned)digit;
+    append_digit_text(digits, c);
+  }
+}
+
+/**
+ * @internal
+ * @brief Scans the rest of a number literal whose first digit was consumed
+ * and decodes its value.
+ *
+ * @param lx Pointer to Lexer
+ * @param start Start of the literal
+ * @param wh_count Leading whitespace length
+ * @return TOK_NUMBER, TOK_NUM_FLOAT or TOK_NUM_DOUBLE with its literal, or
+ *         TOK_ERROR (reported)
+ */
+static Token lex_number(Lexer *lx, const char *start, int wh_count) {
+  NumberDigits digits = {0};
+  int base = 10;
+  if (start[0] == '0' && (peek(lx, 0) == 'x' || peek(lx, 0) == 'X') &&
+      digit_value(peek(lx, 1), 16) >= 0) {
+    base = 16;
+    advance(lx);
+  } else if (start[0] == '0' && (peek(lx, 0) == 'b' || peek(lx, 0) == 'B') &&
+             digit_value(peek(lx, 1), 2) >= 0) {
+    base = 2;
+    advance(lx);
+  } else {
+    digits.value = (unsigned)(start[0] - '0');
+    append_digit_text(&digits, start[0]);
+  }
+  scan_digits(lx, base, &digits);
+
+  TokenType type = TOK_NUMBER;
+  if (base == 10 && peek(lx, 0) == '.' && isdigit(peek(lx, 1))) {
+    advance(lx); // consume the '.'
+    append_digit_text(&digits, '.');
+    scan_digits(lx, 10, &digits);
+    type = TOK_NUM_FLOAT;
+  }
+
+  // Width suffix
+  if (isalpha(peek(lx, 0))) {
+    const char *suffix = lx->current;
+    while (isalnum(peek(lx, 0)) || peek(lx, 0) == '_') {
+      advance(lx);
+    }
+    int suffix_len = (int)(lx->current - suffix);
+    if (STR_EQUALS_LEN(suffix, "f32", suffix_len) && base == 10) {
+      type = TOK_NUM_FLOAT;
+    } else if (STR_EQUALS_LEN(suffix, "f64", suffix_len) && base == 10) {
+      type = TOK_NUM_DOUBLE;
+    } else if (!STR_EQUALS_LEN(suffix, "i64", suffix_len) ||
+               type != TOK_NUMBER) {
+      return literal_error(lx, start, "Unknown suffix on number literal",
+                           wh_count);
+    }
+  }
+
+  if (digits.too_long) {
+    return literal_error(lx, start, "Number literal is too long", wh_count);
+  }
+  if (type == TOK_NUMBER && digits.overflow) {
+    return literal_error(lx, start, "Integer literal does not fit in 64 bits",
+                         wh_count);
+  }
+
+  TokenLiteral *literal = (TokenLiteral *)arena_alloc(
+      lx->arena, sizeof(TokenLiteral), alignof(TokenLiteral));
+  if (!literal) {
+    return literal_error(lx, start, "Out of memory", wh_count);
+  }
+  if (type == TOK_NUMBER) {
+    literal->int_val = (long long)digits.value;
+  } else {
+    digits.text[digits.text_len] = '\0';
+    literal->float_val = strtod(digits.text, NULL);
+  }
+
+  int len = (int)(lx->current - start);
+  Token token = MAKE_TOKEN(type, start, lx, len, wh_count);
+  token.literal = literal;
+  return token;
+}
+
+/**
+ * @internal
+ * @brief Scans the rest of a string literal whose opening quote was
+ * consumed and decodes its escape sequences (\\n, \\r, \\t, \\\\,
+ * \\" and \\0; any other backslash is kept as is).
+ *
+ * @param lx Pointer to Lexer
+ * @param start Opening quote
+ * @param wh_count Leading whitespace length
+ * @return TOK_STRING over the text between the quotes, with its literal
+ */
+static Token lex_string(Lexer *lx, const char *start, int wh_count) {
+  while (!is_at_end(lx) && peek(lx, 0) != '"') {
+    if (peek(lx, 0) == '\\' && peek(lx, 1) != '\0') {
+      advance(lx);
+    }
+    advance(lx);
+  }
+  int len = (int)(lx->current - start - 1);
+  if (!is_at_end(lx)) {
+    advance(lx); // Skip closing quote
+  }
+
+  TokenLiteral *literal = (TokenLiteral *)arena_alloc(
+      lx->arena, sizeof(TokenLiteral), alignof(TokenLiteral));
+  char *text = (char *)arena_alloc(lx->arena, (size_t)len + 1, alignof(char));
+  if (!literal || !text) {
+    return literal_error(lx, start, "Out of memory", wh_count);
+  }
+
+  const char *raw = start + 1;
+  size_t out = 0;
+  for (int i = 0; i < len; i++) {
+    char c = raw[i];
+    if (c == '\\' && i + 1 < len) {
+      switch (raw[i + 1]) {
+      case 'n':
+        c = '\n';
+        break;
+      case 'r':
+        c = '\r';
+        break;
+      case 't':
+        c = '\t';
+        break;
+      case '\\':
+        c = '\\';
+        break;
+      case '"':
+        c = '"';
+        break;
+      case '0':
+        c = '\0';
+        break;
+      default:
+        text[out++] = c;
+        continue;
+      }
+      i++;
+    }
+    text[out++] = c;
+  }
+  text[out] = '\0';
+  literal->string_val = text;
+
+  Token token = MAKE_TOKEN(TOK_STRING, start + 1, lx, len, wh_count);
+  token.literal = literal;
+  return token;
+}
+
 /**
  * @brief Retrieves the next token from the input stream.
  *
@@ -351,12 +606,10 @@ Token next_token(Lexer *lx) {
         return MAKE_TOKEN(type, start, lx, len, wh_count);
       }
       // If not a known preprocessor directive, treat as error or symbol
-      static char error_msg[64];
+      static _Thread_local char error_msg[64];
       snprintf(error_msg, sizeof(error_msg),
                "Unknown preprocessor directive: '%.*s'", len, start);
-      report_lexer_error(lx, "LexerError", "unknown_file", error_msg,
-                         get_line_text_from_source(lx->src, lx->line), lx->line,
-                         lx->col - len, len);
+      report_here(lx, error_msg, lx->col - len, len);
       return MAKE_TOKEN(TOK_ERROR, start, lx, len, wh_count);
     }
     // Just @ by itself - treat as symbol
@@ -376,40 +629,12 @@ Token next_token(Lexer *lx) {
 
   // Numbers
   if (isdigit(c)) {
-    // Read the integer part
-    while (isdigit(peek(lx, 0))) {
-      advance(lx);
-    }
-
-    // Check for decimal point
-    if (peek(lx, 0) == '.' && isdigit(peek(lx, 1))) {
-      advance(lx); // consume the '.'
-
-      // Read the fractional part
-      while (isdigit(peek(lx, 0))) {
-        advance(lx);
-      }
-
-      int len = (int)(lx->current - start);
-      return MAKE_TOKEN(TOK_NUM_FLOAT, start, lx, len,
-                        wh_count); // Make sure this is TOK_FLOAT_LITERAL
-    }
-
-    int len = (int)(lx->current - start);
-    return MAKE_TOKEN(TOK_NUMBER, start, lx, len,
-                      wh_count); // Make sure this is TOK_NUMBER
+    return lex_number(lx, start, wh_count);
   }
 
   // Strings
   if (c == '"') {
-    while (!is_at_end(lx) && peek(lx, 0) != '"') {
-      advance(lx);
-    }
-    if (!is_at_end(lx)) {
-      advance(lx); // Skip closing quote
-    }
-    int len = (int)(lx->current - start - 2);
-    return MAKE_TOKEN(TOK_STRING, start + 1, lx, len, wh_count);
+    return lex_string(lx, start, wh_count);
   }
 
   // Try to match two-character symbol
@@ -428,10 +653,20 @@ Token next_token(Lexer *lx) {
     return MAKE_TOKEN(single_type, start, lx, 1, wh_count);
 
   // Error token if none matched
-  static char error_msg[64];
+  static _Thread_local char error_msg[64];
   snprintf(error_msg, sizeof(error_msg), "Token not found: '%c'", c);
-  report_lexer_error(lx, "LexerError", "unknown_file", error_msg,
-                     get_line_text_from_source(lx->src, lx->line), lx->line,
-                     lx->col, 1);
+  report_here(lx, error_msg, lx->col, 1);
   return MAKE_TOKEN(TOK_ERROR, start, lx, 1, wh_count);
 }
+
+const TokenLiteral *token_literal(const Token *token, ArenaAllocator *arena) {
+  if (token->literal) {
+    return token->literal;
+  }
+  // String tokens point past their opening quote
+  Lexer lexer;
+  init_lexer(&lexer,
+             token->type_ == TOK_STRING ? token->value - 1 : token->value,
+             arena);
+  return next_token(&lexer).literal;
+}
@@ -10,6 +10,7 @@
 #pragma once
 
 #include "../c_libs/memory/memory.h"
+#include <stdbool.h>
 #include <stdint.h>
 
 /**
@@ -23,6 +24,7 @@ typedef enum {
   TOK_KEYWORD,      /**< Reserved keyword */
   TOK_NUMBER,       /**< Numeric literal */
   TOK_NUM_FLOAT,    /**< Floating point numeric literal */
+  TOK_NUM_DOUBLE,   /**< Numeric literal with an f64 suffix */
   TOK_STRING,       /**< String literal */
   TOK_CHAR_LITERAL, /**< Character literal */
 
@@ -64,6 +66,7 @@ typedef enum {
   TOK_MEMCPY,   /**< memcpy(void *to, void *from, int size) */
   TOK_AS,       /**< as keyword (for use in modules) */
   TOK_DEFER,    /**< defer keyword */
+  TOK_EXTERN,   /**< extern keyword (C functions) */
 
   // prepocessor directives
   TOK_MODULE, /**< @module */
@@ -120,19 +123,36 @@ typedef struct {
   const char *current;   /**< Current scanning position in source */
   int line;              /**< Current line number */
   int col;               /**< Current column number */
+  bool quiet;            /**< Leave errors to the TOK_ERROR tokens */
 } Lexer;
 
+/**
+ * @struct TokenLiteral
+ * @brief Value of a number or string token, decoded once by the lexer.
+ *
+ * Lives in the lexer's arena, so it outlives the source text the token
+ * points into.
+ */
+typedef struct {
+  union {
+    long long int_val;      /**< TOK_NUMBER */
+    double float_val;       /**< TOK_NUM_FLOAT, TOK_NUM_DOUBLE */
+    const char *string_val; /**< TOK_STRING, escape sequences resolved */
+  };
+} TokenLiteral;
+
 /**
  * @struct Token
  * @brief Represents a single token extracted by the lexer.
  */
 typedef struct {
-  TokenType type_;    /**< Token type */
-  const char *value;  /**< Pointer to token text start */
-  int line;           /**< Line number of token */
-  int col;            /**< Column number of token */
-  int length;         /**< Length of the token text */
-  int whitespace_len; /**< Leading whitespace length before token */
+  TokenType type_;             /**< Token type */
+  const char *value;           /**< Pointer to token text start */
+  int line;                    /**< Line number of token */
+  int col;                     /**< Column number of token */
+  int length;                  /**< Length of the token text */
+  int whitespace_len;          /**< Leading whitespace length before token */
+  const TokenLiteral *literal; /**< Decoded literal (token_literal()) */
 } Token;
 
 /**
@@ -190,7 +210,47 @@ void init_lexer(Lexer *lexer, const char *source, ArenaAllocator *arena);
 /**
  * @brief Returns the next token parsed from the source code.
  *
+ * Number and string literals come with their decoded value (see
+ * TokenLiteral). Integers are decimal, hexadecimal (`0x`) or binary (`0b`)
+ * and may use `_` between digits, e.g. `1_000_000`; values up to 2^64 - 1
+ * are kept as their 64-bit two's complement. A number may end in a width
+ * suffix: `i64` on an integer (the width of `int`), or `f32` or `f64` on
+ * any number for a `float` or `double` literal.
+ *
  * @param lexer Pointer to initialized Lexer
  * @return The next Token found in the input stream
  */
 Token next_token(Lexer *lexer);
+
+/**
+ * @brief Returns the decoded value of a number or string token.
+ *
+ * A token whose literal is gone (see Token::literal; the language server
+ * drops them when it keeps tokens across edits) is lexed again from its
+ * text, which must still be in memory.
+ *
+ * @param token TOK_NUMBER, TOK_NUM_FLOAT, TOK_NUM_DOUBLE or TOK_STRING
+ * @param arena Arena for a value decoded again
+ * @return The literal, or NULL if out of memory
+ */
+const TokenLiteral *token_literal(const Token *token, ArenaAllocator *arena);
+
+/**
+ * @brief Lexes a whole source file, up to but not including TOK_EOF.
+ *
+ * Files of two megabytes or more are split at line starts into a chunk per
+ * job (of at least a megabyte each), and the chunks are lexed in parallel
+ * as if none of them started inside a string or comment. Each chunk is then
+ * checked against the token the previous one actually stopped at, and lexed
+ * again from there until the two agree if the guess was wrong, so the
+ * tokens (line numbers included) are always those next_token() gives for
+ * the whole file.
+ *
+ * @param source Source code string
+ * @param arena Arena for the tokens and their literals
+ * @param jobs Threads to lex with; 0 for one per CPU
+ * @param tokens Array to initialize with the tokens
+ * @return false if out of memory; lexer errors are reported, not returned
+ */
+bool lex_source(const char *source, ArenaAllocator *arena, size_t jobs,
+                GrowableArray *tokens);
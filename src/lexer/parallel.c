@@ -0,0 +1,303 @@
+/**
+ * @file parallel.c
+ * @brief Lexes whole source files, splitting very large ones across threads.
+ *
+ * A chunk starts at the beginning of a line and is lexed by its own Lexer
+ * into its own arena, guessing that no string or comment is open at its
+ * first character. Since next_token() depends on nothing but the position
+ * it starts from, a chunk is right from the first token it shares with the
+ * serial lexer onwards: stitching walks the chunks in order, carrying the
+ * first token the previous chunk stopped at, and keeps a chunk from the
+ * token starting where that one does. A chunk without such a token (it
+ * started inside a string or comment) is lexed again from the carried state
+ * until the two line up. Line numbers are counted per chunk and added up
+ * while stitching.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../c_libs/memory/memory.h"
+#include "../c_libs/thread/thread_pool.h"
+#include "lexer.h"
+
+/** @internal Smallest chunk worth a thread of its own */
+#define LEX_CHUNK_MIN_SIZE (1u << 20)
+
+/** @internal Token array capacity of a serial lex */
+#define LEX_INITIAL_TOKENS 100
+
+/** @internal Rough source bytes per token, for sizing chunk arrays */
+#define LEX_BYTES_PER_TOKEN 4
+
+typedef struct {
+  const char *start;    /**< First character, at the start of a line */
+  const char *end;      /**< Tokens starting here belong to the next chunk */
+  ArenaAllocator arena; /**< Tokens and literals of this chunk */
+  GrowableArray tokens; /**< Tokens starting in [start, end) */
+  GrowableArray fixed;  /**< Tokens the stitch lexed again, before @c first */
+  int line_offset;      /**< Added to the line of every token kept */
+  int newlines;         /**< Newlines in [start, end) */
+  Token next;           /**< First token starting at or past end */
+  Lexer resume;         /**< Lexer state just before @c next */
+  size_t first;         /**< First of @c tokens kept by the stitch */
+  bool ok;              /**< Lexed without running out of memory */
+} LexChunk;
+
+// Offset of a token's first character; string tokens point past their quote
+static const char *token_start(const Token *token) {
+  return token->type_ == TOK_STRING ? token->value - 1 : token->value;
+}
+
+// Lexes the tokens starting before end. The one after them (or TOK_EOF) is
+// left in chunk->next and the lexer state producing it in chunk->resume.
+static bool lex_range(Lexer *lx, LexChunk *chunk) {
+  for (;;) {
+    Lexer before = *lx;
+    Token tk = next_token(lx);
+    if (tk.type_ == TOK_EOF || token_start(&tk) >= chunk->end) {
+      chunk->next = tk;
+      chunk->resume = before;
+      return true;
+    }
+    Token *slot = (Token *)growable_array_push(&chunk->tokens);
+    if (!slot) {
+      return false;
+    }
+    *slot = tk;
+  }
+}
+
+static void lex_chunk_task(void *arg, size_t worker) {
+  (void)worker;
+  LexChunk *chunk = (LexChunk *)arg;
+
+  for (const char *c = chunk->start;
+       (c = memchr(c, '\n', (size_t)(chunk->end - c))) != NULL; c++) {
+    chunk->newlines++;
+  }
+
+  size_t estimate =
+      (size_t)(chunk->end - chunk->start) / LEX_BYTES_PER_TOKEN + 1;
+  if (!growable_array_init(&chunk->tokens, &chunk->arena, estimate,
+                           sizeof(Token))) {
+    return;
+  }
+
+  // Errors of a wrong guess must not be reported; the stitch checks for
+  // TOK_ERROR instead
+  Lexer lexer;
+  init_lexer(&lexer, chunk->start, &chunk->arena);
+  lexer.quiet = true;
+  chunk->ok = lex_range(&lexer, chunk);
+}
+
+static bool lex_serial(const char *source, ArenaAllocator *arena,
+                       GrowableArray *tokens) {
+  if (!growable_array_init(tokens, arena, LEX_INITIAL_TOKENS, sizeof(Token))) {
+    return false;
+  }
+  Lexer lexer;
+  init_lexer(&lexer, source, arena);
+  Token tk;
+  while ((tk = next_token(&lexer)).type_ != TOK_EOF) {
+    Token *slot = (Token *)growable_array_push(tokens);
+    if (!slot) {
+      return false;
+    }
+    *slot = tk;
+  }
+  return true;
+}
+
+// Splits [source, source + size) into at most count chunks starting at line
+// starts; returns how many there are
+static size_t split_chunks(const char *source, size_t size, LexChunk *chunks,
+                           size_t count) {
+  size_t made = 0;
+  const char *start = source;
+  const char *end_of_source = source + size;
+  for (size_t i = 1; i <= count && start < end_of_source; i++) {
+    const char *end = end_of_source;
+    if (i < count) {
+      const char *split = source + size / count * i;
+      const char *newline =
+          memchr(split, '\n', (size_t)(end_of_source - split));
+      end = newline ? newline + 1 : end_of_source;
+    }
+    if (end <= start) {
+      continue;
+    }
+    memset(&chunks[made], 0, sizeof(LexChunk));
+    chunks[made].start = start;
+    chunks[made].end = end;
+    made++;
+    start = end;
+  }
+  return made;
+}
+
+// Lexes a chunk again from the state the previous one stopped in, until a
+// token starts where one of the chunk's own does; from there on the chunk
+// agrees with the serial lexer. The token found replaces the chunk's own,
+// whose leading whitespace may differ. Lines are absolute in *resume.
+static bool resync_chunk(LexChunk *chunk, Token *next, Lexer *resume) {
+  if (!growable_array_init(&chunk->fixed, &chunk->arena, LEX_INITIAL_TOKENS,
+                           sizeof(Token))) {
+    return false;
+  }
+  Token *own = (Token *)chunk->tokens.data;
+  size_t at = 0;
+  Lexer lexer = *resume;
+  lexer.arena = &chunk->arena;
+
+  for (;;) {
+    Lexer before = lexer;
+    Token tk = next_token(&lexer);
+    const char *pos = token_start(&tk);
+    if (tk.type_ == TOK_EOF || pos >= chunk->end) {
+      // Covered by a token or comment of an earlier chunk
+      chunk->first = chunk->tokens.count;
+      *next = tk;
+      *resume = before;
+      return true;
+    }
+
+    while (at < chunk->tokens.count && token_start(&own[at]) < pos) {
+      at++;
+    }
+    if (at < chunk->tokens.count && token_start(&own[at]) == pos) {
+      own[at] = tk;
+      own[at].line -= chunk->line_offset;
+      chunk->first = at;
+      *next = chunk->next;
+      next->line += chunk->line_offset;
+      *resume = chunk->resume;
+      resume->line += chunk->line_offset;
+      return true;
+    }
+
+    Token *slot = (Token *)growable_array_push(&chunk->fixed);
+    if (!slot) {
+      return false;
+    }
+    *slot = tk;
+  }
+}
+
+static bool has_error_token(const Token *tokens, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    if (tokens[i].type_ == TOK_ERROR) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Decides which tokens of each chunk are kept. Returns false if out of
+// memory or a kept token is TOK_ERROR.
+static bool stitch_chunks(LexChunk *chunks, size_t count) {
+  Token next = chunks[0].next;
+  Lexer resume = chunks[0].resume;
+  int line = 1 + chunks[0].newlines;
+  if (has_error_token((const Token *)chunks[0].tokens.data,
+                      chunks[0].tokens.count)) {
+    return false;
+  }
+
+  for (size_t i = 1; i < count; i++) {
+    LexChunk *chunk = &chunks[i];
+    chunk->line_offset = line - 1;
+    line += chunk->newlines;
+    if (!resync_chunk(chunk, &next, &resume) ||
+        has_error_token((const Token *)chunk->fixed.data,
+                        chunk->fixed.count) ||
+        has_error_token((const Token *)chunk->tokens.data + chunk->first,
+                        chunk->tokens.count - chunk->first)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool lex_parallel(const char *source, size_t size,
+                         ArenaAllocator *arena, size_t workers,
+                         GrowableArray *tokens) {
+  LexChunk *chunks = (LexChunk *)arena_alloc(
+      arena, workers * sizeof(LexChunk), alignof(LexChunk));
+  if (!chunks) {
+    return false;
+  }
+  size_t count = split_chunks(source, size, chunks, workers);
+  for (size_t i = 0; i < count; i++) {
+    arena_allocator_init(&chunks[i].arena, ARENA_MIN_BUFFER_SIZE);
+  }
+
+  bool success = false;
+  ThreadPool *pool = thread_pool_create(count);
+  if (pool) {
+    for (size_t i = 0; i < count; i++) {
+      if (!thread_pool_submit(pool, lex_chunk_task, &chunks[i])) {
+        lex_chunk_task(&chunks[i], 0);
+      }
+    }
+    thread_pool_destroy(pool);
+
+    success = true;
+    for (size_t i = 0; i < count; i++) {
+      success = success && chunks[i].ok;
+    }
+  }
+
+  success = success && stitch_chunks(chunks, count);
+
+  size_t total = 0;
+  for (size_t i = 0; success && i < count; i++) {
+    total += chunks[i].fixed.count + chunks[i].tokens.count - chunks[i].first;
+  }
+  if (success &&
+      growable_array_init(tokens, arena, total ? total : 1, sizeof(Token))) {
+    Token *out = (Token *)tokens->data;
+    for (size_t i = 0; i < count; i++) {
+      if (chunks[i].fixed.count) {
+        memcpy(out, chunks[i].fixed.data,
+               chunks[i].fixed.count * sizeof(Token));
+        out += chunks[i].fixed.count;
+      }
+      const Token *data = (const Token *)chunks[i].tokens.data;
+      for (size_t t = chunks[i].first; t < chunks[i].tokens.count; t++) {
+        *out = data[t];
+        out->line += chunks[i].line_offset;
+        out++;
+      }
+    }
+    tokens->count = total;
+
+    // The literals stay where the chunks decoded them
+    for (size_t i = 0; i < count; i++) {
+      arena_adopt(arena, &chunks[i].arena);
+    }
+    return true;
+  }
+
+  // The caller lexes the file again in one pass, which reports any errors
+  // in order
+  for (size_t i = 0; i < count; i++) {
+    arena_destroy(&chunks[i].arena);
+  }
+  return false;
+}
+
+bool lex_source(const char *source, ArenaAllocator *arena, size_t jobs,
+                GrowableArray *tokens) {
+  size_t size = strlen(source);
+  size_t workers = jobs ? jobs : thread_pool_default_workers();
+  if (workers > size / LEX_CHUNK_MIN_SIZE) {
+    workers = size / LEX_CHUNK_MIN_SIZE;
+  }
+  if (workers > 1 && lex_parallel(source, size, arena, workers, tokens)) {
+    return true;
+  }
+  return lex_serial(source, arena, tokens);
+}
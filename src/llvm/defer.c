@@ -75,11 +75,13 @@ void generate_cleanup_blocks(CodeGenContext *ctx) {
   DeferredStatement *current = ctx->deferred_statements;
   LLVMBasicBlockRef next_cleanup = normal_return; // Start with normal return
 
+  // Blocks are numbered in declaration order of their defer, so the names
+  // are the same in every run
+  size_t index = ctx->deferred_count;
   while (current) {
     // Create a cleanup block for this deferred statement
     char block_name[64];
-    snprintf(block_name, sizeof(block_name), "defer_cleanup_%p",
-             (void *)current);
+    snprintf(block_name, sizeof(block_name), "defer_cleanup_%zu", --index);
 
     current->cleanup_block = LLVMAppendBasicBlockInContext(
         ctx->context, ctx->current_function, block_name);
@@ -8,6 +8,9 @@ LLVMValueRef codegen_expr_literal(CodeGenContext *ctx, AstNode *node) {
   case LITERAL_FLOAT:
     return LLVMConstReal(LLVMFloatTypeInContext(ctx->context),
                          node->expr.literal.value.float_val);
+  case LITERAL_DOUBLE:
+    return LLVMConstReal(LLVMDoubleTypeInContext(ctx->context),
+                         node->expr.literal.value.float_val);
   case LITERAL_BOOL:
     return LLVMConstInt(LLVMInt1TypeInContext(ctx->context),
                         node->expr.literal.value.bool_val ? 1 : 0, false);
@@ -336,8 +339,8 @@ LLVMValueRef codegen_expr_free(CodeGenContext *ctx, AstNode *node) {
   LLVMTypeRef free_func_type = LLVMGlobalGetValueType(free_func);
   LLVMBuildCall2(ctx->builder, free_func_type, free_func, &void_ptr, 1, "");
 
-  // Return a void constant since free() doesn't return a value
-  return LLVMConstNull(LLVMVoidTypeInContext(ctx->context));
+  // free() doesn't return a value (there is no null constant of type void)
+  return NULL;
 }
 
 // *ptr - dereference pointer
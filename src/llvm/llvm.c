@@ -1,6 +1,9 @@
 // Enhanced llvm.c - Module system implementation
 #include "llvm.h"
+#include <llvm-c/BitReader.h>
+#include <llvm-c/Linker.h>
 #include <llvm-c/TargetMachine.h>
+#include <llvm-c/Transforms/PassBuilder.h>
 #include <stdlib.h>
 #include <sys/stat.h>
 
@@ -16,12 +19,25 @@ ModuleCompilationUnit *create_module_unit(CodeGenContext *ctx,
       alignof(ModuleCompilationUnit));
 
   unit->module_name = arena_strdup(ctx->arena, module_name);
-  unit->module = LLVMModuleCreateWithNameInContext(module_name, ctx->context);
+  unit->context = LLVMContextCreate();
+  unit->module = LLVMModuleCreateWithNameInContext(module_name, unit->context);
   unit->symbols = NULL;
+  unit->signature_context = NULL;
+  unit->exports = NULL;
   unit->is_main_module = (strcmp(module_name, "main") == 0);
-  unit->next = ctx->modules;
+  unit->next = NULL;
+  unit->decl_source = NULL;
+  unit->types = NULL;
+  unit->type_count = 0;
+  unit->type_capacity = 0;
 
-  ctx->modules = unit;
+  // Appended, so units (and their object files) keep the order in which
+  // modules were created: the module graph's order, not the reverse
+  ModuleCompilationUnit **tail = &ctx->modules;
+  while (*tail) {
+    tail = &(*tail)->next;
+  }
+  *tail = unit;
   return unit;
 }
 
@@ -51,15 +67,16 @@ void generate_external_declarations(CodeGenContext *ctx,
     if (source_module == target_module)
       continue;
 
-    // Look through source module's symbols for public functions
-    for (LLVM_Symbol *sym = source_module->symbols; sym; sym = sym->next) {
+    // Look through source module's exports for public functions
+    for (LLVM_Symbol *sym = source_module->exports; sym; sym = sym->next) {
       if (sym->is_function) {
         // Check if this function is already declared in target module
         LLVMValueRef existing =
             LLVMGetNamedFunction(target_module->module, sym->name);
         if (!existing) {
           // Create external declaration
-          LLVMTypeRef func_type = LLVMGlobalGetValueType(sym->value);
+          LLVMTypeRef func_type =
+              import_type_into_context(target_module->context, sym->type);
           LLVMValueRef external_func =
               LLVMAddFunction(target_module->module, sym->name, func_type);
           LLVMSetLinkage(external_func, LLVMExternalLinkage);
@@ -73,44 +90,111 @@ void generate_external_declarations(CodeGenContext *ctx,
   }
 }
 
-// Generate object file for a specific module
-bool generate_module_object_file(ModuleCompilationUnit *module,
-                                 const char *output_path) {
+// Target machine every object is compiled for: the host, with PIE-compatible
+// settings. NULL if it cannot be created (already reported).
+static LLVMTargetMachineRef create_target_machine(const char *module_name,
+                                                  LLVMCodeGenOptLevel level) {
   char *error = NULL;
 
   // Get the target triple for the current machine
   char *target_triple = LLVMGetDefaultTargetTriple();
-  LLVMSetTarget(module->module, target_triple);
 
   // Get the target from the triple
   LLVMTargetRef target;
   if (LLVMGetTargetFromTriple(target_triple, &target, &error)) {
-    fprintf(stderr, "Failed to get target for module %s: %s\n",
-            module->module_name, error);
+    fprintf(stderr, "Failed to get target for module %s: %s\n", module_name,
+            error);
     LLVMDisposeMessage(error);
     LLVMDisposeMessage(target_triple);
-    return false;
+    return NULL;
   }
 
   // Create target machine with PIE-compatible settings
   LLVMTargetMachineRef target_machine = LLVMCreateTargetMachine(
-      target, target_triple, "generic", "", LLVMCodeGenLevelDefault,
+      target, target_triple, "generic", "", level,
       LLVMRelocPIC,      // Changed from LLVMRelocDefault to LLVMRelocPIC
       LLVMCodeModelSmall // Changed from LLVMCodeModelDefault to
                          // LLVMCodeModelSmall
   );
-
   if (!target_machine) {
     fprintf(stderr, "Failed to create target machine for module %s\n",
-            module->module_name);
-    LLVMDisposeMessage(target_triple);
-    return false;
+            module_name);
   }
 
-  // Set the data layout
+  LLVMDisposeMessage(target_triple);
+  return target_machine;
+}
+
+// Give a module the triple and data layout of target_machine, as bitcode
+// linked with it (and written for other tools) must have
+static void set_module_target(LLVMModuleRef module,
+                              LLVMTargetMachineRef target_machine) {
+  char *target_triple = LLVMGetTargetMachineTriple(target_machine);
+  LLVMSetTarget(module, target_triple);
+  LLVMDisposeMessage(target_triple);
+
   LLVMTargetDataRef target_data = LLVMCreateTargetDataLayout(target_machine);
   char *data_layout = LLVMCopyStringRepOfTargetData(target_data);
-  LLVMSetDataLayout(module->module, data_layout);
+  LLVMSetDataLayout(module, data_layout);
+  LLVMDisposeMessage(data_layout);
+  LLVMDisposeTargetData(target_data);
+}
+
+// Run an LLVM pass pipeline (opt -passes syntax) over a unit's module
+static bool run_passes(ModuleCompilationUnit *module, const char *pipeline,
+                       LLVMTargetMachineRef target_machine) {
+  LLVMPassBuilderOptionsRef options = LLVMCreatePassBuilderOptions();
+  LLVMErrorRef error =
+      LLVMRunPasses(module->module, pipeline, target_machine, options);
+  LLVMDisposePassBuilderOptions(options);
+  if (error) {
+    char *message = LLVMGetErrorMessage(error);
+    fprintf(stderr, "Failed to run %s on module %s: %s\n", pipeline,
+            module->module_name, message);
+    LLVMDisposeErrorMessage(message);
+    return false;
+  }
+  return true;
+}
+
+// Path of the artifact with extension ext ("s", "ll", "bc") next to the
+// object file object_path
+static void artifact_path(char *path, size_t size, const char *object_path,
+                          const char *ext) {
+  size_t len = strlen(object_path);
+  snprintf(path, size, "%.*s.%s", (int)(len - 2), object_path, ext);
+}
+
+// One backend run writing a file of the given type
+static bool emit_file(LLVMTargetMachineRef target_machine, LLVMModuleRef module,
+                      const char *module_name, const char *path,
+                      LLVMCodeGenFileType type) {
+  char *error = NULL;
+  if (LLVMTargetMachineEmitToFile(target_machine, module, (char *)path, type,
+                                  &error)) {
+    fprintf(stderr, "Failed to emit %s for module %s: %s\n", path,
+            module_name, error);
+    LLVMDisposeMessage(error);
+    return false;
+  }
+  return true;
+}
+
+bool generate_module_outputs(ModuleCompilationUnit *module,
+                             const char *object_path, unsigned emit,
+                             bool dev) {
+  char *error = NULL;
+  char path[512];
+
+  // Without optimization the backend selects instructions with FastISel
+  LLVMCodeGenOptLevel level =
+      dev ? LLVMCodeGenLevelNone : LLVMCodeGenLevelDefault;
+  LLVMTargetMachineRef target_machine =
+      create_target_machine(module->module_name, level);
+  if (!target_machine) {
+    return false;
+  }
+  set_module_target(module->module, target_machine);
 
   // Verify the module
   if (LLVMVerifyModule(module->module, LLVMAbortProcessAction, &error)) {
@@ -118,41 +202,94 @@ bool generate_module_object_file(ModuleCompilationUnit *module,
             module->module_name, error);
     LLVMDisposeMessage(error);
     LLVMDisposeTargetMachine(target_machine);
-    LLVMDisposeTargetData(target_data);
-    LLVMDisposeMessage(data_layout);
-    LLVMDisposeMessage(target_triple);
     return false;
   }
   if (error) {
     LLVMDisposeMessage(error);
   }
 
-  // Generate object file
-  if (LLVMTargetMachineEmitToFile(target_machine, module->module,
-                                  (char *)output_path, LLVMObjectFile,
-                                  &error)) {
-    fprintf(stderr, "Failed to emit object file for module %s: %s\n",
-            module->module_name, error);
-    LLVMDisposeMessage(error);
-    LLVMDisposeTargetMachine(target_machine);
-    LLVMDisposeTargetData(target_data);
-    LLVMDisposeMessage(data_layout);
-    LLVMDisposeMessage(target_triple);
-    return false;
+  // Every local is an alloca, loaded at each use; the dev profile promotes
+  // those whose address is never taken to registers, which FastISel alone
+  // would leave in memory
+  bool ok = !dev || run_passes(module, "function(mem2reg)", target_machine);
+
+  // IR first: the code generator rewrites parts of the module it compiles.
+  // Printed straight to the file, never built up as one string.
+  if (ok && (emit & EMIT_IR)) {
+    artifact_path(path, sizeof(path), object_path, "ll");
+    if (LLVMPrintModuleToFile(module->module, path, &error)) {
+      fprintf(stderr, "Failed to write IR file %s: %s\n", path, error);
+      LLVMDisposeMessage(error);
+      ok = false;
+    }
+  }
+  if (ok && (emit & EMIT_BITCODE)) {
+    artifact_path(path, sizeof(path), object_path, "bc");
+    if (LLVMWriteBitcodeToFile(module->module, path) != 0) {
+      fprintf(stderr, "Failed to write bitcode file: %s\n", path);
+      ok = false;
+    }
+  }
+
+  // The C API emits a single file type per backend run, and a run rewrites
+  // parts of the module, so a unit that also wants the object prints its
+  // assembly from a copy
+  if (ok && (emit & EMIT_ASSEMBLY)) {
+    artifact_path(path, sizeof(path), object_path, "s");
+    LLVMModuleRef printed = emit & EMIT_OBJECT
+                                ? LLVMCloneModule(module->module)
+                                : module->module;
+    ok = emit_file(target_machine, printed, module->module_name, path,
+                   LLVMAssemblyFile);
+    if (printed != module->module) {
+      LLVMDisposeModule(printed);
+    }
+  }
+  if (ok && (emit & EMIT_OBJECT)) {
+    ok = emit_file(target_machine, module->module, module->module_name,
+                   object_path, LLVMObjectFile);
   }
 
   // Cleanup
   LLVMDisposeTargetMachine(target_machine);
-  LLVMDisposeTargetData(target_data);
-  LLVMDisposeMessage(data_layout);
-  LLVMDisposeMessage(target_triple);
+  return ok;
+}
 
-  return true;
+// Generate object file for a specific module
+bool generate_module_object_file(ModuleCompilationUnit *module,
+                                 const char *output_path) {
+  return generate_module_outputs(module, output_path, EMIT_OBJECT, false);
 }
 
-// Compile all modules to separate object files
-bool compile_modules_to_objects(CodeGenContext *ctx, const char *output_dir) {
-  // Create output directory if it doesn't exist
+typedef struct {
+  ModuleCompilationUnit *unit;
+  const char *output_dir;
+  unsigned emit;
+  bool dev;
+  bool ok;
+} ObjectTask;
+
+static void compile_module_task(void *arg, size_t worker) {
+  (void)worker;
+  ObjectTask *task = (ObjectTask *)arg;
+
+  // Create output file path
+  char output_path[512];
+  snprintf(output_path, sizeof(output_path), "%s/%s.o", task->output_dir,
+           task->unit->module_name);
+
+  // printf("Compiling module '%s' to '%s'\n", unit->module_name, output_path);
+
+  // Generate object file for this module
+  task->ok = generate_module_outputs(task->unit, output_path, task->emit,
+                                     task->dev);
+  if (!task->ok) {
+    fprintf(stderr, "Failed to compile module: %s\n", task->unit->module_name);
+  }
+}
+
+// Create output directory if it doesn't exist
+static bool ensure_output_dir(const char *output_dir) {
   struct stat st = {0};
   if (stat(output_dir, &st) == -1) {
     if (mkdir(output_dir, 0755) != 0) {
@@ -160,31 +297,162 @@ bool compile_modules_to_objects(CodeGenContext *ctx, const char *output_dir) {
       return false;
     }
   }
+  return true;
+}
 
-  bool success = true;
+// Compile all modules to separate object files
+bool compile_modules_to_objects(CodeGenContext *ctx, const char *output_dir,
+                                ThreadPool *pool) {
+  if (!ensure_output_dir(output_dir)) {
+    return false;
+  }
 
-  // Process each module
+  size_t unit_count = 0;
   for (ModuleCompilationUnit *unit = ctx->modules; unit; unit = unit->next) {
-    // Generate external declarations for cross-module calls
-    generate_external_declarations(ctx, unit);
-
-    // Create output file path
-    char output_path[512];
-    snprintf(output_path, sizeof(output_path), "%s/%s.o", output_dir,
-             unit->module_name);
+    unit_count += unit->module != NULL;
+  }
+  if (unit_count == 0) {
+    return true;
+  }
 
-    // printf("Compiling module '%s' to '%s'\n", unit->module_name, output_path);
+  ObjectTask *tasks = malloc(unit_count * sizeof(ObjectTask));
+  if (!tasks) {
+    fprintf(stderr, "Out of memory while compiling modules\n");
+    return false;
+  }
 
-    // Generate object file for this module
-    if (!generate_module_object_file(unit, output_path)) {
-      fprintf(stderr, "Failed to compile module: %s\n", unit->module_name);
-      success = false;
+  // Cross-module calls are declared by @use while generating IR, so every
+  // module is self-contained here and can be emitted independently
+  size_t i = 0;
+  for (ModuleCompilationUnit *unit = ctx->modules; unit; unit = unit->next) {
+    if (!unit->module) {
+      continue;
+    }
+    tasks[i] = (ObjectTask){unit, output_dir, ctx->emit, ctx->dev, false};
+    if (!pool) {
+      compile_module_task(&tasks[i], 0);
+    } else if (!thread_pool_submit(pool, compile_module_task, &tasks[i])) {
+      fprintf(stderr, "Out of memory while scheduling module: %s\n",
+              unit->module_name);
     }
+    i++;
+  }
+  if (pool) {
+    thread_pool_wait(pool);
+  }
+
+  bool success = true;
+  for (i = 0; i < unit_count; i++) {
+    success = success && tasks[i].ok;
   }
 
+  free(tasks);
   return success;
 }
 
+// Object file of a program optimized as a whole, in the output directory
+#define WHOLE_PROGRAM_OBJECT "program.lto.o"
+
+// LLVM reports link errors such as two definitions of a symbol through the
+// context; without a handler it would exit the compiler
+static void report_link_diagnostic(LLVMDiagnosticInfoRef info, void *failed) {
+  LLVMDiagnosticSeverity severity = LLVMGetDiagInfoSeverity(info);
+  if (severity != LLVMDSError && severity != LLVMDSWarning) {
+    return;
+  }
+
+  char *message = LLVMGetDiagInfoDescription(info);
+  fprintf(stderr, "%s: %s\n", severity == LLVMDSError ? "Error" : "Warning",
+          message);
+  LLVMDisposeMessage(message);
+  if (severity == LLVMDSError) {
+    *(bool *)failed = true;
+  }
+}
+
+// Parse the bitcode in buffer into program's context and link it in
+static bool link_bitcode(LLVMModuleRef program, LLVMMemoryBufferRef buffer,
+                         const char *name) {
+  LLVMModuleRef module;
+  if (LLVMParseBitcodeInContext2(LLVMGetModuleContext(program), buffer,
+                                 &module)) {
+    fprintf(stderr, "Failed to read bitcode of %s\n", name);
+    return false;
+  }
+
+  // The module is consumed either way
+  if (LLVMLinkModules2(program, module)) {
+    fprintf(stderr, "Failed to link %s into the program\n", name);
+    return false;
+  }
+  return true;
+}
+
+// With bitcode inputs: every module unit and every input are linked into one
+// module, optimized as a whole and compiled to a single object file. Calls
+// between Lux and C code built by clang -flto (or -emit-llvm) can then be
+// inlined in both directions, which separate object files would prevent.
+static bool compile_whole_program(CodeGenContext *ctx, const char *output_dir) {
+  LLVMTargetMachineRef target_machine =
+      create_target_machine("program", LLVMCodeGenLevelDefault);
+  if (!target_machine) {
+    return false;
+  }
+
+  bool failed = false;
+  LLVMContextRef context = LLVMContextCreate();
+  LLVMContextSetDiagnosticHandler(context, report_link_diagnostic, &failed);
+  ModuleCompilationUnit program = {0};
+  program.module_name = "program";
+  program.context = context;
+  program.module = LLVMModuleCreateWithNameInContext("program", context);
+  set_module_target(program.module, target_machine);
+
+  // Units are linked through bitcode: each lives in a context of its own
+  bool ok = true;
+  char path[512];
+  for (ModuleCompilationUnit *unit = ctx->modules; ok && unit;
+       unit = unit->next) {
+    // Each unit's IR and bitcode as generated; the program's artifacts are
+    // of the optimized whole
+    set_module_target(unit->module, target_machine);
+    snprintf(path, sizeof(path), "%s/%s.o", output_dir, unit->module_name);
+    unsigned emit = ctx->emit & (EMIT_IR | EMIT_BITCODE);
+    if (emit && !generate_module_outputs(unit, path, emit, false)) {
+      ok = false;
+      break;
+    }
+
+    LLVMMemoryBufferRef buffer = LLVMWriteBitcodeToMemoryBuffer(unit->module);
+    ok = link_bitcode(program.module, buffer, unit->module_name) && !failed;
+    LLVMDisposeMemoryBuffer(buffer);
+  }
+
+  for (size_t i = 0; ok && i < ctx->bitcode_input_count; i++) {
+    const char *input = ctx->bitcode_inputs[i];
+    LLVMMemoryBufferRef buffer;
+    char *error = NULL;
+    if (LLVMCreateMemoryBufferWithContentsOfFile(input, &buffer, &error)) {
+      fprintf(stderr, "Failed to read bitcode file %s: %s\n", input, error);
+      LLVMDisposeMessage(error);
+      ok = false;
+      break;
+    }
+    ok = link_bitcode(program.module, buffer, input) && !failed;
+    LLVMDisposeMemoryBuffer(buffer);
+  }
+
+  ok = ok && run_passes(&program, "default<O2>", target_machine);
+
+  snprintf(path, sizeof(path), "%s/%s", output_dir, WHOLE_PROGRAM_OBJECT);
+  ok = ok && generate_module_outputs(&program, path, ctx->emit, false);
+
+  LLVMDisposeModule(program.module);
+  LLVMContextDispose(context);
+  LLVMDisposeTargetMachine(target_machine);
+  return ok;
+}
+
 // =============================================================================
 // ENHANCED CORE API FUNCTIONS
 // =============================================================================
@@ -209,6 +477,14 @@ CodeGenContext *init_codegen_context(ArenaAllocator *arena) {
   ctx->loop_continue_block = NULL;
   ctx->loop_break_block = NULL;
   ctx->arena = arena;
+  ctx->function_object_dir = NULL;
+  ctx->codegen_units = 1;
+  ctx->emit = EMIT_OBJECT;
+  ctx->dev = false;
+  ctx->bitcode_inputs = NULL;
+  ctx->bitcode_input_count = 0;
+  growable_array_init(&ctx->object_files, arena, 16, sizeof(const char *));
+  growable_array_init(&ctx->link_libraries, arena, 4, sizeof(const char *));
 
   return ctx;
 }
@@ -222,10 +498,95 @@ void add_symbol_to_module(ModuleCompilationUnit *module, const char *name,
   sym->value = value;
   sym->type = type;
   sym->is_function = is_function;
+  sym->link_name = NULL;
+  sym->visibility = LLVMDefaultVisibility;
   sym->next = module->symbols;
   module->symbols = sym;
 }
 
+static void free_symbols(LLVM_Symbol *sym) {
+  while (sym) {
+    LLVM_Symbol *next_sym = sym->next;
+    free(sym->name);
+    free(sym->link_name);
+    free(sym);
+    sym = next_sym;
+  }
+}
+
+bool publish_module_exports(ModuleCompilationUnit *unit) {
+  unit->signature_context = LLVMContextCreate();
+  if (!unit->signature_context) {
+    return false;
+  }
+
+  // Same order as the symbol table, so lookups find the same entry first
+  LLVM_Symbol **tail = &unit->exports;
+  for (LLVM_Symbol *sym = unit->symbols; sym; sym = sym->next) {
+    if (!sym->type || !LLVMIsAGlobalValue(sym->value) ||
+        LLVMGetLinkage(sym->value) != LLVMExternalLinkage) {
+      continue;
+    }
+
+    size_t length;
+    const char *link_name = LLVMGetValueName2(sym->value, &length);
+    LLVM_Symbol *export = (LLVM_Symbol *)calloc(1, sizeof(LLVM_Symbol));
+    if (!export || !(export->name = strdup(sym->name)) ||
+        !(export->link_name = strdup(link_name))) {
+      free_symbols(export);
+      return false;
+    }
+    export->type = import_type_into_context(unit->signature_context,
+                                            sym->type);
+    export->is_function = sym->is_function;
+    export->visibility = LLVMGetVisibility(sym->value);
+    *tail = export;
+    tail = &export->next;
+  }
+  return true;
+}
+
+void release_module_unit(ModuleCompilationUnit *unit) {
+  free_symbols(unit->symbols);
+  unit->symbols = NULL;
+  free_lowered_types(unit);
+  if (unit->module) {
+    LLVMDisposeModule(unit->module);
+    unit->module = NULL;
+  }
+  if (unit->context) {
+    LLVMContextDispose(unit->context);
+    unit->context = NULL;
+  }
+}
+
+// Declare a symbol of a function unit's module in the function unit, under
+// the LLVM name it has in the module's unit
+static LLVM_Symbol *declare_source_symbol(ModuleCompilationUnit *module,
+                                          const char *name,
+                                          LLVM_Symbol *source) {
+  const char *llvm_name = source->link_name;
+  LLVMTypeRef type = import_type_into_context(module->context, source->type);
+
+  LLVMValueRef value;
+  if (source->is_function) {
+    value = LLVMGetNamedFunction(module->module, llvm_name);
+    if (!value) {
+      value = LLVMAddFunction(module->module, llvm_name, type);
+    }
+  } else {
+    value = LLVMGetNamedGlobal(module->module, llvm_name);
+    if (!value) {
+      value = LLVMAddGlobal(module->module, type, llvm_name);
+    }
+  }
+  LLVMSetLinkage(value, LLVMExternalLinkage);
+  LLVMSetVisibility(value, source->visibility);
+
+  add_symbol_to_module(module, name, value, type, source->is_function);
+  return module->symbols;
+}
+
 LLVM_Symbol *find_symbol_in_module(ModuleCompilationUnit *module,
                                    const char *name) {
   for (LLVM_Symbol *sym = module->symbols; sym; sym = sym->next) {
@@ -233,9 +594,63 @@ LLVM_Symbol *find_symbol_in_module(ModuleCompilationUnit *module,
       return sym;
     }
   }
+
+  // A function unit declares module-level symbols the first time it uses
+  // them, from the exports of the module's (complete) unit
+  if (module->decl_source) {
+    for (LLVM_Symbol *source = module->decl_source->exports; source;
+         source = source->next) {
+      if (strcmp(source->name, name) == 0) {
+        return declare_source_symbol(module, name, source);
+      }
+    }
+  }
   return NULL;
 }
 
+bool split_function_bodies(const CodeGenContext *ctx) {
+  return ctx->function_object_dir || ctx->codegen_units > 1;
+}
+
+const char *module_symbol_name(CodeGenContext *ctx, const char *name,
+                               bool is_public) {
+  if (!split_function_bodies(ctx) || is_public) {
+    return name;
+  }
+
+  const char *module_name = ctx->current_module->module_name;
+  size_t size = strlen(module_name) + strlen(name) + 2;
+  char *qualified = arena_alloc(ctx->arena, size, alignof(char));
+  if (!qualified) {
+    return name;
+  }
+  snprintf(qualified, size, "%s.%s", module_name, name);
+  return qualified;
+}
+
+void set_module_symbol_linkage(CodeGenContext *ctx, LLVMValueRef value,
+                               bool is_public) {
+  if (is_public) {
+    LLVMSetLinkage(value, LLVMExternalLinkage);
+  } else if (split_function_bodies(ctx)) {
+    // Defined in one object file, used from the others of its module
+    LLVMSetLinkage(value, LLVMExternalLinkage);
+    LLVMSetVisibility(value, LLVMHiddenVisibility);
+  } else {
+    LLVMSetLinkage(value, LLVMInternalLinkage);
+  }
+}
+
+void function_object_path(char *path, size_t size, const char *dir,
+                          const char *module_name, const char *function_name) {
+  snprintf(path, size, "%s/%s.%s.o", dir, module_name, function_name);
+}
+
+void codegen_unit_object_path(char *path, size_t size, const char *dir,
+                              const char *module_name, size_t unit) {
+  snprintf(path, size, "%s/%s.cgu%zu.o", dir, module_name, unit);
+}
+
 LLVM_Symbol *find_symbol_global(CodeGenContext *ctx, const char *name,
                                 const char *module_name) {
   if (module_name) {
@@ -251,30 +666,451 @@ LLVM_Symbol *find_symbol_global(CodeGenContext *ctx, const char *name,
         return sym;
     }
 
-    // Search all modules
-    for (ModuleCompilationUnit *unit = ctx->modules; unit; unit = unit->next) {
-      if (unit == ctx->current_module)
+    // Other modules live in their own LLVM contexts (and may still be
+    // generating on another thread); their public symbols reach this module
+    // through @use imports only
+  }
+  return NULL;
+}
+
+typedef struct {
+  CodeGenContext *ctx;
+  const ModuleGraph *graph;
+  ModuleCompilationUnit **units; // Indexed like graph->nodes
+  ArenaAllocator *arenas;        // One per pool worker
+  const char *output_dir;        // NULL: units are kept until the end
+} ProgramCodegen;
+
+// Generate a module's IR and, once its exports are published for the
+// modules of later waves, write its outputs and dispose its IR right away:
+// only the modules in flight are in memory at once
+static bool codegen_module_task(void *arg, size_t node, size_t worker) {
+  ProgramCodegen *program = (ProgramCodegen *)arg;
+  ModuleCompilationUnit *unit = program->units[node];
+  if (!codegen_module_unit(program->ctx, unit,
+                           program->graph->nodes[node].module,
+                           &program->arenas[worker])) {
+    return false;
+  }
+  if (!publish_module_exports(unit)) {
+    fprintf(stderr, "Out of memory while exporting module: %s\n",
+            unit->module_name);
+    return false;
+  }
+  if (!program->output_dir) {
+    return true;
+  }
+
+  char output_path[512];
+  snprintf(output_path, sizeof(output_path), "%s/%s.o", program->output_dir,
+           unit->module_name);
+  if (!generate_module_outputs(unit, output_path, program->ctx->emit,
+                               program->ctx->dev)) {
+    fprintf(stderr, "Failed to compile module: %s\n", unit->module_name);
+    return false;
+  }
+  release_module_unit(unit);
+  return true;
+}
+
+typedef struct {
+  CodeGenContext *ctx;
+  ModuleCompilationUnit *module_unit; // Declarations the bodies may use
+  AstNode **functions;                // Bodies generated into the unit
+  size_t function_count;
+  const char *name;        // module.function or module.cguN
+  const char *output_path; // Object file of the unit
+  ArenaAllocator *arenas;  // One per pool worker
+  bool ok;
+} BodyTask;
+
+// Generate function bodies into a unit of their own and compile it to its
+// object file; the unit is disposed right away, only the object file is kept
+static void compile_body_task(void *arg, size_t worker) {
+  BodyTask *task = (BodyTask *)arg;
+
+  ModuleCompilationUnit unit = {0};
+  unit.module_name = task->module_unit->module_name;
+  unit.context = LLVMContextCreate();
+  unit.module = LLVMModuleCreateWithNameInContext(task->name, unit.context);
+  unit.decl_source = task->module_unit;
+
+  task->ok = true;
+  for (size_t i = 0; task->ok && i < task->function_count; i++) {
+    task->ok = codegen_module_unit(task->ctx, &unit, task->functions[i],
+                                   &task->arenas[worker]);
+  }
+  task->ok = task->ok &&
+             generate_module_outputs(&unit, task->output_path, task->ctx->emit,
+                                     task->ctx->dev);
+  if (!task->ok) {
+    fprintf(stderr, "Failed to compile unit: %s\n", task->name);
+  }
+
+  free_symbols(unit.symbols);
+  free_lowered_types(&unit);
+  LLVMDisposeModule(unit.module);
+  LLVMContextDispose(unit.context);
+}
+
+static BodyTask *push_body_task(GrowableArray *tasks, CodeGenContext *ctx,
+                                const char *name, const char *output_path) {
+  BodyTask *task = (BodyTask *)growable_array_push(tasks);
+  if (!task || !(name = arena_strdup(ctx->arena, name)) ||
+      !(output_path = arena_strdup(ctx->arena, output_path))) {
+    fprintf(stderr, "Out of memory while scheduling functions\n");
+    return NULL;
+  }
+  *task = (BodyTask){ctx, NULL, NULL, 0, name, output_path, NULL, false};
+  return task;
+}
+
+// Per-function layout: a unit for every function that has no reusable object
+static bool schedule_function_units(CodeGenContext *ctx,
+                                    const ModuleGraph *graph,
+                                    ModuleCompilationUnit **units,
+                                    GrowableArray *tasks) {
+  char name[512];
+  char path[512];
+  for (size_t m = 0; m < graph->count; m++) {
+    AstNode *module = graph->nodes[m].module;
+    for (size_t i = 0; i < module->preprocessor.module.body_count; i++) {
+      AstNode **stmt = &module->preprocessor.module.body[i];
+      if (!*stmt || (*stmt)->type != AST_STMT_FUNCTION ||
+          (*stmt)->stmt.func_decl.reuse_object ||
+          (*stmt)->stmt.func_decl.is_extern) {
+        continue;
+      }
+
+      const char *function_name = (*stmt)->stmt.func_decl.name;
+      snprintf(name, sizeof(name), "%s.%s", graph->nodes[m].name,
+               function_name);
+      function_object_path(path, sizeof(path), ctx->function_object_dir,
+                           graph->nodes[m].name, function_name);
+      BodyTask *task = push_body_task(tasks, ctx, name, path);
+      if (!task) {
+        return false;
+      }
+      task->module_unit = units[m];
+      task->functions = stmt;
+      task->function_count = 1;
+    }
+  }
+  return true;
+}
+
+static bool defines_body(AstNode *stmt) {
+  return stmt && stmt->type == AST_STMT_FUNCTION &&
+         !stmt->stmt.func_decl.is_extern;
+}
+
+// Codegen units of a module: --codegen-units, but no more than its bodies
+static size_t module_codegen_units(const CodeGenContext *ctx,
+                                   AstNode *module) {
+  size_t bodies = 0;
+  for (size_t i = 0; i < module->preprocessor.module.body_count; i++) {
+    bodies += defines_body(module->preprocessor.module.body[i]);
+  }
+  return bodies < ctx->codegen_units ? bodies : ctx->codegen_units;
+}
+
+// Backend work grows with the body; its token count is known without
+// walking the AST, as run_build skims every body when splitting
+static size_t body_cost(AstNode *function) {
+  DeferredBody *deferred = function->stmt.func_decl.deferred;
+  return deferred ? deferred->token_count : 1;
+}
+
+typedef struct {
+  AstNode **slot;
+  size_t cost;
+  size_t index; // Source order, breaks ties so partitions are reproducible
+  size_t unit;
+} BodyCost;
+
+static int compare_body_cost(const void *a, const void *b) {
+  const BodyCost *x = (const BodyCost *)a;
+  const BodyCost *y = (const BodyCost *)b;
+  if (x->cost != y->cost) {
+    return x->cost > y->cost ? -1 : 1;
+  }
+  return x->index < y->index ? -1 : x->index > y->index;
+}
+
+static int compare_body_index(const void *a, const void *b) {
+  const BodyCost *x = (const BodyCost *)a;
+  const BodyCost *y = (const BodyCost *)b;
+  return x->index < y->index ? -1 : x->index > y->index;
+}
+
+// --codegen-units: a module's bodies spread over its codegen units. Largest
+// first, each to the least loaded unit, so no unit becomes the critical path;
+// within a unit bodies keep their source order.
+static bool schedule_codegen_units(CodeGenContext *ctx,
+                                   const ModuleGraph *graph,
+                                   ModuleCompilationUnit **units,
+                                   const char *output_dir,
+                                   GrowableArray *tasks) {
+  char name[512];
+  char path[512];
+  for (size_t m = 0; m < graph->count; m++) {
+    AstNode *module = graph->nodes[m].module;
+    size_t unit_count = module_codegen_units(ctx, module);
+    if (unit_count == 0) {
+      continue;
+    }
+
+    BodyCost *bodies = arena_alloc(
+        ctx->arena, module->preprocessor.module.body_count * sizeof(BodyCost),
+        alignof(BodyCost));
+    size_t *load = arena_alloc(ctx->arena, unit_count * sizeof(size_t),
+                               alignof(size_t));
+    AstNode **functions = arena_alloc(
+        ctx->arena, module->preprocessor.module.body_count * sizeof(AstNode *),
+        alignof(AstNode *));
+    if (!bodies || !load || !functions) {
+      fprintf(stderr, "Out of memory while partitioning module: %s\n",
+              graph->nodes[m].name);
+      return false;
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < module->preprocessor.module.body_count; i++) {
+      AstNode **slot = &module->preprocessor.module.body[i];
+      if (defines_body(*slot)) {
+        bodies[count] = (BodyCost){slot, body_cost(*slot), i, 0};
+        count++;
+      }
+    }
+
+    memset(load, 0, unit_count * sizeof(size_t));
+    qsort(bodies, count, sizeof(BodyCost), compare_body_cost);
+    for (size_t i = 0; i < count; i++) {
+      size_t least = 0;
+      for (size_t u = 1; u < unit_count; u++) {
+        least = load[u] < load[least] ? u : least;
+      }
+      bodies[i].unit = least;
+      load[least] += bodies[i].cost;
+    }
+    qsort(bodies, count, sizeof(BodyCost), compare_body_index);
+
+    // Each unit's functions are a contiguous run of the functions array
+    size_t next = 0;
+    for (size_t u = 0; u < unit_count; u++) {
+      snprintf(name, sizeof(name), "%s.cgu%zu", graph->nodes[m].name, u);
+      codegen_unit_object_path(path, sizeof(path), output_dir,
+                               graph->nodes[m].name, u);
+      BodyTask *task = push_body_task(tasks, ctx, name, path);
+      if (!task) {
+        return false;
+      }
+      task->module_unit = units[m];
+      task->functions = &functions[next];
+      for (size_t i = 0; i < count; i++) {
+        if (bodies[i].unit == u) {
+          functions[next++] = *bodies[i].slot;
+          task->function_count++;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+// Compile the bodies the module units only declare, in units of their own
+static bool compile_bodies_to_objects(CodeGenContext *ctx,
+                                      const ModuleGraph *graph,
+                                      ModuleCompilationUnit **units,
+                                      const char *output_dir,
+                                      ArenaAllocator *arenas,
+                                      ThreadPool *pool) {
+  GrowableArray tasks;
+  if (!growable_array_init(&tasks, ctx->arena, 64, sizeof(BodyTask))) {
+    return false;
+  }
+
+  bool scheduled =
+      ctx->function_object_dir
+          ? schedule_function_units(ctx, graph, units, &tasks)
+          : schedule_codegen_units(ctx, graph, units, output_dir, &tasks);
+  if (!scheduled) {
+    return false;
+  }
+
+  // Tasks are submitted only once the array has stopped growing
+  BodyTask *all = (BodyTask *)tasks.data;
+  for (size_t i = 0; i < tasks.count; i++) {
+    all[i].arenas = arenas;
+    if (!pool) {
+      compile_body_task(&all[i], 0);
+    } else if (!thread_pool_submit(pool, compile_body_task, &all[i])) {
+      fprintf(stderr, "Out of memory while scheduling unit: %s\n",
+              all[i].name);
+    }
+  }
+  if (pool) {
+    thread_pool_wait(pool);
+  }
+
+  bool success = true;
+  for (size_t i = 0; i < tasks.count; i++) {
+    success = success && all[i].ok;
+  }
+  return success;
+}
+
+static bool add_object_file(CodeGenContext *ctx, const char *path) {
+  const char **slot = (const char **)growable_array_push(&ctx->object_files);
+  if (!slot || !(*slot = arena_strdup(ctx->arena, path))) {
+    fprintf(stderr, "Out of memory while listing object files\n");
+    return false;
+  }
+  return true;
+}
+
+static bool add_link_library(CodeGenContext *ctx, const char *library) {
+  const char **libraries = (const char **)ctx->link_libraries.data;
+  for (size_t i = 0; i < ctx->link_libraries.count; i++) {
+    if (strcmp(libraries[i], library) == 0) {
+      return true;
+    }
+  }
+
+  const char **slot = (const char **)growable_array_push(&ctx->link_libraries);
+  if (!slot) {
+    fprintf(stderr, "Out of memory while listing libraries\n");
+    return false;
+  }
+  *slot = library;
+  return true;
+}
+
+// List the program's object files and libraries in an order that depends on
+// the program only, never on thread scheduling or on what else lies in the
+// directories
+static bool collect_link_inputs(CodeGenContext *ctx, const ModuleGraph *graph,
+                                const char *output_dir) {
+  char path[512];
+  if (ctx->bitcode_input_count > 0) {
+    snprintf(path, sizeof(path), "%s/%s", output_dir, WHOLE_PROGRAM_OBJECT);
+    if (!add_object_file(ctx, path)) {
+      return false;
+    }
+  }
+  for (ModuleCompilationUnit *unit = ctx->modules;
+       ctx->bitcode_input_count == 0 && unit; unit = unit->next) {
+    snprintf(path, sizeof(path), "%s/%s.o", output_dir, unit->module_name);
+    if (!add_object_file(ctx, path)) {
+      return false;
+    }
+  }
+
+  // Reused objects too: they are the ones of functions that did not change
+  for (size_t m = 0; m < graph->count; m++) {
+    AstNode *module = graph->nodes[m].module;
+    for (size_t i = 0; i < module->preprocessor.module.body_count; i++) {
+      AstNode *stmt = module->preprocessor.module.body[i];
+      if (!stmt || stmt->type != AST_STMT_FUNCTION) {
         continue;
-      LLVM_Symbol *sym = find_symbol_in_module(unit, name);
-      if (sym)
-        return sym;
+      }
+      if (stmt->stmt.func_decl.is_extern) {
+        if (stmt->stmt.func_decl.library &&
+            !add_link_library(ctx, stmt->stmt.func_decl.library)) {
+          return false;
+        }
+        continue;
+      }
+      if (!ctx->function_object_dir) {
+        continue;
+      }
+      function_object_path(path, sizeof(path), ctx->function_object_dir,
+                           graph->nodes[m].name, stmt->stmt.func_decl.name);
+      if (!add_object_file(ctx, path)) {
+        return false;
+      }
     }
   }
-  return NULL;
+
+  // Codegen units, module by module
+  for (size_t m = 0; !ctx->function_object_dir && m < graph->count; m++) {
+    size_t unit_count = split_function_bodies(ctx)
+                            ? module_codegen_units(ctx, graph->nodes[m].module)
+                            : 0;
+    for (size_t u = 0; u < unit_count; u++) {
+      codegen_unit_object_path(path, sizeof(path), output_dir,
+                               graph->nodes[m].name, u);
+      if (!add_object_file(ctx, path)) {
+        return false;
+      }
+    }
+  }
+  return true;
 }
 
 // Main program generation with module support
 bool generate_program_modules(CodeGenContext *ctx, AstNode *ast_root,
+                              const ModuleGraph *graph, ThreadPool *pool,
                               const char *output_dir) {
   if (!ast_root || ast_root->type != AST_PROGRAM) {
     return false;
   }
 
-  // Generate code for all modules
-  codegen_stmt_program_multi_module(ctx, ast_root);
+  ModuleGraph local_graph;
+  if (!graph) {
+    if (!module_graph_build(&local_graph, ast_root->stmt.program.modules,
+                            ast_root->stmt.program.module_count,
+                            ctx->arena)) {
+      return false;
+    }
+    graph = &local_graph;
+  }
+
+  // Every unit exists up front so @use can find modules of earlier waves
+  ModuleCompilationUnit **units =
+      arena_alloc(ctx->arena, graph->count * sizeof(ModuleCompilationUnit *),
+                  alignof(ModuleCompilationUnit *));
+  size_t worker_count = pool ? thread_pool_size(pool) : 1;
+  ArenaAllocator *arenas =
+      arena_alloc(ctx->arena, worker_count * sizeof(ArenaAllocator),
+                  alignof(ArenaAllocator));
+  if (!units || !arenas) {
+    return false;
+  }
+
+  for (size_t i = 0; i < graph->count; i++) {
+    units[i] = create_module_unit(ctx, graph->nodes[i].name);
+  }
+  for (size_t w = 0; w < worker_count; w++) {
+    arena_allocator_init(&arenas[w], ARENA_MIN_BUFFER_SIZE);
+  }
+
+  // Generate IR wave by wave: a module's imports are complete before it
+  // runs. Every module is compiled as soon as it is generated, unless the
+  // whole program is linked into one module with the bitcode inputs.
+  bool whole_program = ctx->bitcode_input_count > 0;
+  ProgramCodegen state = {ctx, graph, units, arenas,
+                          whole_program ? NULL : output_dir};
+  bool success = ensure_output_dir(output_dir) &&
+                 module_graph_run_waves(graph, pool, codegen_module_task,
+                                        &state);
+
+  // Module exports are complete (and left alone) from here on, so every
+  // function unit can declare from them concurrently
+  if (success && split_function_bodies(ctx)) {
+    success = compile_bodies_to_objects(ctx, graph, units, output_dir, arenas,
+                                        pool);
+  }
+
+  for (size_t w = 0; w < worker_count; w++) {
+    arena_destroy(&arenas[w]);
+  }
 
-  // Compile all modules to separate object files
-  return compile_modules_to_objects(ctx, output_dir);
+  // Or compile them together with the bitcode inputs to one object file
+  if (success && whole_program) {
+    success = compile_whole_program(ctx, output_dir);
+  }
+  return success && collect_link_inputs(ctx, graph, output_dir);
 }
 
 // Cleanup (enhanced)
@@ -285,22 +1121,17 @@ void cleanup_codegen_context(CodeGenContext *ctx) {
     while (unit) {
       ModuleCompilationUnit *next = unit->next;
 
-      // Free symbols
-      LLVM_Symbol *sym = unit->symbols;
-      while (sym) {
-        LLVM_Symbol *next_sym = sym->next;
-        free(sym->name);
-        free(sym);
-        sym = next_sym;
+      release_module_unit(unit);
+      free_symbols(unit->exports);
+      if (unit->signature_context) {
+        LLVMContextDispose(unit->signature_context);
       }
-
-      LLVMDisposeModule(unit->module);
       unit = next;
     }
 
     LLVMDisposeBuilder(ctx->builder);
     LLVMContextDispose(ctx->context);
-    LLVMShutdown();
+    // LLVMShutdown() is left to main(): luma watch builds more than once
   }
 }
 
@@ -316,14 +1147,6 @@ LLVM_Symbol *find_symbol(CodeGenContext *ctx, const char *name) {
   return find_symbol_global(ctx, name, NULL);
 }
 
-// Print IR for current module
-char *print_llvm_ir(CodeGenContext *ctx) {
-  if (ctx->current_module) {
-    return LLVMPrintModuleToString(ctx->current_module->module);
-  }
-  return NULL;
-}
-
 // Generate object file for current module
 bool generate_object_file(CodeGenContext *ctx, const char *object_filename) {
   if (ctx->current_module) {
@@ -332,57 +1155,6 @@ bool generate_object_file(CodeGenContext *ctx, const char *object_filename) {
   return false;
 }
 
-// Generate assembly file for current module
-bool generate_assembly_file(CodeGenContext *ctx, const char *asm_filename) {
-  if (!ctx->current_module)
-    return false;
-
-  char *error = NULL;
-  char *target_triple = LLVMGetDefaultTargetTriple();
-  LLVMSetTarget(ctx->current_module->module, target_triple);
-
-  LLVMTargetRef target;
-  if (LLVMGetTargetFromTriple(target_triple, &target, &error)) {
-    fprintf(stderr, "Failed to get target: %s\n", error);
-    LLVMDisposeMessage(error);
-    LLVMDisposeMessage(target_triple);
-    return false;
-  }
-
-  LLVMTargetMachineRef target_machine = LLVMCreateTargetMachine(
-      target, target_triple, "generic", "", LLVMCodeGenLevelDefault,
-      LLVMRelocDefault, LLVMCodeModelDefault);
-
-  if (!target_machine) {
-    fprintf(stderr, "Failed to create target machine\n");
-    LLVMDisposeMessage(target_triple);
-    return false;
-  }
-
-  LLVMTargetDataRef target_data = LLVMCreateTargetDataLayout(target_machine);
-  char *data_layout = LLVMCopyStringRepOfTargetData(target_data);
-  LLVMSetDataLayout(ctx->current_module->module, data_layout);
-
-  if (LLVMTargetMachineEmitToFile(target_machine, ctx->current_module->module,
-                                  (char *)asm_filename, LLVMAssemblyFile,
-                                  &error)) {
-    fprintf(stderr, "Failed to emit assembly file: %s\n", error);
-    LLVMDisposeMessage(error);
-    LLVMDisposeTargetMachine(target_machine);
-    LLVMDisposeTargetData(target_data);
-    LLVMDisposeMessage(data_layout);
-    LLVMDisposeMessage(target_triple);
-    return false;
-  }
-
-  LLVMDisposeTargetMachine(target_machine);
-  LLVMDisposeTargetData(target_data);
-  LLVMDisposeMessage(data_layout);
-  LLVMDisposeMessage(target_triple);
-
-  return true;
-}
-
 // Existing helper functions (unchanged)
 LLVMLinkage get_function_linkage(AstNode *node) {
   const char *name = node->stmt.func_decl.name;
@@ -399,47 +1171,3 @@ LLVMLinkage get_function_linkage(AstNode *node) {
     return LLVMInternalLinkage;
   }
 }
-
-char *process_escape_sequences(const char *input) {
-  size_t len = strlen(input);
-  char *output = malloc(len + 1);
-  size_t out_idx = 0;
-
-  for (size_t i = 0; i < len; i++) {
-    if (input[i] == '\\' && i + 1 < len) {
-      switch (input[i + 1]) {
-      case 'n':
-        output[out_idx++] = '\n';
-        i++;
-        break;
-      case 'r':
-        output[out_idx++] = '\r';
-        i++;
-        break;
-      case 't':
-        output[out_idx++] = '\t';
-        i++;
-        break;
-      case '\\':
-        output[out_idx++] = '\\';
-        i++;
-        break;
-      case '"':
-        output[out_idx++] = '"';
-        i++;
-        break;
-      case '0':
-        output[out_idx++] = '\0';
-        i++;
-        break;
-      default:
-        output[out_idx++] = input[i];
-        break;
-      }
-    } else {
-      output[out_idx++] = input[i];
-    }
-  }
-  output[out_idx] = '\0';
-  return output;
-}
@@ -12,35 +12,77 @@
 #include <llvm-c/Types.h>
 #include <stdalign.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
 // Project Headers
 #include "../ast/ast.h"
+#include "../ast/module_graph.h"
 #include "../c_libs/memory/memory.h"
+#include "../c_libs/thread/thread_pool.h"
 
 typedef struct LLVM_Symbol LLVM_Symbol;
 typedef struct CodeGenContext CodeGenContext;
 typedef struct ModuleCompilationUnit ModuleCompilationUnit;
 
-// Symbol table entry for variables and functions
+// A type lowered in a unit's context (see codegen_type). Types are keyed by
+// structure, not by node: every `*int` of a module is the first one lowered.
+typedef struct {
+  AstNode *node; // Type node, or function declaration for its signature
+  uint64_t hash; // Structural hash of node; 0 marks an empty slot
+  LLVMTypeRef type;
+} LoweredType;
+
+// Symbol table entry for variables and functions. An export (see
+// ModuleCompilationUnit) has no value, only what a declaration needs.
 struct LLVM_Symbol {
   char *name;
   LLVMValueRef value;
-  LLVMTypeRef type;
+  LLVMTypeRef type; // Function type of a function, value type of a global
   bool is_function;
+  char *link_name;           // Export: LLVM name of the global
+  LLVMVisibility visibility; // Export: visibility of the global
   struct LLVM_Symbol *next;
 };
 
-// Individual module compilation unit
+// Individual module compilation unit. Every unit owns its LLVM context so
+// independent modules can be generated on different threads.
+//
+// When function bodies are split out (split_function_bodies), a module's
+// unit only holds its globals and function prototypes, and the bodies are
+// generated into units of their own: one per function in the per-function
+// object layout, or the module's codegen units. Such a body unit declares
+// what its bodies use on demand, from the module's unit (decl_source).
+//
+// Other units only ever declare a module's globals, so once its IR is
+// complete a module publishes their signatures (exports) in a context of
+// their own. Its module and context are then disposed as soon as its
+// outputs are written (release_module_unit); both are NULL after that.
 struct ModuleCompilationUnit {
   char *module_name;
+  LLVMContextRef context;
   LLVMModuleRef module;
   LLVM_Symbol *symbols;
+  LLVMContextRef signature_context; // Owns the types of the exports
+  LLVM_Symbol *exports;             // Globals with external linkage
   bool is_main_module;
   struct ModuleCompilationUnit *next;
+  struct ModuleCompilationUnit *decl_source; // Body unit: module's unit
+  LoweredType *types;   // Open addressing, at most half full (malloc)
+  size_t type_count;    // Used slots of types
+  size_t type_capacity; // Slots of types, a power of two
 };
 
+// Artifacts of a unit (--emit). Only the object files are linked; the
+// others are written next to them with the extension in the comment.
+typedef enum {
+  EMIT_OBJECT = 1 << 0,   // .o
+  EMIT_ASSEMBLY = 1 << 1, // .s
+  EMIT_IR = 1 << 2,       // .ll
+  EMIT_BITCODE = 1 << 3,  // .bc
+} EmitKind;
+
 typedef struct DeferredStatement {
   AstNode *statement;
   LLVMBasicBlockRef cleanup_block;
@@ -72,6 +114,38 @@ struct CodeGenContext {
 
   // Memory Management
   ArenaAllocator *arena;
+
+  // Per-function object layout for incremental builds: every function whose
+  // AST is not marked reuse_object is compiled to its own object file in
+  // this directory (see function_object_path). NULL: one object per module.
+  const char *function_object_dir;
+
+  // --codegen-units: without function_object_dir, the bodies of every module
+  // are spread over this many units (see codegen_unit_object_path) so its
+  // backend work runs in parallel. 1: bodies stay in the module's unit.
+  size_t codegen_units;
+
+  // --emit: EmitKind flags, the artifacts written for every unit
+  unsigned emit;
+
+  // --dev: locals promoted to SSA registers (mem2reg) and no backend
+  // optimization (LLVMCodeGenLevelNone, which selects with FastISel)
+  bool dev;
+
+  // LLVM bitcode files to optimize together with the program, e.g. C built
+  // by clang -flto. With any, the program is compiled as one module to a
+  // single object file; not combined with function_object_dir.
+  const char **bitcode_inputs;
+  size_t bitcode_input_count;
+
+  // const char *, every object file of the program in link order: module
+  // objects in module graph order, then function objects in source order.
+  // Filled by generate_program_modules.
+  GrowableArray object_files;
+
+  // const char *, the libraries named by extern function declarations, in
+  // the order they are first named. Filled by generate_program_modules.
+  GrowableArray link_libraries;
 };
 
 // =============================================================================
@@ -89,8 +163,44 @@ ModuleCompilationUnit *find_module(CodeGenContext *ctx,
 // Set current module for code generation
 void set_current_module(CodeGenContext *ctx, ModuleCompilationUnit *module);
 
-// Compile all modules to separate object files
-bool compile_modules_to_objects(CodeGenContext *ctx, const char *output_dir);
+// Generate IR for one module (or one function of the per-function layout)
+// with its own builder and codegen state
+bool codegen_module_unit(CodeGenContext *ctx, ModuleCompilationUnit *unit,
+                         AstNode *module_node, ArenaAllocator *arena);
+
+// Publish the signatures of a unit's globals with external linkage as its
+// exports, which is all other units may use. False when out of memory.
+bool publish_module_exports(ModuleCompilationUnit *unit);
+
+// Dispose a unit's module, context, symbols and lowered types, keeping its
+// exports
+void release_module_unit(ModuleCompilationUnit *unit);
+
+// Compile all modules to separate object files (in parallel when pool is
+// set); units already released were written when they were
+bool compile_modules_to_objects(CodeGenContext *ctx, const char *output_dir,
+                                ThreadPool *pool);
+
+// Path of the object file of one function in the per-function layout
+void function_object_path(char *path, size_t size, const char *dir,
+                          const char *module_name, const char *function_name);
+
+// Path of the object file of a module's codegen unit
+void codegen_unit_object_path(char *path, size_t size, const char *dir,
+                              const char *module_name, size_t unit);
+
+// Whether function bodies are generated apart from their module's unit
+bool split_function_bodies(const CodeGenContext *ctx);
+
+// LLVM name of a top-level symbol. With split bodies a private symbol is
+// referenced from other object files, so it is qualified with its module's
+// name to keep private symbols of different modules apart.
+const char *module_symbol_name(CodeGenContext *ctx, const char *name,
+                               bool is_public);
+
+// Linkage of a top-level symbol; private symbols stay hidden in the output
+void set_module_symbol_linkage(CodeGenContext *ctx, LLVMValueRef value,
+                               bool is_public);
 
 // Generate external function declarations for cross-module calls
 void generate_external_declarations(CodeGenContext *ctx,
@@ -115,6 +225,9 @@ void import_variable_symbol(CodeGenContext *ctx, LLVM_Symbol *source_symbol,
                             ModuleCompilationUnit *source_module,
                             const char *alias);
 
+// Rebuild a type from another module's context in the given context
+LLVMTypeRef import_type_into_context(LLVMContextRef context, LLVMTypeRef type);
+
 // Enhanced symbol lookup with module support
 LLVM_Symbol *find_symbol_with_module_support(CodeGenContext *ctx,
                                              const char *name);
@@ -150,22 +263,27 @@ LLVM_Symbol *find_symbol_in_module(ModuleCompilationUnit *module,
 LLVM_Symbol *find_symbol_global(CodeGenContext *ctx, const char *name,
                                 const char *module_name);
 
-// Main Code Generation
+// Main Code Generation (graph may be NULL; pool may be NULL for serial)
 bool generate_program_modules(CodeGenContext *ctx, AstNode *ast_root,
+                              const ModuleGraph *graph, ThreadPool *pool,
                               const char *output_dir);
 
 // Object File Generation (per module)
 bool generate_module_object_file(ModuleCompilationUnit *module,
                                  const char *output_path);
 
+// Write the artifacts in emit (EmitKind flags) of a unit whose object file
+// is object_path; the others go next to it. The code generator runs once,
+// with the --dev profile if dev is set.
+bool generate_module_outputs(ModuleCompilationUnit *module,
+                             const char *object_path, unsigned emit,
+                             bool dev);
+
 // Existing API (preserved for compatibility)
 void add_symbol(CodeGenContext *ctx, const char *name, LLVMValueRef value,
                 LLVMTypeRef type, bool is_function);
 LLVM_Symbol *find_symbol(CodeGenContext *ctx, const char *name);
-char *print_llvm_ir(CodeGenContext *ctx);
 bool generate_object_file(CodeGenContext *ctx, const char *object_filename);
-bool generate_assembly_file(CodeGenContext *ctx, const char *asm_filename);
-char *process_escape_sequences(const char *input);
 LLVMLinkage get_function_linkage(AstNode *node);
 
 // =============================================================================
@@ -241,3 +359,18 @@ LLVMTypeRef codegen_type_basic(CodeGenContext *ctx, AstNode *node);
 LLVMTypeRef codegen_type_pointer(CodeGenContext *ctx, AstNode *node);
 LLVMTypeRef codegen_type_array(CodeGenContext *ctx, AstNode *node);
 LLVMTypeRef codegen_type_function(CodeGenContext *ctx, AstNode *node);
+
+// Function type of a function declaration, lowered once per unit and shared
+// with every function type node of the same signature
+LLVMTypeRef codegen_function_signature(CodeGenContext *ctx, AstNode *node);
+
+// The current unit's lowering of a type node (or function declaration) of
+// the same structure, or NULL; *hash receives the structural hash for
+// remember_lowered_type
+LLVMTypeRef find_lowered_type(CodeGenContext *ctx, AstNode *node,
+                              uint64_t *hash);
+void remember_lowered_type(CodeGenContext *ctx, AstNode *node, uint64_t hash,
+                           LLVMTypeRef type);
+
+// Free a unit's lowered types; they belong to its context
+void free_lowered_types(ModuleCompilationUnit *unit);
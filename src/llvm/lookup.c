@@ -78,21 +78,38 @@ LLVMValueRef codegen_stmt(CodeGenContext *ctx, AstNode *node) {
   }
 }
 
+// Lowered once per unit for every distinct type; later uses of the same
+// structure, from any node, get the same LLVMTypeRef
 LLVMTypeRef codegen_type(CodeGenContext *ctx, AstNode *node) {
   if (!node || node->category != Node_Category_TYPE) {
     return NULL;
   }
 
+  uint64_t hash;
+  LLVMTypeRef type = find_lowered_type(ctx, node, &hash);
+  if (type) {
+    return type;
+  }
+
   switch (node->type) {
   case AST_TYPE_BASIC:
-    return codegen_type_basic(ctx, node);
+    type = codegen_type_basic(ctx, node);
+    break;
   case AST_TYPE_POINTER:
-    return codegen_type_pointer(ctx, node);
+    type = codegen_type_pointer(ctx, node);
+    break;
   case AST_TYPE_ARRAY:
-    return codegen_type_array(ctx, node);
+    type = codegen_type_array(ctx, node);
+    break;
   case AST_TYPE_FUNCTION:
-    return codegen_type_function(ctx, node);
+    type = codegen_type_function(ctx, node);
+    break;
   default:
     return NULL;
   }
+
+  if (type) {
+    remember_lowered_type(ctx, node, hash, type);
+  }
+  return type;
 }
@@ -39,11 +39,9 @@ LLVMValueRef codegen_stmt_program_multi_module(CodeGenContext *ctx,
       ModuleCompilationUnit *unit = find_module(ctx, module_name);
 
       if (unit) {
-        set_current_module(ctx, unit);
-        ctx->module = unit->module; // Update legacy field
-
-        // Process module body
-        codegen_stmt_module(ctx, module_node);
+        // Process module body; later modules import from its exports
+        codegen_module_unit(ctx, unit, module_node, ctx->arena);
+        publish_module_exports(unit);
       }
     }
   }
@@ -51,6 +49,38 @@ LLVMValueRef codegen_stmt_program_multi_module(CodeGenContext *ctx,
   return NULL;
 }
 
+// =============================================================================
+// PER-MODULE CODE GENERATION
+// =============================================================================
+
+bool codegen_module_unit(CodeGenContext *ctx, ModuleCompilationUnit *unit,
+                         AstNode *module_node, ArenaAllocator *arena) {
+  // Each module gets a private copy of the codegen state that targets the
+  // unit's own context; only the (read-only) module list is shared
+  CodeGenContext module_ctx = *ctx;
+  module_ctx.context = unit->context;
+  module_ctx.builder = LLVMCreateBuilderInContext(unit->context);
+  module_ctx.current_module = unit;
+  module_ctx.module = unit->module; // Update legacy field
+  module_ctx.current_function = NULL;
+  module_ctx.loop_continue_block = NULL;
+  module_ctx.loop_break_block = NULL;
+  module_ctx.arena = arena;
+  init_defer_stack(&module_ctx);
+
+  if (!module_ctx.builder) {
+    fprintf(stderr, "Failed to create IR builder for module %s\n",
+            unit->module_name);
+    return false;
+  }
+
+  // A module node, or a function node for a unit split out of its module
+  codegen_stmt(&module_ctx, module_node);
+
+  LLVMDisposeBuilder(module_ctx.builder);
+  return true;
+}
+
 // =============================================================================
 // MODULE DECLARATION HANDLER
 // =============================================================================
@@ -117,22 +147,17 @@ void import_module_symbols(CodeGenContext *ctx,
     return;
   }
 
-  // Import all public symbols from source module
-  for (LLVM_Symbol *sym = source_module->symbols; sym; sym = sym->next) {
+  // Import all public symbols from source module: exports under their own
+  // name. Private symbols of split bodies ("module.name") and aliased
+  // imports are exported for the module's own body units only.
+  for (LLVM_Symbol *sym = source_module->exports; sym; sym = sym->next) {
+    if (strcmp(sym->link_name, sym->name) != 0) {
+      continue;
+    }
     if (sym->is_function) {
-      // For functions, check if they have external linkage (public)
-      LLVMValueRef func_value =
-          LLVMGetNamedFunction(source_module->module, sym->name);
-      if (func_value && LLVMGetLinkage(func_value) == LLVMExternalLinkage) {
-        import_function_symbol(ctx, sym, source_module, alias);
-      }
+      import_function_symbol(ctx, sym, source_module, alias);
     } else {
-      // For variables, import public globals
-      LLVMValueRef global_value =
-          LLVMGetNamedGlobal(source_module->module, sym->name);
-      if (global_value && LLVMGetLinkage(global_value) == LLVMExternalLinkage) {
-        import_variable_symbol(ctx, sym, source_module, alias);
-      }
+      import_variable_symbol(ctx, sym, source_module, alias);
     }
   }
 }
@@ -155,10 +180,16 @@ void import_function_symbol(CodeGenContext *ctx, LLVM_Symbol *source_symbol,
   }
 
   // Create external declaration in current module
-  LLVMTypeRef func_type = LLVMGlobalGetValueType(source_symbol->value);
-  LLVMValueRef external_func = LLVMAddFunction(ctx->current_module->module,
-                                               source_symbol->name, func_type);
-  LLVMSetLinkage(external_func, LLVMExternalLinkage);
+  LLVMTypeRef func_type =
+      import_type_into_context(ctx->context, source_symbol->type);
+  // An extern C function several modules declare is a single symbol
+  LLVMValueRef external_func =
+      LLVMGetNamedFunction(ctx->current_module->module, source_symbol->name);
+  if (!external_func) {
+    external_func = LLVMAddFunction(ctx->current_module->module,
+                                    source_symbol->name, func_type);
+    LLVMSetLinkage(external_func, LLVMExternalLinkage);
+  }
 
   // Add to current module's symbol table with imported name
   add_symbol_to_module(ctx->current_module, imported_name, external_func,
@@ -186,18 +217,74 @@ void import_variable_symbol(CodeGenContext *ctx, LLVM_Symbol *source_symbol,
   }
 
   // Create external declaration in current module
-  LLVMValueRef external_global = LLVMAddGlobal(
-      ctx->current_module->module, source_symbol->type, source_symbol->name);
+  LLVMTypeRef var_type =
+      import_type_into_context(ctx->context, source_symbol->type);
+  LLVMValueRef external_global = LLVMAddGlobal(ctx->current_module->module,
+                                               var_type, source_symbol->name);
   LLVMSetLinkage(external_global, LLVMExternalLinkage);
 
   // Add to current module's symbol table with imported name
   add_symbol_to_module(ctx->current_module, imported_name, external_global,
-                       source_symbol->type, false);
+                       var_type, false);
 
   // printf("Imported variable: %s -> %s\n", source_symbol->name,
   // imported_name);
 }
 
+// Types belong to the context that created them, so a declaration imported
+// from another module has its type rebuilt in the importing module's context
+LLVMTypeRef import_type_into_context(LLVMContextRef context, LLVMTypeRef type) {
+  switch (LLVMGetTypeKind(type)) {
+  case LLVMVoidTypeKind:
+    return LLVMVoidTypeInContext(context);
+  case LLVMHalfTypeKind:
+    return LLVMHalfTypeInContext(context);
+  case LLVMFloatTypeKind:
+    return LLVMFloatTypeInContext(context);
+  case LLVMDoubleTypeKind:
+    return LLVMDoubleTypeInContext(context);
+  case LLVMIntegerTypeKind:
+    return LLVMIntTypeInContext(context, LLVMGetIntTypeWidth(type));
+  case LLVMPointerTypeKind:
+    return LLVMPointerType(
+        import_type_into_context(context, LLVMGetElementType(type)),
+        LLVMGetPointerAddressSpace(type));
+  case LLVMArrayTypeKind:
+    return LLVMArrayType(
+        import_type_into_context(context, LLVMGetElementType(type)),
+        LLVMGetArrayLength(type));
+  case LLVMFunctionTypeKind: {
+    unsigned param_count = LLVMCountParamTypes(type);
+    LLVMTypeRef *params = malloc((param_count + 1) * sizeof(LLVMTypeRef));
+    LLVMGetParamTypes(type, params);
+    for (unsigned i = 0; i < param_count; i++) {
+      params[i] = import_type_into_context(context, params[i]);
+    }
+    LLVMTypeRef result = LLVMFunctionType(
+        import_type_into_context(context, LLVMGetReturnType(type)), params,
+        param_count, LLVMIsFunctionVarArg(type));
+    free(params);
+    return result;
+  }
+  case LLVMStructTypeKind: {
+    unsigned field_count = LLVMCountStructElementTypes(type);
+    LLVMTypeRef *fields = malloc((field_count + 1) * sizeof(LLVMTypeRef));
+    LLVMGetStructElementTypes(type, fields);
+    for (unsigned i = 0; i < field_count; i++) {
+      fields[i] = import_type_into_context(context, fields[i]);
+    }
+    LLVMTypeRef result = LLVMStructTypeInContext(context, fields, field_count,
+                                                 LLVMIsPackedStruct(type));
+    free(fields);
+    return result;
+  }
+  default:
+    fprintf(stderr, "Error: Cannot import type of kind %d across modules\n",
+            LLVMGetTypeKind(type));
+    return LLVMInt8TypeInContext(context);
+  }
+}
+
 // =============================================================================
 // MEMBER ACCESS HANDLER (for module.symbol syntax)
 // =============================================================================
@@ -262,11 +349,10 @@ LLVM_Symbol *find_symbol_with_module_support(CodeGenContext *ctx,
       continue; // Already checked
     }
 
-    LLVM_Symbol *sym = find_symbol_in_module(unit, name);
-    if (sym && sym->is_function) {
-      // Check if function has external linkage (is public)
-      LLVMValueRef func = LLVMGetNamedFunction(unit->module, name);
-      if (func && LLVMGetLinkage(func) == LLVMExternalLinkage) {
+    // Exports have external linkage; public ones keep their own name
+    for (LLVM_Symbol *sym = unit->exports; sym; sym = sym->next) {
+      if (sym->is_function && strcmp(sym->name, name) == 0 &&
+          strcmp(sym->link_name, name) == 0) {
         return sym;
       }
     }
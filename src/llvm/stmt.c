@@ -24,15 +24,13 @@ LLVMValueRef codegen_stmt_var_decl(CodeGenContext *ctx, AstNode *node) {
       ctx->current_module ? ctx->current_module->module : ctx->module;
 
   if (ctx->current_function == NULL) {
-    var_ref =
-        LLVMAddGlobal(current_llvm_module, var_type, node->stmt.var_decl.name);
+    bool is_public = node->stmt.var_decl.is_public;
+    var_ref = LLVMAddGlobal(
+        current_llvm_module, var_type,
+        module_symbol_name(ctx, node->stmt.var_decl.name, is_public));
 
     // Set linkage based on whether this is a public declaration
-    if (node->stmt.var_decl.is_public) {
-      LLVMSetLinkage(var_ref, LLVMExternalLinkage);
-    } else {
-      LLVMSetLinkage(var_ref, LLVMInternalLinkage);
-    }
+    set_module_symbol_linkage(ctx, var_ref, is_public);
   } else {
     var_ref = LLVMBuildAlloca(ctx->builder, var_type, node->stmt.var_decl.name);
   }
@@ -52,33 +50,70 @@ LLVMValueRef codegen_stmt_var_decl(CodeGenContext *ctx, AstNode *node) {
   return var_ref;
 }
 
-LLVMValueRef codegen_stmt_function(CodeGenContext *ctx, AstNode *node) {
-  LLVMTypeRef *param_types = (LLVMTypeRef *)arena_alloc(
-      ctx->arena, sizeof(LLVMTypeRef) * node->stmt.func_decl.param_count,
-      alignof(LLVMTypeRef));
-
-  for (size_t i = 0; i < node->stmt.func_decl.param_count; i++) {
-    param_types[i] = codegen_type(ctx, node->stmt.func_decl.param_types[i]);
-    if (!param_types[i])
-      return NULL;
+// A C function: a plain declaration under its own name, C calling convention.
+// Lux bool is i1, which the C ABI passes zero-extended like _Bool.
+static LLVMValueRef codegen_extern_function(CodeGenContext *ctx, AstNode *node,
+                                            LLVMModuleRef module,
+                                            LLVMTypeRef func_type) {
+  const char *name = node->stmt.func_decl.name;
+
+  // Declared already by an @use of another module, or by the print builtins
+  LLVMValueRef function = LLVMGetNamedFunction(module, name);
+  if (function && LLVMGlobalGetValueType(function) != func_type) {
+    fprintf(stderr, "Error: extern function '%s' conflicts with another "
+                    "declaration of '%s'\n",
+            name, name);
+    return NULL;
+  }
+  if (!function) {
+    function = LLVMAddFunction(module, name, func_type);
+    LLVMSetLinkage(function, LLVMExternalLinkage);
+    LLVMSetFunctionCallConv(function, LLVMCCallConv);
+
+    unsigned zeroext = LLVMGetEnumAttributeKindForName("zeroext", 7);
+    LLVMTypeRef i1 = LLVMInt1TypeInContext(ctx->context);
+    if (LLVMGetReturnType(func_type) == i1) {
+      LLVMAddAttributeAtIndex(function, LLVMAttributeReturnIndex,
+                              LLVMCreateEnumAttribute(ctx->context, zeroext, 0));
+    }
+    for (unsigned i = 0; i < node->stmt.func_decl.param_count; i++) {
+      if (LLVMTypeOf(LLVMGetParam(function, i)) == i1) {
+        LLVMAddAttributeAtIndex(
+            function, i + 1, LLVMCreateEnumAttribute(ctx->context, zeroext, 0));
+      }
+    }
   }
 
-  LLVMTypeRef return_type = codegen_type(ctx, node->stmt.func_decl.return_type);
-  if (!return_type)
-    return NULL;
+  add_symbol(ctx, name, function, func_type, true);
+  return function;
+}
 
-  LLVMTypeRef func_type = LLVMFunctionType(
-      return_type, param_types, node->stmt.func_decl.param_count, false);
+LLVMValueRef codegen_stmt_function(CodeGenContext *ctx, AstNode *node) {
+  LLVMTypeRef func_type = codegen_function_signature(ctx, node);
+  if (!func_type)
+    return NULL;
 
   LLVMModuleRef current_llvm_module =
       ctx->current_module ? ctx->current_module->module : ctx->module;
 
-  LLVMValueRef function = LLVMAddFunction(current_llvm_module,
-                                          node->stmt.func_decl.name, func_type);
+  if (node->stmt.func_decl.is_extern) {
+    return codegen_extern_function(ctx, node, current_llvm_module, func_type);
+  }
+
+  bool exported = get_function_linkage(node) == LLVMExternalLinkage;
+  LLVMValueRef function = LLVMAddFunction(
+      current_llvm_module,
+      module_symbol_name(ctx, node->stmt.func_decl.name, exported), func_type);
 
-  LLVMSetLinkage(function, get_function_linkage(node));
+  set_module_symbol_linkage(ctx, function, exported);
   add_symbol(ctx, node->stmt.func_decl.name, function, func_type, true);
 
+  // When bodies are split out, the module's unit only declares functions;
+  // each body is generated into the unit it was split out to
+  if (split_function_bodies(ctx) && !ctx->current_module->decl_source) {
+    return function;
+  }
+
   // Set parameter names
   for (size_t i = 0; i < node->stmt.func_decl.param_count; i++) {
     LLVMValueRef param = LLVMGetParam(function, i);
@@ -103,10 +138,11 @@ LLVMValueRef codegen_stmt_function(CodeGenContext *ctx, AstNode *node) {
   // Add parameters to symbol table as allocas
   for (size_t i = 0; i < node->stmt.func_decl.param_count; i++) {
     LLVMValueRef param = LLVMGetParam(function, i);
-    LLVMValueRef alloca = LLVMBuildAlloca(ctx->builder, param_types[i],
+    LLVMTypeRef param_type = LLVMTypeOf(param);
+    LLVMValueRef alloca = LLVMBuildAlloca(ctx->builder, param_type,
                                           node->stmt.func_decl.param_names[i]);
     LLVMBuildStore(ctx->builder, param, alloca);
-    add_symbol(ctx, node->stmt.func_decl.param_names[i], alloca, param_types[i],
+    add_symbol(ctx, node->stmt.func_decl.param_names[i], alloca, param_type,
                false);
   }
 
@@ -141,6 +177,7 @@ LLVMValueRef codegen_stmt_function(CodeGenContext *ctx, AstNode *node) {
   // Set up normal return block
   LLVMPositionBuilderAtEnd(ctx->builder, normal_return);
 
+  LLVMTypeRef return_type = LLVMGetReturnType(func_type);
   if (LLVMGetTypeKind(return_type) == LLVMVoidTypeKind) {
     LLVMBuildRetVoid(ctx->builder);
   } else {
@@ -303,16 +340,10 @@ LLVMValueRef codegen_stmt_print(CodeGenContext *ctx, AstNode *node) {
 
     if (expr->type == AST_EXPR_LITERAL &&
         expr->expr.literal.lit_type == LITERAL_STRING) {
-
-      // Process escape sequences in the string literal
-      char *processed_str =
-          process_escape_sequences(expr->expr.literal.value.string_val);
-
       // Create the string value directly (not using %s format)
-      value = LLVMBuildGlobalStringPtr(ctx->builder, processed_str, "str");
+      value = LLVMBuildGlobalStringPtr(
+          ctx->builder, expr->expr.literal.value.string_val, "str");
       format_str = "%s";
-
-      free(processed_str);
     } else {
       // Handle non-string expressions as before
       value = codegen_expr(ctx, expr);
@@ -343,7 +374,8 @@ LLVMValueRef codegen_stmt_print(CodeGenContext *ctx, AstNode *node) {
     LLVMBuildCall2(ctx->builder, printf_type, printf_func, args, 2, "");
   }
 
-  return LLVMConstNull(LLVMVoidTypeInContext(ctx->context));
+  // Statements have no value (and there is no null constant of type void)
+  return NULL;
 }
 
 LLVMValueRef codegen_stmt_defer(CodeGenContext *ctx, AstNode *node) {
@@ -1,5 +1,7 @@
 #include "llvm.h"
 
+#include <stdlib.h>
+
 LLVMTypeRef codegen_type_basic(CodeGenContext *ctx, AstNode *node) {
   const char *type_name = node->type_data.basic.name;
   if (strcmp(type_name, "int") == 0) {
@@ -12,6 +14,8 @@ LLVMTypeRef codegen_type_basic(CodeGenContext *ctx, AstNode *node) {
     return LLVMInt1TypeInContext(ctx->context);
   } else if (strcmp(type_name, "void") == 0) {
     return LLVMVoidTypeInContext(ctx->context);
+  } else if (strcmp(type_name, "char") == 0) {
+    return LLVMInt8TypeInContext(ctx->context);
   } else if (strcmp(type_name, "str") == 0) {
     return LLVMPointerType(LLVMInt8TypeInContext(ctx->context), 0);
   }
@@ -42,24 +46,232 @@ LLVMTypeRef codegen_type_array(CodeGenContext *ctx, AstNode *node) {
   return NULL;
 }
 
-LLVMTypeRef codegen_type_function(CodeGenContext *ctx, AstNode *node) {
-  LLVMTypeRef return_type =
-      codegen_type(ctx, node->type_data.function.return_type);
+// Shared by function type nodes and function declarations
+static LLVMTypeRef lower_function_type(CodeGenContext *ctx,
+                                       AstNode *return_node,
+                                       AstNode **param_nodes,
+                                       size_t param_count) {
+  LLVMTypeRef return_type = codegen_type(ctx, return_node);
   if (return_type) {
     LLVMTypeRef *param_types = (LLVMTypeRef *)arena_alloc(
-        ctx->arena, sizeof(LLVMTypeRef) * node->type_data.function.param_count,
-        alignof(LLVMTypeRef *));
+        ctx->arena, sizeof(LLVMTypeRef) * param_count, alignof(LLVMTypeRef *));
 
-    for (size_t i = 0; i < node->type_data.function.param_count; i++) {
-      param_types[i] =
-          codegen_type(ctx, node->type_data.function.param_types[i]);
+    for (size_t i = 0; i < param_count; i++) {
+      param_types[i] = codegen_type(ctx, param_nodes[i]);
       if (!param_types[i]) {
         return NULL;
       }
     }
 
-    return LLVMFunctionType(return_type, param_types,
-                            node->type_data.function.param_count, false);
+    return LLVMFunctionType(return_type, param_types, param_count, false);
   }
   return NULL;
 }
+
+LLVMTypeRef codegen_type_function(CodeGenContext *ctx, AstNode *node) {
+  return lower_function_type(ctx, node->type_data.function.return_type,
+                             node->type_data.function.param_types,
+                             node->type_data.function.param_count);
+}
+
+LLVMTypeRef codegen_function_signature(CodeGenContext *ctx, AstNode *node) {
+  uint64_t hash;
+  LLVMTypeRef type = find_lowered_type(ctx, node, &hash);
+  if (!type) {
+    type = lower_function_type(ctx, node->stmt.func_decl.return_type,
+                               node->stmt.func_decl.param_types,
+                               node->stmt.func_decl.param_count);
+    if (type) {
+      remember_lowered_type(ctx, node, hash, type);
+    }
+  }
+  return type;
+}
+
+// =============================================================================
+// LOWERED TYPES
+// =============================================================================
+
+// The signature of a function type node or a function declaration
+static bool signature_of(AstNode *node, AstNode **return_type,
+                         AstNode ***param_types, size_t *param_count) {
+  if (node->type == AST_TYPE_FUNCTION) {
+    *return_type = node->type_data.function.return_type;
+    *param_types = node->type_data.function.param_types;
+    *param_count = node->type_data.function.param_count;
+    return true;
+  }
+  if (node->type == AST_STMT_FUNCTION) {
+    *return_type = node->stmt.func_decl.return_type;
+    *param_types = node->stmt.func_decl.param_types;
+    *param_count = node->stmt.func_decl.param_count;
+    return true;
+  }
+  return false;
+}
+
+// -1 for an array whose size codegen_type_array does not lower
+static int64_t array_size_of(AstNode *node) {
+  AstNode *size = node->type_data.array.size;
+  if (size && size->type == AST_EXPR_LITERAL &&
+      size->expr.literal.lit_type == LITERAL_INT) {
+    return (int64_t)size->expr.literal.value.int_val;
+  }
+  return -1;
+}
+
+// FNV-1a over whole words rather than bytes
+static uint64_t hash_mix(uint64_t hash, uint64_t value) {
+  return (hash ^ value) * 1099511628211ULL;
+}
+
+static uint64_t type_hash(AstNode *node) {
+  uint64_t hash = 1469598103934665603ULL;
+  if (!node) {
+    return hash;
+  }
+
+  AstNode *return_type;
+  AstNode **param_types;
+  size_t param_count;
+  if (signature_of(node, &return_type, &param_types, &param_count)) {
+    hash = hash_mix(hash_mix(hash, AST_TYPE_FUNCTION), type_hash(return_type));
+    for (size_t i = 0; i < param_count; i++) {
+      hash = hash_mix(hash, type_hash(param_types[i]));
+    }
+    return hash;
+  }
+
+  hash = hash_mix(hash, node->type);
+  switch (node->type) {
+  case AST_TYPE_BASIC:
+    for (const char *c = node->type_data.basic.name; *c; c++) {
+      hash = hash_mix(hash, (unsigned char)*c);
+    }
+    return hash;
+  case AST_TYPE_POINTER:
+    return hash_mix(hash, type_hash(node->type_data.pointer.pointee_type));
+  case AST_TYPE_ARRAY:
+    hash = hash_mix(hash, (uint64_t)array_size_of(node));
+    return hash_mix(hash, type_hash(node->type_data.array.element_type));
+  default:
+    // Not lowered by codegen_type; the node only matches itself
+    return hash_mix(hash, (uint64_t)(uintptr_t)node);
+  }
+}
+
+static bool same_type(AstNode *a, AstNode *b) {
+  if (a == b) {
+    return true;
+  }
+  if (!a || !b) {
+    return false;
+  }
+
+  AstNode *a_return = NULL, *b_return = NULL;
+  AstNode **a_params = NULL, **b_params = NULL;
+  size_t a_count = 0, b_count = 0;
+  bool a_function = signature_of(a, &a_return, &a_params, &a_count);
+  bool b_function = signature_of(b, &b_return, &b_params, &b_count);
+  if (a_function || b_function) {
+    if (a_function != b_function || a_count != b_count ||
+        !same_type(a_return, b_return)) {
+      return false;
+    }
+    for (size_t i = 0; i < a_count; i++) {
+      if (!same_type(a_params[i], b_params[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  if (a->type != b->type) {
+    return false;
+  }
+  switch (a->type) {
+  case AST_TYPE_BASIC:
+    return strcmp(a->type_data.basic.name, b->type_data.basic.name) == 0;
+  case AST_TYPE_POINTER:
+    return same_type(a->type_data.pointer.pointee_type,
+                     b->type_data.pointer.pointee_type);
+  case AST_TYPE_ARRAY:
+    return array_size_of(a) == array_size_of(b) &&
+           same_type(a->type_data.array.element_type,
+                     b->type_data.array.element_type);
+  default:
+    return false;
+  }
+}
+
+// Types of the unit being generated. A context without one (the legacy
+// single-module path) lowers every time.
+static ModuleCompilationUnit *lowering_unit(CodeGenContext *ctx) {
+  ModuleCompilationUnit *unit = ctx->current_module;
+  return unit && unit->context == ctx->context ? unit : NULL;
+}
+
+static size_t type_slot(ModuleCompilationUnit *unit, AstNode *node,
+                        uint64_t hash) {
+  size_t mask = unit->type_capacity - 1;
+  size_t i = (size_t)hash & mask;
+  for (LoweredType *slot = &unit->types[i]; slot->hash;
+       slot = &unit->types[i]) {
+    if (slot->hash == hash && same_type(slot->node, node)) {
+      break;
+    }
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+LLVMTypeRef find_lowered_type(CodeGenContext *ctx, AstNode *node,
+                              uint64_t *hash) {
+  // 0 marks an empty slot
+  *hash = type_hash(node) | 1;
+  ModuleCompilationUnit *unit = lowering_unit(ctx);
+  if (!unit || !unit->types) {
+    return NULL;
+  }
+  return unit->types[type_slot(unit, node, *hash)].type;
+}
+
+// Out of memory only costs lowering the type again
+void remember_lowered_type(CodeGenContext *ctx, AstNode *node, uint64_t hash,
+                           LLVMTypeRef type) {
+  ModuleCompilationUnit *unit = lowering_unit(ctx);
+  if (!unit) {
+    return;
+  }
+
+  if ((unit->type_count + 1) * 2 > unit->type_capacity) {
+    size_t capacity = unit->type_capacity ? unit->type_capacity * 2 : 64;
+    LoweredType *types = (LoweredType *)calloc(capacity, sizeof(LoweredType));
+    if (!types) {
+      return;
+    }
+    LoweredType *old = unit->types;
+    size_t old_capacity = unit->type_capacity;
+    unit->types = types;
+    unit->type_capacity = capacity;
+    for (size_t i = 0; i < old_capacity; i++) {
+      if (old[i].hash) {
+        unit->types[type_slot(unit, old[i].node, old[i].hash)] = old[i];
+      }
+    }
+    free(old);
+  }
+
+  size_t i = type_slot(unit, node, hash);
+  if (!unit->types[i].hash) {
+    unit->types[i] = (LoweredType){node, hash, type};
+    unit->type_count++;
+  }
+}
+
+void free_lowered_types(ModuleCompilationUnit *unit) {
+  free(unit->types);
+  unit->types = NULL;
+  unit->type_count = 0;
+  unit->type_capacity = 0;
+}
@@ -0,0 +1,714 @@
+/**
+ * @file document.c
+ * @brief In-memory documents with range re-lexing.
+ *
+ * @see document.h
+ */
+
+#include "document.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../c_libs/error/error.h"
+#include "../parser/parser.h"
+
+/** Expected tokens per byte of source, for sizing the token arrays */
+#define TOKENS_PER_BYTE_DIVISOR 4
+
+// An edit half applied cannot be undone, and the editor would be out of
+// sync from then on
+static void out_of_memory(const Document *doc) {
+  fprintf(stderr, "Out of memory while editing %s\n", doc->uri);
+  abort();
+}
+
+// Grows the token buffers of a generation to hold @p count entries
+static bool reserve_tokens(Generation *gen, size_t count) {
+  if (count <= gen->token_capacity) {
+    return true;
+  }
+  size_t capacity = gen->token_capacity ? gen->token_capacity : 1024;
+  while (capacity < count) {
+    capacity *= 2;
+  }
+  Token *tokens = realloc(gen->tokens, capacity * sizeof(Token));
+  if (tokens) {
+    gen->tokens = tokens;
+  }
+  size_t *ends = realloc(gen->token_ends, capacity * sizeof(size_t));
+  if (ends) {
+    gen->token_ends = ends;
+  }
+  if (!tokens || !ends) {
+    return false;
+  }
+  gen->token_capacity = capacity;
+  return true;
+}
+
+static char *reserve_text(Generation *gen, size_t length) {
+  if (length + 1 > gen->text_capacity) {
+    char *text = realloc(gen->text, length + 1);
+    if (!text) {
+      return NULL;
+    }
+    gen->text = text;
+    gen->text_capacity = length + 1;
+  }
+  return gen->text;
+}
+
+/**
+ * @brief Token arrays of a generation under construction.
+ */
+typedef struct {
+  Generation *gen; /**< Generation receiving the tokens */
+  size_t count;    /**< Tokens stored so far */
+} TokenBuilder;
+
+static bool builder_init(TokenBuilder *b, Generation *gen, size_t expected) {
+  b->gen = gen;
+  b->count = 0;
+  return reserve_tokens(gen, expected + 16);
+}
+
+static bool builder_push(TokenBuilder *b, Token token, size_t end) {
+  if (!reserve_tokens(b->gen, b->count + 1)) {
+    return false;
+  }
+  b->gen->tokens[b->count] = token;
+  b->gen->token_ends[b->count++] = end;
+  return true;
+}
+
+// Appends old tokens in bulk, pointing them into @p text at @p shift bytes
+// from where they were in @p old_text. Their decoded literals were in the
+// lexer arena of an earlier edit; the parser decodes them again.
+static bool builder_copy(TokenBuilder *b, const Token *tokens,
+                         const size_t *ends, size_t count, const char *old_text,
+                         const char *text, ptrdiff_t shift) {
+  if (!reserve_tokens(b->gen, b->count + count)) {
+    return false;
+  }
+  Token *out = b->gen->tokens + b->count;
+  size_t *out_ends = b->gen->token_ends + b->count;
+  memcpy(out, tokens, count * sizeof(Token));
+  for (size_t i = 0; i < count; i++) {
+    out[i].value = text + (tokens[i].value - old_text) + shift;
+    out[i].literal = NULL;
+    out_ends[i] = (size_t)((ptrdiff_t)ends[i] + shift);
+  }
+  b->count += count;
+  return true;
+}
+
+static size_t raw_start(const char *text, const Token *token) {
+  size_t start = (size_t)(token->value - text);
+  // String tokens point past their opening quote
+  return token->type_ == TOK_STRING && start > 0 ? start - 1 : start;
+}
+
+static bool grow_lines(Generation *gen) {
+  size_t capacity = gen->line_capacity ? gen->line_capacity * 2 : 1024;
+  size_t *starts = realloc(gen->line_starts, capacity * sizeof(size_t));
+  if (!starts) {
+    return false;
+  }
+  gen->line_starts = starts;
+  gen->line_capacity = capacity;
+  return true;
+}
+
+static bool build_line_table(Document *doc, Generation *gen) {
+  if (gen->line_capacity == 0 && !grow_lines(gen)) {
+    return false;
+  }
+  gen->line_starts[0] = 0;
+
+  size_t lines = 1;
+  const char *at = doc->text;
+  const char *end = doc->text + doc->length;
+  while ((at = memchr(at, '\n', (size_t)(end - at))) != NULL) {
+    if (lines == gen->line_capacity && !grow_lines(gen)) {
+      return false;
+    }
+    gen->line_starts[lines++] = (size_t)(++at - doc->text);
+  }
+  doc->line_starts = gen->line_starts;
+  doc->line_count = lines;
+  return true;
+}
+
+static void install_tokens(Document *doc, TokenBuilder *b) {
+  doc->tokens = b->gen->tokens;
+  doc->token_ends = b->gen->token_ends;
+  doc->token_count = b->count;
+}
+
+// Copies the errors added since error_clear() into the document's
+// diagnostics; the messages may live in arenas that are about to go away
+static void collect_errors(Document *doc) {
+  for (int i = 0; i < error_count_get(); i++) {
+    const ErrorInformation *err = error_get(i);
+    Diagnostic *d = (Diagnostic *)growable_array_push(&doc->syntax);
+    if (!d) {
+      return;
+    }
+
+    size_t line = err->line > 0 ? (size_t)err->line - 1 : 0;
+    // Error columns point at the last character of the offending token
+    long last = err->col > 0 ? err->col : 0;
+    long first = last - (err->token_length > 0 ? err->token_length : 1) + 1;
+    d->line = line;
+    d->start = first > 0 ? (size_t)first : 0;
+    d->end = (size_t)last + 1;
+    d->message = arena_strdup(&doc->ast_arena,
+                              err->message ? err->message : "syntax error");
+  }
+}
+
+static bool build_checks(Document *doc) {
+  if (!growable_array_init(&doc->checks, &doc->ast_arena, 64,
+                           sizeof(FunctionCheck))) {
+    return false;
+  }
+  if (!doc->module) {
+    return true;
+  }
+
+  for (size_t i = 0; i < doc->module->preprocessor.module.body_count; i++) {
+    AstNode *stmt = doc->module->preprocessor.module.body[i];
+    if (!stmt || stmt->type != AST_STMT_FUNCTION ||
+        !stmt->stmt.func_decl.deferred) {
+      continue;
+    }
+    FunctionCheck *check = (FunctionCheck *)growable_array_push(&doc->checks);
+    if (!check) {
+      return false;
+    }
+    *check = (FunctionCheck){stmt, true, NULL};
+  }
+  return true;
+}
+
+// Parses the current tokens into a fresh AST. Errors already in the error
+// list (from lexing) end up in the diagnostics as well
+static bool parse_document(Document *doc) {
+  arena_reset(&doc->ast_arena);
+  doc->module = NULL;
+  if (!growable_array_init(&doc->syntax, &doc->ast_arena, 8,
+                           sizeof(Diagnostic))) {
+    return false;
+  }
+
+  GrowableArray view = {doc->tokens, doc->token_count, doc->token_count,
+                        sizeof(Token), &doc->ast_arena};
+  AstNode *program = parse(&view, &doc->ast_arena, doc->path, true);
+  if (program && program->type == AST_PROGRAM &&
+      program->stmt.program.module_count > 0) {
+    AstNode *module = program->stmt.program.modules[0];
+    if (module && module->type == AST_PREPROCESSOR_MODULE) {
+      doc->module = module;
+    }
+  }
+
+  collect_errors(doc);
+  error_clear();
+  return build_checks(doc);
+}
+
+// Replaces the text and lexes all of it into the other generation
+static bool relex_all(Document *doc, const char *text, size_t length) {
+  int next = 1 - doc->generation;
+  Generation *gen = &doc->generations[next];
+  char *copy = reserve_text(gen, length);
+  TokenBuilder b;
+  if (!copy || !builder_init(&b, gen, length / TOKENS_PER_BYTE_DIVISOR)) {
+    return false;
+  }
+  memmove(copy, text, length);
+  copy[length] = '\0';
+
+  arena_reset(&doc->lex_arena);
+  Lexer lexer;
+  init_lexer(&lexer, copy, &doc->lex_arena);
+  Token token;
+  while ((token = next_token(&lexer)).type_ != TOK_EOF) {
+    if (!builder_push(&b, token, (size_t)(lexer.current - copy))) {
+      return false;
+    }
+  }
+
+  doc->text = copy;
+  doc->length = length;
+  doc->generation = next;
+  install_tokens(doc, &b);
+  return build_line_table(doc, gen);
+}
+
+static bool reparse_all(Document *doc, const char *text, size_t length) {
+  error_clear();
+  if (!relex_all(doc, text, length)) {
+    return false;
+  }
+  doc->lex_errors = error_count_get() > 0;
+  return parse_document(doc);
+}
+
+Document *document_create(const char *uri, const char *path, const char *text,
+                          size_t length) {
+  Document *doc = calloc(1, sizeof(Document));
+  if (!doc) {
+    return NULL;
+  }
+  doc->uri = strdup(uri);
+  doc->path = strdup(path);
+  if (!doc->uri || !doc->path ||
+      arena_allocator_init(&doc->lex_arena, ARENA_MIN_BUFFER_SIZE) != 0 ||
+      arena_allocator_init(&doc->ast_arena, ARENA_MIN_BUFFER_SIZE) != 0 ||
+      !reparse_all(doc, text, length)) {
+    document_destroy(doc);
+    return NULL;
+  }
+  return doc;
+}
+
+void document_destroy(Document *doc) {
+  if (!doc) {
+    return;
+  }
+  for (int i = 0; i < 2; i++) {
+    free(doc->generations[i].text);
+    free(doc->generations[i].tokens);
+    free(doc->generations[i].token_ends);
+    free(doc->generations[i].line_starts);
+  }
+  arena_destroy(&doc->lex_arena);
+  arena_destroy(&doc->ast_arena);
+  free(doc->uri);
+  free(doc->path);
+  free(doc);
+}
+
+size_t document_line_of(const Document *doc, size_t offset) {
+  size_t lo = 0, hi = doc->line_count;
+  while (hi - lo > 1) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (doc->line_starts[mid] <= offset) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+static size_t line_end(const Document *doc, size_t line) {
+  return line + 1 < doc->line_count ? doc->line_starts[line + 1] - 1
+                                    : doc->length;
+}
+
+// UTF-16 code units of the UTF-8 sequence starting with @p lead
+static size_t utf16_units(unsigned char lead) {
+  return lead >= 0xF0 ? 2 : 1;
+}
+
+static size_t utf8_length(unsigned char lead) {
+  if (lead >= 0xF0)
+    return 4;
+  if (lead >= 0xE0)
+    return 3;
+  if (lead >= 0xC0)
+    return 2;
+  return 1;
+}
+
+size_t document_offset(const Document *doc, size_t line, size_t character,
+                       bool utf16) {
+  if (line >= doc->line_count) {
+    return doc->length;
+  }
+  size_t offset = doc->line_starts[line];
+  size_t end = line_end(doc, line);
+  if (!utf16) {
+    return offset + character < end ? offset + character : end;
+  }
+
+  size_t units = 0;
+  while (offset < end && units < character) {
+    unsigned char lead = (unsigned char)doc->text[offset];
+    units += utf16_units(lead);
+    offset += utf8_length(lead);
+  }
+  return offset < end ? offset : end;
+}
+
+size_t document_character(const Document *doc, size_t line, size_t offset,
+                          bool utf16) {
+  if (line >= doc->line_count) {
+    return 0;
+  }
+  size_t start = doc->line_starts[line];
+  if (offset < start) {
+    return 0;
+  }
+  if (!utf16) {
+    return offset - start;
+  }
+
+  size_t units = 0;
+  for (size_t at = start; at < offset && at < doc->length;) {
+    unsigned char lead = (unsigned char)doc->text[at];
+    units += utf16_units(lead);
+    at += utf8_length(lead);
+  }
+  return units;
+}
+
+size_t document_token_start(const Document *doc, size_t index) {
+  return raw_start(doc->text, &doc->tokens[index]);
+}
+
+size_t document_token_at(const Document *doc, size_t offset) {
+  size_t lo = 0, hi = doc->token_count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (document_token_start(doc, mid) <= offset) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo > 0 ? lo - 1 : doc->token_count;
+}
+
+static size_t body_first(const Document *doc, const AstNode *function) {
+  return (size_t)((const Token *)function->stmt.func_decl.deferred->tokens -
+                  doc->tokens);
+}
+
+AstNode *document_function_at(const Document *doc, size_t index) {
+  if (!doc->module) {
+    return NULL;
+  }
+  for (size_t i = 0; i < doc->module->preprocessor.module.body_count; i++) {
+    AstNode *stmt = doc->module->preprocessor.module.body[i];
+    if (!stmt || stmt->type != AST_STMT_FUNCTION ||
+        !stmt->stmt.func_decl.deferred) {
+      continue;
+    }
+    size_t first = body_first(doc, stmt);
+    if (index >= first &&
+        index < first + stmt->stmt.func_decl.deferred->token_count) {
+      return stmt;
+    }
+  }
+  return NULL;
+}
+
+FunctionCheck *document_check_of(Document *doc, const AstNode *function) {
+  FunctionCheck *checks = (FunctionCheck *)doc->checks.data;
+  for (size_t i = 0; i < doc->checks.count; i++) {
+    if (checks[i].function == function) {
+      return &checks[i];
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief What range re-lexing changed, in old token indices.
+ */
+typedef struct {
+  size_t head;       /**< Old tokens [0, head) are kept in place */
+  size_t tail;       /**< Old tokens [tail, count) are kept, shifted */
+  size_t added;      /**< New tokens between the two */
+  ptrdiff_t shift;   /**< Byte offset change of the tail */
+  ptrdiff_t lines;   /**< Line number change of the tail */
+  int tail_line;     /**< Old 1-based line of the end of the edit */
+  ptrdiff_t columns; /**< Column change of tail tokens on @c tail_line */
+} Splice;
+
+// Brace-matches the body that starts at new token @p first and checks it
+// closes exactly at @p last
+static bool body_closes_at(const Document *doc, size_t first, size_t last) {
+  if (first >= doc->token_count || doc->tokens[first].type_ != TOK_LBRACE) {
+    return false;
+  }
+  size_t depth = 0;
+  for (size_t i = first; i < doc->token_count; i++) {
+    TokenType type = doc->tokens[i].type_;
+    if (type == TOK_LBRACE) {
+      depth++;
+    } else if (type == TOK_RBRACE && --depth == 0) {
+      return i == last;
+    }
+  }
+  return false;
+}
+
+static bool after_edit(const AstNode *node, const Splice *splice,
+                       size_t tail_column) {
+  return node->line > (size_t)splice->tail_line ||
+         (node->line == (size_t)splice->tail_line &&
+          node->column >= tail_column);
+}
+
+// Keeps the AST when the tokens that changed sit inside one body, or when
+// no token changed at all (whitespace and comments). Every body's token
+// range is moved into the new token array.
+static bool keep_ast(Document *doc, const Token *old_tokens,
+                     const Splice *splice, size_t tail_column,
+                     AstNode **edited) {
+  *edited = NULL;
+  if (!doc->module) {
+    return false;
+  }
+
+  ptrdiff_t token_shift =
+      (ptrdiff_t)splice->added - (ptrdiff_t)(splice->tail - splice->head);
+  bool tokens_changed = splice->added > 0 || splice->tail > splice->head;
+  AstNode **body = doc->module->preprocessor.module.body;
+  size_t body_count = doc->module->preprocessor.module.body_count;
+
+  if (tokens_changed) {
+    for (size_t i = 0; i < body_count; i++) {
+      AstNode *stmt = body[i];
+      if (!stmt || stmt->type != AST_STMT_FUNCTION ||
+          !stmt->stmt.func_decl.deferred) {
+        continue;
+      }
+      const DeferredBody *deferred = stmt->stmt.func_decl.deferred;
+      size_t first = (size_t)((const Token *)deferred->tokens - old_tokens);
+      size_t last = first + deferred->token_count - 1;
+      if (first < splice->head && last >= splice->tail &&
+          body_closes_at(doc, first, (size_t)((ptrdiff_t)last + token_shift))) {
+        *edited = stmt;
+        break;
+      }
+    }
+    if (!*edited) {
+      return false;
+    }
+  }
+
+  // Checks were made in body order, one per skimmed function
+  FunctionCheck *checks = (FunctionCheck *)doc->checks.data;
+  size_t next_check = 0;
+  for (size_t i = 0; i < body_count; i++) {
+    AstNode *stmt = body[i];
+    if (!stmt) {
+      continue;
+    }
+    bool moved = after_edit(stmt, splice, tail_column);
+    if (moved) {
+      stmt->line = (size_t)((ptrdiff_t)stmt->line + splice->lines);
+      if (stmt->line == (size_t)(splice->tail_line + splice->lines)) {
+        stmt->column = (size_t)((ptrdiff_t)stmt->column + splice->columns);
+      }
+    }
+    if (stmt->type != AST_STMT_FUNCTION || !stmt->stmt.func_decl.deferred) {
+      continue;
+    }
+
+    DeferredBody *deferred = stmt->stmt.func_decl.deferred;
+    size_t first = (size_t)((const Token *)deferred->tokens - old_tokens);
+    if (first >= splice->tail) {
+      first = (size_t)((ptrdiff_t)first + token_shift);
+    }
+    deferred->tokens = &doc->tokens[first];
+    deferred->source = doc->token_count > 0 ? doc->tokens[0].value : doc->text;
+
+    FunctionCheck *check = next_check < doc->checks.count &&
+                                   checks[next_check].function == stmt
+                               ? &checks[next_check++]
+                               : document_check_of(doc, stmt);
+    if (stmt == *edited) {
+      deferred->token_count =
+          (size_t)((ptrdiff_t)deferred->token_count + token_shift);
+      stmt->stmt.func_decl.body = NULL;
+      if (check) {
+        check->stale = true;
+      }
+    } else if (moved && splice->lines != 0) {
+      // A parsed body carries the old line numbers; parse it again on demand
+      stmt->stmt.func_decl.body = NULL;
+      if (check && check->error) {
+        check->error->line =
+            (size_t)((ptrdiff_t)check->error->line + splice->lines);
+      }
+    }
+  }
+
+  Diagnostic *syntax = (Diagnostic *)doc->syntax.data;
+  for (size_t i = 0; i < doc->syntax.count; i++) {
+    if (syntax[i].line + 1 > (size_t)splice->tail_line) {
+      syntax[i].line = (size_t)((ptrdiff_t)syntax[i].line + splice->lines);
+    }
+  }
+  return true;
+}
+
+bool document_apply(Document *doc, const DocumentChange *change, bool utf16,
+                    AstNode **edited) {
+  *edited = NULL;
+  if (change->whole) {
+    if (!reparse_all(doc, change->text, change->length)) {
+      out_of_memory(doc);
+    }
+    return true;
+  }
+
+  size_t start = document_offset(doc, change->start_line, change->start_char,
+                                 utf16);
+  size_t end = document_offset(doc, change->end_line, change->end_char, utf16);
+  if (end < start) {
+    end = start;
+  }
+
+  const char *old_text = doc->text;
+  const Token *old_tokens = doc->tokens;
+  const size_t *old_ends = doc->token_ends;
+  size_t old_count = doc->token_count;
+  size_t old_end_line = document_line_of(doc, end);
+  size_t old_end_column = end - doc->line_starts[old_end_line];
+  size_t old_line_count = doc->line_count;
+
+  // New text into the other generation
+  int next = 1 - doc->generation;
+  Generation *gen = &doc->generations[next];
+  size_t length = doc->length - (end - start) + change->length;
+  char *text = reserve_text(gen, length);
+  TokenBuilder b;
+  if (!text || !builder_init(&b, gen, old_count + change->length / 2)) {
+    out_of_memory(doc);
+  }
+  memcpy(text, old_text, start);
+  memcpy(text + start, change->text, change->length);
+  memcpy(text + start + change->length, old_text + end, doc->length - end);
+  text[length] = '\0';
+  ptrdiff_t shift = (ptrdiff_t)change->length - (ptrdiff_t)(end - start);
+
+  // Tokens ending before the edit are untouched; the end of the last one is
+  // a safe place to restart the lexer
+  size_t head = 0;
+  while (head < old_count && old_ends[head] < start) {
+    head++;
+  }
+  if (!builder_copy(&b, old_tokens, old_ends, head, old_text, text, 0)) {
+    out_of_memory(doc);
+  }
+
+  Document next_doc = *doc;
+  next_doc.text = text;
+  next_doc.length = length;
+  if (!build_line_table(&next_doc, gen)) {
+    out_of_memory(doc);
+  }
+
+  size_t restart = head > 0 ? old_ends[head - 1] : 0;
+  size_t restart_line = document_line_of(&next_doc, restart);
+  arena_reset(&doc->lex_arena);
+  Lexer lexer;
+  init_lexer(&lexer, text, &doc->lex_arena);
+  lexer.current = text + restart;
+  lexer.line = (int)restart_line + 1;
+  lexer.col = (int)(restart - next_doc.line_starts[restart_line]);
+
+  // Lex until a new token past the edit lines up with a shifted old one
+  int errors_before = error_count_get();
+  size_t edit_end = start + change->length;
+  size_t candidate = head;
+  size_t tail = old_count;
+  Token resync = {0};
+  bool synced = false;
+  Token token;
+  while ((token = next_token(&lexer)).type_ != TOK_EOF) {
+    size_t token_start = raw_start(text, &token);
+    size_t token_end = (size_t)(lexer.current - text);
+    if (token_start >= edit_end) {
+      while (candidate < old_count &&
+             (ptrdiff_t)raw_start(old_text, &old_tokens[candidate]) + shift <
+                 (ptrdiff_t)token_start) {
+        candidate++;
+      }
+      if (candidate < old_count &&
+          (ptrdiff_t)raw_start(old_text, &old_tokens[candidate]) + shift ==
+              (ptrdiff_t)token_start &&
+          (ptrdiff_t)old_ends[candidate] + shift == (ptrdiff_t)token_end &&
+          old_tokens[candidate].type_ == token.type_ &&
+          old_tokens[candidate].length == token.length) {
+        tail = candidate;
+        resync = token;
+        synced = true;
+        break;
+      }
+    }
+    if (!builder_push(&b, token, token_end)) {
+      out_of_memory(doc);
+    }
+  }
+  size_t added = b.count - head;
+
+  // Lexer errors are only collected by a full pass, which also drops stale
+  // ones; they are rare enough not to bother keeping them in place
+  if (error_count_get() > errors_before || doc->lex_errors) {
+    char *copy = malloc(length + 1);
+    if (!copy) {
+      out_of_memory(doc);
+    }
+    memcpy(copy, text, length + 1);
+    bool ok = reparse_all(doc, copy, length);
+    free(copy);
+    if (!ok) {
+      out_of_memory(doc);
+    }
+    return true;
+  }
+
+  Splice splice = {
+      .head = head,
+      .tail = tail,
+      .added = added,
+      .shift = shift,
+      .lines = (ptrdiff_t)next_doc.line_count - (ptrdiff_t)old_line_count,
+      .tail_line = (int)old_end_line + 1,
+  };
+  size_t new_end_line = document_line_of(&next_doc, edit_end);
+  splice.columns = (ptrdiff_t)(edit_end - next_doc.line_starts[new_end_line]) -
+                   (ptrdiff_t)old_end_column;
+
+  size_t first_moved = b.count;
+  if (!builder_copy(&b, old_tokens + tail, old_ends + tail, old_count - tail,
+                    old_text, text, shift)) {
+    out_of_memory(doc);
+  }
+  for (size_t i = first_moved; i < b.count; i++) {
+    Token *moved = &gen->tokens[i];
+    if (moved->line == splice.tail_line) {
+      moved->col = (int)(moved->col + splice.columns);
+    }
+    moved->line = (int)(moved->line + splice.lines);
+  }
+  if (synced) {
+    gen->tokens[first_moved].whitespace_len = resync.whitespace_len;
+  }
+
+  doc->text = text;
+  doc->length = length;
+  doc->line_starts = next_doc.line_starts;
+  doc->line_count = next_doc.line_count;
+  doc->generation = next;
+  install_tokens(doc, &b);
+
+  if (keep_ast(doc, old_tokens, &splice, old_end_column, edited)) {
+    return false;
+  }
+  error_clear();
+  if (!parse_document(doc)) {
+    out_of_memory(doc);
+  }
+  return true;
+}
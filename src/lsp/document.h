@@ -0,0 +1,171 @@
+/**
+ * @file document.h
+ * @brief Source files held in memory by the language server.
+ *
+ * A Document keeps its text, tokens and a skimmed module AST (function bodies
+ * left as tokens, see parse_deferred_body()). An edit is applied by re-lexing
+ * only the tokens around the changed range:
+ *
+ * - lexing restarts at the end of the last token before the edit
+ * - it stops at the first new token past the edit that lines up with an old
+ *   token, since everything from there on lexes the same as before
+ * - the tokens on either side are kept, shifted to their new offsets
+ *
+ * If the changed tokens lie strictly inside one function body whose braces
+ * still match up, the AST is kept and only that body's token range changes.
+ * Any other edit parses the module again, which is cheap in skim mode.
+ *
+ * Text, tokens and line table live in one of two generations that take
+ * turns, so an edit builds the new version while the old one is still
+ * readable.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "../ast/ast.h"
+#include "../c_libs/memory/memory.h"
+#include "../lexer/lexer.h"
+
+/**
+ * @brief A problem found in a document, in byte columns.
+ */
+typedef struct {
+  size_t line;         /**< 0-based line */
+  size_t start;        /**< First byte on the line */
+  size_t end;          /**< One past the last byte on the line */
+  const char *message; /**< Text shown to the user */
+} Diagnostic;
+
+/**
+ * @brief Result of the last body check of one function.
+ */
+typedef struct {
+  AstNode *function; /**< Top-level function with a skimmed body */
+  bool stale;        /**< Needs checking against the current index */
+  Diagnostic *error; /**< First problem found, NULL if it checked cleanly */
+} FunctionCheck;
+
+/**
+ * @brief Buffers holding one version of a document's text and tokens.
+ *
+ * They are malloc'd and only ever grow, so an edit reuses the memory of the
+ * version before last; a large file is edited without fresh allocations.
+ */
+typedef struct {
+  char *text;            /**< Text buffer */
+  size_t text_capacity;  /**< Bytes allocated for @c text */
+  Token *tokens;         /**< Token buffer */
+  size_t *token_ends;    /**< Token end buffer */
+  size_t token_capacity; /**< Entries allocated for both token buffers */
+  size_t *line_starts;   /**< Line table buffer */
+  size_t line_capacity;  /**< Entries allocated for @c line_starts */
+} Generation;
+
+/**
+ * @brief One source file and everything derived from it.
+ */
+typedef struct {
+  char *uri;   /**< Identifier used by the editor, malloc'd */
+  char *path;  /**< File system path, malloc'd */
+  bool open;   /**< Text comes from the editor rather than the disk */
+  long version; /**< Editor version of the text */
+
+  Generation generations[2];     /**< Current and previous version */
+  int generation;                /**< Generation holding the current text */
+  ArenaAllocator lex_arena;      /**< Lexer error context; reset per lex */
+  const char *text;              /**< NUL-terminated contents */
+  size_t length;                 /**< Bytes of @c text */
+  Token *tokens;                 /**< Tokens, without TOK_EOF */
+  size_t *token_ends;            /**< Byte offset just past each token */
+  size_t token_count;            /**< Number of tokens */
+  size_t *line_starts;           /**< Byte offset of every line */
+  size_t line_count;             /**< Number of lines */
+  bool lex_errors;               /**< The last full lex reported errors */
+
+  ArenaAllocator ast_arena; /**< AST, parsed bodies and diagnostics */
+  AstNode *module;          /**< Skimmed module, NULL without `@module` */
+  GrowableArray syntax;     /**< Diagnostic from lexing and parsing */
+  GrowableArray checks;     /**< FunctionCheck per skimmed function */
+} Document;
+
+/**
+ * @brief One text change sent by the editor.
+ *
+ * Positions are 0-based lines and characters in the negotiated encoding.
+ */
+typedef struct {
+  bool whole;          /**< Replace the whole text; the range is unused */
+  size_t start_line;   /**< Start of the replaced range */
+  size_t start_char;   /**< Start of the replaced range */
+  size_t end_line;     /**< End of the replaced range */
+  size_t end_char;     /**< End of the replaced range */
+  const char *text;    /**< Replacement text */
+  size_t length;       /**< Bytes of @p text */
+} DocumentChange;
+
+/**
+ * @brief Creates a document from its full text and parses it.
+ * @return NULL if out of memory.
+ */
+Document *document_create(const char *uri, const char *path, const char *text,
+                          size_t length);
+
+/**
+ * @brief Frees a document and everything it owns.
+ */
+void document_destroy(Document *doc);
+
+/**
+ * @brief Applies one change.
+ *
+ * @param doc Document to edit.
+ * @param change The change.
+ * @param utf16 Characters in @p change count UTF-16 code units, not bytes.
+ * @param[out] edited Function whose body alone changed, or NULL.
+ * @return true if the module was parsed again; every AST pointer into the
+ *         document is then invalid.
+ */
+bool document_apply(Document *doc, const DocumentChange *change, bool utf16,
+                    AstNode **edited);
+
+/**
+ * @brief Byte offset of a line and character, clamped to the text.
+ */
+size_t document_offset(const Document *doc, size_t line, size_t character,
+                       bool utf16);
+
+/**
+ * @brief Character within its line of a byte offset on line @p line.
+ */
+size_t document_character(const Document *doc, size_t line, size_t offset,
+                          bool utf16);
+
+/**
+ * @brief 0-based line containing a byte offset.
+ */
+size_t document_line_of(const Document *doc, size_t offset);
+
+/**
+ * @brief Index of the last token starting at or before @p offset.
+ * @return doc->token_count if no token starts that early.
+ */
+size_t document_token_at(const Document *doc, size_t offset);
+
+/**
+ * @brief Byte offset where a token starts; strings start at their quote.
+ */
+size_t document_token_start(const Document *doc, size_t index);
+
+/**
+ * @brief Top-level function whose body contains token @p index.
+ * @return The function, or NULL if the token is outside every body.
+ */
+AstNode *document_function_at(const Document *doc, size_t index);
+
+/**
+ * @brief Finds the FunctionCheck of a top-level function.
+ */
+FunctionCheck *document_check_of(Document *doc, const AstNode *function);
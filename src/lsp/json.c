@@ -0,0 +1,477 @@
+/**
+ * @file json.c
+ * @brief JSON parsing and output for the language server.
+ *
+ * @see json.h
+ */
+
+#include "json.h"
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Nesting limit; LSP messages are shallow */
+#define JSON_MAX_DEPTH 64
+
+typedef struct {
+  const char *at;
+  const char *end;
+  ArenaAllocator *arena;
+  int depth;
+} JsonReader;
+
+static JsonValue *parse_value(JsonReader *r);
+
+static void skip_space(JsonReader *r) {
+  while (r->at < r->end && (*r->at == ' ' || *r->at == '\t' ||
+                            *r->at == '\n' || *r->at == '\r')) {
+    r->at++;
+  }
+}
+
+static bool match_word(JsonReader *r, const char *word) {
+  size_t length = strlen(word);
+  if ((size_t)(r->end - r->at) < length || memcmp(r->at, word, length) != 0) {
+    return false;
+  }
+  r->at += length;
+  return true;
+}
+
+static JsonValue *new_value(JsonReader *r, JsonType type) {
+  JsonValue *value =
+      arena_alloc(r->arena, sizeof(JsonValue), alignof(JsonValue));
+  if (value) {
+    memset(value, 0, sizeof(*value));
+    value->type = type;
+  }
+  return value;
+}
+
+static int hex_digit(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+static bool read_hex4(JsonReader *r, uint32_t *out) {
+  if (r->end - r->at < 4) {
+    return false;
+  }
+  uint32_t code = 0;
+  for (int i = 0; i < 4; i++) {
+    int digit = hex_digit(r->at[i]);
+    if (digit < 0) {
+      return false;
+    }
+    code = code * 16 + (uint32_t)digit;
+  }
+  r->at += 4;
+  *out = code;
+  return true;
+}
+
+static size_t encode_utf8(uint32_t code, char *out) {
+  if (code < 0x80) {
+    out[0] = (char)code;
+    return 1;
+  }
+  if (code < 0x800) {
+    out[0] = (char)(0xC0 | (code >> 6));
+    out[1] = (char)(0x80 | (code & 0x3F));
+    return 2;
+  }
+  if (code < 0x10000) {
+    out[0] = (char)(0xE0 | (code >> 12));
+    out[1] = (char)(0x80 | ((code >> 6) & 0x3F));
+    out[2] = (char)(0x80 | (code & 0x3F));
+    return 3;
+  }
+  out[0] = (char)(0xF0 | (code >> 18));
+  out[1] = (char)(0x80 | ((code >> 12) & 0x3F));
+  out[2] = (char)(0x80 | ((code >> 6) & 0x3F));
+  out[3] = (char)(0x80 | (code & 0x3F));
+  return 4;
+}
+
+// Decoding never grows a string, so the raw length bounds the output
+static JsonValue *parse_string(JsonReader *r) {
+  const char *start = ++r->at;
+  const char *scan = start;
+  while (scan < r->end && *scan != '"') {
+    scan += *scan == '\\' ? 2 : 1;
+  }
+  if (scan >= r->end) {
+    return NULL;
+  }
+
+  JsonValue *value = new_value(r, JSON_STRING);
+  char *out = arena_alloc(r->arena, (size_t)(scan - start) + 1, alignof(char));
+  if (!value || !out) {
+    return NULL;
+  }
+
+  size_t n = 0;
+  while (*r->at != '"') {
+    char c = *r->at++;
+    if ((unsigned char)c < 0x20) {
+      return NULL;
+    }
+    if (c != '\\') {
+      out[n++] = c;
+      continue;
+    }
+
+    c = *r->at++;
+    switch (c) {
+    case '"':
+    case '\\':
+    case '/':
+      out[n++] = c;
+      break;
+    case 'b':
+      out[n++] = '\b';
+      break;
+    case 'f':
+      out[n++] = '\f';
+      break;
+    case 'n':
+      out[n++] = '\n';
+      break;
+    case 'r':
+      out[n++] = '\r';
+      break;
+    case 't':
+      out[n++] = '\t';
+      break;
+    case 'u': {
+      uint32_t code;
+      if (!read_hex4(r, &code)) {
+        return NULL;
+      }
+      // A surrogate pair is twelve escaped bytes for a four byte character
+      if (code >= 0xD800 && code < 0xDC00 && r->end - r->at >= 6 &&
+          r->at[0] == '\\' && r->at[1] == 'u') {
+        r->at += 2;
+        uint32_t low;
+        if (!read_hex4(r, &low) || low < 0xDC00 || low > 0xDFFF) {
+          return NULL;
+        }
+        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+      }
+      n += encode_utf8(code, out + n);
+      break;
+    }
+    default:
+      return NULL;
+    }
+  }
+  r->at++; // closing quote
+  out[n] = '\0';
+  value->as.string.chars = out;
+  value->as.string.length = n;
+  return value;
+}
+
+static JsonValue *parse_number(JsonReader *r) {
+  char buffer[64];
+  size_t length = 0;
+  while (r->at < r->end && length < sizeof(buffer) - 1 &&
+         strchr("+-0123456789.eE", *r->at)) {
+    buffer[length++] = *r->at++;
+  }
+  buffer[length] = '\0';
+
+  char *end;
+  double number = strtod(buffer, &end);
+  if (length == 0 || *end != '\0') {
+    return NULL;
+  }
+  JsonValue *value = new_value(r, JSON_NUMBER);
+  if (value) {
+    value->as.number = number;
+  }
+  return value;
+}
+
+// Items are collected in a growable array first since counts are unknown
+static JsonValue *parse_list(JsonReader *r, bool object) {
+  char close = object ? '}' : ']';
+  r->at++;
+
+  GrowableArray items, keys;
+  if (!growable_array_init(&items, r->arena, 8, sizeof(JsonValue *)) ||
+      (object &&
+       !growable_array_init(&keys, r->arena, 8, sizeof(const char *)))) {
+    return NULL;
+  }
+
+  skip_space(r);
+  if (r->at < r->end && *r->at == close) {
+    r->at++;
+  } else {
+    for (;;) {
+      skip_space(r);
+      if (object) {
+        if (r->at >= r->end || *r->at != '"') {
+          return NULL;
+        }
+        JsonValue *key = parse_string(r);
+        const char **key_slot = (const char **)growable_array_push(&keys);
+        if (!key || !key_slot) {
+          return NULL;
+        }
+        *key_slot = key->as.string.chars;
+
+        skip_space(r);
+        if (r->at >= r->end || *r->at != ':') {
+          return NULL;
+        }
+        r->at++;
+      }
+
+      JsonValue *item = parse_value(r);
+      JsonValue **slot = (JsonValue **)growable_array_push(&items);
+      if (!item || !slot) {
+        return NULL;
+      }
+      *slot = item;
+
+      skip_space(r);
+      if (r->at < r->end && *r->at == ',') {
+        r->at++;
+        continue;
+      }
+      if (r->at < r->end && *r->at == close) {
+        r->at++;
+        break;
+      }
+      return NULL;
+    }
+  }
+
+  JsonValue *value = new_value(r, object ? JSON_OBJECT : JSON_ARRAY);
+  if (value) {
+    value->as.list.items = (JsonValue **)items.data;
+    value->as.list.keys = object ? (const char **)keys.data : NULL;
+    value->as.list.count = items.count;
+  }
+  return value;
+}
+
+static JsonValue *parse_value(JsonReader *r) {
+  skip_space(r);
+  if (r->at >= r->end || r->depth >= JSON_MAX_DEPTH) {
+    return NULL;
+  }
+
+  JsonValue *value = NULL;
+  r->depth++;
+  switch (*r->at) {
+  case '{':
+    value = parse_list(r, true);
+    break;
+  case '[':
+    value = parse_list(r, false);
+    break;
+  case '"':
+    value = parse_string(r);
+    break;
+  case 't':
+  case 'f': {
+    bool truth = *r->at == 't';
+    if (match_word(r, truth ? "true" : "false")) {
+      value = new_value(r, JSON_BOOL);
+      if (value) {
+        value->as.boolean = truth;
+      }
+    }
+    break;
+  }
+  case 'n':
+    if (match_word(r, "null")) {
+      value = new_value(r, JSON_NULL);
+    }
+    break;
+  default:
+    value = parse_number(r);
+    break;
+  }
+  r->depth--;
+  return value;
+}
+
+JsonValue *json_parse(const char *text, size_t length, ArenaAllocator *arena) {
+  JsonReader reader = {text, text + length, arena, 0};
+  JsonValue *value = parse_value(&reader);
+  skip_space(&reader);
+  return reader.at == reader.end ? value : NULL;
+}
+
+const JsonValue *json_path(const JsonValue *value, const char *path) {
+  while (value && *path) {
+    const char *dot = strchr(path, '.');
+    size_t length = dot ? (size_t)(dot - path) : strlen(path);
+    if (value->type != JSON_OBJECT) {
+      return NULL;
+    }
+
+    const JsonValue *found = NULL;
+    for (size_t i = 0; i < value->as.list.count; i++) {
+      const char *key = value->as.list.keys[i];
+      if (strncmp(key, path, length) == 0 && key[length] == '\0') {
+        found = value->as.list.items[i];
+        break;
+      }
+    }
+    value = found;
+    path += length + (dot ? 1 : 0);
+  }
+  return value;
+}
+
+const char *json_string(const JsonValue *value) {
+  return value && value->type == JSON_STRING ? value->as.string.chars : NULL;
+}
+
+bool json_int(const JsonValue *value, long *out) {
+  if (!value || value->type != JSON_NUMBER) {
+    return false;
+  }
+  *out = (long)value->as.number;
+  return true;
+}
+
+static void reserve(JsonBuffer *buffer, size_t extra) {
+  if (buffer->length + extra + 1 <= buffer->capacity) {
+    return;
+  }
+  size_t capacity = buffer->capacity ? buffer->capacity : 256;
+  while (capacity < buffer->length + extra + 1) {
+    capacity *= 2;
+  }
+  char *data = realloc(buffer->data, capacity);
+  if (!data) {
+    fprintf(stderr, "Out of memory while writing a JSON message\n");
+    abort();
+  }
+  buffer->data = data;
+  buffer->capacity = capacity;
+}
+
+void json_buffer_clear(JsonBuffer *buffer) {
+  buffer->length = 0;
+  if (buffer->data) {
+    buffer->data[0] = '\0';
+  }
+}
+
+void json_buffer_free(JsonBuffer *buffer) {
+  free(buffer->data);
+  *buffer = (JsonBuffer){0};
+}
+
+void json_append(JsonBuffer *buffer, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  va_list copy;
+  va_copy(copy, args);
+  int needed = vsnprintf(NULL, 0, format, copy);
+  va_end(copy);
+
+  if (needed > 0) {
+    reserve(buffer, (size_t)needed);
+    vsnprintf(buffer->data + buffer->length, (size_t)needed + 1, format, args);
+    buffer->length += (size_t)needed;
+  }
+  va_end(args);
+}
+
+void json_append_string(JsonBuffer *buffer, const char *chars, size_t length) {
+  // Worst case every byte becomes a six byte \u escape
+  reserve(buffer, length * 6 + 2);
+  char *out = buffer->data + buffer->length;
+  *out++ = '"';
+  for (size_t i = 0; i < length; i++) {
+    unsigned char c = (unsigned char)chars[i];
+    switch (c) {
+    case '"':
+      *out++ = '\\';
+      *out++ = '"';
+      break;
+    case '\\':
+      *out++ = '\\';
+      *out++ = '\\';
+      break;
+    case '\n':
+      *out++ = '\\';
+      *out++ = 'n';
+      break;
+    case '\r':
+      *out++ = '\\';
+      *out++ = 'r';
+      break;
+    case '\t':
+      *out++ = '\\';
+      *out++ = 't';
+      break;
+    default:
+      if (c < 0x20) {
+        out += sprintf(out, "\\u%04x", c);
+      } else {
+        *out++ = (char)c;
+      }
+    }
+  }
+  *out++ = '"';
+  *out = '\0';
+  buffer->length = (size_t)(out - buffer->data);
+}
+
+void json_append_value(JsonBuffer *buffer, const JsonValue *value) {
+  if (!value) {
+    json_append(buffer, "null");
+    return;
+  }
+
+  switch (value->type) {
+  case JSON_NULL:
+    json_append(buffer, "null");
+    break;
+  case JSON_BOOL:
+    json_append(buffer, value->as.boolean ? "true" : "false");
+    break;
+  case JSON_NUMBER:
+    json_append(buffer, "%.17g", value->as.number);
+    break;
+  case JSON_STRING:
+    json_append_string(buffer, value->as.string.chars,
+                       value->as.string.length);
+    break;
+  case JSON_ARRAY:
+  case JSON_OBJECT: {
+    bool object = value->type == JSON_OBJECT;
+    json_append(buffer, object ? "{" : "[");
+    for (size_t i = 0; i < value->as.list.count; i++) {
+      if (i > 0) {
+        json_append(buffer, ",");
+      }
+      if (object) {
+        const char *key = value->as.list.keys[i];
+        json_append_string(buffer, key, strlen(key));
+        json_append(buffer, ":");
+      }
+      json_append_value(buffer, value->as.list.items[i]);
+    }
+    json_append(buffer, object ? "}" : "]");
+    break;
+  }
+  }
+}
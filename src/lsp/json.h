@@ -0,0 +1,98 @@
+/**
+ * @file json.h
+ * @brief Minimal JSON reader and writer for the language server.
+ *
+ * Messages are parsed into a tree of JsonValue allocated from an arena, so a
+ * whole request is released at once by resetting that arena. Output is built
+ * in a JsonBuffer, a growable string with helpers for escaping.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "../c_libs/memory/memory.h"
+
+/**
+ * @brief Kind of a JSON value.
+ */
+typedef enum {
+  JSON_NULL,
+  JSON_BOOL,
+  JSON_NUMBER,
+  JSON_STRING,
+  JSON_ARRAY,
+  JSON_OBJECT
+} JsonType;
+
+typedef struct JsonValue JsonValue;
+
+/**
+ * @brief One parsed JSON value.
+ *
+ * Arrays and objects share `list`; `keys` is NULL for arrays. Strings are
+ * decoded to UTF-8 and NUL terminated.
+ */
+struct JsonValue {
+  JsonType type;
+  union {
+    bool boolean;
+    double number;
+    struct {
+      const char *chars;
+      size_t length;
+    } string;
+    struct {
+      JsonValue **items;
+      const char **keys;
+      size_t count;
+    } list;
+  } as;
+};
+
+/**
+ * @brief Parses a complete JSON document.
+ * @return The root value, or NULL if @p text is not valid JSON.
+ */
+JsonValue *json_parse(const char *text, size_t length, ArenaAllocator *arena);
+
+/**
+ * @brief Follows a dotted path of object keys, e.g. "params.position.line".
+ * @return The value, or NULL if any key along the path is missing.
+ */
+const JsonValue *json_path(const JsonValue *value, const char *path);
+
+/** @return The string's characters, or NULL if @p value is not a string. */
+const char *json_string(const JsonValue *value);
+
+/**
+ * @brief Reads an integral number.
+ * @return false if @p value is not a number.
+ */
+bool json_int(const JsonValue *value, long *out);
+
+/**
+ * @brief Growable output string.
+ */
+typedef struct {
+  char *data;      /**< NUL-terminated contents, malloc'd */
+  size_t length;   /**< Bytes used, without the terminator */
+  size_t capacity; /**< Bytes allocated */
+} JsonBuffer;
+
+/** @brief Empties the buffer, keeping its memory. */
+void json_buffer_clear(JsonBuffer *buffer);
+
+/** @brief Frees the buffer's memory. */
+void json_buffer_free(JsonBuffer *buffer);
+
+/** @brief Appends printf-formatted text verbatim. */
+void json_append(JsonBuffer *buffer, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+/** @brief Appends @p length bytes as a quoted, escaped JSON string. */
+void json_append_string(JsonBuffer *buffer, const char *chars, size_t length);
+
+/** @brief Appends a value parsed by json_parse() back as JSON text. */
+void json_append_value(JsonBuffer *buffer, const JsonValue *value);
@@ -0,0 +1,533 @@
+/**
+ * @file lsp.c
+ * @brief JSON-RPC loop of `luma lsp`.
+ *
+ * Messages are read from stdin with their Content-Length framing and
+ * answered on the original stdout. Anything else the compiler prints while
+ * serving would corrupt that stream, so file descriptor 1 is pointed at
+ * stderr for the whole session.
+ *
+ * Body checks run between messages, one function at a time, and only while
+ * no input is waiting; diagnostics of a document are published once all its
+ * checks are done, so the editor never sees a half-checked file.
+ *
+ * @see lsp.h
+ */
+
+#include "lsp.h"
+
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include "json.h"
+#include "workspace.h"
+
+/** Bytes read from stdin at a time */
+#define READ_CHUNK 65536
+
+/** JSON-RPC error code for an unknown method */
+#define METHOD_NOT_FOUND -32601
+
+/**
+ * @brief State of one session.
+ */
+typedef struct {
+  FILE *out;            /**< Protocol output, the original stdout */
+  char *input;          /**< Bytes read but not yet handled, malloc'd */
+  size_t input_length;  /**< Bytes in @c input */
+  size_t input_size;    /**< Bytes allocated for @c input */
+  size_t consumed;      /**< Bytes of the message being handled */
+  bool utf16;           /**< Positions count UTF-16 code units */
+  bool shut_down;       /**< A shutdown request was answered */
+  bool exited;          /**< The exit notification arrived */
+  Workspace ws;         /**< Documents and index */
+  GrowableArray dirty;  /**< Document * whose diagnostics are outdated */
+  ArenaAllocator arena; /**< Parsed message; reset per message */
+  JsonBuffer reply;     /**< Message being written */
+} Server;
+
+// ---------------------------------------------------------------------------
+// Framing
+// ---------------------------------------------------------------------------
+
+static void send_message(Server *server) {
+  fprintf(server->out, "Content-Length: %zu\r\n\r\n%s", server->reply.length,
+          server->reply.data);
+  fflush(server->out);
+  json_buffer_clear(&server->reply);
+}
+
+// Finds a complete message among the bytes read so far
+static bool buffered_message(Server *server, const char **body,
+                             size_t *length) {
+  char *input = server->input;
+  size_t header_end = 0;
+  for (size_t i = 0; i + 3 < server->input_length; i++) {
+    if (memcmp(input + i, "\r\n\r\n", 4) == 0) {
+      header_end = i + 4;
+      break;
+    }
+  }
+  if (header_end == 0) {
+    return false;
+  }
+
+  size_t content_length = 0;
+  for (size_t i = 0; i < header_end;) {
+    const char *name = "Content-Length:";
+    if (strncasecmp(input + i, name, strlen(name)) == 0) {
+      content_length = strtoul(input + i + strlen(name), NULL, 10);
+    }
+    const char *next = memchr(input + i, '\n', header_end - i);
+    i = next ? (size_t)(next - input) + 1 : header_end;
+  }
+  if (server->input_length - header_end < content_length) {
+    return false;
+  }
+
+  *body = input + header_end;
+  *length = content_length;
+  server->consumed = header_end + content_length;
+  return true;
+}
+
+static bool input_waiting(Server *server) {
+  const char *body;
+  size_t length;
+  if (buffered_message(server, &body, &length)) {
+    return true;
+  }
+  struct pollfd fd = {STDIN_FILENO, POLLIN, 0};
+  return poll(&fd, 1, 0) > 0;
+}
+
+// Forgets the message just handled, keeping whatever followed it
+static void drop_message(Server *server) {
+  memmove(server->input, server->input + server->consumed,
+          server->input_length - server->consumed);
+  server->input_length -= server->consumed;
+  server->consumed = 0;
+}
+
+// Blocks until a whole message is buffered; false once stdin is closed
+static bool read_message(Server *server, const char **body, size_t *length) {
+  while (!buffered_message(server, body, length)) {
+    if (server->input_size - server->input_length < READ_CHUNK) {
+      size_t size = server->input_size * 2 + READ_CHUNK;
+      char *grown = realloc(server->input, size);
+      if (!grown) {
+        fprintf(stderr, "lsp: out of memory reading a message\n");
+        return false;
+      }
+      server->input = grown;
+      server->input_size = size;
+    }
+    ssize_t got = read(STDIN_FILENO, server->input + server->input_length,
+                       server->input_size - server->input_length);
+    if (got <= 0) {
+      return false;
+    }
+    server->input_length += (size_t)got;
+  }
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+// Output helpers
+// ---------------------------------------------------------------------------
+
+static void begin_response(Server *server, const JsonValue *id) {
+  json_append(&server->reply, "{\"jsonrpc\":\"2.0\",\"id\":");
+  json_append_value(&server->reply, id);
+  json_append(&server->reply, ",\"result\":");
+}
+
+static void end_response(Server *server) {
+  json_append(&server->reply, "}");
+  send_message(server);
+}
+
+static void append_position(Server *server, const Document *doc, size_t line,
+                            size_t column) {
+  size_t offset = line < doc->line_count ? doc->line_starts[line] + column : 0;
+  json_append(&server->reply, "{\"line\":%zu,\"character\":%zu}", line,
+              document_character(doc, line, offset, server->utf16));
+}
+
+static void append_range(Server *server, const Document *doc, size_t line,
+                         size_t start, size_t end) {
+  json_append(&server->reply, "{\"start\":");
+  append_position(server, doc, line, start);
+  json_append(&server->reply, ",\"end\":");
+  append_position(server, doc, line, end);
+  json_append(&server->reply, "}");
+}
+
+static void append_cstring(Server *server, const char *text) {
+  json_append_string(&server->reply, text, strlen(text));
+}
+
+static void publish_diagnostics(Server *server, Document *doc) {
+  Diagnostic *list;
+  size_t count = workspace_diagnostics(&server->ws, doc, &list);
+
+  json_append(&server->reply, "{\"jsonrpc\":\"2.0\",\"method\":"
+                              "\"textDocument/publishDiagnostics\","
+                              "\"params\":{\"uri\":");
+  append_cstring(server, doc->uri);
+  json_append(&server->reply, ",\"version\":%ld,\"diagnostics\":[",
+              doc->version);
+  for (size_t i = 0; i < count; i++) {
+    json_append(&server->reply, "%s{\"range\":", i > 0 ? "," : "");
+    append_range(server, doc, list[i].line, list[i].start, list[i].end);
+    json_append(&server->reply,
+                ",\"severity\":1,\"source\":\"luma\",\"message\":");
+    append_cstring(server, list[i].message ? list[i].message : "error");
+    json_append(&server->reply, "}");
+  }
+  json_append(&server->reply, "]}}");
+  send_message(server);
+}
+
+static void mark_dirty(Server *server, Document *doc) {
+  Document **list = (Document **)server->dirty.data;
+  for (size_t i = 0; i < server->dirty.count; i++) {
+    if (list[i] == doc) {
+      return;
+    }
+  }
+  Document **slot = (Document **)growable_array_push(&server->dirty);
+  if (slot) {
+    *slot = doc;
+  }
+}
+
+static void forget_dirty(Server *server, Document *doc) {
+  Document **list = (Document **)server->dirty.data;
+  for (size_t i = 0; i < server->dirty.count; i++) {
+    if (list[i] == doc) {
+      list[i] = list[--server->dirty.count];
+      return;
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Requests
+// ---------------------------------------------------------------------------
+
+static Document *params_document(Server *server, const JsonValue *message) {
+  const char *uri =
+      json_string(json_path(message, "params.textDocument.uri"));
+  return uri ? workspace_find(&server->ws, uri) : NULL;
+}
+
+// Byte offset of params.position, or false without an open document
+static bool params_offset(Server *server, const JsonValue *message,
+                          Document **doc, size_t *offset) {
+  long line, character;
+  *doc = params_document(server, message);
+  if (!*doc || !json_int(json_path(message, "params.position.line"), &line) ||
+      !json_int(json_path(message, "params.position.character"),
+                &character) ||
+      line < 0 || character < 0) {
+    return false;
+  }
+  *offset = document_offset(*doc, (size_t)line, (size_t)character,
+                            server->utf16);
+  return true;
+}
+
+static void handle_initialize(Server *server, const JsonValue *message,
+                              const JsonValue *id) {
+  // UTF-8 positions spare converting every column; UTF-16 is the default
+  const JsonValue *encodings =
+      json_path(message, "params.capabilities.general.positionEncodings");
+  server->utf16 = true;
+  for (size_t i = 0; encodings && encodings->type == JSON_ARRAY &&
+                     i < encodings->as.list.count;
+       i++) {
+    const char *encoding = json_string(encodings->as.list.items[i]);
+    if (encoding && strcmp(encoding, "utf-8") == 0) {
+      server->utf16 = false;
+    }
+  }
+
+  begin_response(server, id);
+  json_append(&server->reply,
+              "{\"capabilities\":{\"positionEncoding\":\"%s\","
+              "\"textDocumentSync\":{\"openClose\":true,\"change\":2},"
+              "\"definitionProvider\":true,\"hoverProvider\":true,"
+              "\"completionProvider\":{\"triggerCharacters\":[\".\"]}},"
+              "\"serverInfo\":{\"name\":\"luma\"}}",
+              server->utf16 ? "utf-16" : "utf-8");
+  end_response(server);
+}
+
+static void handle_did_open(Server *server, const JsonValue *message) {
+  const char *uri =
+      json_string(json_path(message, "params.textDocument.uri"));
+  const JsonValue *text = json_path(message, "params.textDocument.text");
+  if (!uri || !text || text->type != JSON_STRING) {
+    return;
+  }
+
+  Document *existing = workspace_find(&server->ws, uri);
+  if (existing) {
+    forget_dirty(server, existing);
+  }
+  Document *doc = workspace_open(&server->ws, uri, text->as.string.chars,
+                                 text->as.string.length);
+  if (!doc) {
+    fprintf(stderr, "lsp: cannot open %s\n", uri);
+    return;
+  }
+  json_int(json_path(message, "params.textDocument.version"), &doc->version);
+  mark_dirty(server, doc);
+}
+
+static bool read_change(const JsonValue *item, DocumentChange *change) {
+  const JsonValue *text = json_path(item, "text");
+  if (!text || text->type != JSON_STRING) {
+    return false;
+  }
+  *change = (DocumentChange){0};
+  change->text = text->as.string.chars;
+  change->length = text->as.string.length;
+
+  long values[4];
+  const char *paths[4] = {"range.start.line", "range.start.character",
+                          "range.end.line", "range.end.character"};
+  if (!json_path(item, "range")) {
+    change->whole = true;
+    return true;
+  }
+  for (int i = 0; i < 4; i++) {
+    if (!json_int(json_path(item, paths[i]), &values[i]) || values[i] < 0) {
+      return false;
+    }
+  }
+  change->start_line = (size_t)values[0];
+  change->start_char = (size_t)values[1];
+  change->end_line = (size_t)values[2];
+  change->end_char = (size_t)values[3];
+  return true;
+}
+
+static void handle_did_change(Server *server, const JsonValue *message) {
+  Document *doc = params_document(server, message);
+  const JsonValue *changes = json_path(message, "params.contentChanges");
+  if (!doc || !changes || changes->type != JSON_ARRAY) {
+    return;
+  }
+
+  for (size_t i = 0; i < changes->as.list.count; i++) {
+    DocumentChange change;
+    if (read_change(changes->as.list.items[i], &change)) {
+      workspace_change(&server->ws, doc, &change, server->utf16);
+    }
+  }
+  json_int(json_path(message, "params.textDocument.version"), &doc->version);
+  mark_dirty(server, doc);
+}
+
+static void handle_did_close(Server *server, const JsonValue *message) {
+  Document *doc = params_document(server, message);
+  if (!doc) {
+    return;
+  }
+
+  // Clear what the editor shows before the document goes away
+  char *uri = strdup(doc->uri);
+  forget_dirty(server, doc);
+  workspace_close(&server->ws, doc);
+  if (uri) {
+    json_append(&server->reply,
+                "{\"jsonrpc\":\"2.0\",\"method\":"
+                "\"textDocument/publishDiagnostics\",\"params\":{\"uri\":");
+    append_cstring(server, uri);
+    json_append(&server->reply, ",\"diagnostics\":[]}}");
+    send_message(server);
+    free(uri);
+  }
+}
+
+static void handle_definition(Server *server, const JsonValue *message,
+                              const JsonValue *id) {
+  Document *doc;
+  size_t offset;
+  Location location;
+  bool found = params_offset(server, message, &doc, &offset) &&
+               workspace_definition(&server->ws, doc, offset, &location);
+
+  begin_response(server, id);
+  if (found) {
+    json_append(&server->reply, "{\"uri\":");
+    append_cstring(server, location.doc->uri);
+    json_append(&server->reply, ",\"range\":");
+    append_range(server, location.doc, location.line, location.start,
+                 location.end);
+    json_append(&server->reply, "}");
+  } else {
+    json_append(&server->reply, "null");
+  }
+  end_response(server);
+}
+
+static void handle_hover(Server *server, const JsonValue *message,
+                         const JsonValue *id) {
+  Document *doc;
+  size_t offset;
+  const char *text = params_offset(server, message, &doc, &offset)
+                         ? workspace_hover(&server->ws, doc, offset)
+                         : NULL;
+
+  begin_response(server, id);
+  if (text) {
+    json_append(&server->reply,
+                "{\"contents\":{\"kind\":\"markdown\",\"value\":");
+    append_cstring(server, text);
+    json_append(&server->reply, "}}");
+  } else {
+    json_append(&server->reply, "null");
+  }
+  end_response(server);
+}
+
+static void handle_completion(Server *server, const JsonValue *message,
+                              const JsonValue *id) {
+  Document *doc;
+  size_t offset;
+  Completion *items = NULL;
+  size_t count = params_offset(server, message, &doc, &offset)
+                     ? workspace_completion(&server->ws, doc, offset, &items)
+                     : 0;
+
+  begin_response(server, id);
+  json_append(&server->reply, "[");
+  for (size_t i = 0; i < count; i++) {
+    json_append(&server->reply, "%s{\"label\":", i > 0 ? "," : "");
+    append_cstring(server, items[i].label);
+    json_append(&server->reply, ",\"kind\":%d,\"detail\":", items[i].kind);
+    append_cstring(server, items[i].detail ? items[i].detail : "");
+    json_append(&server->reply, "}");
+  }
+  json_append(&server->reply, "]");
+  end_response(server);
+}
+
+static void handle_message(Server *server, const JsonValue *message) {
+  const char *method = json_string(json_path(message, "method"));
+  const JsonValue *id = json_path(message, "id");
+  if (!method) {
+    return; // A response to a request we never send
+  }
+
+  if (strcmp(method, "initialize") == 0 && id) {
+    handle_initialize(server, message, id);
+  } else if (strcmp(method, "shutdown") == 0 && id) {
+    server->shut_down = true;
+    begin_response(server, id);
+    json_append(&server->reply, "null");
+    end_response(server);
+  } else if (strcmp(method, "exit") == 0) {
+    server->exited = true;
+  } else if (strcmp(method, "textDocument/didOpen") == 0) {
+    handle_did_open(server, message);
+  } else if (strcmp(method, "textDocument/didChange") == 0) {
+    handle_did_change(server, message);
+  } else if (strcmp(method, "textDocument/didClose") == 0) {
+    handle_did_close(server, message);
+  } else if (strcmp(method, "textDocument/definition") == 0 && id) {
+    handle_definition(server, message, id);
+  } else if (strcmp(method, "textDocument/hover") == 0 && id) {
+    handle_hover(server, message, id);
+  } else if (strcmp(method, "textDocument/completion") == 0 && id) {
+    handle_completion(server, message, id);
+  } else if (id) {
+    // Notifications we do not know, like initialized, are dropped silently
+    json_append(&server->reply, "{\"jsonrpc\":\"2.0\",\"id\":");
+    json_append_value(&server->reply, id);
+    json_append(&server->reply,
+                ",\"error\":{\"code\":%d,\"message\":\"Unknown method\"}}",
+                METHOD_NOT_FOUND);
+    send_message(server);
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Session
+// ---------------------------------------------------------------------------
+
+// Checks bodies until input arrives or nothing is left, then publishes what
+// changed
+static void work_while_idle(Server *server) {
+  while (!input_waiting(server)) {
+    if (workspace_has_pending(&server->ws)) {
+      Document *done = workspace_check_next(&server->ws);
+      if (done) {
+        mark_dirty(server, done);
+      }
+      continue;
+    }
+    if (server->dirty.count == 0) {
+      return;
+    }
+    Document **list = (Document **)server->dirty.data;
+    for (size_t i = 0; i < server->dirty.count; i++) {
+      publish_diagnostics(server, list[i]);
+    }
+    server->dirty.count = 0;
+  }
+}
+
+bool run_lsp(BuildConfig config) {
+  Server server = {0};
+
+  // The protocol keeps the real stdout; stray prints go to stderr
+  int protocol = dup(STDOUT_FILENO);
+  server.out = protocol >= 0 ? fdopen(protocol, "w") : NULL;
+  if (!server.out || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+    fprintf(stderr, "lsp: cannot set up stdout\n");
+    return false;
+  }
+
+  if (!workspace_init(&server.ws, (const char **)config.include_dirs.data,
+                      config.include_dirs.count) ||
+      arena_allocator_init(&server.arena, ARENA_MIN_BUFFER_SIZE) != 0 ||
+      !growable_array_init(&server.dirty, &server.ws.arena, 8,
+                           sizeof(Document *))) {
+    fprintf(stderr, "lsp: out of memory\n");
+    fclose(server.out);
+    return false;
+  }
+
+  const char *body;
+  size_t length;
+  while (!server.exited) {
+    work_while_idle(&server);
+    if (!read_message(&server, &body, &length)) {
+      break;
+    }
+
+    arena_reset(&server.arena);
+    JsonValue *message = json_parse(body, length, &server.arena);
+    if (message) {
+      handle_message(&server, message);
+    } else {
+      fprintf(stderr, "lsp: ignoring malformed message\n");
+    }
+    drop_message(&server);
+  }
+
+  workspace_free(&server.ws);
+  arena_destroy(&server.arena);
+  json_buffer_free(&server.reply);
+  free(server.input);
+  fclose(server.out);
+  return server.shut_down;
+}
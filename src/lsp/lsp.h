@@ -0,0 +1,21 @@
+/**
+ * @file lsp.h
+ * @brief Language server speaking the Language Server Protocol on stdio.
+ *
+ * `luma lsp [-I dir]...` answers an editor's requests for diagnostics,
+ * go-to-definition, hover and completion. Documents stay in memory between
+ * requests (see document.h) and their semantic index is kept up to date
+ * incrementally (see workspace.h).
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "../helper/help.h"
+
+/**
+ * @brief Serves one editor session until it sends `exit` or closes stdin.
+ * @return true after a `shutdown` request preceded the end of the session.
+ */
+bool run_lsp(BuildConfig config);
@@ -0,0 +1,1463 @@
+/**
+ * @file workspace.c
+ * @brief Semantic index, body checks and queries of the language server.
+ *
+ * @see workspace.h
+ */
+
+#include "workspace.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../c_libs/error/error.h"
+#include "../helper/help.h"
+#include "../helper/module_path.h"
+#include "../parser/parser.h"
+
+/** Bytes of typechecker output kept for one diagnostic */
+#define CAPTURE_LIMIT 4096
+
+/** Tokens scanned from the start of a declaration's line for its name */
+#define NAME_SCAN_LIMIT 256
+
+/**
+ * @brief A diagnostic the index has for a document.
+ */
+typedef struct {
+  Document *doc;
+  Diagnostic diagnostic;
+} IndexNote;
+
+/**
+ * @brief A function-local name visible at the cursor.
+ */
+typedef struct {
+  const char *name;
+  AstNode *decl; /**< Variable declaration, or the function for a parameter */
+  AstNode *type; /**< Declared or inferred type, NULL if unknown */
+  bool is_param;
+  bool is_mutable;
+} LocalSymbol;
+
+/**
+ * @brief The name under the cursor and what surrounds it.
+ */
+typedef struct {
+  const char *name;      /**< Identifier under the cursor, or NULL */
+  const char *prefix;    /**< Part of the identifier before the cursor */
+  const char *qualifier; /**< Identifier before a '.', or NULL */
+  AstNode *function;     /**< Function whose body holds the cursor */
+  size_t line;           /**< Token line of the cursor, 1-based */
+  size_t column;         /**< Token column of the cursor */
+} Cursor;
+
+/**
+ * @brief What a name resolved to.
+ */
+typedef struct {
+  Document *doc;           /**< Document of the declaration */
+  AstNode *decl;           /**< Declaring node, NULL if unknown */
+  const char *name;        /**< Name as declared */
+  AstNode *type;           /**< Type from the index or the locals */
+  const LocalSymbol *local; /**< Set for locals and parameters */
+  bool is_module;          /**< Name is a module alias */
+} Resolved;
+
+// ---------------------------------------------------------------------------
+// Typechecker output
+// ---------------------------------------------------------------------------
+
+// The typechecker reports on stderr; while it runs for the server, stderr
+// is pointed at a temporary file so the text can become a diagnostic
+static int capture_begin(Workspace *ws) {
+  fflush(stderr);
+  int fd = fileno(ws->capture);
+  int saved = dup(STDERR_FILENO);
+  if (saved < 0 || lseek(fd, 0, SEEK_SET) < 0 || ftruncate(fd, 0) != 0 ||
+      dup2(fd, STDERR_FILENO) < 0) {
+    if (saved >= 0) {
+      close(saved);
+    }
+    return -1;
+  }
+  return saved;
+}
+
+static const char *capture_end(Workspace *ws, int saved) {
+  fflush(stderr);
+  if (saved < 0) {
+    return "";
+  }
+  dup2(saved, STDERR_FILENO);
+  close(saved);
+
+  int fd = fileno(ws->capture);
+  off_t size = lseek(fd, 0, SEEK_CUR);
+  if (size <= 0) {
+    return "";
+  }
+  if (size > CAPTURE_LIMIT) {
+    size = CAPTURE_LIMIT;
+  }
+  char *text = arena_alloc(&ws->scratch, (size_t)size + 1, alignof(char));
+  ssize_t got = text ? pread(fd, text, (size_t)size, 0) : -1;
+  if (got < 0) {
+    return "";
+  }
+  text[got] = '\0';
+  return text;
+}
+
+// ---------------------------------------------------------------------------
+// Documents
+// ---------------------------------------------------------------------------
+
+static Document **documents(Workspace *ws) {
+  return (Document **)ws->documents.data;
+}
+
+static const char *module_name(const Document *doc) {
+  return doc->module ? doc->module->preprocessor.module.name : NULL;
+}
+
+static char *uri_to_path(const char *uri) {
+  const char *prefix = "file://";
+  if (strncmp(uri, prefix, strlen(prefix)) != 0) {
+    return strdup(uri);
+  }
+
+  const char *in = uri + strlen(prefix);
+  char *path = malloc(strlen(in) + 1);
+  if (!path) {
+    return NULL;
+  }
+  char *out = path;
+  while (*in) {
+    if (in[0] == '%' && isxdigit((unsigned char)in[1]) &&
+        isxdigit((unsigned char)in[2])) {
+      char hex[3] = {in[1], in[2], '\0'};
+      *out++ = (char)strtol(hex, NULL, 16);
+      in += 3;
+    } else {
+      *out++ = *in++;
+    }
+  }
+  *out = '\0';
+  return path;
+}
+
+static char *path_to_uri(const char *path) {
+  char *uri = malloc(strlen("file://") + strlen(path) * 3 + 1);
+  if (!uri) {
+    return NULL;
+  }
+  char *out = uri + sprintf(uri, "file://");
+  for (const unsigned char *in = (const unsigned char *)path; *in; in++) {
+    if (isalnum(*in) || strchr("/._-~", *in)) {
+      *out++ = (char)*in;
+    } else {
+      out += sprintf(out, "%%%02X", *in);
+    }
+  }
+  *out = '\0';
+  return uri;
+}
+
+static bool add_document(Workspace *ws, Document *doc) {
+  Document **slot = (Document **)growable_array_push(&ws->documents);
+  if (!slot) {
+    return false;
+  }
+  *slot = doc;
+  return true;
+}
+
+static void remove_document(Workspace *ws, Document *doc) {
+  Document **docs = documents(ws);
+  for (size_t i = 0; i < ws->documents.count; i++) {
+    if (docs[i] == doc) {
+      docs[i] = docs[--ws->documents.count];
+      document_destroy(doc);
+      return;
+    }
+  }
+}
+
+// Modules named here get every dependent's bodies checked again after the
+// next index rebuild
+static void note_changed(Workspace *ws, const char *name) {
+  if (!name) {
+    return;
+  }
+  char **slot = (char **)growable_array_push(&ws->changed);
+  if (slot) {
+    *slot = arena_strdup(&ws->index_arena, name);
+  }
+  ws->index_stale = true;
+}
+
+static Document *module_document(Workspace *ws, const char *name) {
+  Document *found = NULL;
+  Document **docs = documents(ws);
+  for (size_t i = 0; i < ws->documents.count; i++) {
+    const char *candidate = module_name(docs[i]);
+    if (candidate && strcmp(candidate, name) == 0) {
+      // The editor's text wins over the disk's
+      if (docs[i]->open) {
+        return docs[i];
+      }
+      found = found ? found : docs[i];
+    }
+  }
+  return found;
+}
+
+static Document *path_document(Workspace *ws, const char *path) {
+  Document **docs = documents(ws);
+  for (size_t i = 0; i < ws->documents.count; i++) {
+    if (strcmp(docs[i]->path, path) == 0) {
+      return docs[i];
+    }
+  }
+  return NULL;
+}
+
+bool workspace_init(Workspace *ws, const char **include_dirs,
+                    size_t include_count) {
+  memset(ws, 0, sizeof(*ws));
+  ws->include_dirs = include_dirs;
+  ws->include_count = include_count;
+  ws->capture = tmpfile();
+  return ws->capture &&
+         arena_allocator_init(&ws->arena, ARENA_MIN_BUFFER_SIZE) == 0 &&
+         arena_allocator_init(&ws->index_arena, ARENA_MIN_BUFFER_SIZE) == 0 &&
+         arena_allocator_init(&ws->scratch, ARENA_MIN_BUFFER_SIZE) == 0 &&
+         growable_array_init(&ws->documents, &ws->arena, 16,
+                             sizeof(Document *)) &&
+         growable_array_init(&ws->changed, &ws->index_arena, 16,
+                             sizeof(char *)) &&
+         growable_array_init(&ws->notes, &ws->index_arena, 16,
+                             sizeof(IndexNote));
+}
+
+void workspace_free(Workspace *ws) {
+  Document **docs = documents(ws);
+  for (size_t i = 0; i < ws->documents.count; i++) {
+    document_destroy(docs[i]);
+  }
+  arena_destroy(&ws->arena);
+  arena_destroy(&ws->index_arena);
+  arena_destroy(&ws->scratch);
+  if (ws->capture) {
+    fclose(ws->capture);
+  }
+}
+
+Document *workspace_find(Workspace *ws, const char *uri) {
+  Document **docs = documents(ws);
+  for (size_t i = 0; i < ws->documents.count; i++) {
+    if (strcmp(docs[i]->uri, uri) == 0) {
+      return docs[i];
+    }
+  }
+  return NULL;
+}
+
+Document *workspace_open(Workspace *ws, const char *uri, const char *text,
+                         size_t length) {
+  char *path = uri_to_path(uri);
+  if (!path) {
+    return NULL;
+  }
+
+  // A module read from disk for an @use now comes from the editor
+  Document *existing = workspace_find(ws, uri);
+  if (!existing) {
+    existing = path_document(ws, path);
+  }
+  if (existing) {
+    note_changed(ws, module_name(existing));
+    remove_document(ws, existing);
+  }
+
+  Document *doc = document_create(uri, path, text, length);
+  free(path);
+  if (!doc || !add_document(ws, doc)) {
+    document_destroy(doc);
+    return NULL;
+  }
+  doc->open = true;
+  note_changed(ws, module_name(doc));
+  return doc;
+}
+
+void workspace_change(Workspace *ws, Document *doc,
+                      const DocumentChange *change, bool utf16) {
+  char before[256] = "";
+  if (module_name(doc)) {
+    snprintf(before, sizeof(before), "%s", module_name(doc));
+  }
+
+  AstNode *edited;
+  if (document_apply(doc, change, utf16, &edited)) {
+    note_changed(ws, before[0] ? before : NULL);
+    note_changed(ws, module_name(doc));
+  }
+}
+
+void workspace_close(Workspace *ws, Document *doc) {
+  note_changed(ws, module_name(doc));
+  remove_document(ws, doc);
+}
+
+// ---------------------------------------------------------------------------
+// Index
+// ---------------------------------------------------------------------------
+
+static void line_extent(const Document *doc, size_t line, size_t *start,
+                        size_t *end) {
+  size_t first = doc->line_starts[line];
+  size_t last = line + 1 < doc->line_count ? doc->line_starts[line + 1] - 1
+                                           : doc->length;
+  size_t indent = first;
+  while (indent < last && isspace((unsigned char)doc->text[indent])) {
+    indent++;
+  }
+  *start = indent - first;
+  *end = last - first;
+}
+
+// Turns the typechecker's first message into a diagnostic: the text without
+// the "Error: " it starts with, placed on the line it names if any
+static bool typechecker_diagnostic(ArenaAllocator *arena, const Document *doc,
+                                   const char *output, size_t fallback_line,
+                                   Diagnostic *out) {
+  const char *message = output;
+  while (*message == '\n') {
+    message++;
+  }
+  if (strncmp(message, "Error: ", 7) == 0) {
+    message += 7;
+  }
+  size_t length = strcspn(message, "\n");
+  if (length == 0) {
+    message = "Failed to typecheck";
+    length = strlen(message);
+  }
+  char *text = arena_alloc(arena, length + 1, alignof(char));
+  if (!text) {
+    return false;
+  }
+  memcpy(text, message, length);
+  text[length] = '\0';
+
+  size_t line = fallback_line;
+  const char *at = strstr(text, "line ");
+  if (at) {
+    long reported = strtol(at + 5, NULL, 10);
+    if (reported > 0 && (size_t)reported <= doc->line_count) {
+      line = (size_t)reported - 1;
+    }
+  }
+  out->line = line;
+  out->message = text;
+  line_extent(doc, line, &out->start, &out->end);
+  return true;
+}
+
+static void add_note(Workspace *ws, Document *doc, size_t line,
+                     const char *output) {
+  if (!doc->open) {
+    return;
+  }
+  IndexNote *note = (IndexNote *)growable_array_push(&ws->notes);
+  if (note && typechecker_diagnostic(&ws->index_arena, doc, output, line,
+                                     &note->diagnostic)) {
+    note->doc = doc;
+  } else if (note) {
+    ws->notes.count--;
+  }
+}
+
+static size_t node_line(const Document *doc, const AstNode *node) {
+  size_t line = node->line > 0 ? node->line - 1 : 0;
+  return line < doc->line_count ? line : doc->line_count - 1;
+}
+
+static const char *find_module_file(Workspace *ws, const Document *from,
+                                    const char *name) {
+  const char **dirs = arena_alloc(&ws->scratch,
+                                  (ws->include_count + 1) * sizeof(char *),
+                                  alignof(char *));
+  if (!dirs) {
+    return NULL;
+  }
+
+  // Next to the using file first, like a build run from its directory
+  const char *slash = strrchr(from->path, '/');
+  if (slash) {
+    size_t length = (size_t)(slash - from->path);
+    char *dir = arena_alloc(&ws->scratch, length + 2, alignof(char));
+    if (!dir) {
+      return NULL;
+    }
+    memcpy(dir, from->path, length ? length : 1);
+    dir[length ? length : 1] = '\0';
+    dirs[0] = dir;
+  } else {
+    dirs[0] = ".";
+  }
+  memcpy(dirs + 1, ws->include_dirs, ws->include_count * sizeof(char *));
+
+  ModuleSearchPath search;
+  if (!module_search_path_init(&search, dirs, ws->include_count + 1,
+                               &ws->scratch)) {
+    return NULL;
+  }
+  return module_search_path_find(&search, name);
+}
+
+// Reads every module an indexed document uses that nobody has yet
+static void load_dependencies(Workspace *ws) {
+  for (size_t i = 0; i < ws->documents.count; i++) {
+    Document *doc = documents(ws)[i];
+    if (!doc->module) {
+      continue;
+    }
+    for (size_t j = 0; j < doc->module->preprocessor.module.body_count; j++) {
+      AstNode *use = doc->module->preprocessor.module.body[j];
+      if (!use || use->type != AST_PREPROCESSOR_USE ||
+          module_document(ws, use->preprocessor.use.module_name)) {
+        continue;
+      }
+
+      const char *path =
+          find_module_file(ws, doc, use->preprocessor.use.module_name);
+      if (!path || path_document(ws, path)) {
+        continue;
+      }
+      char *text = (char *)read_file(path);
+      char *uri = path_to_uri(path);
+      Document *dep = text && uri ? document_create(uri, path, text,
+                                                    strlen(text))
+                                  : NULL;
+      free(text);
+      free(uri);
+      if (dep && !add_document(ws, dep)) {
+        document_destroy(dep);
+      }
+    }
+  }
+}
+
+static bool uses_resolve(Workspace *ws, Document *doc, Document **chosen,
+                         const bool *included, size_t count, bool report) {
+  bool ok = true;
+  for (size_t j = 0; j < doc->module->preprocessor.module.body_count; j++) {
+    AstNode *use = doc->module->preprocessor.module.body[j];
+    if (!use || use->type != AST_PREPROCESSOR_USE) {
+      continue;
+    }
+    const char *name = use->preprocessor.use.module_name;
+    bool found = false;
+    for (size_t k = 0; k < count && !found; k++) {
+      found = included[k] && strcmp(module_name(chosen[k]), name) == 0;
+    }
+    if (!found) {
+      ok = false;
+      if (report) {
+        char message[300];
+        snprintf(message, sizeof(message),
+                 module_document(ws, name)
+                     ? "Module '%s' has errors and is not indexed"
+                     : "Cannot find module '%s'",
+                 name);
+        add_note(ws, doc, node_line(doc, use), message);
+      }
+    }
+  }
+  return ok;
+}
+
+// Marks the bodies of changed modules and of everything depending on them
+static void mark_dependents(Workspace *ws, char **changed,
+                            size_t changed_count) {
+  bool *affected = arena_alloc(&ws->scratch, ws->graph.count * sizeof(bool),
+                               alignof(bool));
+  if (!affected) {
+    return;
+  }
+  memset(affected, 0, ws->graph.count * sizeof(bool));
+  for (size_t i = 0; i < changed_count; i++) {
+    size_t node = module_graph_find(&ws->graph, changed[i]);
+    if (node < ws->graph.count) {
+      affected[node] = true;
+    }
+  }
+
+  for (bool grew = true; grew;) {
+    grew = false;
+    for (size_t i = 0; i < ws->graph.count; i++) {
+      for (size_t d = 0; !affected[i] && d < ws->graph.nodes[i].dep_count;
+           d++) {
+        if (affected[ws->graph.nodes[i].deps[d]]) {
+          affected[i] = grew = true;
+        }
+      }
+    }
+  }
+
+  for (size_t i = 0; i < ws->graph.count; i++) {
+    if (!affected[i]) {
+      continue;
+    }
+    FunctionCheck *checks = (FunctionCheck *)ws->nodes[i]->checks.data;
+    for (size_t c = 0; c < ws->nodes[i]->checks.count; c++) {
+      checks[c].stale = true;
+    }
+  }
+}
+
+static void rebuild_index(Workspace *ws) {
+  arena_reset(&ws->scratch);
+
+  // The changed names live in the index arena, which is about to be reset
+  size_t changed_count = ws->changed.count;
+  char **changed = arena_alloc(&ws->scratch,
+                               (changed_count + 1) * sizeof(char *),
+                               alignof(char *));
+  for (size_t i = 0; changed && i < changed_count; i++) {
+    changed[i] = arena_strdup(&ws->scratch, ((char **)ws->changed.data)[i]);
+  }
+
+  arena_reset(&ws->index_arena);
+  ws->index_stale = false;
+  ws->has_graph = false;
+  init_scope(&ws->global_scope, NULL, "global", &ws->index_arena);
+  if (!changed ||
+      !growable_array_init(&ws->changed, &ws->index_arena, 16,
+                           sizeof(char *)) ||
+      !growable_array_init(&ws->notes, &ws->index_arena, 16,
+                           sizeof(IndexNote))) {
+    return;
+  }
+
+  load_dependencies(ws);
+
+  // One document per module name, open documents first
+  size_t count = ws->documents.count;
+  Document **chosen = arena_alloc(&ws->scratch, (count + 1) * sizeof(*chosen),
+                                  alignof(Document *));
+  bool *included =
+      arena_alloc(&ws->scratch, (count + 1) * sizeof(bool), alignof(bool));
+  if (!chosen || !included) {
+    return;
+  }
+  size_t n = 0;
+  for (int pass = 0; pass < 2; pass++) {
+    for (size_t i = 0; i < count; i++) {
+      Document *doc = documents(ws)[i];
+      if (!doc->module || doc->open != (pass == 0) ||
+          module_document(ws, module_name(doc)) != doc) {
+        continue;
+      }
+      chosen[n] = doc;
+      included[n++] = true;
+    }
+  }
+
+  // Modules whose uses cannot all be indexed are left out, transitively
+  for (bool dropped = true; dropped;) {
+    dropped = false;
+    for (size_t i = 0; i < n; i++) {
+      if (included[i] && !uses_resolve(ws, chosen[i], chosen, included, n,
+                                       false)) {
+        included[i] = false;
+        dropped = true;
+      }
+    }
+  }
+  for (size_t i = 0; i < n; i++) {
+    if (!included[i]) {
+      uses_resolve(ws, chosen[i], chosen, included, n, true);
+    }
+  }
+
+  size_t indexed = 0;
+  AstNode **modules = arena_alloc(&ws->index_arena,
+                                  (n + 1) * sizeof(AstNode *),
+                                  alignof(AstNode *));
+  ws->nodes = arena_alloc(&ws->index_arena, (n + 1) * sizeof(Document *),
+                          alignof(Document *));
+  if (!modules || !ws->nodes) {
+    return;
+  }
+  for (size_t i = 0; i < n; i++) {
+    if (included[i]) {
+      ws->nodes[indexed] = chosen[i];
+      modules[indexed++] = chosen[i]->module;
+    }
+  }
+
+  int saved = capture_begin(ws);
+  bool built =
+      module_graph_build(&ws->graph, modules, indexed, &ws->index_arena);
+  const char *output = capture_end(ws, saved);
+  if (!built) {
+    for (size_t i = 0; i < indexed; i++) {
+      add_note(ws, ws->nodes[i], node_line(ws->nodes[i], ws->nodes[i]->module),
+               output);
+    }
+    return;
+  }
+
+  ws->scopes = arena_alloc(&ws->index_arena,
+                           (indexed + 1) * sizeof(Scope *), alignof(Scope *));
+  ws->declared = arena_alloc(&ws->index_arena, (indexed + 1) * sizeof(bool),
+                             alignof(bool));
+  if (!ws->scopes || !ws->declared) {
+    return;
+  }
+
+  saved = capture_begin(ws);
+  bool declared = typecheck_declarations(&ws->graph, &ws->global_scope,
+                                         &ws->index_arena, ws->scopes,
+                                         ws->declared);
+  output = capture_end(ws, saved);
+  for (size_t i = 0; !declared && i < indexed; i++) {
+    if (!ws->declared[i]) {
+      add_note(ws, ws->nodes[i], node_line(ws->nodes[i], ws->nodes[i]->module),
+               output);
+    }
+  }
+
+  ws->has_graph = true;
+  mark_dependents(ws, changed, changed_count);
+}
+
+static void ensure_index(Workspace *ws) {
+  if (ws->index_stale) {
+    rebuild_index(ws);
+  }
+}
+
+static Scope *document_scope(Workspace *ws, const Document *doc) {
+  if (!ws->has_graph) {
+    return NULL;
+  }
+  for (size_t i = 0; i < ws->graph.count; i++) {
+    if (ws->nodes[i] == doc) {
+      return ws->scopes[i];
+    }
+  }
+  return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Body checks
+// ---------------------------------------------------------------------------
+
+static bool has_stale(const Document *doc) {
+  const FunctionCheck *checks = (const FunctionCheck *)doc->checks.data;
+  for (size_t i = 0; i < doc->checks.count; i++) {
+    if (checks[i].stale) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool workspace_has_pending(Workspace *ws) {
+  if (ws->index_stale) {
+    return true;
+  }
+  for (size_t i = 0; ws->has_graph && i < ws->graph.count; i++) {
+    if (ws->nodes[i]->open && has_stale(ws->nodes[i])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Turns the first error of a failed body check into a diagnostic: a syntax
+// error from parsing the body, else the typechecker's first message
+static Diagnostic *body_error(Document *doc, AstNode *function,
+                              const char *output) {
+  Diagnostic *d =
+      arena_alloc(&doc->ast_arena, sizeof(Diagnostic), alignof(Diagnostic));
+  if (!d) {
+    return NULL;
+  }
+
+  const ErrorInformation *err = error_get(0);
+  if (err) {
+    size_t line = err->line > 0 ? (size_t)err->line - 1 : 0;
+    long last = err->col > 0 ? err->col : 0;
+    long first = last - (err->token_length > 0 ? err->token_length : 1) + 1;
+    *d = (Diagnostic){line, first > 0 ? (size_t)first : 0, (size_t)last + 1,
+                      arena_strdup(&doc->ast_arena, err->message)};
+    return d;
+  }
+
+  if (!typechecker_diagnostic(&doc->ast_arena, doc, output,
+                              node_line(doc, function), d)) {
+    return NULL;
+  }
+  return d;
+}
+
+static void check_function(Workspace *ws, Document *doc, Scope *scope,
+                           FunctionCheck *check) {
+  arena_reset(&ws->scratch);
+  error_clear();
+
+  // A resolver per check: its name table points into the checked AST
+  Resolver *resolver = resolver_create(&ws->scratch);
+  int saved = capture_begin(ws);
+  bool ok = resolver && parse_deferred_body(check->function, &doc->ast_arena) &&
+            typecheck_func_body(check->function, scope, resolver,
+                                &ws->scratch);
+  const char *output = capture_end(ws, saved);
+
+  check->stale = false;
+  check->error = ok ? NULL : body_error(doc, check->function, output);
+  error_clear();
+}
+
+Document *workspace_check_next(Workspace *ws) {
+  ensure_index(ws);
+  for (size_t i = 0; ws->has_graph && i < ws->graph.count; i++) {
+    Document *doc = ws->nodes[i];
+    if (!doc->open) {
+      continue;
+    }
+    FunctionCheck *checks = (FunctionCheck *)doc->checks.data;
+    for (size_t c = 0; c < doc->checks.count; c++) {
+      if (checks[c].stale) {
+        check_function(ws, doc, ws->scopes[i], &checks[c]);
+        return has_stale(doc) ? NULL : doc;
+      }
+    }
+  }
+  return NULL;
+}
+
+size_t workspace_diagnostics(Workspace *ws, Document *doc, Diagnostic **out) {
+  arena_reset(&ws->scratch);
+  size_t capacity = doc->syntax.count + doc->checks.count + 8;
+  if (!ws->index_stale) {
+    capacity += ws->notes.count;
+  }
+  Diagnostic *list = arena_alloc(&ws->scratch, capacity * sizeof(Diagnostic),
+                                 alignof(Diagnostic));
+  if (!list) {
+    return 0;
+  }
+
+  size_t n = 0;
+  memcpy(list, doc->syntax.data, doc->syntax.count * sizeof(Diagnostic));
+  n += doc->syntax.count;
+
+  // Notes of an outdated index may point into freed documents
+  const IndexNote *notes = (const IndexNote *)ws->notes.data;
+  for (size_t i = 0; !ws->index_stale && i < ws->notes.count; i++) {
+    if (notes[i].doc == doc) {
+      list[n++] = notes[i].diagnostic;
+    }
+  }
+
+  const FunctionCheck *checks = (const FunctionCheck *)doc->checks.data;
+  for (size_t i = 0; i < doc->checks.count; i++) {
+    if (!checks[i].stale && checks[i].error) {
+      list[n++] = *checks[i].error;
+    }
+  }
+  *out = list;
+  return n;
+}
+
+// ---------------------------------------------------------------------------
+// Queries
+// ---------------------------------------------------------------------------
+
+static bool is_identifier(const Document *doc, size_t index) {
+  return index < doc->token_count &&
+         doc->tokens[index].type_ == TOK_IDENTIFIER;
+}
+
+static char *token_text(Workspace *ws, const Document *doc, size_t index,
+                        size_t length) {
+  char *text = arena_alloc(&ws->scratch, length + 1, alignof(char));
+  if (text) {
+    memcpy(text, doc->tokens[index].value, length);
+    text[length] = '\0';
+  }
+  return text;
+}
+
+static Cursor find_cursor(Workspace *ws, Document *doc, size_t offset) {
+  Cursor cursor = {0};
+  size_t at = document_token_at(doc, offset);
+  if (at >= doc->token_count) {
+    cursor.line = 1;
+    return cursor;
+  }
+
+  size_t before = at;
+  if (is_identifier(doc, at) && offset <= doc->token_ends[at]) {
+    size_t typed = offset - document_token_start(doc, at);
+    cursor.name = token_text(ws, doc, at, (size_t)doc->tokens[at].length);
+    cursor.prefix = token_text(ws, doc, at, typed);
+    before = at > 0 ? at - 1 : doc->token_count;
+  } else {
+    cursor.prefix = "";
+  }
+  if (before < doc->token_count && before > 0 &&
+      doc->tokens[before].type_ == TOK_DOT &&
+      is_identifier(doc, before - 1)) {
+    cursor.qualifier = token_text(ws, doc, before - 1,
+                                  (size_t)doc->tokens[before - 1].length);
+  }
+
+  cursor.function = document_function_at(doc, at);
+  cursor.line = (size_t)doc->tokens[at].line;
+  cursor.column = (size_t)doc->tokens[at].col;
+  return cursor;
+}
+
+static bool starts_before(const AstNode *node, const Cursor *cursor) {
+  return node->line < cursor->line ||
+         (node->line == cursor->line && node->column <= cursor->column);
+}
+
+/**
+ * @brief State of the walk that collects locals up to the cursor.
+ */
+typedef struct {
+  Workspace *ws;
+  const Cursor *cursor;
+  GrowableArray *locals; /**< LocalSymbol */
+} LocalWalk;
+
+static Scope *open_scope(LocalWalk *walk, Scope *parent) {
+  Scope *scope = arena_alloc(&walk->ws->scratch, sizeof(Scope), alignof(Scope));
+  if (scope) {
+    init_scope(scope, parent, "block", &walk->ws->scratch);
+  }
+  return scope;
+}
+
+static void add_local(LocalWalk *walk, Scope *scope, const char *name,
+                      AstNode *decl, AstNode *type, bool is_param,
+                      bool is_mutable) {
+  LocalSymbol *local = (LocalSymbol *)growable_array_push(walk->locals);
+  if (!local) {
+    return;
+  }
+  *local = (LocalSymbol){name, decl, type, is_param, is_mutable};
+  if (type) {
+    scope_add_symbol(scope, name, type, false, is_mutable, &walk->ws->scratch);
+  }
+}
+
+static void walk_statement(LocalWalk *walk, AstNode *stmt, Scope *scope,
+                           bool holds_cursor);
+
+static void walk_list(LocalWalk *walk, AstNode **stmts, size_t count,
+                      Scope *scope) {
+  for (size_t i = 0; i < count; i++) {
+    if (!stmts[i] || !starts_before(stmts[i], walk->cursor)) {
+      break;
+    }
+    bool holds_cursor =
+        i + 1 == count || !stmts[i + 1] ||
+        !starts_before(stmts[i + 1], walk->cursor);
+    walk_statement(walk, stmts[i], scope, holds_cursor);
+  }
+}
+
+static void walk_statement(LocalWalk *walk, AstNode *stmt, Scope *scope,
+                           bool holds_cursor) {
+  if (!scope) {
+    return;
+  }
+
+  switch (stmt->type) {
+  case AST_STMT_VAR_DECL: {
+    AstNode *type = stmt->stmt.var_decl.var_type;
+    if (!type && stmt->stmt.var_decl.initializer) {
+      type = typecheck_expression(stmt->stmt.var_decl.initializer, scope,
+                                  &walk->ws->scratch);
+    }
+    add_local(walk, scope, stmt->stmt.var_decl.name, stmt, type, false,
+              stmt->stmt.var_decl.is_mutable);
+    break;
+  }
+  case AST_STMT_BLOCK:
+    if (holds_cursor) {
+      walk_list(walk, stmt->stmt.block.statements, stmt->stmt.block.stmt_count,
+                open_scope(walk, scope));
+    }
+    break;
+  case AST_STMT_IF: {
+    if (!holds_cursor) {
+      break;
+    }
+    // The last branch starting before the cursor is the one holding it
+    AstNode *branch = stmt->stmt.if_stmt.then_stmt;
+    for (int i = 0; i < stmt->stmt.if_stmt.elif_count; i++) {
+      AstNode *elif = stmt->stmt.if_stmt.elif_stmts[i];
+      if (elif && starts_before(elif, walk->cursor)) {
+        branch = elif;
+      }
+    }
+    AstNode *otherwise = stmt->stmt.if_stmt.else_stmt;
+    if (otherwise && starts_before(otherwise, walk->cursor)) {
+      branch = otherwise;
+    }
+    if (branch) {
+      walk_statement(walk, branch, scope, true);
+    }
+    break;
+  }
+  case AST_STMT_LOOP: {
+    if (!holds_cursor) {
+      break;
+    }
+    Scope *loop_scope = open_scope(walk, scope);
+    for (size_t i = 0; i < stmt->stmt.loop_stmt.init_count; i++) {
+      AstNode *init = stmt->stmt.loop_stmt.initializer[i];
+      if (init) {
+        walk_statement(walk, init, loop_scope, false);
+      }
+    }
+    if (stmt->stmt.loop_stmt.body) {
+      walk_statement(walk, stmt->stmt.loop_stmt.body, loop_scope, true);
+    }
+    break;
+  }
+  case AST_STMT_DEFER:
+    if (holds_cursor && stmt->stmt.defer_stmt.statement) {
+      walk_statement(walk, stmt->stmt.defer_stmt.statement, scope, true);
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+// Parameters and the locals declared before the cursor, in declaration
+// order, so the last entry with a name is the one in effect
+static void collect_locals(Workspace *ws, Document *doc, Scope *module_scope,
+                           const Cursor *cursor, GrowableArray *locals) {
+  if (!growable_array_init(locals, &ws->scratch, 16, sizeof(LocalSymbol)) ||
+      !cursor->function) {
+    return;
+  }
+  AstNode *function = cursor->function;
+
+  int saved = capture_begin(ws);
+  error_clear();
+  parse_deferred_body(function, &doc->ast_arena);
+  error_clear();
+
+  LocalWalk walk = {ws, cursor, locals};
+  Scope *scope = module_scope ? open_scope(&walk, module_scope) : NULL;
+  for (size_t i = 0; i < function->stmt.func_decl.param_count; i++) {
+    LocalSymbol *local = (LocalSymbol *)growable_array_push(locals);
+    if (local) {
+      *local = (LocalSymbol){function->stmt.func_decl.param_names[i], function,
+                             function->stmt.func_decl.param_types[i], true,
+                             true};
+    }
+    if (scope) {
+      scope_add_symbol(scope, function->stmt.func_decl.param_names[i],
+                       function->stmt.func_decl.param_types[i], false, true,
+                       &ws->scratch);
+    }
+  }
+
+  AstNode *body = function->stmt.func_decl.body;
+  if (scope && body && body->type == AST_STMT_BLOCK) {
+    walk_list(&walk, body->stmt.block.statements, body->stmt.block.stmt_count,
+              scope);
+  }
+  capture_end(ws, saved);
+}
+
+static const LocalSymbol *find_local(const GrowableArray *locals,
+                                     const char *name) {
+  const LocalSymbol *list = (const LocalSymbol *)locals->data;
+  for (size_t i = locals->count; i > 0; i--) {
+    if (strcmp(list[i - 1].name, name) == 0) {
+      return &list[i - 1];
+    }
+  }
+  return NULL;
+}
+
+static const char *declared_name(const AstNode *stmt) {
+  switch (stmt->type) {
+  case AST_STMT_FUNCTION:
+    return stmt->stmt.func_decl.name;
+  case AST_STMT_VAR_DECL:
+    return stmt->stmt.var_decl.name;
+  case AST_STMT_STRUCT:
+    return stmt->stmt.struct_decl.name;
+  case AST_STMT_ENUM:
+    return stmt->stmt.enum_decl.name;
+  default:
+    return NULL;
+  }
+}
+
+static AstNode *top_level_decl(const Document *doc, const char *name) {
+  if (!doc || !doc->module) {
+    return NULL;
+  }
+  for (size_t i = 0; i < doc->module->preprocessor.module.body_count; i++) {
+    AstNode *stmt = doc->module->preprocessor.module.body[i];
+    const char *declared = stmt ? declared_name(stmt) : NULL;
+    if (declared && strcmp(declared, name) == 0) {
+      return stmt;
+    }
+  }
+  return NULL;
+}
+
+static ModuleImport *find_import(Scope *scope, const char *alias) {
+  if (!scope) {
+    return NULL;
+  }
+  for (size_t i = 0; i < scope->imported_modules.count; i++) {
+    ModuleImport *import = (ModuleImport *)scope->imported_modules.data + i;
+    if (strcmp(import->alias, alias) == 0) {
+      return import;
+    }
+  }
+  return NULL;
+}
+
+// Struct named by a type, looked for in the document and what it uses
+static AstNode *find_struct(Workspace *ws, Document *doc, Scope *scope,
+                            AstNode *type) {
+  while (type && type->type == AST_TYPE_POINTER) {
+    type = type->type_data.pointer.pointee_type;
+  }
+  if (!type || type->type != AST_TYPE_BASIC) {
+    return NULL;
+  }
+  const char *name = type->type_data.basic.name;
+
+  AstNode *decl = top_level_decl(doc, name);
+  for (size_t i = 0; (!decl || decl->type != AST_STMT_STRUCT) && scope &&
+                     i < scope->imported_modules.count;
+       i++) {
+    ModuleImport *import = (ModuleImport *)scope->imported_modules.data + i;
+    decl = top_level_decl(module_document(ws, import->module_name), name);
+  }
+  return decl && decl->type == AST_STMT_STRUCT ? decl : NULL;
+}
+
+// Public members for section 0, private ones for section 1
+static AstNode **struct_members(const AstNode *decl, int section,
+                                size_t *count) {
+  *count = section == 0 ? decl->stmt.struct_decl.public_count
+                        : decl->stmt.struct_decl.private_count;
+  return section == 0 ? decl->stmt.struct_decl.public_members
+                      : decl->stmt.struct_decl.private_members;
+}
+
+static AstNode *find_field(AstNode *decl, const char *name) {
+  for (int section = 0; decl && section < 2; section++) {
+    size_t count;
+    AstNode **members = struct_members(decl, section, &count);
+    for (size_t i = 0; i < count; i++) {
+      if (members[i] && strcmp(members[i]->stmt.field_decl.name, name) == 0) {
+        return members[i];
+      }
+    }
+  }
+  return NULL;
+}
+
+static AstNode *type_of_name(Scope *scope, const GrowableArray *locals,
+                             const char *name) {
+  const LocalSymbol *local = find_local(locals, name);
+  if (local) {
+    return local->type;
+  }
+  Symbol *symbol = scope ? scope_lookup(scope, name) : NULL;
+  return symbol ? symbol->type : NULL;
+}
+
+static bool resolve(Workspace *ws, Document *doc, const Cursor *cursor,
+                    const GrowableArray *locals, Resolved *out) {
+  *out = (Resolved){doc, NULL, cursor->name, NULL, NULL, false};
+  if (!cursor->name) {
+    return false;
+  }
+  Scope *scope = document_scope(ws, doc);
+
+  if (cursor->qualifier) {
+    ModuleImport *import = find_import(scope, cursor->qualifier);
+    if (import) {
+      Symbol *symbol = scope_lookup_current_only_with_visibility(
+          import->module_scope, cursor->name, scope);
+      out->doc = module_document(ws, import->module_name);
+      out->decl = top_level_decl(out->doc, cursor->name);
+      out->type = symbol ? symbol->type : NULL;
+      return symbol || out->decl;
+    }
+
+    // Enum members are declared as "Enum.member"
+    size_t length = strlen(cursor->qualifier) + strlen(cursor->name) + 2;
+    char *member = arena_alloc(&ws->scratch, length, alignof(char));
+    if (member && scope) {
+      snprintf(member, length, "%s.%s", cursor->qualifier, cursor->name);
+      Symbol *symbol = scope_lookup(scope, member);
+      if (symbol) {
+        out->decl = top_level_decl(doc, cursor->qualifier);
+        out->type = symbol->type;
+        return true;
+      }
+    }
+
+    AstNode *decl = find_struct(ws, doc, scope,
+                                type_of_name(scope, locals, cursor->qualifier));
+    AstNode *field = find_field(decl, cursor->name);
+    if (field) {
+      out->decl = field;
+      out->type = field->stmt.field_decl.type;
+      return true;
+    }
+    return false;
+  }
+
+  const LocalSymbol *local = find_local(locals, cursor->name);
+  if (local) {
+    out->decl = local->decl;
+    out->type = local->type;
+    out->local = local;
+    return true;
+  }
+
+  ModuleImport *import = find_import(scope, cursor->name);
+  if (import) {
+    out->doc = module_document(ws, import->module_name);
+    out->decl = out->doc ? out->doc->module : NULL;
+    out->name = import->module_name;
+    out->is_module = true;
+    return true;
+  }
+
+  Symbol *symbol = scope ? scope_lookup(scope, cursor->name) : NULL;
+  out->decl = top_level_decl(doc, cursor->name);
+  out->type = symbol ? symbol->type : NULL;
+  return symbol || out->decl;
+}
+
+static Location name_location(const Document *doc, const AstNode *decl,
+                              const char *name) {
+  Location location = {(Document *)doc, node_line(doc, decl), 0, 0};
+  size_t name_length = strlen(name);
+
+  // Token lines only grow, so the declaration's first token is found by
+  // bisection; its name follows within a few tokens
+  size_t lo = 0, hi = doc->token_count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if ((size_t)doc->tokens[mid].line < decl->line) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  for (size_t i = lo; i < doc->token_count && i < lo + NAME_SCAN_LIMIT; i++) {
+    const Token *token = &doc->tokens[i];
+    if (token->type_ == TOK_IDENTIFIER &&
+        (size_t)token->length == name_length &&
+        memcmp(token->value, name, name_length) == 0) {
+      size_t start = document_token_start(doc, i);
+      location.line = document_line_of(doc, start);
+      location.start = start - doc->line_starts[location.line];
+      location.end = location.start + name_length;
+      return location;
+    }
+  }
+  return location;
+}
+
+bool workspace_definition(Workspace *ws, Document *doc, size_t offset,
+                          Location *out) {
+  ensure_index(ws);
+  arena_reset(&ws->scratch);
+  Cursor cursor = find_cursor(ws, doc, offset);
+  GrowableArray locals;
+  collect_locals(ws, doc, document_scope(ws, doc), &cursor, &locals);
+
+  Resolved resolved;
+  if (!resolve(ws, doc, &cursor, &locals, &resolved) || !resolved.decl ||
+      !resolved.doc) {
+    return false;
+  }
+  if (resolved.is_module) {
+    *out = (Location){resolved.doc, node_line(resolved.doc, resolved.decl), 0,
+                      0};
+    return true;
+  }
+
+  const char *name = resolved.decl->type == AST_STMT_FIELD_DECL
+                         ? resolved.decl->stmt.field_decl.name
+                         : resolved.name;
+  *out = name_location(resolved.doc, resolved.decl, name);
+  return true;
+}
+
+// type_to_string has no case for function types, so they are spelled here
+static const char *type_text(Workspace *ws, AstNode *type) {
+  if (!type) {
+    return "?";
+  }
+  if (type->type != AST_TYPE_FUNCTION) {
+    return type_to_string(type, &ws->scratch);
+  }
+
+  size_t count = type->type_data.function.param_count;
+  const char **params =
+      arena_alloc(&ws->scratch, (count + 1) * sizeof(char *), alignof(char *));
+  if (!params) {
+    return "?";
+  }
+  size_t capacity = 16;
+  for (size_t i = 0; i < count; i++) {
+    params[i] = type_text(ws, type->type_data.function.param_types[i]);
+    capacity += strlen(params[i]) + 2;
+  }
+  const char *ret = type_text(ws, type->type_data.function.return_type);
+  capacity += strlen(ret);
+
+  char *text = arena_alloc(&ws->scratch, capacity, alignof(char));
+  if (!text) {
+    return "?";
+  }
+  size_t n = (size_t)snprintf(text, capacity, "fn(");
+  for (size_t i = 0; i < count; i++) {
+    n += (size_t)snprintf(text + n, capacity - n, "%s%s", i > 0 ? ", " : "",
+                          params[i]);
+  }
+  snprintf(text + n, capacity - n, ") %s", ret);
+  return text;
+}
+
+static const char *function_signature(Workspace *ws, const AstNode *fn) {
+  size_t capacity = 256;
+  for (size_t i = 0; i < fn->stmt.func_decl.param_count; i++) {
+    capacity += strlen(fn->stmt.func_decl.param_names[i]) + 64;
+  }
+  char *text = arena_alloc(&ws->scratch, capacity, alignof(char));
+  if (!text) {
+    return "";
+  }
+
+  size_t n = (size_t)snprintf(text, capacity, "%s%sfn %s(",
+                              fn->stmt.func_decl.is_public ? "pub " : "",
+                              fn->stmt.func_decl.is_extern ? "extern " : "",
+                              fn->stmt.func_decl.name);
+  for (size_t i = 0; i < fn->stmt.func_decl.param_count && n < capacity;
+       i++) {
+    n += (size_t)snprintf(
+        text + n, capacity - n, "%s%s: %s", i > 0 ? ", " : "",
+        fn->stmt.func_decl.param_names[i],
+        type_text(ws, fn->stmt.func_decl.param_types[i]));
+  }
+  if (n < capacity) {
+    snprintf(text + n, capacity - n, ") %s",
+             type_text(ws, fn->stmt.func_decl.return_type));
+  }
+  return text;
+}
+
+const char *workspace_hover(Workspace *ws, Document *doc, size_t offset) {
+  ensure_index(ws);
+  arena_reset(&ws->scratch);
+  Cursor cursor = find_cursor(ws, doc, offset);
+  GrowableArray locals;
+  collect_locals(ws, doc, document_scope(ws, doc), &cursor, &locals);
+
+  Resolved r;
+  if (!resolve(ws, doc, &cursor, &locals, &r)) {
+    return NULL;
+  }
+
+  const char *text;
+  if (r.is_module) {
+    text = r.name;
+  } else if (r.local) {
+    text = r.local->is_param ? "(parameter) " : r.local->is_mutable ? "let "
+                                                                    : "const ";
+  } else {
+    text = "";
+  }
+
+  const char *detail;
+  if (r.is_module) {
+    detail = "";
+  } else if (r.decl && r.decl->type == AST_STMT_FUNCTION && !r.local) {
+    detail = function_signature(ws, r.decl);
+  } else if (r.decl && r.decl->type == AST_STMT_STRUCT) {
+    detail = "struct";
+  } else if (r.decl && r.decl->type == AST_STMT_ENUM && !r.type) {
+    detail = "enum";
+  } else {
+    detail = type_text(ws, r.type);
+  }
+
+  size_t capacity = strlen(text) + strlen(detail) + strlen(r.name) + 64;
+  char *markdown = arena_alloc(&ws->scratch, capacity, alignof(char));
+  if (!markdown) {
+    return NULL;
+  }
+  if (r.is_module) {
+    snprintf(markdown, capacity, "```lux\n@module \"%s\"\n```", r.name);
+  } else if (r.decl && r.decl->type == AST_STMT_FUNCTION && !r.local) {
+    snprintf(markdown, capacity, "```lux\n%s\n```", detail);
+  } else if (r.decl && r.decl->type == AST_STMT_STRUCT) {
+    snprintf(markdown, capacity, "```lux\nstruct %s\n```", r.name);
+  } else {
+    snprintf(markdown, capacity, "```lux\n%s%s: %s\n```", text,
+             cursor.qualifier && !r.local ? cursor.name : r.name, detail);
+  }
+  return markdown;
+}
+
+static bool add_completion(GrowableArray *items, const char *label,
+                           const char *detail, CompletionKind kind) {
+  Completion *item = (Completion *)growable_array_push(items);
+  if (!item) {
+    return false;
+  }
+  *item = (Completion){label, detail, kind};
+  return true;
+}
+
+static CompletionKind symbol_kind(const Symbol *symbol) {
+  if (symbol->type && symbol->type->type == AST_TYPE_FUNCTION) {
+    return COMPLETION_FUNCTION;
+  }
+  if (symbol->type && symbol->type->type == AST_TYPE_BASIC &&
+      strcmp(symbol->type->type_data.basic.name, "struct") == 0) {
+    return COMPLETION_STRUCT;
+  }
+  return COMPLETION_VARIABLE;
+}
+
+static bool matches(const char *label, const char *prefix) {
+  return strncmp(label, prefix, strlen(prefix)) == 0;
+}
+
+// Shown next to a symbol; functions get the signature hover shows
+static const char *symbol_detail(Workspace *ws, const Document *doc,
+                                 const Symbol *symbol) {
+  AstNode *decl = symbol_kind(symbol) == COMPLETION_FUNCTION
+                      ? top_level_decl(doc, symbol->name)
+                      : NULL;
+  if (decl && decl->type == AST_STMT_FUNCTION) {
+    return function_signature(ws, decl);
+  }
+  return type_text(ws, symbol->type);
+}
+
+// Adds the symbols of a module scope, declared in doc; with a qualifier only
+// its members
+static void complete_scope(Workspace *ws, GrowableArray *items,
+                           const Document *doc, Scope *scope,
+                           const char *prefix, const char *member_of,
+                           bool public_only) {
+  size_t member_length = member_of ? strlen(member_of) : 0;
+  for (size_t i = 0; i < scope->symbols.count; i++) {
+    const Symbol *symbol = (const Symbol *)scope->symbols.data + i;
+    const char *label = symbol->name;
+    CompletionKind kind = symbol_kind(symbol);
+    if (member_of) {
+      if (strncmp(label, member_of, member_length) != 0 ||
+          label[member_length] != '.') {
+        continue;
+      }
+      label += member_length + 1;
+      kind = COMPLETION_ENUM_MEMBER;
+    } else if (strchr(label, '.')) {
+      continue;
+    }
+    if ((public_only && !symbol->is_public) || !matches(label, prefix)) {
+      continue;
+    }
+    add_completion(items, label, symbol_detail(ws, doc, symbol), kind);
+  }
+}
+
+size_t workspace_completion(Workspace *ws, Document *doc, size_t offset,
+                            Completion **out) {
+  ensure_index(ws);
+  arena_reset(&ws->scratch);
+  Cursor cursor = find_cursor(ws, doc, offset);
+  Scope *scope = document_scope(ws, doc);
+  GrowableArray locals, items;
+  collect_locals(ws, doc, scope, &cursor, &locals);
+  if (!growable_array_init(&items, &ws->scratch, 64, sizeof(Completion))) {
+    return 0;
+  }
+  const char *prefix = cursor.prefix ? cursor.prefix : "";
+
+  if (cursor.qualifier) {
+    ModuleImport *import = find_import(scope, cursor.qualifier);
+    if (import) {
+      complete_scope(ws, &items, module_document(ws, import->module_name),
+                     import->module_scope, prefix, NULL, true);
+    } else if (scope) {
+      complete_scope(ws, &items, doc, scope, prefix, cursor.qualifier, false);
+      AstNode *decl = find_struct(ws, doc, scope,
+                                  type_of_name(scope, &locals,
+                                               cursor.qualifier));
+      for (int section = 0; decl && section < 2; section++) {
+        size_t count;
+        AstNode **members = struct_members(decl, section, &count);
+        for (size_t i = 0; i < count; i++) {
+          if (members[i] && matches(members[i]->stmt.field_decl.name, prefix)) {
+            add_completion(&items, members[i]->stmt.field_decl.name,
+                           type_text(ws, members[i]->stmt.field_decl.type),
+                           COMPLETION_FIELD);
+          }
+        }
+      }
+    }
+    *out = (Completion *)items.data;
+    return items.count;
+  }
+
+  // Innermost first, so a shadowing local is offered rather than its victim
+  const LocalSymbol *list = (const LocalSymbol *)locals.data;
+  for (size_t i = locals.count; i > 0; i--) {
+    const LocalSymbol *local = &list[i - 1];
+    if (matches(local->name, prefix) &&
+        find_local(&locals, local->name) == local) {
+      add_completion(&items, local->name, type_text(ws, local->type),
+                     COMPLETION_VARIABLE);
+    }
+  }
+  if (scope) {
+    complete_scope(ws, &items, doc, scope, prefix, NULL, false);
+    for (size_t i = 0; i < scope->imported_modules.count; i++) {
+      ModuleImport *import = (ModuleImport *)scope->imported_modules.data + i;
+      if (matches(import->alias, prefix)) {
+        add_completion(&items, import->alias, import->module_name,
+                       COMPLETION_MODULE);
+      }
+    }
+  }
+  *out = (Completion *)items.data;
+  return items.count;
+}
@@ -0,0 +1,157 @@
+/**
+ * @file workspace.h
+ * @brief Semantic index of the documents a language server knows about.
+ *
+ * The workspace holds the documents open in the editor plus the modules they
+ * `@use`, read from disk next to the using file or from the `-I`
+ * directories. Its index is what the typechecker's phase 1 builds for a
+ * compiler run: a global Scope with one module Scope per module, filled with
+ * every declaration but no function body (see typecheck_declarations()).
+ *
+ * - The index is rebuilt only after a document was parsed again, i.e. after
+ *   an edit outside function bodies; body edits leave it alone.
+ * - Function bodies are checked one at a time against the index, only for
+ *   open documents and only when stale: after their own body changed, or
+ *   after the declarations of their module or of a module they depend on
+ *   did. The server runs these checks while the editor is quiet.
+ * - Queries look names up in the index, plus the locals of the function
+ *   under the cursor, whose body is parsed on demand.
+ *
+ * Positions in this interface are byte offsets into a document's text.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "../ast/module_graph.h"
+#include "../typechecker/type.h"
+#include "document.h"
+
+/**
+ * @brief Semantic state shared by every document.
+ */
+typedef struct {
+  GrowableArray documents;   /**< Document *, open ones and their uses */
+  const char **include_dirs; /**< -I module search directories */
+  size_t include_count;      /**< Number of @c include_dirs */
+  ArenaAllocator arena;      /**< Long-lived workspace data */
+
+  ArenaAllocator index_arena; /**< Scopes and graph; reset on rebuild */
+  bool index_stale;           /**< Rebuild before the next use */
+  GrowableArray changed;      /**< char *, modules whose declarations changed */
+  GrowableArray notes;        /**< Diagnostics the index has for documents */
+  Scope global_scope;         /**< Root of the index */
+  ModuleGraph graph;          /**< Indexed modules */
+  bool has_graph;             /**< @c graph, @c scopes and @c nodes are valid */
+  Scope **scopes;             /**< Module scope per graph node */
+  Document **nodes;           /**< Document per graph node */
+  bool *declared;             /**< Per graph node: declared without errors */
+
+  ArenaAllocator scratch; /**< Per query and per body check */
+  FILE *capture;          /**< Collects stderr output of the typechecker */
+} Workspace;
+
+/**
+ * @brief A place in a document, in byte columns.
+ */
+typedef struct {
+  Document *doc; /**< Document of the place */
+  size_t line;   /**< 0-based line */
+  size_t start;  /**< First byte on the line */
+  size_t end;    /**< One past the last byte on the line */
+} Location;
+
+/** LSP CompletionItemKind values used by completion items */
+typedef enum {
+  COMPLETION_FIELD = 5,
+  COMPLETION_VARIABLE = 6,
+  COMPLETION_FUNCTION = 3,
+  COMPLETION_MODULE = 9,
+  COMPLETION_ENUM = 13,
+  COMPLETION_ENUM_MEMBER = 20,
+  COMPLETION_STRUCT = 22
+} CompletionKind;
+
+/**
+ * @brief One completion candidate.
+ */
+typedef struct {
+  const char *label;   /**< Text to insert */
+  const char *detail;  /**< Type shown next to it */
+  CompletionKind kind; /**< Icon shown by the editor */
+} Completion;
+
+/**
+ * @brief Initializes an empty workspace.
+ * @return false if out of memory.
+ */
+bool workspace_init(Workspace *ws, const char **include_dirs,
+                    size_t include_count);
+
+/**
+ * @brief Frees every document and the index.
+ */
+void workspace_free(Workspace *ws);
+
+/**
+ * @brief Finds a document by URI, open or not.
+ */
+Document *workspace_find(Workspace *ws, const char *uri);
+
+/**
+ * @brief Opens a document with the editor's text.
+ * @return The document, or NULL if out of memory.
+ */
+Document *workspace_open(Workspace *ws, const char *uri, const char *text,
+                         size_t length);
+
+/**
+ * @brief Applies one change sent by the editor to an open document.
+ */
+void workspace_change(Workspace *ws, Document *doc,
+                      const DocumentChange *change, bool utf16);
+
+/**
+ * @brief Closes a document; a module still used by others is read from disk.
+ */
+void workspace_close(Workspace *ws, Document *doc);
+
+/**
+ * @brief Whether any body check is waiting.
+ */
+bool workspace_has_pending(Workspace *ws);
+
+/**
+ * @brief Checks one stale function body.
+ * @return The document if this finished its last stale check, else NULL.
+ */
+Document *workspace_check_next(Workspace *ws);
+
+/**
+ * @brief Collects every diagnostic of a document.
+ * @return Number of diagnostics stored in @p out.
+ */
+size_t workspace_diagnostics(Workspace *ws, Document *doc, Diagnostic **out);
+
+/**
+ * @brief Finds where the name at @p offset is declared.
+ * @return false if there is no name there or it is not declared anywhere.
+ */
+bool workspace_definition(Workspace *ws, Document *doc, size_t offset,
+                          Location *out);
+
+/**
+ * @brief Describes the name at @p offset.
+ * @return Markdown text, or NULL if there is nothing to show.
+ */
+const char *workspace_hover(Workspace *ws, Document *doc, size_t offset);
+
+/**
+ * @brief Lists the names that can be written at @p offset.
+ * @return Number of candidates stored in @p out.
+ */
+size_t workspace_completion(Workspace *ws, Document *doc, size_t offset,
+                            Completion **out);
@@ -14,6 +14,7 @@
  * ## Usage
  * ```bash
  * lux build <source_file>
+ * lux run <source_file> [--interp]
  * ```
  *
  * Example:
@@ -23,7 +24,9 @@
  */
 
 #include "c_libs/memory/memory.h"
+#include "helper/build_cache.h"
 #include "helper/help.h"
+#include "lsp/lsp.h"
 
 /**
  * @brief Program entry point.
@@ -57,16 +60,41 @@ int main(int argc, char *argv[]) {
     return ARGC_ERROR;
   }
 
+  // The language server takes its sources from the editor
+  if (config.lsp) {
+    bool served = run_lsp(config);
+    arena_destroy(&allocator);
+    return served ? 0 : 1;
+  }
+
+  // A stand-in object store for -cache http://
+  if (config.cache_server) {
+    bool served = run_cache_server(config.cache_server,
+                                   config.bind_address, config.port);
+    arena_destroy(&allocator);
+    return served ? 0 : 1;
+  }
+
   // Step 4: Ensure a source file was provided
   if (!config.filepath) {
     fprintf(stderr, "No source file provided.\n");
     return ARGC_ERROR;
   }
 
-  // Step 6: Run build process
-  bool success = run_build(config, &allocator);
+  // luma run: exit with the program's status
+  if (config.run && !config.watch) {
+    int status = run_command(config, &allocator);
+    LLVMShutdown();
+    arena_destroy(&allocator);
+    return status;
+  }
+
+  // Step 6: Run build process (or keep rebuilding in watch mode)
+  bool success =
+      config.watch ? run_watch(config) : run_build(config, &allocator);
 
   // Step 7: Clean up resources
+  LLVMShutdown();
   arena_destroy(&allocator);
 
   // Step 8: Return exit status
@@ -42,20 +42,27 @@ Expr *primary(Parser *parser) {
   LiteralType lit_type = PRIMARY_LITERAL_TYPE_MAP[current.type_];
 
   if (lit_type != LITERAL_NULL) {
+    // Numbers and strings were decoded by the lexer
+    const TokenLiteral *literal = NULL;
+    if (lit_type == LITERAL_INT || lit_type == LITERAL_FLOAT ||
+        lit_type == LITERAL_DOUBLE || lit_type == LITERAL_STRING) {
+      literal = token_literal(&current, parser->arena);
+      if (!literal) {
+        return NULL;
+      }
+    }
+
     void *value = NULL;
     switch (lit_type) {
     case LITERAL_INT:
-      value = arena_alloc(parser->arena, sizeof(long long), alignof(long long));
-      *(long long *)value = strtoll(current.value, NULL, 10);
+      value = (void *)&literal->int_val;
       break;
     case LITERAL_FLOAT:
-      value = arena_alloc(parser->arena, sizeof(double), alignof(double));
-      *(double *)value = strtod(current.value, NULL);
+    case LITERAL_DOUBLE:
+      value = (void *)&literal->float_val;
       break;
     case LITERAL_STRING:
-      value = arena_alloc(parser->arena, strlen(get_name(parser)) + 1,
-                          alignof(char));
-      strcpy((char *)value, get_name(parser));
+      value = (void *)literal->string_val;
       break;
     case LITERAL_CHAR:
       value = arena_alloc(parser->arena, sizeof(char), alignof(char));
@@ -132,7 +139,7 @@ Expr *call_expr(Parser *parser, Expr *left, BindingPower bp) {
   }
 
   p_consume(parser, TOK_LPAREN, "Expected '(' for function call");
-  while (p_current(parser).type_ != TOK_RPAREN) {
+  while (p_has_tokens(parser) && p_current(parser).type_ != TOK_RPAREN) {
     Expr *arg = parse_expr(parser, BP_LOWEST);
     if (!arg) {
       fprintf(stderr, "Expected expression inside function call\n");
@@ -144,9 +151,10 @@ Expr *call_expr(Parser *parser, Expr *left, BindingPower bp) {
       return NULL;
     }
     *slot = arg;
-    if (p_current(parser).type_ == TOK_COMMA) {
-      p_advance(parser); // Consume the comma
+    if (p_current(parser).type_ != TOK_COMMA) {
+      break; // Anything but ',' must be the closing ')'
     }
+    p_advance(parser); // Consume the comma
   }
   p_consume(parser, TOK_RPAREN, "Expected ')' to close function call");
 
@@ -195,8 +203,11 @@ Expr *prefix_expr(Parser *parser, Expr *left, BindingPower bp) {
   case TOK_DOT:
     p_advance(parser); // Consume the '.' token
     if (p_current(parser).type_ != TOK_IDENTIFIER) {
-      fprintf(stderr, "Expected identifier after '.' for member access\n");
-      return NULL;
+      parser_error(parser, "SyntaxError", parser->file_path,
+                   "Expected identifier after '.' for member access",
+                   p_current(parser).line, p_current(parser).col,
+                   CURRENT_TOKEN_LENGTH(parser));
+      return create_error_expr(parser->arena, line, col);
     }
     char *member = get_name(parser);
     p_advance(parser); // Consume the identifier token
@@ -226,7 +237,7 @@ Expr *array_expr(Parser *parser) {
   }
 
   p_consume(parser, TOK_LBRACKET, "Expected '[' for array expression");
-  while (p_current(parser).type_ != TOK_RBRACKET) {
+  while (p_has_tokens(parser) && p_current(parser).type_ != TOK_RBRACKET) {
     Expr *element = parse_expr(parser, BP_LOWEST);
     if (!element) {
       fprintf(stderr, "Expected expression inside array\n");
@@ -241,9 +252,10 @@ Expr *array_expr(Parser *parser) {
 
     *slot = element;
 
-    if (p_current(parser).type_ == TOK_COMMA) {
-      p_advance(parser); // Consume the comma
+    if (p_current(parser).type_ != TOK_COMMA) {
+      break; // Anything but ',' must be the closing ']'
     }
+    p_advance(parser); // Consume the comma
   }
   p_consume(parser, TOK_RBRACKET, "Expected ']' to close array expression");
 
@@ -41,17 +41,28 @@
  * @param col Column number where the error occurred (1-based)
  * @param tk_length Length of the token that caused the error
  *
+ * @note The parser's own file path, when set, takes precedence over @p file
+ * @note While the parser is in panic mode further errors are ignored
  * @note This function uses the arena allocator to duplicate the line text
  * @see ErrorInformation, error_add()
  */
 void parser_error(Parser *psr, const char *error_type, const char *file,
                   const char *msg, int line, int col, int tk_length) {
+  // Only the first error of a statement is reported; the rest are usually
+  // fallout from it and are dropped until p_synchronize() runs
+  if (psr->panic) {
+    return;
+  }
+  psr->panic = true;
+  psr->error_count++;
+
   // Use the same approach as the lexer to get the line text
-  const char *line_text = get_line_text_from_source(psr->tks->value, line);
+  const char *line_text =
+      psr->source ? get_line_text_from_source(psr->source, line) : "";
 
   ErrorInformation err = {
       .error_type = error_type,
-      .file_path = file,
+      .file_path = psr->file_path ? psr->file_path : file,
       .message = msg,
       .line = line,
       .col = col,
@@ -73,6 +84,9 @@ void parser_error(Parser *psr, const char *error_type, const char *file,
  *
  * @param tks Growable array containing all tokens from the lexer
  * @param arena Arena allocator for memory management during parsing
+ * @param file_path Source file name used in diagnostics
+ * @param skim_bodies Record function bodies as token ranges instead of
+ *                    parsing them; see parse_deferred_body()
  *
  * @return Pointer to the root AST node (Program node) containing all parsed
  * statements, or NULL if parsing fails
@@ -80,11 +94,14 @@ void parser_error(Parser *psr, const char *error_type, const char *file,
  * @note The function estimates the initial capacity for statements based on
  * token count
  * @note All memory allocations use the provided arena allocator
+ * @note A statement with a syntax error does not end parsing; see
+ *       parse_stmt_recover()
  *
  * @see Parser, parse_stmt(), create_program_node()
  */
 
-Stmt *parse(GrowableArray *tks, ArenaAllocator *arena) {
+Stmt *parse(GrowableArray *tks, ArenaAllocator *arena, const char *file_path,
+            bool skim_bodies) {
     // Initialize parser
     Parser parser = {
         .arena = arena,
@@ -92,6 +109,11 @@ Stmt *parse(GrowableArray *tks, ArenaAllocator *arena) {
         .tk_count = tks->count,
         .capacity = (tks->count / 4) + 10,
         .pos = 0,
+        .file_path = file_path,
+        .source = tks->count > 0 ? ((Token *)tks->data)[0].value : NULL,
+        .panic = false,
+        .error_count = 0,
+        .skim_bodies = skim_bodies,
     };
 
     if (!parser.tks) {
@@ -126,11 +148,7 @@ Stmt *parse(GrowableArray *tks, ArenaAllocator *arena) {
 
     // Parse all statements
     while (p_current(&parser).type_ != TOK_EOF) {
-        Stmt *stmt = parse_stmt(&parser);
-        if (!stmt) {
-            // Error already reported in parse_stmt
-            return NULL;
-        }
+        Stmt *stmt = parse_stmt_recover(&parser);
 
         Stmt **slot = (Stmt **)growable_array_push(&stmts);
         if (!slot) {
@@ -152,18 +170,55 @@ Stmt *parse(GrowableArray *tks, ArenaAllocator *arena) {
                                0, 0);
 }
 /**
- * @brief Gets the binding power (precedence) for a given token type
+ * @brief Parses a function body recorded by fn_stmt() in skim mode
  *
- * This function is crucial for the Pratt parser implementation. It returns
- * the binding power (precedence level) for different operators, which
- * determines the order of operations during expression parsing.
+ * Runs a fresh parser over just the body's tokens; the only state it shares
+ * with anything else is the global error list, so bodies of different
+ * functions can be parsed on different threads.
  *
- * Higher binding power values indicate higher precedence operators.
+ * @param func Function declaration whose body may be deferred
+ * @param arena Arena for the body's AST nodes
  *
- * @param kind The token type to get binding power for
+ * @return true if the body parsed without syntax errors (or was not
+ *         deferred, or was parsed already), false otherwise
+ *
+ * @see fn_stmt(), DeferredBody
+ */
+bool parse_deferred_body(AstNode *func, ArenaAllocator *arena) {
+  DeferredBody *deferred = func->stmt.func_decl.deferred;
+  if (!deferred || func->stmt.func_decl.body) {
+    return true;
+  }
+
+  Parser parser = {
+      .arena = arena,
+      .tks = (Token *)deferred->tokens,
+      .tk_count = deferred->token_count,
+      .capacity = (deferred->token_count / 4) + 10,
+      .pos = 0,
+      .file_path = deferred->file_path,
+      .source = deferred->source,
+      .panic = false,
+      .error_count = 0,
+      .skim_bodies = false,
+  };
+
+  Stmt *body = block_stmt(&parser);
+  func->stmt.func_decl.body = body;
+  return body && parser.error_count == 0;
+}
+
+/**
+ * @brief Pratt parser rules indexed directly by token type
+ *
+ * Each entry holds the prefix (nud) handler, the infix/postfix (led) handler
+ * and the binding power a token has when it appears after an expression.
+ * Looking a token up is a single array index instead of three switches, and
+ * parse_expr() reads the binding power once per operator.
  *
- * @return BindingPower enumeration value representing the precedence level
- *         Returns BP_NONE for tokens that don't have binding power
+ * Tokens without an entry have no handlers and BP_NONE. A token with a
+ * binding power but no led handler (currently `?`) is skipped, matching the
+ * old fallback behaviour.
  *
  * @note Precedence levels (highest to lowest):
  *       - BP_CALL: Function calls, member access, indexing
@@ -177,66 +232,83 @@ Stmt *parse(GrowableArray *tks, ArenaAllocator *arena) {
  *       - BP_TERNARY: Ternary conditional operator
  *       - BP_ASSIGN: Assignment operators
  *
- * @see BindingPower, TokenType
+ * @see ParseRule, get_bp(), nud(), led(), parse_expr()
  */
-BindingPower get_bp(TokenType kind) {
-  switch (kind) {
-  // Assignment
-  case TOK_EQUAL:
-    return BP_ASSIGN;
-
-  // Ternary
-  case TOK_QUESTION:
-    return BP_TERNARY;
-
-  // Logical
-  case TOK_OR:
-    return BP_LOGICAL_OR;
-  case TOK_AND:
-    return BP_LOGICAL_AND;
-
-  // Bitwise
-  case TOK_PIPE:
-    return BP_BITWISE_OR;
-  case TOK_CARET:
-    return BP_BITWISE_XOR;
-  case TOK_AMP:
-    return BP_BITWISE_AND;
-
-  // Equality
-  case TOK_EQEQ:
-  case TOK_NEQ:
-    return BP_EQUALITY;
-
-  // Relational
-  case TOK_LT:
-  case TOK_LE:
-  case TOK_GT:
-  case TOK_GE:
-    return BP_RELATIONAL;
-
-  // Arithmetic
-  case TOK_PLUS:
-  case TOK_MINUS:
-    return BP_SUM;
-  case TOK_STAR:
-  case TOK_SLASH:
-    return BP_PRODUCT;
-
-  // Postfix
-  case TOK_PLUSPLUS:
-  case TOK_MINUSMINUS:
-    return BP_POSTFIX;
-
-  // Call/indexing/member access
-  case TOK_LPAREN:
-  case TOK_LBRACKET:
-  case TOK_DOT:
-    return BP_CALL;
+static const ParseRule PARSE_RULES[TOKEN_TYPE_COUNT] = {
+    // Primary expressions
+    [TOK_NUMBER] = {primary, NULL, BP_NONE},
+    [TOK_NUM_FLOAT] = {primary, NULL, BP_NONE},
+    [TOK_NUM_DOUBLE] = {primary, NULL, BP_NONE},
+    [TOK_STRING] = {primary, NULL, BP_NONE},
+    [TOK_IDENTIFIER] = {primary, NULL, BP_NONE},
+
+    // Prefix-only operators and builtins
+    [TOK_BANG] = {unary, NULL, BP_NONE},
+    [TOK_ALLOC] = {alloc_expr, NULL, BP_NONE},
+    [TOK_MEMCPY] = {memcpy_expr, NULL, BP_NONE},
+    [TOK_FREE] = {free_expr, NULL, BP_NONE},
+    [TOK_CAST] = {cast_expr, NULL, BP_NONE},
+    [TOK_SIZE_OF] = {sizeof_expr, NULL, BP_NONE},
+
+    // Assignment and ternary
+    [TOK_EQUAL] = {NULL, assign_expr, BP_ASSIGN},
+    [TOK_QUESTION] = {NULL, NULL, BP_TERNARY},
+
+    // Logical
+    [TOK_OR] = {NULL, binary, BP_LOGICAL_OR},
+    [TOK_AND] = {NULL, binary, BP_LOGICAL_AND},
+
+    // Bitwise
+    [TOK_PIPE] = {NULL, binary, BP_BITWISE_OR},
+    [TOK_CARET] = {NULL, binary, BP_BITWISE_XOR},
+    [TOK_AMP] = {addr_expr, binary, BP_BITWISE_AND},
+
+    // Equality and relational
+    [TOK_EQEQ] = {NULL, binary, BP_EQUALITY},
+    [TOK_NEQ] = {NULL, binary, BP_EQUALITY},
+    [TOK_LT] = {NULL, binary, BP_RELATIONAL},
+    [TOK_LE] = {NULL, binary, BP_RELATIONAL},
+    [TOK_GT] = {NULL, binary, BP_RELATIONAL},
+    [TOK_GE] = {NULL, binary, BP_RELATIONAL},
+
+    // Arithmetic
+    [TOK_PLUS] = {unary, binary, BP_SUM},
+    [TOK_MINUS] = {unary, binary, BP_SUM},
+    [TOK_STAR] = {deref_expr, binary, BP_PRODUCT},
+    [TOK_SLASH] = {NULL, binary, BP_PRODUCT},
+
+    // Prefix or postfix increment/decrement
+    [TOK_PLUSPLUS] = {unary, prefix_expr, BP_POSTFIX},
+    [TOK_MINUSMINUS] = {unary, prefix_expr, BP_POSTFIX},
+
+    // Grouping, array literals, calls, indexing and member access
+    [TOK_LPAREN] = {grouping, call_expr, BP_CALL},
+    [TOK_LBRACKET] = {array_expr, prefix_expr, BP_CALL},
+    [TOK_DOT] = {NULL, prefix_expr, BP_CALL},
+};
 
-  default:
-    return BP_NONE;
-  }
+/**
+ * @brief Type of the current token, without copying the token
+ */
+static inline TokenType p_current_type(const Parser *parser) {
+  return parser->pos < parser->tk_count ? parser->tks[parser->pos].type_
+                                        : TOK_EOF;
+}
+
+/**
+ * @brief Gets the binding power (precedence) for a given token type
+ *
+ * Higher binding power values indicate higher precedence operators.
+ *
+ * @param kind The token type to get binding power for
+ *
+ * @return BindingPower from PARSE_RULES, BP_NONE for tokens that don't have
+ *         binding power
+ *
+ * @see PARSE_RULES, BindingPower, TokenType
+ */
+BindingPower get_bp(TokenType kind) {
+  return (unsigned)kind < TOKEN_TYPE_COUNT ? PARSE_RULES[kind].bp : BP_NONE;
 }
 
 /**
@@ -244,57 +316,35 @@ BindingPower get_bp(TokenType kind) {
  *
  * This is part of the Pratt parser implementation. The "nud" function handles
  * tokens that can appear at the beginning of an expression (prefix operators
- * and primary expressions like literals and identifiers).
+ * and primary expressions like literals and identifiers), dispatching through
+ * the nud column of PARSE_RULES.
  *
  * @param parser Pointer to the parser instance
  *
- * @return Pointer to the parsed expression AST node, or NULL if parsing fails
- *
- * @note Handles:
- *       - Primary expressions: numbers, strings, identifiers
- *       - Prefix unary operators: -, +, !, ++, --
- *       - Grouped expressions: (expression)
- *       - Array literals: [expression, ...]
+ * @return Pointer to the parsed expression AST node. A token with no prefix
+ *         handler is reported and yields an AST_EXPR_ERROR node; it is
+ *         skipped unless it closes an enclosing construct (`;`, `)`, ...).
  *
- * @see led(), parse_expr(), primary(), unary(), grouping(), array_expr()
+ * @see led(), parse_expr(), PARSE_RULES
  */
 Expr *nud(Parser *parser) {
-  switch (p_current(parser).type_) {
-  case TOK_NUMBER:
-  case TOK_NUM_FLOAT:
-  case TOK_STRING:
-  case TOK_IDENTIFIER:
-    return primary(parser);
-  case TOK_MINUS:
-  case TOK_PLUS:
-  case TOK_BANG:
-  case TOK_PLUSPLUS:
-  case TOK_MINUSMINUS:
-    return unary(parser);
-  case TOK_LPAREN:
-    return grouping(parser);
-  case TOK_LBRACKET:
-    return array_expr(parser);
-  case TOK_STAR:
-    return deref_expr(parser);
-  case TOK_AMP:
-    return addr_expr(parser);
-  case TOK_ALLOC:
-    return alloc_expr(parser);
-  case TOK_MEMCPY:
-    return memcpy_expr(parser);
-  case TOK_FREE:
-    return free_expr(parser);
-  case TOK_CAST:
-    return cast_expr(parser);
-
-  // Compile time
-  case TOK_SIZE_OF:
-    return sizeof_expr(parser);
-  default:
+  TokenType kind = p_current_type(parser);
+  NudFn handler = PARSE_RULES[kind].nud;
+  if (handler) {
+    return handler(parser);
+  }
+
+  int line = p_current(parser).line;
+  int col = p_current(parser).col;
+  parser_error(parser, "SyntaxError", parser->file_path, "Expected expression",
+               line, col, CURRENT_TOKEN_LENGTH(parser));
+
+  // Leave closing tokens in place so the enclosing construct can still end
+  if (kind != TOK_SEMICOLON && kind != TOK_RBRACE && kind != TOK_RPAREN &&
+      kind != TOK_RBRACKET && kind != TOK_COMMA) {
     p_advance(parser);
-    return NULL;
   }
+  return create_error_expr(parser->arena, line, col);
 }
 
 /**
@@ -302,7 +352,7 @@ Expr *nud(Parser *parser) {
  *
  * This is part of the Pratt parser implementation. The "led" function handles
  * tokens that can appear after an expression has been parsed (binary operators
- * and postfix operators).
+ * and postfix operators), dispatching through the led column of PARSE_RULES.
  *
  * @param parser Pointer to the parser instance
  * @param left The left operand expression (already parsed)
@@ -311,48 +361,15 @@ Expr *nud(Parser *parser) {
  * @return Pointer to the parsed expression AST node incorporating the left
  * operand, or the original left expression if no valid LED is found
  *
- * @note Handles:
- *       - Binary arithmetic and logical operators: +, -, *, /, ==, !=, etc.
- *       - Function calls: function(args)
- *       - Assignment: variable = value
- *       - Member access: object.member
- *       - Postfix operators: variable++, variable--
- *       - Array indexing: array[index]
- *
- * @see nud(), parse_expr(), binary(), call_expr(), assign_expr(), prefix_expr()
+ * @see nud(), parse_expr(), PARSE_RULES
  */
 Expr *led(Parser *parser, Expr *left, BindingPower bp) {
-  switch (p_current(parser).type_) {
-  case TOK_PLUS:
-  case TOK_MINUS:
-  case TOK_STAR:
-  case TOK_SLASH:
-  case TOK_EQEQ:
-  case TOK_NEQ:
-  case TOK_LT:
-  case TOK_LE:
-  case TOK_GT:
-  case TOK_GE:
-  case TOK_AMP:
-  case TOK_PIPE:
-  case TOK_CARET:
-  case TOK_AND: // Add logical AND
-  case TOK_OR:  // Add logical OR
-    return binary(parser, left, bp);
-  case TOK_LPAREN:
-    return call_expr(parser, left, bp);
-  case TOK_EQUAL:
-    return assign_expr(parser, left, bp);
-  case TOK_DOT:
-  case TOK_PLUSPLUS:
-  case TOK_MINUSMINUS:
-  case TOK_LBRACKET:
-    // Handle member access, postfix increment/decrement, and indexing
-    return prefix_expr(parser, left, bp);
-  default:
+  LedFn handler = PARSE_RULES[p_current_type(parser)].led;
+  if (!handler) {
     p_advance(parser);
     return left; // No valid LED found, return left expression
   }
+  return handler(parser, left, bp);
 }
 
 /**
@@ -371,16 +388,28 @@ Expr *led(Parser *parser, Expr *left, BindingPower bp) {
  * @note The algorithm works by:
  *       1. Getting the left expression using nud()
  *       2. While the next operator has higher binding power than bp:
- *          - Use led() to extend the expression with the operator
+ *          - Use its led handler to extend the expression with the operator
  *       3. Return the final expression
  *
- * @see nud(), led(), get_bp(), BindingPower
+ * @note The rule for the operator is looked up once per iteration; TOK_EOF
+ *       has BP_NONE, so the loop also stops at the end of the token stream.
+ *
+ * @see nud(), led(), PARSE_RULES, BindingPower
  */
 Expr *parse_expr(Parser *parser, BindingPower bp) {
   Expr *left = nud(parser);
 
-  while (p_has_tokens(parser) && get_bp(p_current(parser).type_) > bp) {
-    left = led(parser, left, get_bp(p_current(parser).type_));
+  for (;;) {
+    const ParseRule *rule = &PARSE_RULES[p_current_type(parser)];
+    if (rule->bp <= bp) {
+      break;
+    }
+
+    if (rule->led) {
+      left = rule->led(parser, left, rule->bp);
+    } else {
+      p_advance(parser);
+    }
   }
 
   return left;
@@ -450,6 +479,48 @@ Stmt *parse_stmt(Parser *parser) {
   }
 }
 
+/**
+ * @brief Parses a single statement and recovers from any syntax error in it
+ *
+ * Wraps parse_stmt() for statement lists (the top level and blocks). If the
+ * statement reported an error, the parser is resynchronized with
+ * p_synchronize() so the following statements are still parsed and their
+ * errors reported in the same run.
+ *
+ * @param parser Pointer to the parser instance
+ *
+ * @return The parsed statement, possibly containing AST_EXPR_ERROR nodes, or
+ *         an AST_STMT_ERROR node if nothing usable was parsed. Never NULL.
+ *
+ * @note Always consumes at least one token, so callers looping until `}` or
+ *       EOF cannot get stuck on a token no statement accepts.
+ *
+ * @see parse_stmt(), p_synchronize(), create_error_stmt()
+ */
+Stmt *parse_stmt_recover(Parser *parser) {
+  size_t start = parser->pos;
+  int line = p_current(parser).line;
+  int col = p_current(parser).col;
+
+  Stmt *stmt = parse_stmt(parser);
+  if (stmt && !parser->panic) {
+    return stmt;
+  }
+
+  if (!stmt) {
+    // Make sure a statement that bailed out silently still fails the build
+    parser_error(parser, "SyntaxError", parser->file_path, "Invalid statement",
+                 line, col, 1);
+    stmt = create_error_stmt(parser->arena, line, col);
+  }
+
+  p_synchronize(parser);
+  if (parser->pos == start) {
+    p_advance(parser);
+  }
+  return stmt;
+}
+
 /**
  * @brief Parses a type annotation
  *
@@ -462,7 +533,7 @@ Stmt *parse_stmt(Parser *parser) {
  * @return Pointer to the parsed Type AST node, or NULL if parsing fails
  *
  * @note Handles:
- *       - Primitive types: int, uint, float, bool, string, void, char
+ *       - Primitive types: int, uint, float, double, bool, string, void, char
  *       - Pointer types: *type
  *       - Array types: [size]type or []type
  *       - User-defined types: identified by TOK_IDENTIFIER
@@ -478,6 +549,7 @@ Type *parse_type(Parser *parser) {
   case TOK_INT:
   case TOK_UINT:
   case TOK_FLOAT:
+  case TOK_DOUBLE:
   case TOK_BOOL:
   case TOK_STRINGT:
   case TOK_VOID:
@@ -491,7 +563,9 @@ Type *parse_type(Parser *parser) {
     return tled(parser, NULL, BP_NONE);
 
   default:
-    fprintf(stderr, "[parse_type] Unexpected token for type: %d\n", tok);
+    parser_error(parser, "SyntaxError", parser->file_path, "Expected type",
+                 p_current(parser).line, p_current(parser).col,
+                 CURRENT_TOKEN_LENGTH(parser));
     return NULL;
   }
 }
@@ -77,7 +77,8 @@ typedef enum {
  */
 static const LiteralType PRIMARY_LITERAL_TYPE_MAP[] = {
     [TOK_NUMBER] = LITERAL_INT,       [TOK_NUM_FLOAT] = LITERAL_FLOAT,
-    [TOK_STRING] = LITERAL_STRING,    [TOK_CHAR_LITERAL] = LITERAL_CHAR,
+    [TOK_NUM_DOUBLE] = LITERAL_DOUBLE, [TOK_STRING] = LITERAL_STRING,
+    [TOK_CHAR_LITERAL] = LITERAL_CHAR,
     [TOK_TRUE] = LITERAL_BOOL,        [TOK_FALSE] = LITERAL_BOOL,
     [TOK_IDENTIFIER] = LITERAL_IDENT,
 };
@@ -115,8 +116,34 @@ typedef struct {
   size_t tk_count;       /**< Number of tokens in the array */
   size_t capacity;       /**< Capacity for statements and expressions */
   size_t pos;            /**< Current token position */
+  const char *file_path; /**< Source file the tokens came from */
+  const char *source;    /**< Source text, for error line excerpts */
+  bool panic;            /**< Error reported; suppress the cascade */
+  size_t error_count;    /**< Syntax errors reported so far */
+  bool skim_bodies;      /**< Record function bodies instead of parsing */
 } Parser;
 
+/**
+ * @brief Number of token kinds; sizes the tables indexed by TokenType.
+ */
+#define TOKEN_TYPE_COUNT (TOK_COMMENT + 1)
+
+/** @brief Prefix (null denotation) parse handler. */
+typedef Expr *(*NudFn)(Parser *parser);
+
+/** @brief Infix/postfix (left denotation) parse handler. */
+typedef Expr *(*LedFn)(Parser *parser, Expr *left, BindingPower bp);
+
+/**
+ * @struct ParseRule
+ * @brief Pratt parser entry for one token type.
+ */
+typedef struct {
+  NudFn nud;       /**< Handler when the token starts an expression */
+  LedFn led;       /**< Handler when the token follows an expression */
+  BindingPower bp; /**< Binding power of the token as an operator */
+} ParseRule;
+
 /**
  * @brief Report a parser error with detailed location info.
  *
@@ -137,17 +164,46 @@ Token p_current(Parser *psr);
 Token p_advance(Parser *psr);
 Token p_consume(Parser *psr, TokenType type, const char *error_msg);
 char *get_name(Parser *psr);
+void p_synchronize(Parser *psr);
 
 /**
  * @brief Parses a full program from tokens into an AST of statements.
  *
+ * Syntax errors do not stop parsing: each one is reported through the error
+ * system, the parser resynchronizes at the next statement boundary and the
+ * broken statement becomes an AST_STMT_ERROR node. Check error_report() after
+ * parsing every file.
+ *
+ * With @p skim_bodies set, the bodies of top-level functions are not parsed:
+ * fn_stmt() only matches their braces and stores the token range in
+ * func_decl.deferred. The tokens and the source text they point into must
+ * then stay alive until parse_deferred_body() has run for every function.
+ *
  * @param tks GrowableArray containing tokens.
  * @param arena Memory arena for allocations.
- * @return Pointer to the root AST statement node (program).
+ * @param file_path Source file name used in diagnostics.
+ * @param skim_bodies Defer parsing of function bodies.
+ * @return Pointer to the root AST statement node (program), or NULL if the
+ *         file has no usable module declaration.
+ */
+Stmt *parse(GrowableArray *tks, ArenaAllocator *arena, const char *file_path,
+            bool skim_bodies);
+
+/**
+ * @brief Parses a function body that was skipped in skim mode.
+ *
+ * Parses func_decl.deferred into func_decl.body; the token range is kept.
+ * Safe to call concurrently for different functions.
+ *
+ * @param func AST_STMT_FUNCTION node; nothing happens if it has no deferred
+ *             body or the body was parsed already.
+ * @param arena Arena the body's nodes are allocated from.
+ * @return false if the body had syntax errors (reported via error_add()).
  */
-Stmt *parse(GrowableArray *tks, ArenaAllocator *arena);
+bool parse_deferred_body(AstNode *func, ArenaAllocator *arena);
 Expr *parse_expr(Parser *parser, BindingPower bp);
 Stmt *parse_stmt(Parser *parser);
+Stmt *parse_stmt_recover(Parser *parser);
 Type *parse_type(Parser *parser);
 
 // Helper functions for the parser
@@ -197,6 +253,7 @@ Stmt *expr_stmt(Parser *parser);
 Stmt *var_stmt(Parser *parser, bool is_public);
 Stmt *const_stmt(Parser *parser, bool is_public);
 Stmt *fn_stmt(Parser *parser, const char *name, bool is_public);
+Stmt *extern_fn_stmt(Parser *parser, const char *name, bool is_public);
 Stmt *enum_stmt(Parser *parser, const char *name, bool is_public);
 Stmt *struct_stmt(Parser *parser, const char *name, bool is_public);
 Stmt *print_stmt(Parser *parser, bool ln);
@@ -161,7 +161,7 @@ Token p_consume(Parser *psr, TokenType type, const char *error_msg) {
   if (p_current(psr).type_ == type)
     return p_advance(psr);
   else {
-    parser_error(psr, "SyntaxError", "unknown_file", error_msg, line, col,
+    parser_error(psr, "SyntaxError", psr->file_path, error_msg, line, col,
                  CURRENT_TOKEN_LENGTH(psr));
     return (Token){.type_ = TOK_EOF}; // Return an error token
   }
@@ -217,13 +217,19 @@ bool init_parser_arrays(Parser *parser, GrowableArray *stmts,
 // Helper function to validate and consume module declaratio
 const char *parse_module_declaration(Parser *parser) {
   if (!p_has_tokens(parser) || p_current(parser).type_ != TOK_MODULE) {
-    fprintf(stderr, "Error: file must begin with @module declaration\n");
+    parser_error(parser, "SyntaxError", parser->file_path,
+                 "File must begin with @module declaration",
+                 p_current(parser).line, p_current(parser).col,
+                 CURRENT_TOKEN_LENGTH(parser));
     return NULL;
   }
   p_advance(parser); // consume @module
 
   if (!p_has_tokens(parser) || p_current(parser).type_ != TOK_STRING) {
-    fprintf(stderr, "Error: expected module name string after @module\n");
+    parser_error(parser, "SyntaxError", parser->file_path,
+                 "Expected module name string after @module",
+                 p_current(parser).line, p_current(parser).col,
+                 CURRENT_TOKEN_LENGTH(parser));
     return NULL;
   }
 
@@ -231,3 +237,40 @@ const char *parse_module_declaration(Parser *parser) {
   p_advance(parser); // consume module name
   return module_name;
 }
+
+/**
+ * @brief Skips tokens until parsing can resume after a syntax error
+ *
+ * Called once a statement has reported an error. Tokens are discarded until
+ * the parser sits just past a `;` or `}`, or on a token that can only start a
+ * statement (`const`, `let`, `pub`, `return`, `}`...). Panic mode is cleared
+ * afterwards so the next real error is reported again.
+ *
+ * @param psr Pointer to the parser instance
+ *
+ * @see parse_stmt_recover(), parser_error()
+ */
+void p_synchronize(Parser *psr) {
+  while (p_has_tokens(psr)) {
+    if (psr->pos > 0) {
+      TokenType previous = psr->tks[psr->pos - 1].type_;
+      if (previous == TOK_SEMICOLON || previous == TOK_RBRACE) {
+        break;
+      }
+    }
+
+    TokenType current = psr->tks[psr->pos].type_;
+    if (current == TOK_RBRACE || current == TOK_CONST ||
+        current == TOK_PUBLIC || current == TOK_PRIVATE ||
+        current == TOK_VAR || current == TOK_USE || current == TOK_RETURN ||
+        current == TOK_IF || current == TOK_LOOP || current == TOK_PRINT ||
+        current == TOK_PRINTLN || current == TOK_BREAK ||
+        current == TOK_CONTINUE || current == TOK_DEFER) {
+      break;
+    }
+
+    p_advance(psr);
+  }
+
+  psr->panic = false;
+}
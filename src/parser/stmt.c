@@ -123,6 +123,8 @@ Stmt *const_stmt(Parser *parser, bool is_public) {
   switch (p_current(parser).type_) {
   case TOK_FN:
     return fn_stmt(parser, name, is_public);
+  case TOK_EXTERN:
+    return extern_fn_stmt(parser, name, is_public);
   case TOK_STRUCT:
     return struct_stmt(parser, name, is_public);
   case TOK_ENUM:
@@ -136,25 +138,53 @@ Stmt *const_stmt(Parser *parser, bool is_public) {
 }
 
 /**
- * @brief Parses a function declaration statement
- * 
- * Handles function declarations with the syntax:
- * `fn(param1: Type1, param2: Type2, ...) ReturnType { body }`
- * 
- * @param parser Pointer to the parser instance
- * @param name Function name (already parsed by caller)
- * @param is_public Whether this function has public visibility
- * 
- * @return Pointer to the function declaration AST node, or NULL on failure
- * 
- * @note Function parameters are stored as parallel arrays of names and types
- * @note Return type is required and parsed after the parameter list
- * @note Function body must be a block statement
- * @note Memory for parameter arrays is allocated using the arena allocator
- * 
- * @see parse_type(), block_stmt(), create_func_decl_stmt()
+ * @brief Skips a function body by brace matching and records its tokens
+ *
+ * Used in skim mode instead of block_stmt(). Nothing inside the braces is
+ * looked at beyond the token kind, so this is much cheaper than building the
+ * body's AST.
+ *
+ * @param parser Pointer to the parser instance, positioned on the body's '{'
+ *
+ * @return The recorded body, or NULL (with the parser not moved) if there is
+ *         no '{' or its '}' is missing; the body is then parsed normally so
+ *         the syntax error is reported right away
+ *
+ * @see parse_deferred_body()
  */
-Stmt *fn_stmt(Parser *parser, const char *name, bool is_public) {
+static DeferredBody *skim_body(Parser *parser) {
+  size_t start = parser->pos;
+  if (start >= parser->tk_count || parser->tks[start].type_ != TOK_LBRACE) {
+    return NULL;
+  }
+
+  size_t depth = 0;
+  for (size_t i = start; i < parser->tk_count; i++) {
+    TokenType type = parser->tks[i].type_;
+    if (type == TOK_LBRACE) {
+      depth++;
+    } else if (type == TOK_RBRACE && --depth == 0) {
+      DeferredBody *deferred = arena_alloc(parser->arena, sizeof(DeferredBody),
+                                           alignof(DeferredBody));
+      if (!deferred) {
+        return NULL;
+      }
+      deferred->tokens = &parser->tks[start];
+      deferred->token_count = i - start + 1;
+      deferred->source = parser->source;
+      deferred->file_path = parser->file_path;
+
+      parser->pos = i + 1;
+      return deferred;
+    }
+  }
+
+  return NULL;
+}
+
+// Signature and, unless is_extern, body of a function; see fn_stmt()
+static Stmt *function_decl(Parser *parser, const char *name, bool is_public,
+                           bool is_extern) {
   int line = p_current(parser).line;
   int col = p_current(parser).col;
 
@@ -171,7 +201,10 @@ Stmt *fn_stmt(Parser *parser, const char *name, bool is_public) {
   // Parse parameter list: param_name: param_type, ...
   while (p_has_tokens(parser) && p_current(parser).type_ != TOK_RPAREN) {
     if (p_current(parser).type_ != TOK_IDENTIFIER) {
-      fprintf(stderr, "Expected identifier for function parameter\n");
+      parser_error(parser, "SyntaxError", parser->file_path,
+                   "Expected identifier for function parameter",
+                   p_current(parser).line, p_current(parser).col,
+                   CURRENT_TOKEN_LENGTH(parser));
       return NULL;
     }
 
@@ -182,8 +215,7 @@ Stmt *fn_stmt(Parser *parser, const char *name, bool is_public) {
 
     Type *param_type = parse_type(parser);
     if (!param_type) {
-      fprintf(stderr, "Failed to parse type for parameter '%s'\n", param_name);
-      return NULL;
+      return NULL; // parse_type() already reported the error
     }
     p_advance(parser); // Advance past the type token
 
@@ -198,9 +230,10 @@ Stmt *fn_stmt(Parser *parser, const char *name, bool is_public) {
     *name_slot = param_name;
     *type_slot = param_type;
 
-    if (p_current(parser).type_ == TOK_COMMA) {
-      p_advance(parser); // Advance past the comma
+    if (p_current(parser).type_ != TOK_COMMA) {
+      break; // Anything but ',' must be the closing ')'
     }
+    p_advance(parser); // Advance past the comma
   }
 
   p_consume(parser, TOK_RPAREN, "Expected ')' after function parameters");
@@ -208,11 +241,82 @@ Stmt *fn_stmt(Parser *parser, const char *name, bool is_public) {
   Type *return_type = parse_type(parser);
   p_advance(parser); // Advance past the return type token
 
-  Stmt *body = block_stmt(parser);
+  DeferredBody *deferred = NULL;
+  Stmt *body = NULL;
+  if (is_extern) {
+    p_consume(parser, TOK_SEMICOLON,
+              "Expected ';' after extern function declaration");
+  } else {
+    deferred = parser->skim_bodies ? skim_body(parser) : NULL;
+    body = deferred ? NULL : block_stmt(parser);
+  }
+
+  Stmt *fn = create_func_decl_stmt(
+      parser->arena, name, (char **)param_names.data,
+      (AstNode **)param_types.data, param_names.count, return_type, is_public,
+      body, line, col);
+  fn->stmt.func_decl.deferred = deferred;
+  fn->stmt.func_decl.is_extern = is_extern;
+  return fn;
+}
+
+/**
+ * @brief Parses a function declaration statement
+ * 
+ * Handles function declarations with the syntax:
+ * `fn(param1: Type1, param2: Type2, ...) ReturnType { body }`
+ * 
+ * @param parser Pointer to the parser instance
+ * @param name Function name (already parsed by caller)
+ * @param is_public Whether this function has public visibility
+ * 
+ * @return Pointer to the function declaration AST node, or NULL on failure
+ * 
+ * @note Function parameters are stored as parallel arrays of names and types
+ * @note Return type is required and parsed after the parameter list
+ * @note Function body must be a block statement
+ * @note In skim mode the body is only brace-matched and left in
+ *       func_decl.deferred; see skim_body()
+ * @note Memory for parameter arrays is allocated using the arena allocator
+ * 
+ * @see parse_type(), block_stmt(), create_func_decl_stmt()
+ */
+Stmt *fn_stmt(Parser *parser, const char *name, bool is_public) {
+  return function_decl(parser, name, is_public, false);
+}
+
+/**
+ * @brief Parses the declaration of a C function
+ *
+ * Handles declarations with the syntax:
+ * `extern ["library"] fn(param1: Type1, ...) ReturnType;`
+ *
+ * @param parser Pointer to the parser instance, on the 'extern' keyword
+ * @param name Function name (already parsed by caller)
+ * @param is_public Whether this function has public visibility
+ *
+ * @return Pointer to the function declaration AST node, with no body and
+ *         func_decl.is_extern set, or NULL on failure
+ *
+ * @note The optional string names a library the program is linked with
+ *       (`-l<library>`, or the path itself if it contains a '/')
+ *
+ * @see fn_stmt()
+ */
+Stmt *extern_fn_stmt(Parser *parser, const char *name, bool is_public) {
+  p_consume(parser, TOK_EXTERN, "Expected 'extern' keyword");
 
-  return create_func_decl_stmt(parser->arena, name, (char **)param_names.data,
-                               (AstNode **)param_types.data, param_names.count,
-                               return_type, is_public, body, line, col);
+  const char *library = NULL;
+  if (p_current(parser).type_ == TOK_STRING) {
+    library = get_name(parser);
+    p_advance(parser); // Advance past the library name
+  }
+
+  Stmt *fn = function_decl(parser, name, is_public, true);
+  if (fn) {
+    fn->stmt.func_decl.library = library;
+  }
+  return fn;
 }
 
 /**
@@ -249,7 +353,10 @@ Stmt *enum_stmt(Parser *parser, const char *name, bool is_public) {
   // Parse enum members: member1, member2, ...
   while (p_has_tokens(parser) && p_current(parser).type_ != TOK_RBRACE) {
     if (p_current(parser).type_ != TOK_IDENTIFIER) {
-      fprintf(stderr, "Expected identifier for enum member\n");
+      parser_error(parser, "SyntaxError", parser->file_path,
+                   "Expected identifier for enum member",
+                   p_current(parser).line, p_current(parser).col,
+                   CURRENT_TOKEN_LENGTH(parser));
       return NULL;
     }
 
@@ -263,9 +370,10 @@ Stmt *enum_stmt(Parser *parser, const char *name, bool is_public) {
     }
     *slot = member_name;
 
-    if (p_current(parser).type_ == TOK_COMMA) {
-      p_advance(parser); // Advance past the comma
+    if (p_current(parser).type_ != TOK_COMMA) {
+      break; // Anything but ',' must be the closing '}'
     }
+    p_advance(parser); // Advance past the comma
   }
 
   p_consume(parser, TOK_RBRACE, "Expected '}' to end enum declaration");
@@ -342,7 +450,13 @@ Stmt *struct_stmt(Parser *parser, const char *name, bool is_public) {
     // Method: field_name = fn(...)
     if (p_current(parser).type_ == TOK_EQUAL) {
       p_consume(parser, TOK_EQUAL, "Expected '=' after field name");
+
+      // Only top-level function bodies are materialized later, so methods
+      // are always parsed in full
+      bool skim_bodies = parser->skim_bodies;
+      parser->skim_bodies = false;
       field_function = fn_stmt(parser, field_name, public_member);
+      parser->skim_bodies = skim_bodies;
     } else {
       // Data field: field_name: Type
       p_consume(parser, TOK_COLON, "Expected ':' after field name");
@@ -471,7 +585,8 @@ Stmt *return_stmt(Parser *parser) {
  * @note Empty blocks are allowed and create a valid block statement with 0 statements
  * @note Each statement in the block is parsed recursively using parse_stmt()
  * @note Handles memory allocation for the statement array using growable arrays
- * @note Continues parsing on individual statement failures (for error recovery)
+ * @note A statement with a syntax error is resynchronized by
+ *       parse_stmt_recover() and parsing of the block continues
  * 
  * @see parse_stmt(), create_block_stmt()
  */
@@ -485,11 +600,7 @@ Stmt *block_stmt(Parser *parser) {
   }
 
   while (p_has_tokens(parser) && p_current(parser).type_ != TOK_RBRACE) {
-    Stmt *stmt = parse_stmt(parser);
-    if (!stmt) {
-      fprintf(stderr, "parse_stmt returned NULL inside block\n");
-      continue; // or return NULL to fail the entire block
-    }
+    Stmt *stmt = parse_stmt_recover(parser);
 
     Stmt **slot = (Stmt **)growable_array_push(&block);
     if (!slot) {
@@ -690,9 +801,10 @@ Stmt *for_loop_stmt(Parser *parser, int line, int col) {
 
     *slot = init;
 
-    if (p_current(parser).type_ == TOK_COMMA) {
-      p_advance(parser); // Advance past the comma
+    if (p_current(parser).type_ != TOK_COMMA) {
+      break; // Anything but ',' must be the closing ']'
     }
+    p_advance(parser); // Advance past the comma
   }
   p_consume(parser, TOK_RBRACKET, "Expected ']' after loop initializer");
 
@@ -821,9 +933,10 @@ Stmt *print_stmt(Parser *parser, bool ln) {
 
     *slot = expr;
 
-    if (p_current(parser).type_ == TOK_COMMA) {
-      p_advance(parser); // Advance past the comma
+    if (p_current(parser).type_ != TOK_COMMA) {
+      break; // Anything but ',' must be the closing ')'
     }
+    p_advance(parser); // Advance past the comma
   }
   p_consume(parser, TOK_RPAREN, "Expected ')' to end print statement");
   p_consume(parser, TOK_SEMICOLON, "Expected semicolon after print statement");
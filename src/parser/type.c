@@ -47,6 +47,9 @@ Type *tnud(Parser *parser) {
   case TOK_FLOAT:
     return create_basic_type(parser->arena, "float", p_current(parser).line,
                              p_current(parser).col);
+  case TOK_DOUBLE:
+    return create_basic_type(parser->arena, "double", p_current(parser).line,
+                             p_current(parser).col);
   case TOK_BOOL:
     return create_basic_type(parser->arena, "bool", p_current(parser).line,
                              p_current(parser).col);
@@ -5,13 +5,8 @@
 bool typecheck_statement(AstNode *stmt, Scope *scope, ArenaAllocator *arena) {
   switch (stmt->type) {
   case AST_PROGRAM:
-    // Simple single-pass approach: just process each module
-    for (size_t i = 0; i < stmt->stmt.program.module_count; i++) {
-      if (!typecheck(stmt->stmt.program.modules[i], scope, arena)) {
-        return false;
-      }
-    }
-    return true;
+    // Declarations first, then bodies (inline, no worker pool)
+    return typecheck_program(stmt, NULL, scope, arena, NULL);
 
   // ... rest of your existing cases ...
   case AST_STMT_VAR_DECL:
@@ -31,13 +26,14 @@ bool typecheck_statement(AstNode *stmt, Scope *scope, ArenaAllocator *arena) {
 
   case AST_STMT_BLOCK: {
     // Create new scope for block
-    Scope *block_scope = create_child_scope(scope, "block", arena);
-    for (size_t i = 0; i < stmt->stmt.block.stmt_count; i++) {
-      if (!typecheck(stmt->stmt.block.statements[i], block_scope, arena)) {
-        return false;
-      }
+    Scope block_frame;
+    Scope *block_scope = scope_push(scope, &block_frame, "block", arena);
+    bool ok = true;
+    for (size_t i = 0; ok && i < stmt->stmt.block.stmt_count; i++) {
+      ok = typecheck(stmt->stmt.block.statements[i], block_scope, arena);
     }
-    return true;
+    scope_pop(block_scope);
+    return ok;
   }
 
   case AST_STMT_PRINT: {
@@ -74,6 +70,8 @@ AstNode *typecheck_expression(AstNode *expr, Scope *scope,
       return create_basic_type(arena, "int", expr->line, expr->column);
     case LITERAL_FLOAT:
       return create_basic_type(arena, "float", expr->line, expr->column);
+    case LITERAL_DOUBLE:
+      return create_basic_type(arena, "double", expr->line, expr->column);
     case LITERAL_STRING:
       return create_basic_type(arena, "string", expr->line, expr->column);
     case LITERAL_BOOL:
@@ -92,8 +92,10 @@ Scope *create_module_scope(Scope *global_scope, const char *module_name,
   module_scope->is_module_scope = true;
   module_scope->module_name = arena_strdup(arena, module_name);
 
-  growable_array_init(&module_scope->imported_modules, arena, 4,
-                      sizeof(ModuleImport));
+#ifndef DEBUG_SCOPE_TREE
+  // Module scopes are always linked so find_module_scope can see them
+  scope_attach_child(global_scope, module_scope);
+#endif
 
   return module_scope;
 }
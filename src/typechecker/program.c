@@ -0,0 +1,365 @@
+/**
+ * @file program.c
+ * @brief Two-phase typechecking of a whole program
+ *
+ * Phase 1 builds every module's declaration table, one module per task,
+ * scheduled in the topological waves of the module graph so a module is only
+ * declared once everything it `@use`s is:
+ * - resolve `@use` imports
+ * - declare function signatures, structs and enums
+ * - check the remaining top-level statements (globals, ...) in source order
+ *
+ * All module scopes are created and registered before the first wave, so
+ * `@use` does not depend on the order files were given on the command line.
+ * Each module allocates its declarations from its own arena; the arenas are
+ * handed to the caller's arena once checking is done.
+ *
+ * Phase 2 checks function bodies. Bodies only read the module scopes built in
+ * phase 1, so they are independent of each other and are handed to the
+ * thread pool, one task per function. Each worker gets its own arena and
+ * resolver; nothing a body check allocates outlives the check.
+ *
+ * Bodies the parser skimmed (see parse_deferred_body()) are parsed by the
+ * same phase 2 task right before they are checked, so that parsing also
+ * runs on the pool. Their AST goes into a second per-worker arena that is
+ * handed to the caller's arena, since codegen still needs it.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../parser/parser.h"
+#include "type.h"
+
+/**
+ * @brief One function body waiting for phase 2
+ */
+typedef struct {
+  AstNode *node;
+  Scope *module_scope;
+  bool ok;
+} BodyJob;
+
+/**
+ * @brief Per-worker state for phase 2
+ */
+typedef struct {
+  ArenaAllocator arena;     /**< Scratch memory for checking */
+  ArenaAllocator ast_arena; /**< Deferred bodies; outlives the check */
+  Resolver *resolver;
+} BodyWorker;
+
+typedef struct {
+  BodyJob *job;
+  BodyWorker *workers;
+} BodyTask;
+
+/**
+ * @brief Phase 1 state of one module
+ */
+typedef struct {
+  Scope *scope;         /**< Module scope, allocated from arena */
+  ArenaAllocator arena; /**< Declarations made by this module */
+  GrowableArray bodies; /**< BodyJob for every declared function */
+} ModuleCheck;
+
+typedef struct {
+  const ModuleGraph *graph;
+  ModuleCheck *checks; /**< Indexed like graph->nodes */
+  Scope *global_scope;
+} ProgramCheck;
+
+static void typecheck_body_task(void *arg, size_t worker_index) {
+  BodyTask *task = (BodyTask *)arg;
+  BodyWorker *worker = &task->workers[worker_index];
+
+  if (!worker->resolver) {
+    worker->resolver = resolver_create(&worker->arena);
+  }
+
+  BodyJob *job = task->job;
+  job->ok = parse_deferred_body(job->node, &worker->ast_arena) &&
+            typecheck_func_body(job->node, job->module_scope, worker->resolver,
+                                &worker->arena);
+  if (!job->ok) {
+    fprintf(stderr, "Error: Failed to typecheck statement in module '%s'\n",
+            job->module_scope->module_name);
+  }
+}
+
+static bool is_declaration(AstNode *stmt) {
+  return stmt->type == AST_STMT_FUNCTION || stmt->type == AST_STMT_STRUCT ||
+         stmt->type == AST_STMT_ENUM;
+}
+
+/**
+ * @brief Phase 1 for a single module: imports, then declarations
+ */
+static bool declare_module(AstNode *module, Scope *module_scope,
+                           Scope *global_scope, GrowableArray *bodies,
+                           ArenaAllocator *arena) {
+  const char *module_name = module->preprocessor.module.name;
+  AstNode **body = module->preprocessor.module.body;
+  size_t body_count = module->preprocessor.module.body_count;
+
+  for (size_t i = 0; i < body_count; i++) {
+    if (body[i] && body[i]->type == AST_PREPROCESSOR_USE &&
+        !typecheck_use_stmt(body[i], module_scope, global_scope, arena)) {
+      fprintf(stderr, "Error: Failed to process use statement in module '%s'\n",
+              module_name);
+      return false;
+    }
+  }
+
+  // Signatures before anything that evaluates expressions, so globals and
+  // bodies can refer to functions declared further down
+  for (size_t i = 0; i < body_count; i++) {
+    if (!body[i] || !is_declaration(body[i])) {
+      continue;
+    }
+
+    bool ok;
+    if (body[i]->type == AST_STMT_FUNCTION) {
+      ok = typecheck_func_signature(body[i], module_scope, arena);
+      // A body an incremental build reuses was checked when it was compiled;
+      // an extern function has none
+      if (ok && !body[i]->stmt.func_decl.reuse_object &&
+          !body[i]->stmt.func_decl.is_extern) {
+        BodyJob *job = (BodyJob *)growable_array_push(bodies);
+        if (!job) {
+          return false;
+        }
+        job->node = body[i];
+        job->module_scope = module_scope;
+        job->ok = false;
+      }
+    } else {
+      ok = typecheck(body[i], module_scope, arena);
+    }
+
+    if (!ok) {
+      fprintf(stderr, "Error: Failed to typecheck statement in module '%s'\n",
+              module_name);
+      return false;
+    }
+  }
+
+  for (size_t i = 0; i < body_count; i++) {
+    if (!body[i] || body[i]->type == AST_PREPROCESSOR_USE ||
+        is_declaration(body[i])) {
+      continue;
+    }
+    if (!typecheck(body[i], module_scope, arena)) {
+      fprintf(stderr, "Error: Failed to typecheck statement in module '%s'\n",
+              module_name);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool declare_module_task(void *arg, size_t node, size_t worker) {
+  (void)worker;
+  ProgramCheck *program = (ProgramCheck *)arg;
+  ModuleCheck *check = &program->checks[node];
+  return declare_module(program->graph->nodes[node].module, check->scope,
+                        program->global_scope, &check->bodies, &check->arena);
+}
+
+/**
+ * @brief Phase 2: check every collected function body
+ */
+static bool check_bodies(ModuleCheck *checks, size_t module_count,
+                         ArenaAllocator *arena, ThreadPool *pool) {
+  bool success = true;
+
+  if (!pool || thread_pool_size(pool) == 1) {
+    for (size_t m = 0; m < module_count; m++) {
+      BodyJob *jobs = (BodyJob *)checks[m].bodies.data;
+      for (size_t i = 0; i < checks[m].bodies.count; i++) {
+        if (!parse_deferred_body(jobs[i].node, arena) ||
+            !typecheck_func_body(jobs[i].node, jobs[i].module_scope, NULL,
+                                 arena)) {
+          fprintf(stderr,
+                  "Error: Failed to typecheck statement in module '%s'\n",
+                  jobs[i].module_scope->module_name);
+          success = false;
+        }
+      }
+    }
+    return success;
+  }
+
+  size_t body_count = 0;
+  for (size_t m = 0; m < module_count; m++) {
+    body_count += checks[m].bodies.count;
+  }
+
+  size_t worker_count = thread_pool_size(pool);
+  BodyWorker *workers = arena_alloc(arena, worker_count * sizeof(BodyWorker),
+                                    alignof(BodyWorker));
+  BodyTask *tasks =
+      arena_alloc(arena, body_count * sizeof(BodyTask), alignof(BodyTask));
+  if (!workers || !tasks) {
+    return false;
+  }
+
+  for (size_t w = 0; w < worker_count; w++) {
+    arena_allocator_init(&workers[w].arena, ARENA_MIN_BUFFER_SIZE);
+    arena_allocator_init(&workers[w].ast_arena, ARENA_MIN_BUFFER_SIZE);
+    workers[w].resolver = NULL;
+  }
+
+  size_t t = 0;
+  for (size_t m = 0; m < module_count; m++) {
+    BodyJob *jobs = (BodyJob *)checks[m].bodies.data;
+    for (size_t i = 0; i < checks[m].bodies.count; i++, t++) {
+      tasks[t].job = &jobs[i];
+      tasks[t].workers = workers;
+      if (!thread_pool_submit(pool, typecheck_body_task, &tasks[t])) {
+        fprintf(stderr, "Out of memory while scheduling '%s'\n",
+                jobs[i].node->stmt.func_decl.name);
+        jobs[i].ok = false;
+      }
+    }
+  }
+  thread_pool_wait(pool);
+
+  for (size_t i = 0; i < body_count; i++) {
+    success = success && tasks[i].job->ok;
+  }
+
+  for (size_t w = 0; w < worker_count; w++) {
+    arena_destroy(&workers[w].arena);
+    arena_adopt(arena, &workers[w].ast_arena);
+  }
+
+  return success;
+}
+
+/**
+ * @brief Typecheck every module of a program
+ *
+ * @param program AST_PROGRAM node
+ * @param graph Module graph of @p program, or NULL to build it here
+ * @param global_scope Initialized global scope
+ * @param arena Arena for declarations (must outlive codegen)
+ * @param pool Worker pool for modules and function bodies, or NULL to check
+ * everything inline
+ * @return true if every module and function body checked successfully
+ */
+bool typecheck_program(AstNode *program, const ModuleGraph *graph,
+                       Scope *global_scope, ArenaAllocator *arena,
+                       ThreadPool *pool) {
+  AstNode **modules = program->stmt.program.modules;
+  size_t module_count = program->stmt.program.module_count;
+
+#ifdef DEBUG_SCOPE_TREE
+  // The retained tree links every body scope into its module; keep it serial
+  pool = NULL;
+#endif
+
+  ModuleGraph local_graph;
+  if (!graph) {
+    if (!module_graph_build(&local_graph, modules, module_count, arena)) {
+      return false;
+    }
+    graph = &local_graph;
+  }
+
+  // Loose top-level statements belong to the global scope
+  for (size_t i = 0; i < module_count; i++) {
+    if (modules[i]->type != AST_PREPROCESSOR_MODULE &&
+        !typecheck(modules[i], global_scope, arena)) {
+      return false;
+    }
+  }
+
+  ModuleCheck *checks = arena_alloc(
+      arena, graph->count * sizeof(ModuleCheck), alignof(ModuleCheck));
+  if (!checks) {
+    return false;
+  }
+
+  // Every module scope exists before any import is resolved
+  bool success = true;
+  size_t ready = 0;
+  for (; success && ready < graph->count; ready++) {
+    ModuleCheck *check = &checks[ready];
+    const char *name = graph->nodes[ready].name;
+
+    arena_allocator_init(&check->arena, ARENA_MIN_BUFFER_SIZE);
+    check->scope = find_module_scope(global_scope, name);
+    if (!check->scope) {
+      check->scope = create_module_scope(global_scope, name, &check->arena);
+      if (!register_module(global_scope, name, check->scope, arena)) {
+        fprintf(stderr, "Error: Failed to register module '%s'\n", name);
+        success = false;
+      }
+    }
+    success = success && growable_array_init(&check->bodies, &check->arena,
+                                             16, sizeof(BodyJob));
+  }
+
+  if (success) {
+    ProgramCheck state = {graph, checks, global_scope};
+    success =
+        module_graph_run_waves(graph, pool, declare_module_task, &state) &&
+        check_bodies(checks, graph->count, arena, pool);
+  }
+
+  for (size_t i = 0; i < ready; i++) {
+    arena_adopt(arena, &checks[i].arena);
+  }
+
+  return success;
+}
+
+/**
+ * @brief Phase 1 only: declare every module without checking any body
+ *
+ * For tools that check function bodies on demand, such as the language
+ * server. Unlike typecheck_program(), a module that fails to declare does not
+ * stop the others, so one broken file leaves the rest of the program usable.
+ *
+ * @param graph Module graph; modules are declared in its topological order
+ * @param global_scope Initialized global scope
+ * @param arena Arena for every scope and declaration
+ * @param[out] scopes Module scope of every node, indexed like graph->nodes
+ * @param[out] declared Optional, indexed like graph->nodes: whether each
+ * module declared without errors
+ * @return true if every module declared cleanly
+ */
+bool typecheck_declarations(const ModuleGraph *graph, Scope *global_scope,
+                            ArenaAllocator *arena, Scope **scopes,
+                            bool *declared) {
+  for (size_t i = 0; i < graph->count; i++) {
+    const char *name = graph->nodes[i].name;
+    scopes[i] = find_module_scope(global_scope, name);
+    if (!scopes[i]) {
+      scopes[i] = create_module_scope(global_scope, name, arena);
+      if (!register_module(global_scope, name, scopes[i], arena)) {
+        fprintf(stderr, "Error: Failed to register module '%s'\n", name);
+        return false;
+      }
+    }
+  }
+
+  // Bodies are the caller's business; the jobs are only collected
+  GrowableArray bodies;
+  bool success = true;
+  for (size_t i = 0; i < graph->count; i++) {
+    size_t node = graph->order[i];
+    if (!growable_array_init(&bodies, arena, 16, sizeof(BodyJob))) {
+      return false;
+    }
+    bool ok = declare_module(graph->nodes[node].module, scopes[node],
+                             global_scope, &bodies, arena);
+    if (declared) {
+      declared[node] = ok;
+    }
+    success = success && ok;
+  }
+  return success;
+}
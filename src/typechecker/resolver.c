@@ -0,0 +1,308 @@
+/**
+ * @file resolver.c
+ * @brief Flat symbol stack used for function-local scopes
+ *
+ * Function bodies are checked with a single flat stack of bindings instead of
+ * a tree of heap-allocated scopes. Every local name is interned into a small
+ * open-addressed table whose slot holds the index of the innermost live
+ * binding for that name. Each binding remembers the binding it shadowed, so
+ * the entries stack doubles as an undo log:
+ *
+ * - entering a scope records the current stack height (O(1))
+ * - adding a symbol pushes an entry and repoints the name's slot (O(1))
+ * - looking a name up is one hash probe (O(1) expected)
+ * - leaving a scope pops entries back to the recorded height, restoring each
+ *   name's previous binding (O(symbols declared in that scope))
+ *
+ * The stack and table are reused for every function checked against the same
+ * resolver, so checking a function leaves nothing behind in the arena once
+ * the stack has grown to the deepest function seen.
+ *
+ * Module and global scopes keep using the Scope tree; lookups that miss the
+ * flat stack continue from the nearest enclosing tree scope.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../c_libs/memory/memory.h"
+#include "type.h"
+
+/** @brief Initial number of slots in the name table (power of two). */
+#define RESOLVER_INITIAL_SLOTS 64
+
+/**
+ * @brief A live binding on the flat stack.
+ */
+typedef struct {
+  Symbol symbol;   /**< Symbol data handed out by lookups */
+  Scope *owner;    /**< Scope frame that declared the binding */
+  size_t slot;     /**< Name table slot of the binding's interned name */
+  size_t shadowed; /**< Binding this one hides, or RESOLVER_NONE */
+} ResolverEntry;
+
+/**
+ * @brief One interned name and the innermost binding currently using it.
+ */
+typedef struct {
+  const char *name; /**< Interned name (NULL for an unused slot) */
+  uint64_t hash;    /**< Cached hash of name */
+  size_t top;       /**< Innermost live binding, or RESOLVER_NONE */
+} ResolverSlot;
+
+/**
+ * @brief FNV-1a hash of a name; also used by the symbol index of large scopes.
+ */
+uint64_t resolver_hash(const char *name) {
+  uint64_t hash = 1469598103934665603ULL; // FNV-1a
+  for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+    hash ^= *p;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+static ResolverSlot *resolver_slots(Resolver *resolver) {
+  return (ResolverSlot *)resolver->slots;
+}
+
+static ResolverEntry *resolver_entry(Resolver *resolver, size_t index) {
+  return (ResolverEntry *)resolver->entries.data + index;
+}
+
+/**
+ * @brief Find the slot for a name, or the empty slot where it would go
+ */
+static size_t resolver_probe(Resolver *resolver, const char *name,
+                             uint64_t hash) {
+  ResolverSlot *slots = resolver_slots(resolver);
+  size_t mask = resolver->slot_capacity - 1;
+  size_t i = (size_t)hash & mask;
+
+  while (slots[i].name) {
+    if (slots[i].hash == hash && strcmp(slots[i].name, name) == 0) {
+      return i;
+    }
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+/**
+ * @brief Double the name table and repoint live entries at their new slots
+ */
+static bool resolver_grow(Resolver *resolver) {
+  ResolverSlot *old_slots = resolver_slots(resolver);
+  size_t old_capacity = resolver->slot_capacity;
+  size_t new_capacity = old_capacity * 2;
+
+  ResolverSlot *new_slots =
+      arena_alloc(resolver->arena, new_capacity * sizeof(ResolverSlot),
+                  alignof(ResolverSlot));
+  if (!new_slots) {
+    return false;
+  }
+  memset(new_slots, 0, new_capacity * sizeof(ResolverSlot));
+
+  // Remember where each old slot went so the undo log can be rewritten
+  size_t *moved = arena_alloc(resolver->arena, old_capacity * sizeof(size_t),
+                              alignof(size_t));
+  if (!moved) {
+    return false;
+  }
+
+  resolver->slots = new_slots;
+  resolver->slot_capacity = new_capacity;
+
+  for (size_t i = 0; i < old_capacity; i++) {
+    if (!old_slots[i].name) {
+      continue;
+    }
+    size_t j = resolver_probe(resolver, old_slots[i].name, old_slots[i].hash);
+    new_slots[j] = old_slots[i];
+    moved[i] = j;
+  }
+
+  for (size_t i = 0; i < resolver->entries.count; i++) {
+    ResolverEntry *entry = resolver_entry(resolver, i);
+    entry->slot = moved[entry->slot];
+  }
+
+  return true;
+}
+
+/**
+ * @brief Intern a name, returning its slot index
+ */
+static size_t resolver_intern(Resolver *resolver, const char *name) {
+  uint64_t hash = resolver_hash(name);
+  size_t i = resolver_probe(resolver, name, hash);
+
+  if (resolver_slots(resolver)[i].name) {
+    return i;
+  }
+
+  // Keep the table at most half full so probe chains stay short
+  if ((resolver->slot_count + 1) * 2 > resolver->slot_capacity) {
+    if (!resolver_grow(resolver)) {
+      return RESOLVER_NONE;
+    }
+    i = resolver_probe(resolver, name, hash);
+  }
+
+  ResolverSlot *slot = &resolver_slots(resolver)[i];
+  slot->name = name;
+  slot->hash = hash;
+  slot->top = RESOLVER_NONE;
+  resolver->slot_count++;
+  return i;
+}
+
+/**
+ * @brief Look up a name without interning it
+ */
+static ResolverEntry *resolver_find(Resolver *resolver, const char *name) {
+  size_t i = resolver_probe(resolver, name, resolver_hash(name));
+  ResolverSlot *slot = &resolver_slots(resolver)[i];
+
+  if (!slot->name || slot->top == RESOLVER_NONE) {
+    return NULL;
+  }
+  return resolver_entry(resolver, slot->top);
+}
+
+Resolver *resolver_create(ArenaAllocator *arena) {
+  Resolver *resolver = arena_alloc(arena, sizeof(Resolver), alignof(Resolver));
+  if (!resolver) {
+    return NULL;
+  }
+
+  resolver->arena = arena;
+  resolver->slot_capacity = RESOLVER_INITIAL_SLOTS;
+  resolver->slot_count = 0;
+  resolver->slots =
+      arena_alloc(arena, RESOLVER_INITIAL_SLOTS * sizeof(ResolverSlot),
+                  alignof(ResolverSlot));
+  if (!resolver->slots ||
+      !growable_array_init(&resolver->entries, arena, 32,
+                           sizeof(ResolverEntry))) {
+    return NULL;
+  }
+  memset(resolver->slots, 0, RESOLVER_INITIAL_SLOTS * sizeof(ResolverSlot));
+
+  return resolver;
+}
+
+#ifndef DEBUG_SCOPE_TREE
+/**
+ * @brief Find the resolver shared by everything below the global scope
+ */
+static Resolver *resolver_for(Scope *parent, ArenaAllocator *arena) {
+  if (parent->resolver) {
+    return parent->resolver;
+  }
+
+  Scope *root = parent;
+  while (root->parent) {
+    root = root->parent;
+  }
+  if (!root->local_resolver) {
+    root->local_resolver = resolver_create(arena);
+  }
+  return root->local_resolver;
+}
+#endif
+
+Scope *scope_push_frame(Scope *parent, Scope *storage, const char *name,
+                        Resolver *resolver, ArenaAllocator *arena) {
+#ifdef DEBUG_SCOPE_TREE
+  (void)storage;
+  (void)resolver;
+  return create_child_scope(parent, name, arena);
+#else
+  if (!resolver) {
+    return create_child_scope(parent, name, arena);
+  }
+
+  // Frames live on the C stack; only the name is needed for diagnostics, so
+  // skip init_scope() and its arena copy of the name
+  memset(storage, 0, sizeof(Scope));
+  storage->parent = parent;
+  storage->scope_name = name;
+  storage->depth = parent->depth + 1;
+  storage->resolver = resolver;
+  storage->frame_base = resolver->entries.count;
+  return storage;
+#endif
+}
+
+Scope *scope_push(Scope *parent, Scope *storage, const char *name,
+                  ArenaAllocator *arena) {
+#ifdef DEBUG_SCOPE_TREE
+  Resolver *resolver = NULL;
+#else
+  Resolver *resolver = resolver_for(parent, arena);
+#endif
+  return scope_push_frame(parent, storage, name, resolver, arena);
+}
+
+void scope_pop(Scope *scope) {
+  Resolver *resolver = scope->resolver;
+  if (!resolver) {
+    return;
+  }
+
+  ResolverSlot *slots = resolver_slots(resolver);
+  while (resolver->entries.count > scope->frame_base) {
+    ResolverEntry *entry =
+        resolver_entry(resolver, resolver->entries.count - 1);
+    slots[entry->slot].top = entry->shadowed;
+    resolver->entries.count--;
+  }
+}
+
+bool resolver_add_symbol(Scope *scope, const char *name, AstNode *type,
+                         bool is_public, bool is_mutable) {
+  Resolver *resolver = scope->resolver;
+
+  size_t slot = resolver_intern(resolver, name);
+  if (slot == RESOLVER_NONE) {
+    fprintf(stderr, "Out of memory while adding symbol '%s'\n", name);
+    return false;
+  }
+
+  size_t top = resolver_slots(resolver)[slot].top;
+  if (top != RESOLVER_NONE && resolver_entry(resolver, top)->owner == scope) {
+    fprintf(stderr, "Error: Symbol '%s' already declared in current scope\n",
+            name);
+    return false;
+  }
+
+  ResolverEntry *entry = growable_array_push(&resolver->entries);
+  if (!entry) {
+    fprintf(stderr, "Out of memory while adding symbol '%s'\n", name);
+    return false;
+  }
+
+  // AST names outlive the check, so the interned pointer is stored as-is
+  entry->symbol.name = resolver_slots(resolver)[slot].name;
+  entry->symbol.type = type;
+  entry->symbol.is_public = is_public;
+  entry->symbol.is_mutable = is_mutable;
+  entry->symbol.scope_depth = scope->depth;
+  entry->owner = scope;
+  entry->slot = slot;
+  entry->shadowed = top;
+
+  resolver_slots(resolver)[slot].top = resolver->entries.count - 1;
+  return true;
+}
+
+Symbol *resolver_lookup(Scope *scope, const char *name, bool current_only) {
+  ResolverEntry *entry = resolver_find(scope->resolver, name);
+  if (!entry || (current_only && entry->owner != scope)) {
+    return NULL;
+  }
+  return &entry->symbol;
+}
@@ -40,8 +40,8 @@
  * - Parent pointer assignment and depth calculation
  * - Name duplication into arena memory for persistence
  * - Default flag initialization (not a function scope, no associated AST node)
- * - Growable array setup with reasonable initial capacities (16 symbols, 8
- * children)
+ * - Symbol storage pointing at the scope's inline buffer; the children and
+ * import arrays start empty and allocate on first push
  *
  * @note The scope name is duplicated using arena allocation, ensuring it
  * remains valid for the lifetime of the scope without external string
@@ -67,13 +67,116 @@ void init_scope(Scope *scope, Scope *parent, const char *name,
   scope->is_module_scope = false; // Initialize new module flag
   scope->associated_node = NULL;
   scope->module_name = NULL; // Initialize module name
+  scope->resolver = NULL;
+  scope->frame_base = 0;
+  scope->local_resolver = NULL;
 
-  // Initialize growable arrays with reasonable initial capacities
-  growable_array_init(&scope->symbols, arena, 16, sizeof(Symbol));
-  growable_array_init(&scope->children, arena, 8, sizeof(Scope *));
-  growable_array_init(&scope->imported_modules, arena, 4,
-                      sizeof(ModuleImport)); // New array
+  // Symbols start in the inline buffer; growable_array_push copies them into
+  // the arena if the scope ever outgrows it
+  scope->symbols = (GrowableArray){.data = scope->inline_symbols,
+                                   .capacity = SCOPE_INLINE_SYMBOLS,
+                                   .item_size = sizeof(Symbol),
+                                   .arena = arena};
+
+  // Children and imports are rare outside the global/module scopes, so they
+  // stay empty until the first push
+  scope->children = (GrowableArray){.item_size = sizeof(Scope *),
+                                    .arena = arena};
+  scope->imported_modules = (GrowableArray){.item_size = sizeof(ModuleImport),
+                                            .arena = arena};
+  scope->symbol_index = NULL;
+  scope->index_capacity = 0;
+}
+
+static void scope_index_insert(Scope *scope, size_t position) {
+  const Symbol *symbols = (const Symbol *)scope->symbols.data;
+  size_t mask = scope->index_capacity - 1;
+  size_t i = (size_t)resolver_hash(symbols[position].name) & mask;
+  while (scope->symbol_index[i] != 0) {
+    i = (i + 1) & mask;
+  }
+  scope->symbol_index[i] = position + 1;
+}
+
+/**
+ * @brief Keep the hash index of a large scope current after an addition
+ *
+ * The index is created when the scope reaches SCOPE_INDEX_THRESHOLD symbols
+ * and rebuilt at four times the symbol count whenever it gets half full. If
+ * the arena runs out the scope simply goes back to linear lookups.
+ *
+ * @param scope Scope whose last symbol was just added
+ */
+static void scope_index_added(Scope *scope) {
+  size_t count = scope->symbols.count;
+  if (count < SCOPE_INDEX_THRESHOLD) {
+    return;
+  }
+  if (scope->symbol_index && count * 2 <= scope->index_capacity) {
+    scope_index_insert(scope, count - 1);
+    return;
+  }
+
+  size_t capacity = 64;
+  while (capacity < count * 4) {
+    capacity *= 2;
+  }
+  size_t *index = arena_alloc(scope->symbols.arena, capacity * sizeof(size_t),
+                              alignof(size_t));
+  scope->symbol_index = index;
+  scope->index_capacity = index ? capacity : 0;
+  if (!index) {
+    return;
+  }
+  memset(index, 0, capacity * sizeof(size_t));
+  for (size_t i = 0; i < count; i++) {
+    scope_index_insert(scope, i);
+  }
 }
+
+/**
+ * @brief Find a symbol declared directly in a tree scope, ignoring visibility
+ *
+ * @param scope Scope to search (not a resolver frame)
+ * @param name Symbol name
+ * @return The symbol, or NULL if the scope does not declare it
+ */
+static Symbol *scope_find_symbol(Scope *scope, const char *name) {
+  Symbol *symbols = (Symbol *)scope->symbols.data;
+  if (scope->symbol_index) {
+    size_t mask = scope->index_capacity - 1;
+    for (size_t i = (size_t)resolver_hash(name) & mask;
+         scope->symbol_index[i] != 0; i = (i + 1) & mask) {
+      Symbol *s = &symbols[scope->symbol_index[i] - 1];
+      if (strcmp(s->name, name) == 0) {
+        return s;
+      }
+    }
+    return NULL;
+  }
+
+  // Linear search through a small scope's symbols
+  for (size_t i = 0; i < scope->symbols.count; ++i) {
+    if (strcmp(symbols[i].name, name) == 0) {
+      return &symbols[i];
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief Record a child scope in its parent's children array
+ *
+ * @param parent Parent scope
+ * @param child Child scope to record
+ */
+void scope_attach_child(Scope *parent, Scope *child) {
+  Scope **child_ptr = (Scope **)growable_array_push(&parent->children);
+  if (child_ptr) {
+    *child_ptr = child;
+  }
+}
+
 /**
  * @brief Add a symbol to the specified scope with duplicate checking
  *
@@ -109,6 +212,11 @@ void init_scope(Scope *scope, Scope *parent, const char *name,
  */
 bool scope_add_symbol(Scope *scope, const char *name, AstNode *type,
                       bool is_public, bool is_mutable, ArenaAllocator *arena) {
+  // Frames opened with scope_push() keep their symbols on the flat stack
+  if (scope->resolver) {
+    return resolver_add_symbol(scope, name, type, is_public, is_mutable);
+  }
+
   // Check for duplicate symbols in current scope only (shadowing is allowed)
   Symbol *existing = scope_lookup_current_only(scope, name);
   if (existing) {
@@ -131,6 +239,7 @@ bool scope_add_symbol(Scope *scope, const char *name, AstNode *type,
   s->is_mutable = is_mutable;          // Set mutability flag
   s->scope_depth = scope->depth;       // Record the scope depth for debugging
 
+  scope_index_added(scope);
   return true;
 }
 
@@ -138,31 +247,37 @@ Symbol *scope_lookup_with_visibility(Scope *scope, const char *name,
                                      Scope *requesting_module_scope) {
   Scope *current = scope;
 
-  while (current) {
-    // Linear search through current scope's symbols
-    for (size_t i = 0; i < current->symbols.count; ++i) {
-      Symbol *s =
-          (Symbol *)((char *)current->symbols.data + i * sizeof(Symbol));
-      if (strcmp(s->name, name) == 0) {
-
-        // Check visibility rules
-        if (s->is_public) {
-          return s; // Public symbols are always accessible
-        }
+  // Locals are always visible; on a miss continue from the nearest tree scope
+  if (current->resolver) {
+    Symbol *local = resolver_lookup(current, name, false);
+    if (local) {
+      return local;
+    }
+    while (current && current->resolver) {
+      current = current->parent;
+    }
+  }
 
-        // Private symbols: check if we're in the same module
-        Scope *symbol_module = find_containing_module(current);
-        Scope *requesting_module = requesting_module_scope
-                                       ? requesting_module_scope
-                                       : find_containing_module(scope);
+  while (current) {
+    Symbol *s = scope_find_symbol(current, name);
+    if (s) {
+      // Check visibility rules
+      if (s->is_public) {
+        return s; // Public symbols are always accessible
+      }
 
-        if (symbol_module == requesting_module) {
-          return s; // Same module - private symbol is accessible
-        }
+      // Private symbols: check if we're in the same module
+      Scope *symbol_module = find_containing_module(current);
+      Scope *requesting_module = requesting_module_scope
+                                     ? requesting_module_scope
+                                     : find_containing_module(scope);
 
-        // Different module and symbol is private - not accessible
-        return NULL;
+      if (symbol_module == requesting_module) {
+        return s; // Same module - private symbol is accessible
       }
+
+      // Different module and symbol is private - not accessible
+      return NULL;
     }
     current = current->parent;
   }
@@ -197,31 +312,26 @@ Symbol *scope_lookup(Scope *scope, const char *name) {
 Symbol *
 scope_lookup_current_only_with_visibility(Scope *scope, const char *name,
                                           Scope *requesting_module_scope) {
-  // Linear search through current scope's symbols only
-  for (size_t i = 0; i < scope->symbols.count; ++i) {
-    Symbol *s = (Symbol *)((char *)scope->symbols.data + i * sizeof(Symbol));
-    if (strcmp(s->name, name) == 0) {
-
-      // Check visibility rules
-      if (s->is_public) {
-        return s; // Public symbols are always accessible
-      }
+  if (scope->resolver) {
+    return resolver_lookup(scope, name, true);
+  }
 
-      // Private symbols: check if we're in the same module
-      Scope *symbol_module = find_containing_module(scope);
-      Scope *requesting_module = requesting_module_scope
-                                     ? requesting_module_scope
-                                     : find_containing_module(scope);
+  Symbol *s = scope_find_symbol(scope, name);
+  if (!s || s->is_public) {
+    return s; // Public symbols are always accessible
+  }
 
-      if (symbol_module == requesting_module) {
-        return s; // Same module - private symbol is accessible
-      }
+  // Private symbols: check if we're in the same module
+  Scope *symbol_module = find_containing_module(scope);
+  Scope *requesting_module = requesting_module_scope
+                                 ? requesting_module_scope
+                                 : find_containing_module(scope);
 
-      // Different module and symbol is private - not accessible
-      return NULL;
-    }
+  if (symbol_module == requesting_module) {
+    return s; // Same module - private symbol is accessible
   }
 
+  // Different module and symbol is private - not accessible
   return NULL;
 }
 
@@ -235,9 +345,9 @@ Symbol *scope_lookup_current_only(Scope *scope, const char *name) {
 /**
  * @brief Create a new child scope under the specified parent
  *
- * Allocates and initializes a new scope as a child of the given parent,
- * automatically establishing the parent-child relationship and adding
- * the new scope to the parent's children list.
+ * Allocates and initializes a new scope as a child of the given parent.
+ * With DEBUG_SCOPE_TREE the new scope is also added to the parent's children
+ * list; otherwise only the parent pointer links them.
  *
  * @param parent Parent scope for the new child (NULL for root scope)
  * @param name Descriptive name for the new scope
@@ -248,12 +358,12 @@ Symbol *scope_lookup_current_only(Scope *scope, const char *name) {
  * Creation process:
  * 1. Allocate memory for new Scope structure from arena
  * 2. Initialize the scope with proper parent linkage
- * 3. Add the new scope to parent's children array (if parent exists)
+ * 3. Add the new scope to parent's children array (DEBUG_SCOPE_TREE only)
  * 4. Return pointer to fully initialized child scope
  *
- * @note The child scope is automatically added to the parent's children list,
- *       maintaining the bidirectional parent-child relationship for debugging
- *       and traversal purposes
+ * @note Block and function scopes are only reachable from their parent when
+ *       DEBUG_SCOPE_TREE is enabled, which keeps the per-scope footprint small
+ *       in normal builds
  *
  * @warning If memory allocation fails, this function may return NULL or
  *          an incompletely initialized scope. The caller should verify
@@ -271,16 +381,12 @@ Scope *create_child_scope(Scope *parent, const char *name,
   // Initialize the child scope with proper parent linkage
   init_scope(child, parent, name, arena);
 
-  // Add child to parent's children list for bidirectional relationship
+#ifdef DEBUG_SCOPE_TREE
+  // Keep the full tree around so debug_print_scope can walk it
   if (parent) {
-    // Get a slot in the parent's children array
-    Scope **child_ptr = (Scope **)growable_array_push(&parent->children);
-    if (child_ptr) {
-      *child_ptr = child; // Store pointer to child scope
-    }
-    // Note: If growable_array_push fails, the child is still valid
-    // but won't appear in the parent's children list
+    scope_attach_child(parent, child);
   }
+#endif
 
   return child;
 }
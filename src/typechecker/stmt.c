@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "../parser/parser.h"
 #include "type.h"
 
 bool typecheck_var_decl(AstNode *node, Scope *scope, ArenaAllocator *arena) {
@@ -42,14 +43,33 @@ bool typecheck_var_decl(AstNode *node, Scope *scope, ArenaAllocator *arena) {
                           arena);
 }
 
-// Stub implementations for remaining functions
 bool typecheck_func_decl(AstNode *node, Scope *scope, ArenaAllocator *arena) {
+  if (!typecheck_func_signature(node, scope, arena)) {
+    return false;
+  }
+  if (node->stmt.func_decl.reuse_object || node->stmt.func_decl.is_extern) {
+    return true; // Checked by the build that produced its object, or C
+  }
+  if (!parse_deferred_body(node, arena)) {
+    return false;
+  }
+  return typecheck_func_body(node, scope, NULL, arena);
+}
+
+/**
+ * @brief Validate a function's signature and declare it in @p scope
+ *
+ * This is the declaration half of function checking: it never looks at the
+ * body, so every signature in a module can be collected before any body is
+ * checked.
+ */
+bool typecheck_func_signature(AstNode *node, Scope *scope,
+                              ArenaAllocator *arena) {
   const char *name = node->stmt.func_decl.name;
   AstNode *return_type = node->stmt.func_decl.return_type;
   AstNode **param_types = node->stmt.func_decl.param_types;
   char **param_names = node->stmt.func_decl.param_names;
   size_t param_count = node->stmt.func_decl.param_count;
-  AstNode *body = node->stmt.func_decl.body;
   bool is_public = node->stmt.func_decl.is_public;
 
   // Validate return type
@@ -60,6 +80,12 @@ bool typecheck_func_decl(AstNode *node, Scope *scope, ArenaAllocator *arena) {
     return false;
   }
 
+  if (node->stmt.func_decl.is_extern && strcmp(name, "main") == 0) {
+    fprintf(stderr, "Error: Function 'main' cannot be extern at line %zu\n",
+            node->line);
+    return false;
+  }
+
   // Main function validation
   if (strcmp(name, "main") == 0) {
     if (strcmp(return_type->type_data.basic.name, "int") != 0) {
@@ -95,35 +121,63 @@ bool typecheck_func_decl(AstNode *node, Scope *scope, ArenaAllocator *arena) {
       arena, param_types, param_count, return_type, node->line, node->column);
 
   // Add function to current scope with proper visibility
-  if (!scope_add_symbol(scope, name, func_type, is_public, false, arena)) {
+  return scope_add_symbol(scope, name, func_type, is_public, false, arena);
+}
+
+/**
+ * @brief Check a function body against its already-declared signature
+ *
+ * Only reads the enclosing module scope, so bodies of different functions can
+ * be checked concurrently as long as each caller brings its own resolver and
+ * arena. A NULL @p resolver uses the one shared through the global scope.
+ *
+ * A body skimmed by the parser must have been parsed with
+ * parse_deferred_body() first, into an arena that outlives codegen.
+ */
+bool typecheck_func_body(AstNode *node, Scope *scope, Resolver *resolver,
+                         ArenaAllocator *arena) {
+  const char *name = node->stmt.func_decl.name;
+  AstNode **param_types = node->stmt.func_decl.param_types;
+  char **param_names = node->stmt.func_decl.param_names;
+  size_t param_count = node->stmt.func_decl.param_count;
+  AstNode *body = node->stmt.func_decl.body;
+
+  if (!body) {
+    fprintf(stderr, "Error: Body of function '%s' was never parsed\n", name);
     return false;
   }
 
   // Create function scope for parameters and body
-  Scope *func_scope = create_child_scope(scope, name, arena);
+  Scope func_frame;
+  Scope *func_scope =
+      resolver ? scope_push_frame(scope, &func_frame, name, resolver, arena)
+               : scope_push(scope, &func_frame, name, arena);
   func_scope->is_function_scope = true;
   func_scope->associated_node = node;
 
+  bool ok = true;
+
   // Add parameters to function scope (parameters are always local)
-  for (size_t i = 0; i < param_count; i++) {
+  for (size_t i = 0; ok && i < param_count; i++) {
     if (!scope_add_symbol(func_scope, param_names[i], param_types[i], false,
                           true, arena)) {
       fprintf(stderr,
               "Error: Could not add parameter '%s' to function '%s' scope\n",
               param_names[i], name);
-      return false;
+      ok = false;
     }
   }
 
   // Typecheck function body
-  if (body) {
+  if (ok && body) {
     if (!typecheck_statement(body, func_scope, arena)) {
       fprintf(stderr, "Error: Function '%s' body failed typechecking\n", name);
-      return false;
+      ok = false;
     }
   }
 
-  return true;
+  scope_pop(func_scope);
+  return ok;
 }
 
 bool typecheck_struct_decl(AstNode *node, Scope *scope, ArenaAllocator *arena) {
@@ -212,9 +266,6 @@ bool typecheck_return_decl(AstNode *node, Scope *scope, ArenaAllocator *arena) {
 }
 
 bool typecheck_if_decl(AstNode *node, Scope *scope, ArenaAllocator *arena) {
-  Scope *then_branch = create_child_scope(scope, "then_branch", arena);
-  Scope *else_branch = create_child_scope(scope, "else_branch", arena);
-
   Type *expected =
       create_basic_type(arena, "bool", node->stmt.if_stmt.condition->line,
                         node->stmt.if_stmt.condition->column);
@@ -228,6 +279,9 @@ bool typecheck_if_decl(AstNode *node, Scope *scope, ArenaAllocator *arena) {
     return false;
   }
 
+  Scope then_frame;
+  Scope *then_branch = scope_push(scope, &then_frame, "then_branch", arena);
+
   if (node->stmt.if_stmt.then_stmt != NULL) {
     typecheck_statement(node->stmt.if_stmt.then_stmt, then_branch, arena);
   }
@@ -238,8 +292,13 @@ bool typecheck_if_decl(AstNode *node, Scope *scope, ArenaAllocator *arena) {
     }
   }
 
+  scope_pop(then_branch);
+
   if (node->stmt.if_stmt.else_stmt != NULL) {
+    Scope else_frame;
+    Scope *else_branch = scope_push(scope, &else_frame, "else_branch", arena);
     typecheck_statement(node->stmt.if_stmt.else_stmt, else_branch, arena);
+    scope_pop(else_branch);
   }
 
   return true;
@@ -328,15 +387,18 @@ bool typecheck_use_stmt(AstNode *node, Scope *current_scope,
 
 bool typecheck_infinite_loop_decl(AstNode *node, Scope *scope,
                                   ArenaAllocator *arena) {
-  Scope *loop_scope = create_child_scope(scope, "infinite_loop", arena);
-
   if (node->stmt.loop_stmt.body == NULL) {
     fprintf(stderr, "Error: Loop body cannot be null at line %zu\n",
             node->line);
     return false;
   }
 
-  if (!typecheck_statement(node->stmt.loop_stmt.body, loop_scope, arena)) {
+  Scope loop_frame;
+  Scope *loop_scope = scope_push(scope, &loop_frame, "infinite_loop", arena);
+  bool ok = typecheck_statement(node->stmt.loop_stmt.body, loop_scope, arena);
+  scope_pop(loop_scope);
+
+  if (!ok) {
     fprintf(stderr, "Error: Loop body failed typechecking at line %zu\n",
             node->line);
     return false;
@@ -346,12 +408,16 @@ bool typecheck_infinite_loop_decl(AstNode *node, Scope *scope,
 }
 bool typecheck_while_loop_decl(AstNode *node, Scope *scope,
                                ArenaAllocator *arena) {
-  Scope *while_loop = create_child_scope(scope, "while_loop", arena);
+  (void)node;
+  (void)scope;
+  (void)arena;
   return true;
 }
 bool typecheck_for_loop_decl(AstNode *node, Scope *scope,
                              ArenaAllocator *arena) {
-  Scope *lookup_scope = create_child_scope(scope, "for_loop", arena);
+  (void)node;
+  (void)scope;
+  (void)arena;
   return true;
 }
 
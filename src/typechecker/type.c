@@ -38,6 +38,12 @@ TypeMatchResult types_match(AstNode *type1, AstNode *type2) {
             (strcmp(name1, "float") == 0 && strcmp(name2, "int") == 0)) {
             return TYPE_MATCH_COMPATIBLE;
         }
+
+        // String literals are typed "string"; both lower to a char pointer
+        if ((strcmp(name1, "str") == 0 && strcmp(name2, "string") == 0) ||
+            (strcmp(name1, "string") == 0 && strcmp(name2, "str") == 0)) {
+            return TYPE_MATCH_EXACT;
+        }
     }
     
     // Pointer type matching - recursively check pointee types
@@ -12,13 +12,26 @@
 
 #pragma once
 
+#include <stdint.h>
+
 #include "../ast/ast.h"
+#include "../ast/module_graph.h"
 #include "../c_libs/memory/memory.h"
+#include "../c_libs/thread/thread_pool.h"
 
 // ============================================================================
 // Data Structures
 // ============================================================================
 
+/** @brief Number of symbols a scope stores inline before touching the arena. */
+#define SCOPE_INLINE_SYMBOLS 4
+
+/** @brief Symbol count at which a scope starts keeping a hash index. */
+#define SCOPE_INDEX_THRESHOLD 16
+
+/** @brief Enable to keep every child scope linked for debug_print_scope(). */
+// #define DEBUG_SCOPE_TREE 1
+
 /**
  * @brief Represents a symbol with associated type and metadata.
  */
@@ -30,13 +43,43 @@ typedef struct {
   size_t scope_depth; /**< Nesting level for debugging */
 } Symbol;
 
+/** @brief Sentinel index meaning "no binding" in the flat resolver. */
+#define RESOLVER_NONE ((size_t)-1)
+
+/**
+ * @brief Flat symbol stack used for function-local scopes (see resolver.c).
+ */
+typedef struct Resolver {
+  GrowableArray entries; /**< Live bindings, innermost last (undo log) */
+  void *slots;           /**< Open-addressed interned name table */
+  size_t slot_capacity;  /**< Number of slots (power of two) */
+  size_t slot_count;     /**< Number of interned names */
+  ArenaAllocator *arena; /**< Arena backing the stack and table */
+} Resolver;
+
 /**
  * @brief Represents a lexical scope with hierarchical relationships.
+ *
+ * Most block and function scopes hold only a handful of symbols, so the first
+ * SCOPE_INLINE_SYMBOLS live inside the scope itself and the symbol array only
+ * spills into the arena once it outgrows them. Because `symbols` may point at
+ * `inline_symbols`, a scope must not be copied after init_scope().
+ *
+ * Only module scopes are recorded in their parent's `children` (needed by
+ * find_module_scope); block scopes are linked only with DEBUG_SCOPE_TREE.
+ *
+ * Function and block scopes opened with scope_push() are frames on a shared
+ * Resolver instead: they keep no symbols of their own and vanish again on
+ * scope_pop(). Defining DEBUG_SCOPE_TREE switches back to the retained tree.
+ *
+ * Once a scope holds SCOPE_INDEX_THRESHOLD symbols (module and global scopes
+ * of large programs) its symbols also get a hash index, so declaring and
+ * looking up n module-level names does not cost O(n^2) string compares.
  */
 typedef struct Scope {
   struct Scope *parent;   /**< Parent scope */
   GrowableArray symbols;  /**< Array of Symbol entries */
-  GrowableArray children; /**< Array of child scopes */
+  GrowableArray children; /**< Array of child scopes (allocated lazily) */
   const char *scope_name; /**< Debugging name (function, block, etc.) */
   size_t depth;           /**< Nesting depth from global scope */
   bool is_function_scope;
@@ -45,7 +88,18 @@ typedef struct Scope {
   // Module-related metadata
   bool is_module_scope;
   const char *module_name;
-  GrowableArray imported_modules;
+  GrowableArray imported_modules; /**< Allocated on first import */
+
+  // Flat resolver frames
+  Resolver *resolver;       /**< Resolver holding this frame's symbols */
+  size_t frame_base;        /**< Resolver stack height when the frame opened */
+  Resolver *local_resolver; /**< Resolver owned by the root scope */
+
+  // Hash index over `symbols`, built once the scope grows large
+  size_t *symbol_index;  /**< Open-addressed symbol positions + 1, or NULL */
+  size_t index_capacity; /**< Slots in symbol_index (power of two) */
+
+  Symbol inline_symbols[SCOPE_INLINE_SYMBOLS]; /**< Initial symbol storage */
 } Scope;
 
 /**
@@ -95,6 +149,18 @@ Scope *find_containing_module(Scope *scope);
 
 Scope *create_child_scope(Scope *parent, const char *name,
                           ArenaAllocator *arena);
+void scope_attach_child(Scope *parent, Scope *child);
+Scope *scope_push(Scope *parent, Scope *storage, const char *name,
+                  ArenaAllocator *arena);
+Scope *scope_push_frame(Scope *parent, Scope *storage, const char *name,
+                        Resolver *resolver, ArenaAllocator *arena);
+void scope_pop(Scope *scope);
+
+Resolver *resolver_create(ArenaAllocator *arena);
+uint64_t resolver_hash(const char *name);
+bool resolver_add_symbol(Scope *scope, const char *name, AstNode *type,
+                         bool is_public, bool is_mutable);
+Symbol *resolver_lookup(Scope *scope, const char *name, bool current_only);
 void debug_print_scope(Scope *scope, int indent_level);
 
 // ============================================================================
@@ -134,6 +200,12 @@ const char *type_to_string(AstNode *type, ArenaAllocator *arena);
 // ============================================================================
 
 bool typecheck(AstNode *node, Scope *scope, ArenaAllocator *arena);
+bool typecheck_program(AstNode *program, const ModuleGraph *graph,
+                       Scope *global_scope, ArenaAllocator *arena,
+                       ThreadPool *pool);
+bool typecheck_declarations(const ModuleGraph *graph, Scope *global_scope,
+                            ArenaAllocator *arena, Scope **scopes,
+                            bool *declared);
 AstNode *typecheck_expression(AstNode *expr, Scope *scope,
                               ArenaAllocator *arena);
 bool typecheck_statement(AstNode *stmt, Scope *scope, ArenaAllocator *arena);
@@ -141,6 +213,10 @@ bool typecheck_statement(AstNode *stmt, Scope *scope, ArenaAllocator *arena);
 // Declarations
 bool typecheck_var_decl(AstNode *node, Scope *scope, ArenaAllocator *arena);
 bool typecheck_func_decl(AstNode *node, Scope *scope, ArenaAllocator *arena);
+bool typecheck_func_signature(AstNode *node, Scope *scope,
+                              ArenaAllocator *arena);
+bool typecheck_func_body(AstNode *node, Scope *scope, Resolver *resolver,
+                         ArenaAllocator *arena);
 bool typecheck_struct_decl(AstNode *node, Scope *scope, ArenaAllocator *arena);
 bool typecheck_enum_decl(AstNode *node, Scope *scope, ArenaAllocator *arena);
 bool typecheck_return_decl(AstNode *node, Scope *scope, ArenaAllocator *arena);